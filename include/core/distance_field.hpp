@@ -0,0 +1,73 @@
+#pragma once
+
+#include <eigen3/Eigen/Dense>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Float channel over a voxel lattice holding distances in world units
+ *
+ * Laid out like a VoxelGrid (x fastest, then y, then z) so that a field and
+ * the grid it was computed from share positions. Optionally stores, per
+ * voxel, the linear index of the voxel its distance was measured to.
+ */
+class DistanceField {
+public:
+    // Distance of voxels with nothing to measure to
+    static constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+    DistanceField(float resolution,
+                  const Eigen::Vector3f& min_bounds,
+                  const Eigen::Vector3i& dimensions,
+                  bool with_nearest = false);
+
+    float resolution() const { return resolution_; }
+    const Eigen::Vector3f& min_bounds() const { return min_bounds_; }
+    const Eigen::Vector3i& dimensions() const { return dimensions_; }
+
+    size_t index(int x, int y, int z) const {
+        return (static_cast<size_t>(z) * dimensions_.y() + y) * dimensions_.x() + x;
+    }
+    Eigen::Vector3i position(size_t index) const;
+
+    bool is_valid_position(const Eigen::Vector3i& position) const {
+        return (position.array() >= 0).all() && (position.array() < dimensions_.array()).all();
+    }
+
+    // Distance at a voxel; no bounds check
+    float get(int x, int y, int z) const { return distances_[index(x, y, z)]; }
+    float get(const Eigen::Vector3i& position) const { return get(position.x(), position.y(), position.z()); }
+    void set(int x, int y, int z, float distance) { distances_[index(x, y, z)] = distance; }
+
+    /**
+     * @brief Distance at the voxel containing a world position
+     * @throws std::out_of_range if the position is outside the field
+     */
+    float distance_at(const Eigen::Vector3f& world_pos) const;
+
+    /**
+     * @brief Voxel the distance at position was measured to
+     * @return (-1, -1, -1) if there is none or the field has no nearest channel
+     */
+    Eigen::Vector3i nearest(const Eigen::Vector3i& position) const;
+    bool has_nearest() const { return !nearest_.empty(); }
+
+    // Raw channels, see index()
+    std::vector<float>& distances() { return distances_; }
+    const std::vector<float>& distances() const { return distances_; }
+    std::vector<int32_t>& nearest_indices() { return nearest_; }
+    const std::vector<int32_t>& nearest_indices() const { return nearest_; }
+
+private:
+    float resolution_;
+    Eigen::Vector3f min_bounds_;
+    Eigen::Vector3i dimensions_;
+    std::vector<float> distances_;
+    // Linear voxel index, -1 for none; empty unless requested
+    std::vector<int32_t> nearest_;
+};
+
+} // namespace VXZ
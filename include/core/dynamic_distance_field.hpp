@@ -0,0 +1,139 @@
+#pragma once
+
+#include "voxel_grid.hpp"
+#include "distance_field.hpp"
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Euclidean distance field kept up to date from voxel change sets
+ *
+ * Follows the dynamic EDT of Lau et al.: every voxel stores its squared
+ * distance and the obstacle voxel it was measured to. Voxels that become
+ * occupied start lower waves. Voxels that become free invalidate the voxels
+ * measured to them (kept in a list per obstacle voxel, so none are searched
+ * for) and start raise waves from them, and the gap is refilled by
+ * lower waves from the intact frontier. Both waves run in one queue bucketed
+ * by squared distance and over the 26-neighbourhood, and stop wherever
+ * distances do not change, so an update costs in proportion to the region
+ * whose distance changed.
+ *
+ * Distances beyond max_distance are not propagated and read as kInfinity,
+ * which also bounds the cost of an update.
+ */
+class DynamicDistanceField {
+public:
+    DynamicDistanceField(float resolution,
+                         const Eigen::Vector3f& min_bounds,
+                         const Eigen::Vector3i& dimensions,
+                         float max_distance = DistanceField::kInfinity);
+
+    /**
+     * @brief Field of grid's occupied voxels, on grid's lattice
+     *
+     * Initialized with a full DistanceTransformOperator pass.
+     */
+    explicit DynamicDistanceField(const VoxelGrid& grid, float max_distance = DistanceField::kInfinity);
+
+    float resolution() const { return occupancy_.resolution(); }
+    const Eigen::Vector3f& min_bounds() const { return occupancy_.min_bounds(); }
+    const Eigen::Vector3i& dimensions() const { return occupancy_.dimensions(); }
+    float max_distance() const { return max_distance_; }
+
+    /**
+     * @brief Queue a voxel change; takes effect on the next update()
+     * @throws std::out_of_range if position is outside the field
+     */
+    void set_occupied(const Eigen::Vector3i& position);
+    void set_free(const Eigen::Vector3i& position);
+
+    /**
+     * @brief Propagate the queued changes
+     * @return Number of voxels taken from the queue
+     */
+    size_t update();
+
+    /**
+     * @brief Queue a change set and propagate it; freed voxels are applied first
+     */
+    size_t update(const std::vector<Eigen::Vector3i>& occupied, const std::vector<Eigen::Vector3i>& freed);
+
+    /**
+     * @brief Queue every voxel where grid differs from the field, and propagate
+     *
+     * The difference is taken word by word on the packed rows.
+     * @throws std::invalid_argument if grid has other dimensions
+     */
+    size_t update(const VoxelGrid& grid);
+
+    bool is_occupied(const Eigen::Vector3i& position) const { return occupancy_.get(position); }
+
+    // Distance in world units at a voxel, as of the last update
+    float get(const Eigen::Vector3i& position) const;
+    float get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+
+    /**
+     * @brief Distance at the voxel containing a world position
+     * @throws std::out_of_range if the position is outside the field
+     */
+    float distance_at(const Eigen::Vector3f& world_pos) const;
+
+    /**
+     * @brief Obstacle voxel the distance at position is measured to, (-1, -1, -1) if none
+     */
+    Eigen::Vector3i nearest(const Eigen::Vector3i& position) const;
+
+    // Occupancy as of the queued changes
+    const VoxelGrid& occupancy() const { return occupancy_; }
+
+    // Snapshot as a static field, with the nearest channel
+    DistanceField to_distance_field() const;
+
+private:
+    // Squared distance of voxels without an obstacle in range
+    static constexpr int32_t kUnreached = std::numeric_limits<int32_t>::max();
+
+    /**
+     * @brief Priority queue with one bucket per squared distance
+     */
+    class BucketQueue {
+    public:
+        bool empty() const { return size_ == 0; }
+        void push(int32_t key, int32_t index);
+        int32_t pop();
+
+    private:
+        std::vector<std::vector<int32_t>> buckets_;
+        size_t next_ = 0;
+        size_t size_ = 0;
+    };
+
+    VoxelGrid occupancy_;
+    float max_distance_;
+    int32_t max_squared_;
+    std::vector<int32_t> squared_;
+    // Linear index of the obstacle voxel, -1 for none
+    std::vector<int32_t> site_;
+    std::vector<uint8_t> raise_;
+    // Per obstacle voxel, a doubly linked list of the voxels measured to it:
+    // the first one, then next_/previous_ per voxel; -1 ends a list
+    std::vector<int32_t> first_;
+    std::vector<int32_t> next_;
+    std::vector<int32_t> previous_;
+    BucketQueue queue_;
+
+    int32_t index(const Eigen::Vector3i& position) const {
+        const Eigen::Vector3i& dims = occupancy_.dimensions();
+        return (position.z() * dims.y() + position.y()) * dims.x() + position.x();
+    }
+    Eigen::Vector3i position(int32_t index) const;
+    // Set site_[voxel], moving the voxel between the obstacles' lists
+    void assign(int32_t voxel, int32_t site);
+
+    void initialize();
+    void raise(int32_t index);
+    void lower(int32_t index);
+};
+
+} // namespace VXZ
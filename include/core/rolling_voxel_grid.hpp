@@ -0,0 +1,97 @@
+#pragma once
+
+#include "voxel_grid.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Fixed-size VoxelGrid window that scrolls in voxel steps
+ *
+ * The voxels live in a VoxelGrid used as a ring buffer: logical position p
+ * is stored at (p + offset) mod dimensions, and scroll() only moves the
+ * offset and clears the slabs that enter the window. Voxels that stay in the
+ * window are neither moved nor copied, so the cost of a scroll is the size
+ * of the exposed slabs.
+ *
+ * Positions passed to get/set and returned by world_to_grid are logical,
+ * relative to the current min_bounds().
+ */
+class RollingVoxelGrid {
+public:
+    RollingVoxelGrid(float resolution,
+                     const Eigen::Vector3f& min_bounds,
+                     const Eigen::Vector3f& max_bounds);
+
+    float resolution() const { return storage_.resolution(); }
+    const Eigen::Vector3i& dimensions() const { return storage_.dimensions(); }
+
+    // Bounds of the current window
+    Eigen::Vector3f min_bounds() const;
+    Eigen::Vector3f max_bounds() const;
+
+    // Voxel steps scrolled since construction
+    const Eigen::Vector3i& offset() const { return offset_; }
+
+    // Grid access, as VoxelGrid; throws std::out_of_range outside the window
+    bool get(const Eigen::Vector3i& position) const;
+    void set(const Eigen::Vector3i& position, bool value);
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+    void set(int x, int y, int z, bool value) { set(Eigen::Vector3i(x, y, z), value); }
+
+    void fill(bool value = true) { storage_.fill(value); }
+    void clear() { fill(false); }
+    void set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value = true);
+
+    bool is_valid_position(const Eigen::Vector3i& position) const {
+        return storage_.is_valid_position(position);
+    }
+
+    // Coordinate conversion for the current window
+    Eigen::Vector3i world_to_grid(const Eigen::Vector3f& world_pos) const;
+    Eigen::Vector3f grid_to_world(const Eigen::Vector3i& grid_pos) const;
+
+    /**
+     * @brief Move the window by whole voxels
+     *
+     * Voxels inside both windows keep their values; the slabs that enter the
+     * window are cleared. Steps of a full dimension or more clear everything.
+     */
+    void scroll(const Eigen::Vector3i& steps);
+
+    /**
+     * @brief Scroll so that a world position falls in the central voxel
+     */
+    void recenter(const Eigen::Vector3f& world_pos);
+
+    // Position of a logical voxel in storage()
+    Eigen::Vector3i storage_position(const Eigen::Vector3i& position) const;
+
+    // The ring buffer; its own bounds are those of the initial window
+    const VoxelGrid& storage() const { return storage_; }
+
+    /**
+     * @brief Copy of the window as a regular VoxelGrid
+     */
+    VoxelGrid to_voxel_grid() const;
+
+    size_t count_occupied() const { return storage_.count_occupied(); }
+
+private:
+    VoxelGrid storage_;
+    Eigen::Vector3i offset_;
+    // offset_ reduced modulo the dimensions
+    Eigen::Vector3i wrap_;
+
+    /**
+     * @brief Visit the storage ranges [begin, end) of logical range [first, last) along an axis
+     */
+    template <typename Visitor>
+    void for_each_storage_range(int axis, int first, int last, Visitor&& visitor) const;
+
+    /**
+     * @brief Set the box [min, max) of the window, clamped to it
+     */
+    void set_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value);
+};
+
+} // namespace VXZ
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <cstdint>
 
 namespace VXZ  {
 
@@ -67,6 +68,26 @@ public:
     void fill(bool value = true);
     void clear() { fill(false); }
     void set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value = true);
+
+    // Set voxels [x_begin, x_end) of row (y, z); the span is clamped to the grid
+    void set_span(int y, int z, int x_begin, int x_end, bool value = true);
+
+    // Packed storage: each x-row is bit-packed into 64-bit words and starts on
+    // a word boundary, so rows never share a word. Bits past the end of a row
+    // are kept zero.
+    static constexpr int kWordBits = 64;
+    size_t words_per_row() const { return words_per_row_; }
+    uint64_t* row_data(int y, int z) {
+        return words_.data() + (static_cast<size_t>(z) * dimensions_.y() + y) * words_per_row_;
+    }
+    const uint64_t* row_data(int y, int z) const {
+        return words_.data() + (static_cast<size_t>(z) * dimensions_.y() + y) * words_per_row_;
+    }
+    // Mask of the valid bits in the last word of a row
+    uint64_t row_tail_mask() const {
+        int tail = dimensions_.x() % kWordBits;
+        return tail == 0 ? ~uint64_t(0) : (uint64_t(1) << tail) - 1;
+    }
     
     // Grid validation
     bool is_valid_position(const Eigen::Vector3i& position) const;
@@ -90,8 +111,9 @@ private:
     Eigen::Vector3f max_bounds_;
     Eigen::Vector3i dimensions_;
     
-    // CPU data
-    std::vector<bool> data_;
+    // CPU data, packed rows (see row_data)
+    size_t words_per_row_;
+    std::vector<uint64_t> words_;
     
     // Helper methods
     void initialize();
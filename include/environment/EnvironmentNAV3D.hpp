@@ -5,8 +5,15 @@
 #include <sbpl/discrete_space_information/environment.h>
 #include <vector>
 #include <string>
+#include <memory>
+#include <cmath>
+#include <algorithm>
 #include <octomap/OcTree.h>
 #include <openvdb/openvdb.h>
+#include "core/voxel_grid.hpp"
+#include "storage/chunked_map.hpp"
+#include "storage/vdb_tree_storage.hpp"
+#include "core/dynamic_distance_field.hpp"
 
 // 3D grid environment class for SBPL with serialization support
 class EnvironmentNAV3D : public DiscreteSpaceInformation {
@@ -24,10 +31,42 @@ public:
     void SetStart(double wx, double wy, double wz);
     void SetGoal(double wx, double wy, double wz);
     void SetObstacle(int ix, int iy, int iz);
+    // Occupy the inclusive box of cells, clipped to the grid, a row span at
+    // a time rather than cell by cell
+    void SetObstacleBox(int ix0, int iy0, int iz0, int ix1, int iy1, int iz1);
+    void ClearObstacle(int ix, int iy, int iz);
 
+    // Keep occupancy in a chunked world map instead of the dense grid. The
+    // map is not owned; cells map to the map voxels at their centres, and
+    // SetStart() moves the map focus. Pass nullptr to go back to a fresh grid.
+    void SetChunkedMap(VXZ::ChunkedMap* map);
+    VXZ::ChunkedMap* GetChunkedMap() const { return map_; }
+    bool IsOccupied(int ix, int iy, int iz) const;
+
+    // Keep a distance field over the cells, seeded from the current
+    // occupancy. SetObstacle/ClearObstacle queue changes into it and
+    // UpdateDistanceField() propagates them, e.g. once per scan. Distances
+    // beyond max_distance read as infinite. Returns false, and keeps no
+    // field, while a chunked map is attached; attaching one drops it.
+    bool EnableDistanceField(double max_distance);
+    void UpdateDistanceField();
+    const VXZ::DynamicDistanceField* GetDistanceField() const { return distance_field_.get(); }
+    // Distance to the nearest obstacle cell; 0 outside the grid, infinite
+    // without a distance field
+    double GetClearance(int ix, int iy, int iz) const;
+    // Successors closer than this to an obstacle are pruned; needs the field
+    void SetMinClearance(double clearance) { min_clearance_ = clearance; }
+
+    // Exports visit the occupied cells only; with a chunked map, spilled
+    // chunks are read one at a time without becoming resident
     bool LoadFromOctoMap(const std::string& filename);
     bool SaveToOctoMap(const std::string& filename) const;
+    // Active tiles of the grid are filled as boxes
     bool LoadFromOpenVDB(const std::string& filename, const std::string& gridName = "Occupancy");
+    // Read the grid into a VDB tree on this environment's cells instead,
+    // keeping its tiles as tiles; the environment itself is left alone
+    bool LoadFromOpenVDB(const std::string& filename, VXZ::VDBTreeStorage& tree,
+                         const std::string& gridName = "Occupancy") const;
     bool SaveToOpenVDB(const std::string& filename, const std::string& gridName = "Occupancy") const;
 
     int GetFromToHeuristic(int stateID_from, int stateID_to) override;
@@ -40,16 +79,64 @@ private:
     double minx_, maxx_, miny_, maxy_, minz_, maxz_, resolution_;
     int size_x_, size_y_, size_z_;
     HeuristicType h_type_;
-    std::vector<char> grid_;
+    // Packed occupancy; nullptr while a chunked map is attached
+    std::unique_ptr<VXZ::VoxelGrid> grid_;
+    VXZ::ChunkedMap* map_;
+    std::unique_ptr<VXZ::DynamicDistanceField> distance_field_;
+    double min_clearance_;
     int startID_, goalID_;
     std::vector<std::tuple<int,int,int,int>> motions_;
 
     inline int ToIndex(int ix, int iy, int iz) const;
     inline void FromIndex(int idx, int& ix, int& iy, int& iz) const;
+    Eigen::Vector3i ToMapVoxel(int ix, int iy, int iz) const;
+    std::unique_ptr<VXZ::VoxelGrid> MakeGrid() const;
+    // Calls visitor(ix, iy, iz) for every occupied cell
+    template <typename Visitor>
+    void ForEachOccupied(Visitor&& visitor) const;
     int ComputeHeuristic(int ix, int iy, int iz, int gx, int gy, int gz) const;
     void InitMotionPrimitives(bool use_26_neighbors);
 };
 
+template <typename Visitor>
+void EnvironmentNAV3D::ForEachOccupied(Visitor&& visitor) const
+{
+    if (map_)
+    {
+        // A cell is occupied when the map voxel at its centre is; test the
+        // cells overlapping each occupied voxel, whichever grid is finer
+        const double map_res = map_->resolution();
+        map_->for_each_occupied(ToMapVoxel(0, 0, 0), ToMapVoxel(size_x_ - 1, size_y_ - 1, size_z_ - 1),
+                                [&](const Eigen::Vector3i &v)
+                                {
+                                    const Eigen::Vector3d lo = v.cast<double>() * map_res;
+                                    const Eigen::Vector3d hi = lo + Eigen::Vector3d::Constant(map_res);
+                                    const int x0 = std::max(static_cast<int>(std::floor((lo.x() - minx_) / resolution_)), 0);
+                                    const int y0 = std::max(static_cast<int>(std::floor((lo.y() - miny_) / resolution_)), 0);
+                                    const int z0 = std::max(static_cast<int>(std::floor((lo.z() - minz_) / resolution_)), 0);
+                                    const int x1 = std::min(static_cast<int>(std::floor((hi.x() - minx_) / resolution_)), size_x_ - 1);
+                                    const int y1 = std::min(static_cast<int>(std::floor((hi.y() - miny_) / resolution_)), size_y_ - 1);
+                                    const int z1 = std::min(static_cast<int>(std::floor((hi.z() - minz_) / resolution_)), size_z_ - 1);
+                                    for (int iz = z0; iz <= z1; ++iz)
+                                        for (int iy = y0; iy <= y1; ++iy)
+                                            for (int ix = x0; ix <= x1; ++ix)
+                                                if (ToMapVoxel(ix, iy, iz) == v)
+                                                    visitor(ix, iy, iz);
+                                });
+        return;
+    }
+
+    // Scan whole words of the packed rows; padding bits are always clear
+    for (int iz = 0; iz < size_z_; ++iz)
+        for (int iy = 0; iy < size_y_; ++iy)
+        {
+            const uint64_t *row = grid_->row_data(iy, iz);
+            for (size_t w = 0; w < grid_->words_per_row(); ++w)
+                for (uint64_t word = row[w]; word; word &= word - 1)
+                    visitor(static_cast<int>(w) * VXZ::VoxelGrid::kWordBits + __builtin_ctzll(word), iy, iz);
+        }
+}
+
 #endif // ENVIRONMENT_NAV3D_H
 
 
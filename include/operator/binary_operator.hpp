@@ -5,12 +5,21 @@
 
 namespace VXZ {
 
+/**
+ * @brief Word-level boolean operations shared by the binary operators
+ */
+enum class BooleanOp { UNION, INTERSECTION, DIFFERENCE, XOR };
+
 /**
  * @brief Base class for binary operators that operate on two VoxelGrid objects
  * 
  * This class defines the interface for binary operators that take two VoxelGrid objects
  * as input and produce a new VoxelGrid as output. Derived classes should implement
  * the specific operation logic in the apply() method.
+ *
+ * The grids may differ in extent as long as they share the resolution and
+ * their voxels line up. The result always has the extent of the first grid;
+ * the second grid is read on the overlap and counts as empty elsewhere.
  */
 class BinaryOperator {
 public:
@@ -26,6 +35,27 @@ public:
      */
     virtual std::unique_ptr<VoxelGrid> apply(const VoxelGrid& grid1, const VoxelGrid& grid2) = 0;
 
+    /**
+     * @brief Apply the operation with the result written over the first grid
+     */
+    virtual void apply_in_place(VoxelGrid& grid1, const VoxelGrid& grid2) = 0;
+
+    /**
+     * @brief Position of the first voxel of grid2 in grid1
+     * @throws std::invalid_argument if the resolutions differ or the voxels do not line up
+     */
+    static Eigen::Vector3i alignmentOffset(const VoxelGrid& grid1, const VoxelGrid& grid2);
+
+    /**
+     * @brief Read row (y, z) of grid1's frame from an aligned grid
+     *
+     * @param offset Position of the first voxel of grid in the frame, as alignmentOffset
+     * @param width Row length of the frame in voxels
+     * @param out Receives the packed row; voxels outside grid read as empty
+     */
+    static void loadAlignedRow(const VoxelGrid& grid, const Eigen::Vector3i& offset,
+                               int y, int z, int width, uint64_t* out);
+
 protected:
     /**
      * @brief Create a new VoxelGrid with the same parameters as the input grids
@@ -55,6 +85,13 @@ protected:
                grid1.max_bounds() == grid2.max_bounds() &&
                grid1.dimensions() == grid2.dimensions();
     }
+
+    /**
+     * @brief result = grid1 op grid2, one packed word at a time, rows in parallel
+     *
+     * result must have the extent of grid1 and may be grid1 itself.
+     */
+    static void combine(const VoxelGrid& grid1, const VoxelGrid& grid2, BooleanOp op, VoxelGrid& result);
 };
 
 } // namespace VXZ 
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include "morphology.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Closing operator for VoxelGrid objects
+ *
+ * Dilation followed by erosion with the same element: fills holes and gaps
+ * smaller than the element, e.g. to clean noisy LiDAR maps. Both steps run
+ * fused per brick, see closing().
+ */
+class ClosingOperator : public GridOperator {
+public:
+    /**
+     * @throws std::invalid_argument if radius is negative
+     */
+    explicit ClosingOperator(int radius, StructuringElement element = StructuringElement::BOX);
+    ~ClosingOperator() override = default;
+
+    bool apply(VoxelGrid& grid) const override;
+    int stencil_radius() const override { return 2 * radius_; }
+
+    int radius() const { return radius_; }
+    StructuringElement element() const { return element_; }
+
+private:
+    int radius_;
+    StructuringElement element_;
+};
+
+} // namespace VXZ
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../core/voxel_grid.hpp"
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Neighbourhoods for connected components: face, face or edge, or any touching voxel
+ */
+enum class Connectivity { SIX = 6, EIGHTEEN = 18, TWENTY_SIX = 26 };
+
+/**
+ * @brief Size and extent of one component
+ */
+struct ComponentStats {
+    size_t voxel_count = 0;
+    // Inclusive voxel bounds
+    Eigen::Vector3i min = Eigen::Vector3i::Constant(std::numeric_limits<int>::max());
+    Eigen::Vector3i max = Eigen::Vector3i::Constant(-1);
+};
+
+/**
+ * @brief Label channel and per-component statistics
+ *
+ * Labels are laid out like a VoxelGrid (x fastest, then y, then z). Empty
+ * voxels have label 0; components are numbered from 1 in the order their
+ * first voxel appears in that layout.
+ */
+struct ConnectedComponents {
+    Eigen::Vector3i dimensions = Eigen::Vector3i::Zero();
+    std::vector<int32_t> labels;
+    // Statistics of label l at components[l - 1]
+    std::vector<ComponentStats> components;
+
+    size_t count() const { return components.size(); }
+    int32_t label(int x, int y, int z) const {
+        return labels[(static_cast<size_t>(z) * dimensions.y() + y) * dimensions.x() + x];
+    }
+    int32_t label(const Eigen::Vector3i& position) const {
+        return label(position.x(), position.y(), position.z());
+    }
+};
+
+/**
+ * @brief Connected-component labeling of the occupied voxels of a VoxelGrid
+ *
+ * Works on runs of occupied voxels extracted from the packed rows, so the
+ * union-find has one element per run rather than per voxel. Bricks of z
+ * slices are linked in parallel, each on its own runs; the runs across brick
+ * borders are then merged in parallel with a lock-free union-find (CAS
+ * linking of the larger root under the smaller, with path halving).
+ */
+class ConnectedComponentsOperator {
+public:
+    explicit ConnectedComponentsOperator(Connectivity connectivity = Connectivity::TWENTY_SIX)
+        : connectivity_(connectivity) {}
+
+    ConnectedComponents apply(const VoxelGrid& grid) const;
+
+    Connectivity connectivity() const { return connectivity_; }
+
+private:
+    Connectivity connectivity_;
+};
+
+} // namespace VXZ
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "binary_operator.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Difference operator for VoxelGrid objects
+ * 
+ * This operator performs a logical AND NOT operation between two VoxelGrid objects.
+ * The result is a new VoxelGrid where a voxel is occupied if it is occupied
+ * in the first grid but not in the second.
+ */
+class DifferenceOperator : public BinaryOperator {
+public:
+    DifferenceOperator() = default;
+    ~DifferenceOperator() override = default;
+
+    std::unique_ptr<VoxelGrid> apply(const VoxelGrid& grid1, const VoxelGrid& grid2) override;
+    void apply_in_place(VoxelGrid& grid1, const VoxelGrid& grid2) override;
+};
+
+} // namespace VXZ 
\ No newline at end of file
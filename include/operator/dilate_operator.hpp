@@ -0,0 +1,36 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include "morphology.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Dilation operator for VoxelGrid objects
+ *
+ * A voxel becomes occupied if the structuring element centred on it touches
+ * an occupied voxel. Inflating obstacles by the robot radius is a dilation
+ * with a SPHERE (or BOX, for a conservative bound) of that radius.
+ * See dilate() for the algorithm; the cost grows at most logarithmically
+ * with the radius.
+ */
+class DilateOperator : public GridOperator {
+public:
+    /**
+     * @throws std::invalid_argument if radius is negative
+     */
+    explicit DilateOperator(int radius, StructuringElement element = StructuringElement::BOX);
+    ~DilateOperator() override = default;
+
+    bool apply(VoxelGrid& grid) const override;
+    int stencil_radius() const override { return radius_; }
+
+    int radius() const { return radius_; }
+    StructuringElement element() const { return element_; }
+
+private:
+    int radius_;
+    StructuringElement element_;
+};
+
+} // namespace VXZ
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../core/voxel_grid.hpp"
+#include "../core/distance_field.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Exact Euclidean distance transform of a VoxelGrid
+ *
+ * Computes, for every voxel, the distance between voxel centres to the
+ * nearest occupied voxel (zero on occupied voxels), in world units. The
+ * squared distance is separable, so it is computed with three passes of
+ * the Felzenszwalb-Huttenlocher lower envelope of parabolas, along x, y and
+ * z in turn; each pass is linear in the line length and the lines of a pass
+ * are processed in parallel.
+ *
+ * In signed mode occupied voxels instead hold minus the distance to the
+ * nearest free voxel. With the nearest channel, every voxel also records the
+ * voxel its distance was measured to.
+ */
+class DistanceTransformOperator {
+public:
+    explicit DistanceTransformOperator(bool signed_distance = false, bool compute_nearest = false)
+        : signed_distance_(signed_distance), compute_nearest_(compute_nearest) {}
+
+    /**
+     * @brief Distance field of grid, with grid's lattice
+     *
+     * Voxels with nothing to measure to (e.g. an empty grid) get kInfinity.
+     */
+    DistanceField apply(const VoxelGrid& grid) const;
+
+    bool signed_distance() const { return signed_distance_; }
+    bool compute_nearest() const { return compute_nearest_; }
+
+private:
+    bool signed_distance_;
+    bool compute_nearest_;
+};
+
+} // namespace VXZ
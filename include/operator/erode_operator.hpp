@@ -0,0 +1,35 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include "morphology.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Erosion operator for VoxelGrid objects
+ *
+ * A voxel stays occupied only if the structuring element centred on it lies
+ * entirely in occupied voxels; voxels outside the grid count as occupied.
+ * See erode() for the algorithm; the cost grows at most logarithmically
+ * with the radius.
+ */
+class ErodeOperator : public GridOperator {
+public:
+    /**
+     * @throws std::invalid_argument if radius is negative
+     */
+    explicit ErodeOperator(int radius, StructuringElement element = StructuringElement::BOX);
+    ~ErodeOperator() override = default;
+
+    bool apply(VoxelGrid& grid) const override;
+    int stencil_radius() const override { return radius_; }
+
+    int radius() const { return radius_; }
+    StructuringElement element() const { return element_; }
+
+private:
+    int radius_;
+    StructuringElement element_;
+};
+
+} // namespace VXZ
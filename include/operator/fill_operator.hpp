@@ -0,0 +1,42 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Flood fill operator for VoxelGrid objects
+ *
+ * Without seeds, fills every empty region that is not face-connected to the
+ * grid border, which turns the closed shell of a surface voxelization into
+ * a solid. With seeds, fills the empty regions face-connected to them.
+ *
+ * The flood runs on the packed rows: a row takes the empty spans that touch
+ * reached voxels of its own or of the four neighbouring rows. Rows are
+ * grouped into bricks that converge locally in parallel; between rounds the
+ * rows bordering each brick are exchanged, and only bricks that received
+ * new voxels run again, so the work follows the wavefront.
+ */
+class FillOperator : public GridOperator {
+public:
+    FillOperator() = default;
+    explicit FillOperator(std::vector<Eigen::Vector3i> seeds) : seeds_(std::move(seeds)) {}
+    ~FillOperator() override = default;
+
+    bool apply(VoxelGrid& grid) const override;
+
+    /**
+     * @brief Empty voxels face-connected to the seeds, or to the border without seeds
+     *
+     * Seeds outside the grid or on occupied voxels are ignored.
+     */
+    VoxelGrid reachable(const VoxelGrid& grid) const;
+
+    const std::vector<Eigen::Vector3i>& seeds() const { return seeds_; }
+
+private:
+    std::vector<Eigen::Vector3i> seeds_;
+};
+
+} // namespace VXZ
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "binary_operator.hpp"
+#include "morphology.hpp"
+#include <memory>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Boolean expression over VoxelGrids evaluated in one fused pass
+ *
+ * Expressions are built from grids with |, &, - (difference), ^ and ~ and
+ * keep references to their grids, which must outlive them. evaluate()
+ * compiles the tree to a small postfix program and runs it row by row: each
+ * instruction works on whole packed rows held in a per-thread register
+ * stack, so no intermediate grid is allocated however many layers are
+ * combined. Rows are split across threads.
+ *
+ * dilated() and eroded() nodes need neighbouring rows, so an expression
+ * with them is evaluated by bricks of rows instead, as opening() is: each
+ * stencil node evaluates its operand into a tile of the brick grown by its
+ * radius, applies dilate() or erode() to the tile and feeds the brick's rows
+ * to the row program above it. Bricks are max(32, 4h) rows a side, where h
+ * is the largest sum of radii along a path of nested stencils; only the
+ * tiles are allocated, plus the result grid when it is one of the grids.
+ *
+ * As with BinaryOperator, the grids may differ in extent if they share the
+ * resolution and voxel lattice; outside its extent a grid reads as empty.
+ */
+class GridExpression {
+public:
+    /**
+     * @brief Leaf referencing a grid
+     */
+    GridExpression(const VoxelGrid& grid);
+
+    friend GridExpression operator|(const GridExpression& lhs, const GridExpression& rhs);
+    friend GridExpression operator&(const GridExpression& lhs, const GridExpression& rhs);
+    friend GridExpression operator-(const GridExpression& lhs, const GridExpression& rhs);
+    friend GridExpression operator^(const GridExpression& lhs, const GridExpression& rhs);
+    friend GridExpression operator~(const GridExpression& operand);
+
+    /**
+     * @brief Union or intersection of a list of expressions
+     * @throws std::invalid_argument if the list is empty
+     */
+    static GridExpression union_of(const std::vector<GridExpression>& operands);
+    static GridExpression intersection_of(const std::vector<GridExpression>& operands);
+
+    /**
+     * @brief Dilation or erosion of this expression
+     *
+     * Matches dilate() and erode() on the expression evaluated over the
+     * result extent: beyond it voxels read as empty when dilating and as
+     * occupied when eroding.
+     * @throws std::invalid_argument if radius is negative
+     */
+    GridExpression dilated(StructuringElement element, int radius) const;
+    GridExpression eroded(StructuringElement element, int radius) const;
+
+    /**
+     * @brief Evaluate over the extent of the leftmost grid
+     */
+    std::unique_ptr<VoxelGrid> evaluate() const;
+
+    /**
+     * @brief Evaluate over the extent of result, which may be one of the grids
+     * @throws std::invalid_argument if a grid is not aligned with result
+     */
+    void evaluate_into(VoxelGrid& result) const;
+
+    /**
+     * @brief Number of grid references in the expression, stencil operands included
+     */
+    size_t leaf_count() const;
+
+private:
+    struct Node;
+    std::shared_ptr<const Node> node_;
+
+    explicit GridExpression(std::shared_ptr<const Node> node);
+    static GridExpression combine(BooleanOp op, const GridExpression& lhs, const GridExpression& rhs);
+};
+
+} // namespace VXZ
@@ -1,51 +1,185 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
 #include <eigen3/Eigen/Dense>
 #include <tbb/parallel_for.h>
-#include <tbb/blocked_range3d.h>
+#include <tbb/blocked_range2d.h>
 #include "../core/voxel_grid.hpp"
-// #include "operator/SmoothOperator.hpp"
-// #include "operator/DilateOperator.hpp"
-// #include "operator/ErodeOperator.hpp"
-// #include "operator/OffsetOperator.hpp"
-// #include "operator/UnionOperator.hpp"
-// #include "operator/IntersectionOperator.hpp"
-// #include "operator/DifferenceOperator.hpp"
-// #include "operator/OpeningOperator.hpp"
-// #include "operator/ClosingOperator.hpp"
-// #include "operator/DistanceTransformOperator.hpp"
-// #include "operator/ConnectedComponentsOperator.hpp"
-// #include "operator/FillOperator.hpp"
-// #include "operator/InterpolationOperator.hpp"
 
+namespace VXZ {
 
+/**
+ * @brief Rows of a brick in GridOperator::parallel_apply_bricks
+ *
+ * The brick writes rows y in [y_begin, y_end), z in [z_begin, z_end), and
+ * may read rows y in [halo_y_begin, halo_y_end), z in [halo_z_begin,
+ * halo_z_end): the brick grown by the halo and clipped to the grid.
+ */
+struct GridBrick {
+    int y_begin, y_end, z_begin, z_end;
+    int halo_y_begin, halo_y_end, halo_z_begin, halo_z_end;
+};
 
+/**
+ * @brief Call func(input, output, brick) for square bricks of rows
+ *
+ * Each brick writes its own rows of output, full rows along x, and may read
+ * input up to halo rows around them in y and z (and anywhere along x).
+ * Bricks run in parallel. input is only read, so its halo rows need no
+ * copy, but it must not be output when halo > 0.
+ * @throws std::invalid_argument if the grids differ in dimensions
+ */
+template<typename Func>
+void parallel_apply_bricks(const VXZ::VoxelGrid& input, VXZ::VoxelGrid& output, int brick_rows, int halo, Func func) {
+    if (input.dimensions() != output.dimensions()) {
+        throw std::invalid_argument("Brick input and output must have the same dimensions");
+    }
+    const int size_y = static_cast<int>(input.get_size_y());
+    const int size_z = static_cast<int>(input.get_size_z());
+    const int bricks_y = (size_y + brick_rows - 1) / brick_rows;
+    const int bricks_z = (size_z + brick_rows - 1) / brick_rows;
+    tbb::parallel_for(
+        tbb::blocked_range2d<int>(0, bricks_z, 0, bricks_y),
+        [&](const tbb::blocked_range2d<int>& r) {
+            for (int bz = r.rows().begin(); bz < r.rows().end(); ++bz) {
+                for (int by = r.cols().begin(); by < r.cols().end(); ++by) {
+                    GridBrick brick;
+                    brick.y_begin = by * brick_rows;
+                    brick.z_begin = bz * brick_rows;
+                    brick.y_end = std::min(brick.y_begin + brick_rows, size_y);
+                    brick.z_end = std::min(brick.z_begin + brick_rows, size_z);
+                    brick.halo_y_begin = std::max(brick.y_begin - halo, 0);
+                    brick.halo_z_begin = std::max(brick.z_begin - halo, 0);
+                    brick.halo_y_end = std::min(brick.y_end + halo, size_y);
+                    brick.halo_z_end = std::min(brick.z_end + halo, size_z);
+                    func(input, output, brick);
+                }
+            }
+        }
+    );
+}
 
+/**
+ * @brief Empty grid over the rows a brick may read, halo included
+ *
+ * Input row (y, z) corresponds to tile row (y - halo_y_begin, z -
+ * halo_z_begin); the tile keeps the resolution and world position of those
+ * rows.
+ */
+inline VXZ::VoxelGrid make_brick_tile(const VXZ::VoxelGrid& input, const GridBrick& brick) {
+    const float resolution = input.resolution();
+    const Eigen::Vector3f tile_min = input.min_bounds() +
+        Eigen::Vector3f(0.0f, brick.halo_y_begin, brick.halo_z_begin) * resolution;
+    // Half a voxel short of the far edge, so rounding cannot add a row
+    const Eigen::Vector3f tile_size(input.get_size_x() - 0.5f,
+                                    brick.halo_y_end - brick.halo_y_begin - 0.5f,
+                                    brick.halo_z_end - brick.halo_z_begin - 0.5f);
+    return VXZ::VoxelGrid(resolution, tile_min, tile_min + tile_size * resolution);
+}
 
-namespace VXZ {
+/**
+ * @brief Copy the rows a brick may read, halo included, into a grid of their own
+ *
+ * The tile is laid out as in make_brick_tile.
+ */
+inline VXZ::VoxelGrid copy_brick_tile(const VXZ::VoxelGrid& input, const GridBrick& brick) {
+    VXZ::VoxelGrid tile = make_brick_tile(input, brick);
+    const size_t words = input.words_per_row();
+    for (int z = brick.halo_z_begin; z < brick.halo_z_end; ++z) {
+        for (int y = brick.halo_y_begin; y < brick.halo_y_end; ++y) {
+            const uint64_t* row = input.row_data(y, z);
+            std::copy(row, row + words, tile.row_data(y - brick.halo_y_begin, z - brick.halo_z_begin));
+        }
+    }
+    return tile;
+}
+
+/**
+ * @brief Write the brick's own rows of a tile from copy_brick_tile to output
+ */
+inline void store_brick_tile(const VXZ::VoxelGrid& tile, const GridBrick& brick, VXZ::VoxelGrid& output) {
+    const size_t words = output.words_per_row();
+    for (int z = brick.z_begin; z < brick.z_end; ++z) {
+        for (int y = brick.y_begin; y < brick.y_end; ++y) {
+            const uint64_t* row = tile.row_data(y - brick.halo_y_begin, z - brick.halo_z_begin);
+            std::copy(row, row + words, output.row_data(y, z));
+        }
+    }
+}
 
 class GridOperator {
 public:
     virtual ~GridOperator() = default;
     virtual bool apply(VXZ::VoxelGrid& grid) const = 0;
 
+    /**
+     * @brief Reach of the operator in voxels, -1 if unbounded
+     *
+     * A result voxel depends only on input voxels at most this far away
+     * along each axis, and not on where it is in the grid. Operators with a
+     * bounded reach can run on tiles of a grid (see GridPipeline); the
+     * default of -1 keeps an operator to whole-grid passes.
+     */
+    virtual int stencil_radius() const { return -1; }
+
 protected:
+    /**
+     * @brief Call func(x, y, z) for every voxel
+     *
+     * Tasks take whole rows, so threads writing voxels never share a word.
+     */
     template<typename Func>
     void parallel_apply(VXZ::VoxelGrid& grid, Func func) const {
+        const int size_x = static_cast<int>(grid.get_size_x());
+        parallel_apply_rows(grid, [&](uint64_t*, size_t, int y, int z) {
+            for (int x = 0; x < size_x; ++x) {
+                func(x, y, z);
+            }
+        });
+    }
+
+    /**
+     * @brief Call func(words, word_count, y, z) for every packed row
+     *
+     * The row's words are contiguous, so loops over them vectorize. Bits
+     * past the row end must be left clear (see VoxelGrid::row_tail_mask).
+     */
+    template<typename Func>
+    void parallel_apply_rows(VXZ::VoxelGrid& grid, Func func) const {
+        const size_t words = grid.words_per_row();
         tbb::parallel_for(
-            tbb::blocked_range3d<int>(0, grid.get_size_x(), 0, grid.get_size_y(), 0, grid.get_size_z()),
-            [&](const tbb::blocked_range3d<int>& r) {
-                for (int z = r.pages().begin(); z < r.pages().end(); ++z) {
-                    for (int y = r.rows().begin(); y < r.rows().end(); ++y) {
-                        for (int x = r.cols().begin(); x < r.cols().end(); ++x) {
-                            func(x, y, z);
-                        }
+            tbb::blocked_range2d<int>(0, static_cast<int>(grid.get_size_z()), 0, static_cast<int>(grid.get_size_y())),
+            [&](const tbb::blocked_range2d<int>& r) {
+                for (int z = r.rows().begin(); z < r.rows().end(); ++z) {
+                    for (int y = r.cols().begin(); y < r.cols().end(); ++y) {
+                        func(grid.row_data(y, z), words, y, z);
                     }
                 }
             }
         );
     }
+
+    /**
+     * @brief Call func(input, output, brick) for square bricks of rows of one grid
+     *
+     * As the two-grid parallel_apply_bricks with output the grid itself. With
+     * a halo, input is a copy of the grid taken before the pass, so bricks
+     * never see each other's writes; the copy costs one full grid of memory
+     * and a pass over it. An operator that builds its result in a new grid
+     * anyway should read the original through the two-grid form, which
+     * copies nothing. Without a halo, input is the grid itself.
+     */
+    template<typename Func>
+    void parallel_apply_bricks(VXZ::VoxelGrid& grid, int brick_rows, int halo, Func func) const {
+        if (halo > 0) {
+            const VXZ::VoxelGrid snapshot(grid);
+            VXZ::parallel_apply_bricks(snapshot, grid, brick_rows, halo, func);
+        } else {
+            VXZ::parallel_apply_bricks(grid, grid, brick_rows, 0, func);
+        }
+    }
 };
 
 }
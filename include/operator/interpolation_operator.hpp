@@ -0,0 +1,84 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include "../core/distance_field.hpp"
+#include <eigen3/Eigen/Geometry>
+
+namespace VXZ {
+
+/**
+ * @brief How a target voxel is sampled from the source
+ *
+ * NEAREST takes the source voxel containing the target voxel centre.
+ * MAJORITY samples the source on a sub-lattice of the target voxel, about one
+ * sample per covered source voxel, and takes the majority (occupancy) or the
+ * mean (float channels); use it for downsampling. TRILINEAR and TRICUBIC
+ * (Catmull-Rom) interpolate between source voxel centres; occupancy is
+ * interpolated as 0/1 and thresholded at one half.
+ */
+enum class InterpolationMode { NEAREST, MAJORITY, TRILINEAR, TRICUBIC };
+
+/**
+ * @brief Resamples a grid onto another lattice
+ *
+ * The target lattice has its own resolution and bounds, and the source may be
+ * placed in it with an affine transform, so converting between mapping and
+ * planning resolutions, or between frames, needs no re-voxelization. Target
+ * voxels whose centre maps outside the source are empty (occupancy) or take
+ * the outside value (float channels).
+ *
+ * Each target row is sampled at source coordinates that advance by a fixed
+ * step per voxel, computed into contiguous row buffers before the gathers.
+ * Target rows are processed in parallel in square bricks of rows, which keeps
+ * the source reads of a task close together.
+ */
+class InterpolationOperator : public GridOperator {
+public:
+    /**
+     * @brief Resample to a new resolution over the grid's own bounds
+     * @throws std::invalid_argument if resolution is not positive
+     */
+    explicit InterpolationOperator(float resolution, InterpolationMode mode = InterpolationMode::NEAREST);
+
+    /**
+     * @brief Resample onto the lattice (resolution, min_bounds, max_bounds)
+     * @param transform Maps source world coordinates to target world coordinates
+     * @throws std::invalid_argument if resolution is not positive or transform is singular
+     */
+    InterpolationOperator(float resolution,
+                          const Eigen::Vector3f& min_bounds,
+                          const Eigen::Vector3f& max_bounds,
+                          const Eigen::Affine3f& transform = Eigen::Affine3f::Identity(),
+                          InterpolationMode mode = InterpolationMode::NEAREST);
+    ~InterpolationOperator() override = default;
+
+    // Replaces grid with its resampled copy
+    bool apply(VoxelGrid& grid) const override;
+
+    VoxelGrid resample(const VoxelGrid& source) const;
+
+    /**
+     * @brief Resample a float channel, e.g. a distance field
+     *
+     * Interpolation falls back to NEAREST wherever it would mix in a
+     * non-finite sample. The result has no nearest channel.
+     */
+    DistanceField resample(const DistanceField& source, float outside = DistanceField::kInfinity) const;
+
+    float resolution() const { return resolution_; }
+    InterpolationMode mode() const { return mode_; }
+    Eigen::Affine3f transform() const;
+
+private:
+    float resolution_;
+    InterpolationMode mode_;
+    // Without bounds the target covers the bounds of the source
+    bool has_bounds_;
+    Eigen::Vector3f min_bounds_;
+    Eigen::Vector3f max_bounds_;
+    // Target world to source world
+    Eigen::Matrix3f inverse_linear_;
+    Eigen::Vector3f inverse_translation_;
+};
+
+} // namespace VXZ
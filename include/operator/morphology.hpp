@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../core/voxel_grid.hpp"
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Structuring elements of the morphological operators
+ *
+ * BOX is the (2r+1)^3 cube, CROSS the three axis-aligned lines of half
+ * length r, and SPHERE an approximation of the ball of radius r built as the
+ * union of a few boxes inscribed in it (exact for r <= 2, always contained in
+ * the ball and containing the cross).
+ */
+enum class StructuringElement { BOX, CROSS, SPHERE };
+
+/**
+ * @brief Half extents of the boxes whose union is the structuring element
+ */
+std::vector<Eigen::Vector3i> structuring_boxes(StructuringElement element, int radius);
+
+/**
+ * @brief Dilate a grid in place; voxels outside the grid count as empty
+ *
+ * Each box of the element is applied as three separable passes on the packed
+ * rows. The x pass ORs word-shifted copies of a row, doubling the covered
+ * span each step, so it costs O(log r) word operations per word. The y and z
+ * passes OR whole rows with the van Herk/Gil-Werman scheme: three row ORs per
+ * row whatever the radius.
+ *
+ * An element of several boxes (SPHERE) dilates the unmodified grid by each
+ * box and ORs the results; this holds two grid-sized buffers for the
+ * duration of the call, and every box but the first reads its input
+ * straight from the grid rather than from a copy of it.
+ */
+void dilate(VoxelGrid& grid, StructuringElement element, int radius);
+
+/**
+ * @brief Erode a grid in place; voxels outside the grid count as occupied
+ *
+ * The same passes as dilate() with AND in place of OR, reading the bits
+ * past the grid as set, so erosion is the exact dual of dilation without
+ * complementing the grid. An element of several boxes intersects the
+ * erosions by each box.
+ */
+void erode(VoxelGrid& grid, StructuringElement element, int radius);
+
+/**
+ * @brief Opening (erode, then dilate) and closing (dilate, then erode) in place
+ *
+ * Both steps are fused per brick: the grid is cut into bricks of whole x-rows,
+ * each brick is copied with a halo of 2r rows in y and z into a thread-local
+ * tile, both steps run on the tile and the brick's rows are written to the
+ * output. No full intermediate grid is built between the two steps; the
+ * halo makes the result identical to the unfused sequence.
+ *
+ * Costs: bricks are max(32, 8r) rows a side, so a tile is at most 1.5 bricks
+ * a side and the halo adds at most 1.25x the brick's own work. Bricks read
+ * the untouched grid, so one grid-sized output is allocated and moved into
+ * grid at the end; each tile also holds the SPHERE buffers of dilate().
+ */
+void opening(VoxelGrid& grid, StructuringElement element, int radius);
+void closing(VoxelGrid& grid, StructuringElement element, int radius);
+
+} // namespace VXZ
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "grid_operator.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Complement operator for VoxelGrid objects
+ *
+ * This operator inverts every voxel of the grid in place, one packed word
+ * at a time with the rows split across threads.
+ */
+class NotOperator : public GridOperator {
+public:
+    NotOperator() = default;
+    ~NotOperator() override = default;
+
+    bool apply(VoxelGrid& grid) const override;
+    int stencil_radius() const override { return 0; }
+};
+
+} // namespace VXZ
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include "morphology.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Offset operator for VoxelGrid objects
+ *
+ * Grows the occupied region by a signed distance in voxels: a positive
+ * distance dilates, a negative one erodes, zero leaves the grid unchanged.
+ */
+class OffsetOperator : public GridOperator {
+public:
+    explicit OffsetOperator(int distance, StructuringElement element = StructuringElement::SPHERE);
+    ~OffsetOperator() override = default;
+
+    bool apply(VoxelGrid& grid) const override;
+    int stencil_radius() const override { return distance_ < 0 ? -distance_ : distance_; }
+
+    int distance() const { return distance_; }
+    StructuringElement element() const { return element_; }
+
+private:
+    int distance_;
+    StructuringElement element_;
+};
+
+} // namespace VXZ
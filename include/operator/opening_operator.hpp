@@ -0,0 +1,34 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include "morphology.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Opening operator for VoxelGrid objects
+ *
+ * Erosion followed by dilation with the same element: removes specks and
+ * thin structures smaller than the element and keeps the rest. Both steps
+ * run fused per brick, see opening().
+ */
+class OpeningOperator : public GridOperator {
+public:
+    /**
+     * @throws std::invalid_argument if radius is negative
+     */
+    explicit OpeningOperator(int radius, StructuringElement element = StructuringElement::BOX);
+    ~OpeningOperator() override = default;
+
+    bool apply(VoxelGrid& grid) const override;
+    int stencil_radius() const override { return 2 * radius_; }
+
+    int radius() const { return radius_; }
+    StructuringElement element() const { return element_; }
+
+private:
+    int radius_;
+    StructuringElement element_;
+};
+
+} // namespace VXZ
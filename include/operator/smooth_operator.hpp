@@ -0,0 +1,68 @@
+#pragma once
+
+#include "grid_operator.hpp"
+#include "../core/distance_field.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Smoothing kernels for float channels
+ *
+ * BOX averages the (2r + 1)^3 neighbourhood; GAUSSIAN weights it with a
+ * Gaussian truncated at the radius.
+ */
+enum class SmoothingKernel { BOX, GAUSSIAN };
+
+/**
+ * @brief Separable smoothing of float channels and majority filter for occupancy
+ *
+ * Float channels (e.g. a signed distance field before surface extraction, or
+ * occupancy probabilities) are convolved with three 1-D passes, along x, y
+ * and z. The y and z passes combine whole x-rows, so their inner loops run
+ * over contiguous memory and vectorize; the lines of each pass are processed
+ * in parallel. The box passes keep a sliding window sum, so their cost does
+ * not depend on the radius. Voxels past the border repeat the border value.
+ *
+ * On a VoxelGrid the operator is a majority filter: a voxel is occupied if
+ * more than half of its (2r + 1)^3 box is, counted with the box passes.
+ * The counts are int32, so a grid taller or deeper than one brick of
+ * max(32, 4r) rows is filtered brick by brick with an r-row halo, as
+ * opening() is: counts are only held for the tiles in flight, plus one
+ * grid-sized result.
+ */
+class SmoothOperator : public GridOperator {
+public:
+    /**
+     * @param sigma Gaussian standard deviation in voxels; 0 selects radius / 3
+     * @throws std::invalid_argument if radius or sigma is negative
+     */
+    explicit SmoothOperator(int radius, SmoothingKernel kernel = SmoothingKernel::GAUSSIAN, float sigma = 0.0f);
+    ~SmoothOperator() override = default;
+
+    // Majority filter; the kernel does not apply
+    bool apply(VoxelGrid& grid) const override;
+    int stencil_radius() const override { return radius_; }
+
+    bool apply(DistanceField& field) const;
+
+    /**
+     * @brief Smooth a float channel laid out like a VoxelGrid (x fastest, then y, then z)
+     *
+     * Non-finite values (e.g. kInfinity in a distance field) spread over the
+     * voxels whose window contains them, as in a direct sum.
+     */
+    void apply(float* values, const Eigen::Vector3i& dimensions) const;
+
+    int radius() const { return radius_; }
+    SmoothingKernel kernel() const { return kernel_; }
+    float sigma() const { return sigma_; }
+
+private:
+    int radius_;
+    SmoothingKernel kernel_;
+    float sigma_;
+    // Normalized Gaussian taps, weights_[radius_ + k] for offset k
+    std::vector<float> weights_;
+};
+
+} // namespace VXZ
@@ -17,6 +17,7 @@ public:
     ~UnionOperator() override = default;
 
     std::unique_ptr<VoxelGrid> apply(const VoxelGrid& grid1, const VoxelGrid& grid2) override;
+    void apply_in_place(VoxelGrid& grid1, const VoxelGrid& grid2) override;
 };
 
 } // namespace VXZ 
\ No newline at end of file
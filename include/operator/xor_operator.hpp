@@ -0,0 +1,23 @@
+#pragma once
+
+#include "binary_operator.hpp"
+
+namespace VXZ {
+
+/**
+ * @brief Exclusive-or operator for VoxelGrid objects
+ * 
+ * This operator performs a logical XOR operation between two VoxelGrid objects.
+ * The result is a new VoxelGrid where a voxel is occupied if it is occupied
+ * in exactly one of the input grids.
+ */
+class XorOperator : public BinaryOperator {
+public:
+    XorOperator() = default;
+    ~XorOperator() override = default;
+
+    std::unique_ptr<VoxelGrid> apply(const VoxelGrid& grid1, const VoxelGrid& grid2) override;
+    void apply_in_place(VoxelGrid& grid1, const VoxelGrid& grid2) override;
+};
+
+} // namespace VXZ 
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Append-only array in fixed-size blocks shared between copies
+ *
+ * Copying the array copies the block table only, so a copy is a cheap
+ * snapshot. Blocks are never written while shared: the first append to a
+ * shared last block copies that block. A snapshot can therefore be read from
+ * other threads while the original keeps appending.
+ */
+template <typename T>
+class BlockArray {
+public:
+    static constexpr int kBlockShift = 12;
+    static constexpr size_t kBlockSize = size_t(1) << kBlockShift;
+
+    BlockArray() : size_(0) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const T& operator[](size_t index) const {
+        return data_[index >> kBlockShift][index & (kBlockSize - 1)];
+    }
+
+    void push_back(const T& value) {
+        const size_t slot = size_ & (kBlockSize - 1);
+        if (slot == 0) {
+            blocks_.push_back(std::make_shared<std::vector<T>>());
+            blocks_.back()->reserve(kBlockSize);
+            data_.push_back(blocks_.back()->data());
+        } else if (blocks_.back().use_count() > 1) {
+            std::shared_ptr<std::vector<T>> copy = std::make_shared<std::vector<T>>();
+            copy->reserve(kBlockSize);
+            copy->assign(blocks_.back()->begin(), blocks_.back()->begin() + slot);
+            blocks_.back() = copy;
+            data_.back() = copy->data();
+        }
+        // Capacity is reserved, so the block never moves
+        blocks_.back()->push_back(value);
+        ++size_;
+    }
+
+    void clear() {
+        blocks_.clear();
+        data_.clear();
+        size_ = 0;
+    }
+
+    void assign(const std::vector<T>& values) {
+        clear();
+        for (size_t begin = 0; begin < values.size(); begin += kBlockSize) {
+            const size_t end = std::min(values.size(), begin + kBlockSize);
+            blocks_.push_back(std::make_shared<std::vector<T>>());
+            blocks_.back()->reserve(kBlockSize);
+            blocks_.back()->assign(values.begin() + begin, values.begin() + end);
+            data_.push_back(blocks_.back()->data());
+        }
+        size_ = values.size();
+    }
+
+    /**
+     * @brief Call function(const T* data, size_t count) for each block in order
+     */
+    template <typename Function>
+    void for_each_block(Function&& function) const {
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            function(data_[b], std::min(kBlockSize, size_ - (b << kBlockShift)));
+        }
+    }
+
+    bool operator==(const BlockArray& other) const {
+        if (size_ != other.size_) return false;
+        for (size_t i = 0; i < size_; ++i) {
+            if (!((*this)[i] == other[i])) return false;
+        }
+        return true;
+    }
+    bool operator!=(const BlockArray& other) const { return !(*this == other); }
+
+private:
+    std::vector<std::shared_ptr<std::vector<T>>> blocks_;
+    // Element pointers of blocks_, for indexing without the shared_ptr hop
+    std::vector<T*> data_;
+    size_t size_;
+};
+
+template <typename T>
+constexpr int BlockArray<T>::kBlockShift;
+template <typename T>
+constexpr size_t BlockArray<T>::kBlockSize;
+
+} // namespace VXZ
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "core/voxel_grid.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <tbb/task_arena.h>
+
+namespace VXZ {
+
+/**
+ * @brief Unbounded occupancy map made of fixed-size VoxelGrid chunks
+ *
+ * Voxel (0, 0, 0) covers [0, resolution)^3 in world space, and chunk c holds
+ * the voxels [c * chunk_size, (c + 1) * chunk_size). Only chunks near the
+ * focus stay in memory: set_focus() loads the chunks within the load radius,
+ * and those around the point prefetch_distance chunks ahead along the
+ * direction of travel, on a background task arena, and spills chunks beyond
+ * the unload radius to spill_directory in the SVO file format. Unmodified
+ * chunks are simply dropped. At most max_resident_chunks() chunks are kept,
+ * counting those still being loaded or written out; past that the ones
+ * farthest from the focus are spilled first, and loads wait for the spills.
+ *
+ * Queries are safe from several threads. A query that reaches a chunk which
+ * is not resident reads it synchronously, so callers see a single map; with
+ * the map full it first writes out a spilling chunk itself.
+ * Chunks that were never written read as free space.
+ */
+class ChunkedMap {
+public:
+    static constexpr int kDefaultChunkSize = 64;
+    static constexpr size_t kDefaultMaxResidentChunks = 512;
+
+    /**
+     * @param spill_directory Directory of the chunk files, created if missing
+     * @throws std::invalid_argument if resolution <= 0 or chunk_size < 4
+     * @throws std::runtime_error if spill_directory cannot be created
+     */
+    ChunkedMap(float resolution, const std::string& spill_directory,
+               int chunk_size = kDefaultChunkSize,
+               size_t max_resident_chunks = kDefaultMaxResidentChunks);
+
+    /**
+     * @brief Wait for background work and spill all modified chunks
+     */
+    ~ChunkedMap();
+
+    float resolution() const { return resolution_; }
+    int chunk_size() const { return chunk_size_; }
+    const std::string& spill_directory() const { return directory_; }
+
+    // Coordinate conversion
+    Eigen::Vector3i world_to_voxel(const Eigen::Vector3f& world_pos) const;
+    Eigen::Vector3f voxel_to_world(const Eigen::Vector3i& voxel) const;
+    Eigen::Vector3i chunk_of(const Eigen::Vector3i& voxel) const;
+
+    /**
+     * @brief Query a voxel, reading its chunk if it is not resident
+     * @throws std::runtime_error if a spilled chunk cannot be read
+     */
+    bool get(const Eigen::Vector3i& voxel) const;
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+    bool get(const Eigen::Vector3f& world_pos) const { return get(world_to_voxel(world_pos)); }
+
+    void set(const Eigen::Vector3i& voxel, bool value);
+    void set(int x, int y, int z, bool value) { set(Eigen::Vector3i(x, y, z), value); }
+
+    /**
+     * @brief Set all voxels of the inclusive box [min, max]
+     */
+    void set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value = true);
+
+    /**
+     * @brief Test the inclusive box [min, max] for occupied voxels
+     */
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const;
+
+    /**
+     * @brief Visit the occupied voxels of the inclusive box [min, max]
+     *
+     * Resident chunks are scanned in place. Spilled chunks are read one at a
+     * time and dropped again, so the box may be far larger than the resident
+     * set. The visitor runs without the map locked and may query the map.
+     * @param visitor Called as visitor(const Eigen::Vector3i&) in map voxels
+     * @throws std::runtime_error if a spilled chunk cannot be read
+     */
+    void for_each_occupied(const Eigen::Vector3i& min, const Eigen::Vector3i& max,
+                           const std::function<void(const Eigen::Vector3i&)>& visitor) const;
+
+    /**
+     * @brief Move the focus and stream chunks in and out around it
+     * @param velocity Direction of travel; prefetching is skipped if zero
+     *
+     * Returns once the work is scheduled; wait() blocks until it is done.
+     */
+    void set_focus(const Eigen::Vector3f& world_pos,
+                   const Eigen::Vector3f& velocity = Eigen::Vector3f::Zero());
+
+    /**
+     * @brief Streaming radii in chunks (Chebyshev distance from the focus chunk)
+     * @throws std::invalid_argument unless 0 <= load_radius <= unload_radius
+     */
+    void set_radii(int load_radius, int unload_radius);
+    void set_prefetch_distance(int chunks) { prefetch_distance_ = chunks; }
+    int load_radius() const { return load_radius_; }
+    int unload_radius() const { return unload_radius_; }
+    int prefetch_distance() const { return prefetch_distance_; }
+
+    /**
+     * @brief Block until the background loads and spills are finished
+     */
+    void wait() const;
+
+    /**
+     * @brief Write every modified resident chunk to the spill directory
+     * @return false if a chunk could not be written
+     */
+    bool flush();
+
+    bool is_resident(const Eigen::Vector3i& chunk) const;
+
+    /**
+     * @brief Chunks in memory, including those still being loaded or written out
+     */
+    size_t resident_chunks() const;
+    size_t max_resident_chunks() const { return max_resident_; }
+
+    /**
+     * @brief Change the limit; surplus chunks are spilled in the background
+     */
+    void set_max_resident_chunks(size_t count);
+
+private:
+    enum class ChunkState { LOADING, READY, SPILLING };
+
+    struct Chunk {
+        ChunkState state = ChunkState::LOADING;
+        // nullptr for a chunk without occupied voxels
+        std::shared_ptr<VoxelGrid> grid;
+        bool dirty = false;
+        // Queried while spilling; keep it once written
+        bool wanted = false;
+        // The spill is being written; edits wait for it to end
+        bool writing = false;
+        // Unique per entry, so a read finishing after its entry was spilled
+        // and replaced can tell, and drops its now stale grid
+        uint64_t epoch = 0;
+    };
+
+    struct ChunkHash {
+        size_t operator()(const Eigen::Vector3i& key) const;
+    };
+
+    using ChunkTable = std::unordered_map<Eigen::Vector3i, Chunk, ChunkHash>;
+
+    float resolution_;
+    int chunk_size_;
+    std::string directory_;
+    size_t max_resident_;
+    int load_radius_;
+    int unload_radius_;
+    int prefetch_distance_;
+
+    mutable std::mutex mutex_;
+    // Every entry holds at most one grid and counts against max_resident_
+    mutable ChunkTable chunks_;
+    // Entries of chunks_ in SPILLING state
+    mutable size_t spilling_;
+    // Last epoch given to an entry
+    mutable uint64_t epochs_;
+    Eigen::Vector3i focus_;
+    // Focus chunk plus prefetch_distance_ chunks along the direction of travel
+    Eigen::Vector3i lookahead_;
+    // Background loads and spills. Enqueued tasks run even without spare
+    // cores, and callers never join them, so queries cannot stall on them.
+    mutable tbb::task_arena arena_;
+    mutable std::condition_variable idle_;
+    // Signalled whenever a spill has been written
+    mutable std::condition_variable drained_;
+    mutable size_t pending_;
+
+    ChunkedMap(const ChunkedMap&) = delete;
+    ChunkedMap& operator=(const ChunkedMap&) = delete;
+
+    std::string chunk_path(const Eigen::Vector3i& chunk) const;
+    VoxelGrid make_chunk_grid(const Eigen::Vector3i& chunk) const;
+
+    /**
+     * @brief Read a spilled chunk; nullptr if it was never written
+     * @throws std::runtime_error if the file exists but cannot be read
+     */
+    std::shared_ptr<VoxelGrid> read_chunk(const Eigen::Vector3i& chunk) const;
+    bool write_chunk(const Eigen::Vector3i& chunk, const VoxelGrid& grid) const;
+
+    /**
+     * @brief Resident chunk, read synchronously if needed; requires mutex_
+     */
+    Chunk& resident(const Eigen::Vector3i& chunk, std::unique_lock<std::mutex>& lock) const;
+
+    /**
+     * @brief Grid of a chunk ready for edits, created if create is set; requires mutex_
+     * @return nullptr if the chunk has no grid and create is false
+     */
+    VoxelGrid* writable(const Eigen::Vector3i& chunk, bool create, std::unique_lock<std::mutex>& lock);
+
+    /**
+     * @brief Write a spilling chunk that no one is writing yet; requires mutex_
+     *
+     * The lock is released while the file is written.
+     * @return false if the chunk could not be written and stays in memory
+     */
+    bool write_spill(const Eigen::Vector3i& chunk, std::unique_lock<std::mutex>& lock) const;
+
+    /**
+     * @brief Free one slot below max_resident_ for a synchronous read; requires mutex_
+     *
+     * Spills are written on the calling thread, so this may block. The limit
+     * is exceeded only if chunks cannot be written.
+     */
+    void make_room(const Eigen::Vector3i& keep, std::unique_lock<std::mutex>& lock) const;
+
+    // Require mutex_
+    ChunkTable::iterator add_loading(const Eigen::Vector3i& chunk) const;
+    void run_background(std::function<void()> task) const;
+    void schedule_load(const Eigen::Vector3i& chunk) const;
+    void schedule_loads() const;
+    void unload(ChunkTable::iterator it) const;
+    bool evict_beyond(int distance, const Eigen::Vector3i* keep) const;
+    void enforce_limit() const;
+    int focus_distance(const Eigen::Vector3i& chunk) const;
+};
+
+} // namespace VXZ
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "voxelstorage.hpp"
+#include <memory>
+
+namespace VXZ {
+
+/**
+ * @brief Uncompressed storage backed by a VoxelGrid
+ *
+ * Queries work on the packed rows of the grid: for_each_occupied scans
+ * whole words and any_in_box masks row spans.
+ */
+class DenseStorage : public VoxelStorage {
+public:
+    DenseStorage();
+    explicit DenseStorage(const VXZ::VoxelGrid& grid);
+    ~DenseStorage() override = default;
+
+    bool save(const std::string& filename) const override;
+    bool load(const std::string& filename) override;
+    size_t get_size() const override;
+    bool to_voxel_grid(VXZ::VoxelGrid& grid) const override;
+    bool from_voxel_grid(const VXZ::VoxelGrid& grid) override;
+    StorageType type() const override { return StorageType::DENSE; }
+
+    /**
+     * @brief Query a voxel
+     * @throws std::out_of_range if the position is outside the grid
+     */
+    bool get(const Eigen::Vector3i& position) const;
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+
+    /**
+     * @brief Visit every occupied voxel
+     * @param visitor Called as visitor(const Eigen::Vector3i&)
+     */
+    template <typename Visitor>
+    void for_each_occupied(Visitor&& visitor) const;
+
+    /**
+     * @brief Test a box for occupied voxels, as SVOStorage::any_in_box
+     */
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const;
+
+    /**
+     * @brief First occupied voxel along a ray, as SVOStorage::raycast
+     */
+    bool raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                 float max_distance, Eigen::Vector3i& hit) const;
+
+    Eigen::Vector3i dimensions() const;
+
+    /**
+     * @brief The stored grid, or nullptr if the storage is empty
+     */
+    const VXZ::VoxelGrid* grid() const { return grid_.get(); }
+
+private:
+    std::unique_ptr<VXZ::VoxelGrid> grid_;
+};
+
+template <typename Visitor>
+void DenseStorage::for_each_occupied(Visitor&& visitor) const {
+    if (!grid_) return;
+    const Eigen::Vector3i& dims = grid_->dimensions();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            const uint64_t* row = grid_->row_data(y, z);
+            for (size_t w = 0; w < grid_->words_per_row(); ++w) {
+                uint64_t word = row[w];
+                while (word) {
+                    const int b = __builtin_ctzll(word);
+                    word &= word - 1;
+                    visitor(Eigen::Vector3i(static_cast<int>(w) * VoxelGrid::kWordBits + b, y, z));
+                }
+            }
+        }
+    }
+}
+
+} // namespace VXZ
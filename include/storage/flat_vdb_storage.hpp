@@ -0,0 +1,92 @@
+#pragma once
+
+#include "voxelstorage.hpp"
+#include "vdb_tree_storage.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Read-only storage on the flat form of a VDBTreeStorage
+ *
+ * Holds the flat VDB form (see VDBHeader) in one contiguous buffer and
+ * answers queries in place, without rebuilding any pointer structure. The
+ * buffer is either owned or a read-only memory mapping of a saved file.
+ * Opening checks the root table and every internal node once (see
+ * VDBTreeView::valid()), so it is linear in the internal nodes, but the
+ * leaves, the bulk of the file, are not read and page in on demand. This
+ * follows the NanoVDB approach on our own format; it does not read NanoVDB
+ * grids.
+ */
+class FlatVDBStorage : public VoxelStorage {
+public:
+    FlatVDBStorage();
+    ~FlatVDBStorage() override;
+
+    bool save(const std::string& filename) const override;
+
+    /**
+     * @brief Read a flat VDB file into memory
+     */
+    bool load(const std::string& filename) override;
+    size_t get_size() const override;
+    bool to_voxel_grid(VXZ::VoxelGrid& grid) const override;
+
+    /**
+     * @brief Build the tree through VDBTreeStorage and keep its flat form
+     */
+    bool from_voxel_grid(const VXZ::VoxelGrid& grid) override;
+    StorageType type() const override { return StorageType::FLAT_VDB; }
+
+    /**
+     * @brief Map a flat VDB file read-only instead of reading it
+     *
+     * Reads the root table and internal nodes to check them; leaves stay unread.
+     * @return false if the file cannot be mapped or is not a valid flat VDB file
+     */
+    bool map(const std::string& filename);
+
+    /**
+     * @brief Copy the flat form of a tree
+     */
+    bool from_tree(const VDBTreeStorage& storage);
+
+    bool is_mapped() const { return mapped_ != nullptr; }
+
+    /**
+     * @brief Query a voxel
+     * @throws std::out_of_range if the position is outside the grid
+     */
+    bool get(const Eigen::Vector3i& position) const;
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+
+    template <typename Visitor>
+    void for_each_occupied(Visitor&& visitor) const { view_.for_each_occupied(visitor); }
+
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+        return view_.any_in_box(min, max);
+    }
+
+    bool raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                 float max_distance, Eigen::Vector3i& hit) const {
+        return view_.raycast(origin, direction, max_distance, hit);
+    }
+
+    Eigen::Vector3i dimensions() const { return view_.dimensions(); }
+
+private:
+    std::vector<uint64_t> buffer_;
+    void* mapped_;
+    size_t mapped_size_;
+    VDBTreeView view_;
+
+    // The view points into the buffer or mapping
+    FlatVDBStorage(const FlatVDBStorage&) = delete;
+    FlatVDBStorage& operator=(const FlatVDBStorage&) = delete;
+
+    void release();
+    bool attach_buffer(std::vector<uint64_t>& buffer);
+};
+
+} // namespace VXZ
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "voxelstorage.hpp"
+#include "svo.hpp"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Header of a paged SVO file
+ *
+ * The header is followed by the top levels of the octree (SVONodes,
+ * breadth-first), the page table and the pages. Nodes of the last top level
+ * index the page table instead of nodes. A page holds one subtree of
+ * page_size^3 voxels: its nodes breadth-first with page-local child indices,
+ * then its bricks. Every page starts on a kPageAlignment boundary.
+ */
+struct PagedSVOHeader {
+    char magic[4];
+    uint32_t version;
+    float resolution;
+    float min_bounds[3];
+    float max_bounds[3];
+    int32_t dimensions[3];
+    int32_t root_size;
+    int32_t depth;
+    // Node levels inside a page
+    int32_t page_depth;
+    int32_t reserved;
+    uint64_t top_node_count;
+    uint64_t page_count;
+};
+
+/**
+ * @brief Page table entry
+ */
+struct PagedSVOPage {
+    uint64_t offset;
+    uint32_t node_count;
+    uint32_t brick_count;
+};
+
+/**
+ * @brief SVO read lazily from a page-structured file
+ *
+ * load() maps the file and checks only the header, the top levels and the
+ * page table, so opening costs in proportion to the index, not the file.
+ * A page is faulted in by the first query that touches it, and its child
+ * indices are checked then, before any are followed; a query reaching a
+ * corrupt page throws. Resident pages are kept in LRU order, and beyond
+ * max_resident_pages() the least recently used one is handed back to the
+ * kernel, so memory follows the region actually queried. Queries are safe
+ * from several threads.
+ *
+ * from_svo() and from_voxel_grid() build the same image in memory; save()
+ * writes it.
+ */
+class PagedSVOStorage : public VoxelStorage {
+public:
+    static constexpr size_t kPageAlignment = 4096;
+    // Edge length of a page in voxels
+    static constexpr int kDefaultPageSize = 64;
+    static constexpr size_t kDefaultMaxResidentPages = 1024;
+
+    PagedSVOStorage();
+    ~PagedSVOStorage() override;
+
+    bool save(const std::string& filename) const override;
+
+    /**
+     * @brief Map a paged SVO file
+     * @return false if the file cannot be mapped, is not a paged SVO file, or
+     *         has a top level index or page out of range
+     */
+    bool load(const std::string& filename) override;
+    size_t get_size() const override;
+
+    /**
+     * @return false if there is no image or a page is corrupt
+     */
+    bool to_voxel_grid(VXZ::VoxelGrid& grid) const override;
+
+    /**
+     * @brief Build the paged image in memory through SVOStorage
+     */
+    bool from_voxel_grid(const VXZ::VoxelGrid& grid) override;
+    StorageType type() const override { return StorageType::PAGED_SVO; }
+
+    /**
+     * @brief Build the paged image of an octree in memory
+     * @param page_size Page edge length in voxels, a power of two >= 8
+     */
+    bool from_svo(const SVOStorage& svo, int page_size = kDefaultPageSize);
+
+    /**
+     * @brief Query a voxel
+     * @throws std::out_of_range if the position is outside the grid
+     * @throws std::runtime_error if the voxel's page is corrupt, as for every query
+     */
+    bool get(const Eigen::Vector3i& position) const;
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+
+    /**
+     * @brief Visit every occupied voxel, paging in every occupied page
+     */
+    template <typename Visitor>
+    void for_each_occupied(Visitor&& visitor) const;
+
+    /**
+     * @brief Test a box for occupied voxels; only pages overlapping it are read
+     */
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const;
+
+    /**
+     * @brief First occupied voxel along a ray, as SVOStorage::raycast
+     */
+    bool raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                 float max_distance, Eigen::Vector3i& hit) const;
+
+    const Eigen::Vector3i& dimensions() const { return dimensions_; }
+    size_t page_count() const { return header_ ? header_->page_count : 0; }
+    bool is_mapped() const { return mapped_ != nullptr; }
+
+    /**
+     * @brief Pages currently resident; all pages of an in-memory image
+     */
+    size_t resident_pages() const;
+    size_t max_resident_pages() const { return max_resident_; }
+    void set_max_resident_pages(size_t count);
+
+private:
+    struct PageView {
+        const SVONode* nodes;
+        const uint64_t* bricks;
+    };
+
+    enum class PageCheck : uint8_t { UNCHECKED, VALID, CORRUPT };
+
+    std::vector<uint64_t> buffer_;
+    void* mapped_;
+    size_t mapped_size_;
+    const char* data_;
+    const PagedSVOHeader* header_;
+    const SVONode* top_;
+    const PagedSVOPage* pages_;
+    int top_levels_;
+    Eigen::Vector3i dimensions_;
+
+    // LRU of the resident pages of a mapping, most recent first
+    mutable std::mutex mutex_;
+    mutable std::list<uint32_t> lru_;
+    // lru_.end() for pages not resident
+    mutable std::vector<std::list<uint32_t>::iterator> lru_position_;
+    // Child indices of a mapped page are checked on its first fault-in
+    mutable std::vector<PageCheck> checked_;
+    size_t max_resident_;
+
+    PagedSVOStorage(const PagedSVOStorage&) = delete;
+    PagedSVOStorage& operator=(const PagedSVOStorage&) = delete;
+
+    bool attach(const char* data, size_t size);
+    void release();
+    void evict_to(size_t count) const;
+
+    /**
+     * @brief Page a subtree in and mark it most recently used
+     * @throws std::runtime_error if the page has a child index out of range
+     */
+    PageView acquire(uint32_t page) const;
+
+    /**
+     * @brief Visit the occupied parts of the tree, as SVOStorage::visit_node
+     */
+    template <typename Enter, typename FullVisitor, typename BrickVisitor>
+    bool visit_top(uint32_t index, const Eigen::Vector3i& origin, int size, int level,
+                   Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const;
+
+    template <typename Enter, typename FullVisitor, typename BrickVisitor>
+    bool visit_page(const PageView& page, uint32_t index, const Eigen::Vector3i& origin, int size,
+                    Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const;
+
+    template <typename Enter, typename FullVisitor, typename BrickVisitor>
+    bool visit(Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const;
+};
+
+template <typename Enter, typename FullVisitor, typename BrickVisitor>
+bool PagedSVOStorage::visit_page(const PageView& page, uint32_t index, const Eigen::Vector3i& origin, int size,
+                                 Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const {
+    const SVONode& node = page.nodes[index];
+    const int half = size / 2;
+    for (int i = 0; i < 8; ++i) {
+        if (!(node.child_mask & (1u << i))) continue;
+        const Eigen::Vector3i child_origin = origin + half * Eigen::Vector3i(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        if (!enter(child_origin, half)) continue;
+        if (node.full_mask & (1u << i)) {
+            if (!on_full(child_origin, half)) return false;
+            continue;
+        }
+        const uint32_t child = node.first_child + node.child_offset(i);
+        if (half == SVOStorage::kBrickSize) {
+            if (!on_brick(child_origin, page.bricks[child])) return false;
+        } else if (!visit_page(page, child, child_origin, half, enter, on_full, on_brick)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Enter, typename FullVisitor, typename BrickVisitor>
+bool PagedSVOStorage::visit_top(uint32_t index, const Eigen::Vector3i& origin, int size, int level,
+                                Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const {
+    const SVONode& node = top_[index];
+    const int half = size / 2;
+    for (int i = 0; i < 8; ++i) {
+        if (!(node.child_mask & (1u << i))) continue;
+        const Eigen::Vector3i child_origin = origin + half * Eigen::Vector3i(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        if (!enter(child_origin, half)) continue;
+        if (node.full_mask & (1u << i)) {
+            if (!on_full(child_origin, half)) return false;
+            continue;
+        }
+        const uint32_t child = node.first_child + node.child_offset(i);
+        if (level == 1) {
+            if (!visit_page(acquire(child), 0, child_origin, half, enter, on_full, on_brick)) return false;
+        } else if (!visit_top(child, child_origin, half, level - 1, enter, on_full, on_brick)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Enter, typename FullVisitor, typename BrickVisitor>
+bool PagedSVOStorage::visit(Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const {
+    if (!header_) return true;
+    if (top_levels_ == 0) {
+        return visit_page(acquire(0), 0, Eigen::Vector3i::Zero(), header_->root_size, enter, on_full, on_brick);
+    }
+    return visit_top(0, Eigen::Vector3i::Zero(), header_->root_size, top_levels_, enter, on_full, on_brick);
+}
+
+template <typename Visitor>
+void PagedSVOStorage::for_each_occupied(Visitor&& visitor) const {
+    const Eigen::Vector3i dims = dimensions_;
+    auto enter = [&](const Eigen::Vector3i& origin, int) { return (origin.array() < dims.array()).all(); };
+    auto on_full = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z)
+            for (int y = origin.y(); y < end.y(); ++y)
+                for (int x = origin.x(); x < end.x(); ++x)
+                    visitor(Eigen::Vector3i(x, y, z));
+        return true;
+    };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        SVOStorage::for_each_brick_voxel(origin, mask, dims, visitor);
+        return true;
+    };
+    visit(enter, on_full, on_brick);
+}
+
+} // namespace VXZ
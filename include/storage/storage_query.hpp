@@ -0,0 +1,80 @@
+#pragma once
+
+#include "voxelstorage.hpp"
+#include "dense_storage.hpp"
+#include "svo.hpp"
+#include "svdag.hpp"
+#include "vdb_tree_storage.hpp"
+#include "flat_vdb_storage.hpp"
+#include "paged_svo.hpp"
+#include <stdexcept>
+#include <utility>
+
+namespace VXZ {
+
+/**
+ * @brief Call function with the concrete backend of a storage
+ *
+ * The backend is selected once from type(); function is instantiated for
+ * every backend, so the query itself runs without virtual calls on the
+ * backend's compressed form. All instantiations must return the same type.
+ * @throws std::invalid_argument for a backend without query support
+ */
+template <typename Function>
+auto dispatch_storage(const VoxelStorage& storage, Function&& function)
+    -> decltype(function(std::declval<const DenseStorage&>())) {
+    switch (storage.type()) {
+        case StorageType::DENSE:
+            return function(static_cast<const DenseStorage&>(storage));
+        case StorageType::SVO:
+            return function(static_cast<const SVOStorage&>(storage));
+        case StorageType::SVDAG:
+            return function(static_cast<const SVDAGStorage&>(storage));
+        case StorageType::VDB_TREE:
+            return function(static_cast<const VDBTreeStorage&>(storage));
+        case StorageType::FLAT_VDB:
+            return function(static_cast<const FlatVDBStorage&>(storage));
+        case StorageType::PAGED_SVO:
+            return function(static_cast<const PagedSVOStorage&>(storage));
+        default:
+            break;
+    }
+    throw std::invalid_argument("Storage type does not support queries");
+}
+
+/**
+ * @brief Query one voxel of any storage
+ * @throws std::out_of_range if the position is outside the grid
+ */
+inline bool get_voxel(const VoxelStorage& storage, const Eigen::Vector3i& position) {
+    return dispatch_storage(storage, [&](const auto& backend) { return backend.get(position); });
+}
+
+/**
+ * @brief Test a box of any storage for occupied voxels
+ * @param min,max Inclusive box corners in grid coordinates
+ */
+inline bool any_in_box(const VoxelStorage& storage, const Eigen::Vector3i& min, const Eigen::Vector3i& max) {
+    return dispatch_storage(storage, [&](const auto& backend) { return backend.any_in_box(min, max); });
+}
+
+/**
+ * @brief First occupied voxel of any storage along a ray in world coordinates
+ */
+inline bool raycast(const VoxelStorage& storage, const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                    float max_distance, Eigen::Vector3i& hit) {
+    return dispatch_storage(storage, [&](const auto& backend) {
+        return backend.raycast(origin, direction, max_distance, hit);
+    });
+}
+
+/**
+ * @brief Visit every occupied voxel of any storage
+ * @param visitor Called as visitor(const Eigen::Vector3i&)
+ */
+template <typename Visitor>
+void for_each_occupied(const VoxelStorage& storage, Visitor&& visitor) {
+    dispatch_storage(storage, [&](const auto& backend) { backend.for_each_occupied(visitor); });
+}
+
+} // namespace VXZ
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "voxelstorage.hpp"
+#include "svo.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Sparse Voxel DAG storage
+ *
+ * An SVO in which identical subtrees are stored once. The SVO is merged
+ * bottom-up: leaf bricks are hashed first, then the nodes of each level by
+ * their masks and the ids of their (already merged) children.
+ *
+ * In symmetric mode (SSVDAG) a subtree is also merged with its mirror images
+ * along any combination of the x, y and z axes. Each child reference then
+ * carries three mirror bits which are accumulated on the way down.
+ *
+ * Node layout in nodes(): a header word (child_mask | full_mask << 8, masks
+ * as in SVONode) followed by one reference per stored child. A reference is
+ * the child's index in nodes(), or in bricks() below the last node level,
+ * with the mirror bits in the top three bits.
+ */
+class SVDAGStorage : public VoxelStorage {
+public:
+    /**
+     * @brief Constructor
+     * @param symmetric Also merge subtrees that are mirror images (SSVDAG)
+     */
+    explicit SVDAGStorage(bool symmetric = false);
+    ~SVDAGStorage() override = default;
+
+    bool save(const std::string& filename) const override;
+    bool load(const std::string& filename) override;
+    size_t get_size() const override;
+    bool to_voxel_grid(VXZ::VoxelGrid& grid) const override;
+
+    /**
+     * @brief Build the DAG from a voxel grid
+     * @param grid The voxel grid to convert
+     * @return true if successful, false otherwise
+     */
+    bool from_voxel_grid(const VXZ::VoxelGrid& grid) override;
+    StorageType type() const override { return StorageType::SVDAG; }
+
+    /**
+     * @brief Build the DAG by merging the subtrees of an SVO
+     * @param svo Source octree
+     * @return true if successful, false if the SVO is empty or too large
+     */
+    bool from_svo(const SVOStorage& svo);
+
+    /**
+     * @brief Query a voxel
+     * @param position Grid coordinates
+     * @return Occupancy of the voxel
+     * @throws std::out_of_range if the position is outside the grid
+     */
+    bool get(const Eigen::Vector3i& position) const;
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+
+    /**
+     * @brief Visit every occupied voxel without expanding the DAG
+     * @param visitor Called as visitor(const Eigen::Vector3i&)
+     */
+    template <typename Visitor>
+    void for_each_occupied(Visitor&& visitor) const;
+
+    /**
+     * @brief Test a box for occupied voxels, as SVOStorage::any_in_box
+     */
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const;
+
+    /**
+     * @brief First occupied voxel along a ray, as SVOStorage::raycast
+     */
+    bool raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                 float max_distance, Eigen::Vector3i& hit) const;
+
+    // Reference layout
+    static constexpr int kMirrorShift = 29;
+    static constexpr uint32_t kIndexMask = (1u << kMirrorShift) - 1;
+
+    bool symmetric() const { return symmetric_; }
+    const Eigen::Vector3i& dimensions() const { return dimensions_; }
+    int root_size() const { return root_size_; }
+    int depth() const { return depth_; }
+    uint32_t root() const { return root_; }
+    const std::vector<uint32_t>& nodes() const { return nodes_; }
+    const std::vector<uint64_t>& bricks() const { return bricks_; }
+
+    /**
+     * @brief Mirror a 4^3 brick mask
+     * @param mask Brick bits, bit x + 4y + 16z
+     * @param mirror Bit 0, 1, 2 flips x, y, z
+     */
+    static uint64_t mirror_brick(uint64_t mask, int mirror);
+
+private:
+    bool symmetric_;
+    float resolution_;
+    Eigen::Vector3f min_bounds_;
+    Eigen::Vector3f max_bounds_;
+    Eigen::Vector3i dimensions_;
+    int root_size_;
+    int depth_;
+
+    uint32_t root_;
+    std::vector<uint32_t> nodes_;
+    std::vector<uint64_t> bricks_;
+
+    /**
+     * @brief Visit the occupied parts of a subtree, as SVOStorage::visit_node
+     *
+     * mirror is the mirror accumulated above the reference; bricks are
+     * handed to on_brick already mirrored into place.
+     */
+    template <typename Enter, typename FullVisitor, typename BrickVisitor>
+    bool visit_node(uint32_t reference, const Eigen::Vector3i& origin, int size, int mirror,
+                    Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const;
+};
+
+template <typename Enter, typename FullVisitor, typename BrickVisitor>
+bool SVDAGStorage::visit_node(uint32_t reference, const Eigen::Vector3i& origin, int size, int mirror,
+                              Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const {
+    mirror ^= static_cast<int>(reference >> kMirrorShift);
+    const uint32_t index = reference & kIndexMask;
+    const uint32_t header = nodes_[index];
+    const uint32_t stored = header & ~(header >> 8) & 0xFF;
+    const int half = size / 2;
+    for (int c = 0; c < 8; ++c) {
+        const int s = c ^ mirror;
+        if (!(header & (1u << s))) continue;
+        const Eigen::Vector3i child_origin = origin + half * Eigen::Vector3i(c & 1, (c >> 1) & 1, (c >> 2) & 1);
+        if (!enter(child_origin, half)) continue;
+        if (header & (0x100u << s)) {
+            if (!on_full(child_origin, half)) return false;
+            continue;
+        }
+        const uint32_t child = nodes_[index + 1 + __builtin_popcount(stored & ((1u << s) - 1))];
+        if (half == SVOStorage::kBrickSize) {
+            const int brick_mirror = mirror ^ static_cast<int>(child >> kMirrorShift);
+            if (!on_brick(child_origin, mirror_brick(bricks_[child & kIndexMask], brick_mirror))) return false;
+        } else if (!visit_node(child, child_origin, half, mirror, enter, on_full, on_brick)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Visitor>
+void SVDAGStorage::for_each_occupied(Visitor&& visitor) const {
+    if (nodes_.empty()) return;
+    const Eigen::Vector3i dims = dimensions_;
+    auto enter = [&](const Eigen::Vector3i& origin, int) { return (origin.array() < dims.array()).all(); };
+    auto on_full = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z)
+            for (int y = origin.y(); y < end.y(); ++y)
+                for (int x = origin.x(); x < end.x(); ++x)
+                    visitor(Eigen::Vector3i(x, y, z));
+        return true;
+    };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        SVOStorage::for_each_brick_voxel(origin, mask, dims, visitor);
+        return true;
+    };
+    visit_node(root_, Eigen::Vector3i::Zero(), root_size_, 0, enter, on_full, on_brick);
+}
+
+} // namespace VXZ
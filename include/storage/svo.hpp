@@ -1,24 +1,91 @@
 #pragma once
 
 #include "voxelstorage.hpp"
+#include "block_array.hpp"
+#include <cstdint>
 #include <memory>
-#include <array>
+#include <vector>
 
 namespace VXZ {
 
 /**
- * @brief Node structure for Sparse Voxel Octree (SVO)
+ * @brief Node of the linearized Sparse Voxel Octree (8 bytes)
+ *
+ * child_mask marks the children holding any occupied voxel and full_mask the
+ * ones that are entirely occupied. Only children that are occupied but not
+ * full are stored; they are contiguous, in child order, starting at
+ * first_child. For nodes whose children are 4^3 leaf bricks first_child
+ * indexes the brick array, otherwise the node array.
+ *
+ * Child i covers the octant with x, y, z offset given by bits 0, 1, 2 of i.
  */
 struct SVONode {
-    bool is_leaf;
-    bool value;
-    std::array<std::unique_ptr<SVONode>, 8> children;
+    uint8_t child_mask;
+    uint8_t full_mask;
+    uint16_t reserved;
+    uint32_t first_child;
 
-    SVONode() : is_leaf(false), value(false) {}
+    SVONode() : child_mask(0), full_mask(0), reserved(0), first_child(0) {}
+
+    bool operator==(const SVONode& other) const {
+        return child_mask == other.child_mask && full_mask == other.full_mask && first_child == other.first_child;
+    }
+
+    /**
+     * @brief Offset of stored child i from first_child
+     */
+    uint32_t child_offset(int i) const {
+        return static_cast<uint32_t>(__builtin_popcount(child_mask & ~full_mask & ((1u << i) - 1)));
+    }
+};
+
+/**
+ * @brief Batch of voxel edits, applied in order by SVOStorage::apply
+ */
+class SVOEditBatch {
+public:
+    struct Edit {
+        Eigen::Vector3i min;
+        Eigen::Vector3i max;
+        bool value;
+    };
+
+    void set(const Eigen::Vector3i& position, bool value) { edits_.push_back(Edit{position, position, value}); }
+
+    /**
+     * @brief Set the inclusive box [min, max]
+     */
+    void set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value = true) {
+        edits_.push_back(Edit{min, max, value});
+    }
+
+    size_t size() const { return edits_.size(); }
+    bool empty() const { return edits_.empty(); }
+    void clear() { edits_.clear(); }
+    const std::vector<Edit>& edits() const { return edits_; }
+
+private:
+    std::vector<Edit> edits_;
 };
 
 /**
  * @brief Implementation of Sparse Voxel Octree storage
+ *
+ * Pointer-free octree: nodes are stored breadth-first in one array, the
+ * root first and each level after the one above it, and the leaves are 4^3
+ * bricks packed in a 64-bit mask (bit x + 4y + 16z). The octree is a cube of
+ * power-of-two size padded around the grid; padding is empty. Point queries
+ * walk one node per level.
+ *
+ * Edits copy the path from the root to every changed brick: the sibling
+ * groups on the path are appended anew, collapsing groups that became
+ * uniform and expanding full or empty children that are edited, and the
+ * root moves to the new copy. Untouched subtrees are shared, so a batch
+ * costs O(changed voxels x depth). The arrays are BlockArrays and never
+ * overwritten, which makes a copy of the storage (snapshot()) a consistent
+ * view that other threads may read while this one keeps editing. Edited
+ * trees are no longer breadth-first; compact() restores the layout and
+ * drops unreachable nodes, and runs by itself once the arrays have doubled.
  */
 class SVOStorage : public VoxelStorage {
 public:
@@ -35,56 +102,217 @@ public:
      * @param grid The voxel grid to convert
      * @return true if successful, false otherwise
      */
-    bool from_voxel_grid(const VXZ::VoxelGrid& grid);
+    bool from_voxel_grid(const VXZ::VoxelGrid& grid) override;
+    StorageType type() const override { return StorageType::SVO; }
 
-private:
-    std::unique_ptr<SVONode> root_;
-    size_t max_depth_;
-    size_t resolution_;
+    /**
+     * @brief Query a voxel
+     * @param position Grid coordinates
+     * @return Occupancy of the voxel
+     * @throws std::out_of_range if the position is outside the grid
+     */
+    bool get(const Eigen::Vector3i& position) const;
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
 
     /**
-     * @brief Recursively build SVO node
-     * @param node Current node
-     * @param grid Reference to voxel grid
-     * @param x,y,z Current position in grid
-     * @param size Current node size
-     * @param depth Current depth
+     * @brief Set a voxel in place
+     * @throws std::out_of_range if the position is outside the grid
      */
-    void build_node(SVONode* node, const VXZ::VoxelGrid& grid,
-                   size_t x, size_t y, size_t z,
-                   size_t size, size_t depth);
+    void set(const Eigen::Vector3i& position, bool value);
+    void set(int x, int y, int z, bool value) { set(Eigen::Vector3i(x, y, z), value); }
 
     /**
-     * @brief Recursively save node to file
-     * @param node Current node
-     * @param ofs Output file stream
+     * @brief Set the inclusive box [min, max], as VoxelGrid::set_region
+     * @throws std::out_of_range if a corner is outside the grid
      */
-    void save_node(const SVONode* node, std::ofstream& ofs) const;
+    void set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value = true);
 
     /**
-     * @brief Recursively load node from file
-     * @param node Current node
-     * @param ifs Input file stream
+     * @brief Apply a batch of edits in one pass over the tree
+     *
+     * Later edits override earlier ones. Nothing is changed if any edit is
+     * invalid.
+     * @throws std::out_of_range if an edit corner is outside the grid
      */
-    void load_node(SVONode* node, std::ifstream& ifs);
+    void apply(const SVOEditBatch& batch);
 
     /**
-     * @brief Recursively convert node to voxel grid
-     * @param node Current node
-     * @param grid Reference to voxel grid
-     * @param x,y,z Current position in grid
-     * @param size Current node size
+     * @brief Read-only copy sharing all unchanged nodes with this storage
+     *
+     * Must be taken on the thread that edits; it can then be read anywhere.
      */
-    void node_to_grid(const SVONode* node, VXZ::VoxelGrid& grid,
-                     size_t x, size_t y, size_t z,
-                     size_t size) const;
+    std::shared_ptr<const SVOStorage> snapshot() const { return std::make_shared<SVOStorage>(*this); }
 
     /**
-     * @brief Calculate memory usage of a node
-     * @param node Current node
-     * @return Size in bytes
+     * @brief Rewrite the tree breadth-first without unreachable nodes
      */
-    size_t calculate_node_size(const SVONode* node) const;
+    void compact();
+    bool is_compact() const { return compact_; }
+
+    /**
+     * @brief Visit every occupied voxel without expanding the tree
+     * @param visitor Called as visitor(const Eigen::Vector3i&)
+     */
+    template <typename Visitor>
+    void for_each_occupied(Visitor&& visitor) const;
+
+    /**
+     * @brief Test a box for occupied voxels
+     *
+     * Subtrees outside the box are skipped and the walk stops at the first
+     * full child or brick bit inside it.
+     * @param min,max Inclusive box corners in grid coordinates
+     * @return true if any voxel of the box (clipped to the grid) is occupied
+     */
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const;
+
+    /**
+     * @brief First occupied voxel along a ray
+     * @param origin Ray origin in world coordinates
+     * @param direction Ray direction (need not be normalized)
+     * @param max_distance Ray length in world units
+     * @param hit Grid coordinates of the first occupied voxel
+     * @return true if the ray hits an occupied voxel
+     */
+    bool raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                 float max_distance, Eigen::Vector3i& hit) const;
+
+    // Brick edge length in voxels
+    static constexpr int kBrickSize = 4;
+
+    float resolution() const { return resolution_; }
+    const Eigen::Vector3f& min_bounds() const { return min_bounds_; }
+    const Eigen::Vector3f& max_bounds() const { return max_bounds_; }
+    const Eigen::Vector3i& dimensions() const { return dimensions_; }
+    // Edge length of the padded octree cube in voxels
+    int root_size() const { return root_size_; }
+    // Number of node levels above the bricks
+    int depth() const { return depth_; }
+    // Index of the root node; 0 unless the tree was edited since compact()
+    uint32_t root() const { return root_; }
+    const BlockArray<SVONode>& nodes() const { return nodes_; }
+    const BlockArray<uint64_t>& bricks() const { return bricks_; }
+
+    /**
+     * @brief Whether nodes[0] roots a tree of depth node levels with every child in range
+     *
+     * Children of the bottom level index leaf_count leaves (bricks, or pages
+     * for the top levels of a PagedSVOStorage); those above index nodes, and
+     * no node may be reached twice. Used to check trees read from files.
+     */
+    static bool valid_tree(const SVONode* nodes, size_t node_count, uint64_t leaf_count, int depth);
+
+    /**
+     * @brief Brick bits inside a box given in brick-local coordinates
+     */
+    static uint64_t brick_box_mask(const Eigen::Vector3i& min, const Eigen::Vector3i& max);
+
+    /**
+     * @brief OR a brick at origin into a grid, clipped to the grid
+     */
+    static void write_brick(VXZ::VoxelGrid& grid, const Eigen::Vector3i& origin, uint64_t mask);
+
+    /**
+     * @brief Call visitor(position) for every set bit of a brick inside dims
+     */
+    template <typename Visitor>
+    static void for_each_brick_voxel(const Eigen::Vector3i& origin, uint64_t mask,
+                                     const Eigen::Vector3i& dims, Visitor& visitor);
+
+private:
+    float resolution_;
+    Eigen::Vector3f min_bounds_;
+    Eigen::Vector3f max_bounds_;
+    Eigen::Vector3i dimensions_;
+    int root_size_;
+    int depth_;
+
+    uint32_t root_;
+    BlockArray<SVONode> nodes_;
+    BlockArray<uint64_t> bricks_;
+    bool compact_;
+    // Array sizes after the last compaction
+    size_t compact_size_;
+
+    // Subtree during edits: uniform, or a node / brick not yet placed
+    struct EditCell {
+        uint8_t state;
+        SVONode node;
+        uint64_t brick;
+    };
+
+    EditCell apply_edits(const EditCell& cell, const Eigen::Vector3i& origin, int size,
+                         const std::vector<SVOEditBatch::Edit>& edits, const std::vector<uint32_t>& ids);
+    EditCell child_cell(const EditCell& cell, int child, int half) const;
+
+    /**
+     * @brief Visit the occupied parts of the subtree below a node
+     *
+     * Children for which enter(origin, size) is false are skipped. Calls
+     * on_full(origin, size) for every full child cube and
+     * on_brick(origin, mask) for every stored brick; either returns false
+     * to stop the walk.
+     * @return false if a visitor stopped the walk
+     */
+    template <typename Enter, typename FullVisitor, typename BrickVisitor>
+    bool visit_node(uint32_t index, const Eigen::Vector3i& origin, int size,
+                    Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const;
 };
 
-} // namespace VXZ 
\ No newline at end of file
+template <typename Visitor>
+void SVOStorage::for_each_brick_voxel(const Eigen::Vector3i& origin, uint64_t mask,
+                                      const Eigen::Vector3i& dims, Visitor& visitor) {
+    while (mask) {
+        const int b = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        const Eigen::Vector3i p = origin + Eigen::Vector3i(b & 3, (b >> 2) & 3, b >> 4);
+        if ((p.array() < dims.array()).all()) {
+            visitor(p);
+        }
+    }
+}
+
+template <typename Enter, typename FullVisitor, typename BrickVisitor>
+bool SVOStorage::visit_node(uint32_t index, const Eigen::Vector3i& origin, int size,
+                            Enter& enter, FullVisitor& on_full, BrickVisitor& on_brick) const {
+    const SVONode& node = nodes_[index];
+    const int half = size / 2;
+    for (int i = 0; i < 8; ++i) {
+        if (!(node.child_mask & (1u << i))) continue;
+        const Eigen::Vector3i child_origin = origin + half * Eigen::Vector3i(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+        if (!enter(child_origin, half)) continue;
+        if (node.full_mask & (1u << i)) {
+            if (!on_full(child_origin, half)) return false;
+            continue;
+        }
+        const uint32_t child = node.first_child + node.child_offset(i);
+        if (half == kBrickSize) {
+            if (!on_brick(child_origin, bricks_[child])) return false;
+        } else if (!visit_node(child, child_origin, half, enter, on_full, on_brick)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Visitor>
+void SVOStorage::for_each_occupied(Visitor&& visitor) const {
+    if (nodes_.empty()) return;
+    const Eigen::Vector3i dims = dimensions_;
+    auto enter = [&](const Eigen::Vector3i& origin, int) { return (origin.array() < dims.array()).all(); };
+    auto on_full = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z)
+            for (int y = origin.y(); y < end.y(); ++y)
+                for (int x = origin.x(); x < end.x(); ++x)
+                    visitor(Eigen::Vector3i(x, y, z));
+        return true;
+    };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        for_each_brick_voxel(origin, mask, dims, visitor);
+        return true;
+    };
+    visit_node(root_, Eigen::Vector3i::Zero(), root_size_, enter, on_full, on_brick);
+}
+
+} // namespace VXZ
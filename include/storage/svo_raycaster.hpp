@@ -0,0 +1,73 @@
+#pragma once
+
+#include "svo.hpp"
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Ray in world coordinates
+ */
+struct SVORay {
+    Eigen::Vector3f origin;
+    // Need not be normalized
+    Eigen::Vector3f direction;
+    float max_distance;
+};
+
+/**
+ * @brief Result of casting one ray
+ */
+struct SVORayHit {
+    bool hit;
+    // World distance from the origin to where the ray enters the voxel
+    float distance;
+    Eigen::Vector3i voxel;
+};
+
+/**
+ * @brief CPU ray casting on the linearized SVO
+ *
+ * Single rays use the parametric octree traversal of Revelles et al.: the
+ * ray is mirrored into the positive octant, and the children it crosses are
+ * found from the entry and exit parameters of the node alone, without
+ * per-voxel stepping. Full children end the ray at their entry point, and
+ * bricks are walked as two more octree levels on the brick mask.
+ *
+ * Packets of up to kMaxPacketSize rays are split by direction octant and each
+ * group is traversed in lockstep with Eigen arrays of 8 or 16 lanes. Visiting
+ * the children in ascending mirrored order is front to back for every ray of
+ * the group, so a lane simply drops out at its first hit.
+ */
+class SVORaycaster {
+public:
+    static constexpr int kMaxPacketSize = 16;
+
+    /**
+     * @brief Constructor
+     * @param svo Octree to cast against; must outlive the raycaster
+     */
+    explicit SVORaycaster(const SVOStorage& svo);
+
+    /**
+     * @brief Cast one ray
+     */
+    SVORayHit cast(const SVORay& ray) const;
+
+    /**
+     * @brief Cast up to kMaxPacketSize rays together
+     * @throws std::invalid_argument if count exceeds kMaxPacketSize
+     */
+    void cast_packet(const SVORay* rays, int count, SVORayHit* hits) const;
+
+    /**
+     * @brief Cast many rays in packets on all cores
+     * @param hits Resized to the number of rays
+     */
+    void cast_batch(const std::vector<SVORay>& rays, std::vector<SVORayHit>& hits) const;
+
+private:
+    const SVOStorage& svo_;
+};
+
+} // namespace VXZ
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "voxelstorage.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief Leaf of the VDB tree: 8^3 voxels, word z holds bit x + 8y
+ */
+struct VDBLeaf {
+    uint64_t words[8];
+};
+
+/**
+ * @brief Internal node of the VDB tree with (2^Log2)^3 child slots
+ *
+ * A slot is either empty, a tile (uniformly occupied) or a child. Children
+ * are stored contiguously in slot order from first_child; prefix[w] counts
+ * the children in the mask words before w, so a child is found by rank.
+ * Slot index is x + (y << Log2) + (z << 2 Log2) in child units.
+ */
+template <int Log2>
+struct VDBInternalNode {
+    static constexpr int kLog2 = Log2;
+    static constexpr int kSlots = 1 << (3 * Log2);
+    static constexpr int kWords = kSlots / 64;
+
+    uint64_t child_mask[kWords];
+    uint64_t tile_mask[kWords];
+    uint32_t prefix[kWords];
+    uint32_t first_child;
+    int32_t origin[3];
+
+    bool is_child(int slot) const { return (child_mask[slot >> 6] >> (slot & 63)) & 1; }
+    bool is_tile(int slot) const { return (tile_mask[slot >> 6] >> (slot & 63)) & 1; }
+    uint32_t child_index(int slot) const {
+        const uint64_t below = child_mask[slot >> 6] & ((uint64_t(1) << (slot & 63)) - 1);
+        return first_child + prefix[slot >> 6] + static_cast<uint32_t>(__builtin_popcountll(below));
+    }
+};
+
+// 16^3 leaves (128^3 voxels) and 32^3 lower nodes (4096^3 voxels), as in OpenVDB
+typedef VDBInternalNode<4> VDBLowerNode;
+typedef VDBInternalNode<5> VDBUpperNode;
+
+/**
+ * @brief Root table entry: an upper node keyed by its 4096^3 block
+ */
+struct VDBRootEntry {
+    uint64_t key;
+    uint32_t upper;
+    uint32_t reserved;
+};
+
+/**
+ * @brief Uniformly occupied cube of kLeafDim, kLowerDim or kUpperDim voxels, aligned to its size
+ */
+struct VDBTile {
+    Eigen::Vector3i origin;
+    int size;
+};
+
+/**
+ * @brief Leaf with the origin of its 8^3 block
+ */
+struct VDBLeafEntry {
+    Eigen::Vector3i origin;
+    VDBLeaf leaf;
+};
+
+/**
+ * @brief Header of the flat VDB form
+ *
+ * The flat form is the header followed by the root entries (sorted by key),
+ * the upper nodes, the lower nodes and the leaves, each section an array of
+ * the structs above. Every struct is a multiple of 8 bytes, so a buffer that
+ * starts 8-byte aligned can be queried in place.
+ */
+struct VDBHeader {
+    char magic[4];
+    uint32_t version;
+    float resolution;
+    float min_bounds[3];
+    float max_bounds[3];
+    int32_t dimensions[3];
+    uint64_t root_count;
+    uint64_t upper_count;
+    uint64_t lower_count;
+    uint64_t leaf_count;
+};
+
+/**
+ * @brief Read-only queries on a VDB tree held in flat arrays
+ *
+ * Used both on the vectors of VDBTreeStorage and in place on a loaded or
+ * memory-mapped flat buffer (FlatVDBStorage).
+ */
+class VDBTreeView {
+public:
+    // Voxel edge length of leaves, lower and upper nodes
+    static constexpr int kLeafDim = 8;
+    static constexpr int kLowerDim = kLeafDim << VDBLowerNode::kLog2;
+    static constexpr int kUpperDim = kLowerDim << VDBUpperNode::kLog2;
+
+    VDBTreeView();
+
+    /**
+     * @brief View a flat buffer
+     * @return false if the buffer is not a complete flat VDB form or fails valid()
+     */
+    bool attach(const void* data, size_t size);
+
+    /**
+     * @brief Check the tree before queries rely on it
+     *
+     * Requires positive dimensions, sorted root keys that match the origins
+     * of their upper nodes, and in every internal node disjoint tile and
+     * child masks, a correct prefix table and child indices inside the next
+     * level's array. Linear in the number of nodes.
+     */
+    bool valid() const;
+
+    const VDBHeader* header;
+    const VDBRootEntry* roots;
+    const VDBUpperNode* uppers;
+    const VDBLowerNode* lowers;
+    const VDBLeaf* leaves;
+
+    Eigen::Vector3i dimensions() const;
+
+    /**
+     * @brief Occupancy of a voxel; voxels outside the tree are empty
+     */
+    bool get(const Eigen::Vector3i& position) const;
+
+    /**
+     * @brief Test the box [min, max] (clipped to the grid) for occupied voxels
+     */
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const;
+
+    /**
+     * @brief First occupied voxel along a ray in world coordinates
+     */
+    bool raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                 float max_distance, Eigen::Vector3i& hit) const;
+
+    /**
+     * @brief Call visitor(position) for every occupied voxel inside the grid
+     */
+    template <typename Visitor>
+    void for_each_occupied(Visitor& visitor) const;
+
+    /**
+     * @brief Recreate the voxel grid
+     */
+    bool to_voxel_grid(VXZ::VoxelGrid& grid) const;
+
+    static uint64_t root_key(const Eigen::Vector3i& position);
+
+    /**
+     * @brief Visit the occupied parts of the tree
+     *
+     * Calls on_tile(origin, size) for every tile and
+     * on_leaf(origin, const VDBLeaf&) for every leaf.
+     */
+    template <typename TileVisitor, typename LeafVisitor>
+    void visit(TileVisitor& on_tile, LeafVisitor& on_leaf) const;
+
+private:
+    const VDBUpperNode* find_upper(uint64_t key) const;
+};
+
+/**
+ * @brief Sparse storage in a native VDB-layout tree
+ *
+ * Three-level tree of the OpenVDB layout (32^3 upper nodes, 16^3 lower
+ * nodes, 8^3 bitmask leaves) under a sorted root table. Uniformly occupied
+ * lower nodes and leaves are stored as tiles and empty ones not at all, so
+ * memory follows the occupied surface rather than the grid volume. The tree
+ * is built from the packed rows of a voxel grid, one lower node per task.
+ *
+ * save() writes the flat form described at VDBHeader in one pass; it can be
+ * loaded back here or queried in place by FlatVDBStorage.
+ *
+ * This is not backed by the OpenVDB library: the storage module has no
+ * OpenVDB dependency, and neither class reads or writes .vdb files.
+ * Exchange with OpenVDB goes through EnvironmentNAV3D::LoadFromOpenVDB and
+ * SaveToOpenVDB; from_nodes() lets the former keep the tiles of a .vdb
+ * grid as tiles.
+ */
+class VDBTreeStorage : public VoxelStorage {
+public:
+    VDBTreeStorage();
+    ~VDBTreeStorage() override = default;
+
+    bool save(const std::string& filename) const override;
+    bool load(const std::string& filename) override;
+    size_t get_size() const override;
+    bool to_voxel_grid(VXZ::VoxelGrid& grid) const override;
+    bool from_voxel_grid(const VXZ::VoxelGrid& grid) override;
+    StorageType type() const override { return StorageType::VDB_TREE; }
+
+    /**
+     * @brief Build the tree from tiles and leaves rather than from voxels
+     *
+     * Tiles are kept as tiles, a kUpperDim one as an upper node of tiles,
+     * and cover any leaves given inside them. Leaves at the same origin are
+     * merged; full ones become tiles and empty ones are dropped. Nodes may
+     * reach past dimensions, whose voxels queries do not see.
+     * @return false unless dimensions are positive and every tile and leaf
+     *         lies at non-negative coordinates, aligned to its size
+     */
+    bool from_nodes(float resolution, const Eigen::Vector3f& min_bounds, const Eigen::Vector3i& dimensions,
+                    const std::vector<VDBTile>& tiles, const std::vector<VDBLeafEntry>& leaves);
+
+    /**
+     * @brief Query a voxel
+     * @throws std::out_of_range if the position is outside the grid
+     */
+    bool get(const Eigen::Vector3i& position) const;
+    bool get(int x, int y, int z) const { return get(Eigen::Vector3i(x, y, z)); }
+
+    template <typename Visitor>
+    void for_each_occupied(Visitor&& visitor) const { view_.for_each_occupied(visitor); }
+
+    bool any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+        return view_.any_in_box(min, max);
+    }
+
+    bool raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                 float max_distance, Eigen::Vector3i& hit) const {
+        return view_.raycast(origin, direction, max_distance, hit);
+    }
+
+    Eigen::Vector3i dimensions() const { return view_.dimensions(); }
+
+    /**
+     * @brief Copy the tree into a flat buffer (see VDBHeader)
+     */
+    std::vector<uint64_t> flatten() const;
+
+    size_t upper_count() const { return uppers_.size(); }
+    size_t lower_count() const { return lowers_.size(); }
+    size_t leaf_count() const { return leaves_.size(); }
+
+private:
+    VDBHeader header_;
+    std::vector<VDBRootEntry> roots_;
+    std::vector<VDBUpperNode> uppers_;
+    std::vector<VDBLowerNode> lowers_;
+    std::vector<VDBLeaf> leaves_;
+    VDBTreeView view_;
+
+    // The view points into the members
+    VDBTreeStorage(const VDBTreeStorage&) = delete;
+    VDBTreeStorage& operator=(const VDBTreeStorage&) = delete;
+
+    void update_view();
+};
+
+template <typename TileVisitor, typename LeafVisitor>
+void VDBTreeView::visit(TileVisitor& on_tile, LeafVisitor& on_leaf) const {
+    if (!header) return;
+    for (uint64_t r = 0; r < header->root_count; ++r) {
+        const VDBUpperNode& upper = uppers[roots[r].upper];
+        const Eigen::Vector3i upper_origin(upper.origin[0], upper.origin[1], upper.origin[2]);
+        for (int w = 0; w < VDBUpperNode::kWords; ++w) {
+            uint64_t bits = upper.child_mask[w] | upper.tile_mask[w];
+            while (bits) {
+                const int slot = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                const Eigen::Vector3i lower_origin = upper_origin + kLowerDim * Eigen::Vector3i(
+                    slot & 31, (slot >> 5) & 31, slot >> 10);
+                if (upper.is_tile(slot)) {
+                    on_tile(lower_origin, kLowerDim);
+                    continue;
+                }
+                const VDBLowerNode& lower = lowers[upper.child_index(slot)];
+                for (int lw = 0; lw < VDBLowerNode::kWords; ++lw) {
+                    uint64_t lower_bits = lower.child_mask[lw] | lower.tile_mask[lw];
+                    while (lower_bits) {
+                        const int lower_slot = lw * 64 + __builtin_ctzll(lower_bits);
+                        lower_bits &= lower_bits - 1;
+                        const Eigen::Vector3i leaf_origin = lower_origin + kLeafDim * Eigen::Vector3i(
+                            lower_slot & 15, (lower_slot >> 4) & 15, lower_slot >> 8);
+                        if (lower.is_tile(lower_slot)) {
+                            on_tile(leaf_origin, kLeafDim);
+                        } else {
+                            on_leaf(leaf_origin, leaves[lower.child_index(lower_slot)]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+void VDBTreeView::for_each_occupied(Visitor& visitor) const {
+    if (!header) return;
+    const Eigen::Vector3i dims = dimensions();
+    auto on_tile = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z)
+            for (int y = origin.y(); y < end.y(); ++y)
+                for (int x = origin.x(); x < end.x(); ++x)
+                    visitor(Eigen::Vector3i(x, y, z));
+    };
+    auto on_leaf = [&](const Eigen::Vector3i& origin, const VDBLeaf& leaf) {
+        for (int z = 0; z < kLeafDim; ++z) {
+            uint64_t word = leaf.words[z];
+            while (word) {
+                const int b = __builtin_ctzll(word);
+                word &= word - 1;
+                const Eigen::Vector3i p = origin + Eigen::Vector3i(b & 7, b >> 3, z);
+                if ((p.array() < dims.array()).all()) {
+                    visitor(p);
+                }
+            }
+        }
+    };
+    visit(on_tile, on_leaf);
+}
+
+} // namespace VXZ
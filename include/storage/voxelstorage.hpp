@@ -9,10 +9,25 @@
 
 namespace VXZ {
 
-
+/**
+ * @brief Storage backend kinds, used for template dispatch of queries
+ */
+enum class StorageType {
+    DENSE,
+    SVO,
+    SVDAG,
+    VDB_TREE,
+    FLAT_VDB,
+    PAGED_SVO
+};
 
 /**
  * @brief Base class for all voxel storage types
+ *
+ * Voxel queries are not virtual: every backend offers get, any_in_box,
+ * raycast and for_each_occupied as plain (template) members working on its
+ * own compressed form, and dispatch_storage in storage_query.hpp selects the
+ * backend once per query from type().
  */
 class VoxelStorage {
 public:
@@ -44,8 +59,40 @@ public:
      * @return true if successful, false otherwise
      */
     virtual bool to_voxel_grid(VXZ::VoxelGrid& grid) const = 0;
+
+    /**
+     * @brief Replace the storage content with a voxel grid
+     * @param grid The voxel grid to convert
+     * @return true if successful, false otherwise
+     */
+    virtual bool from_voxel_grid(const VXZ::VoxelGrid& grid) = 0;
+
+    /**
+     * @brief Backend kind of this storage
+     */
+    virtual StorageType type() const = 0;
 };
 
+/**
+ * @brief Creates storage backends by name
+ *
+ * Known types: "dense", "svo", "svdag", "ssvdag" (symmetric SVDAG),
+ * "vdb_tree", "flat_vdb" and "paged_svo".
+ */
+class VoxelStorageFactory {
+public:
+    /**
+     * @brief Create an empty backend, e.g. to load() into
+     * @throws std::invalid_argument for an unknown type
+     */
+    static std::unique_ptr<VoxelStorage> create(const std::string& type);
 
+    /**
+     * @brief Create a backend holding a voxel grid
+     * @throws std::invalid_argument for an unknown type
+     * @throws std::runtime_error if the backend cannot represent the grid
+     */
+    static std::unique_ptr<VoxelStorage> create(const std::string& type, const VXZ::VoxelGrid& grid);
+};
 
 } // namespace VXZ
\ No newline at end of file
@@ -26,7 +26,6 @@ private:
     // Helper functions
     Eigen::Vector3f evaluate_cubic_spline(float t, int segment) const;
     Eigen::Vector3f evaluate_spline_derivative(float t, int segment) const;
-    bool is_point_in_corridor(const Eigen::Vector3f& point) const;
 };
 
 // 3D corridor voxelizer GPU implementation
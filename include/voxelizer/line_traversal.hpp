@@ -0,0 +1,380 @@
+#pragma once
+
+#include "voxelizer/line_voxelizer.hpp"
+#include <eigen3/Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace VXZ {
+
+/**
+ * @brief Allocation-free walk over the voxels of a line segment
+ *
+ * Enumerates the voxels that LineVoxelizerCPU would write for a segment, but
+ * hands each one to a visitor instead of a grid. The visitor is a template
+ * parameter, so the call is inlined without std::function overhead. It is
+ * called as `bool visitor(const Eigen::Vector3i& voxel)` and returns false to
+ * stop the walk early (e.g. at the first occupied voxel).
+ *
+ * Traversals:
+ * - BRESENHAM, ILV: integer 3D Bresenham, 26-connected
+ * - DDA: rounded incremental interpolation
+ * - RLV: exact grid walk of the real line (Amanatides & Woo), 6-connected
+ * - SLV: RLV plus both neighbours at edge/corner crossings (supercover)
+ * - TRIPOD, WU: walked as BRESENHAM; their binary footprint is the
+ *   26-connected digital line
+ */
+class LineTraversal {
+public:
+    /**
+     * @brief Segment between two voxel indices
+     * @param start First voxel
+     * @param end Last voxel
+     * @param algorithm Traversal to use
+     */
+    LineTraversal(const Eigen::Vector3i& start,
+                  const Eigen::Vector3i& end,
+                  LineAlgorithm algorithm = LineAlgorithm::BRESENHAM)
+        : start_voxel_(start),
+          end_voxel_(end),
+          start_(start.cast<float>() + Eigen::Vector3f::Constant(0.5f)),
+          end_(end.cast<float>() + Eigen::Vector3f::Constant(0.5f)),
+          algorithm_(algorithm) {}
+
+    /**
+     * @brief Segment between two continuous grid coordinates
+     *
+     * Voxel i spans [i, i + 1) along each axis.
+     */
+    LineTraversal(const Eigen::Vector3f& start,
+                  const Eigen::Vector3f& end,
+                  LineAlgorithm algorithm = LineAlgorithm::BRESENHAM)
+        : start_voxel_(start.array().floor().cast<int>()),
+          end_voxel_(end.array().floor().cast<int>()),
+          start_(start),
+          end_(end),
+          algorithm_(algorithm) {}
+
+    /**
+     * @brief Segment between two world positions of a grid
+     *
+     * Integer traversals use VoxelGrid::world_to_grid, exactly like
+     * LineVoxelizerCPU; RLV and SLV keep the sub-voxel position.
+     */
+    static LineTraversal from_world(const VoxelGrid& grid,
+                                    const Eigen::Vector3f& start,
+                                    const Eigen::Vector3f& end,
+                                    LineAlgorithm algorithm = LineAlgorithm::BRESENHAM) {
+        if (algorithm == LineAlgorithm::RLV || algorithm == LineAlgorithm::SLV) {
+            return LineTraversal(Eigen::Vector3f((start - grid.min_bounds()) / grid.resolution()),
+                                 Eigen::Vector3f((end - grid.min_bounds()) / grid.resolution()),
+                                 algorithm);
+        }
+        return LineTraversal(grid.world_to_grid(start), grid.world_to_grid(end), algorithm);
+    }
+
+    /**
+     * @brief Visit every voxel of the segment
+     * @return true if the walk completed, false if the visitor stopped it
+     */
+    template <typename Visitor>
+    bool for_each_voxel(Visitor&& visitor) const {
+        const int lo = std::numeric_limits<int>::min() / 4;
+        const int hi = std::numeric_limits<int>::max() / 4;
+        return walk(Eigen::Vector3i::Constant(lo), Eigen::Vector3i::Constant(hi), false, visitor);
+    }
+
+    /**
+     * @brief Visit the voxels of the segment inside [0, dims)
+     *
+     * The segment is clipped before walking, so the cost is proportional to
+     * the part that lies inside the grid.
+     * @return true if the walk completed, false if the visitor stopped it
+     */
+    template <typename Visitor>
+    bool for_each_voxel(const Eigen::Vector3i& dims, Visitor&& visitor) const {
+        return walk(Eigen::Vector3i::Zero(), dims - Eigen::Vector3i::Ones(), true, visitor);
+    }
+
+    const Eigen::Vector3i& start_voxel() const { return start_voxel_; }
+    const Eigen::Vector3i& end_voxel() const { return end_voxel_; }
+    LineAlgorithm algorithm() const { return algorithm_; }
+
+private:
+    Eigen::Vector3i start_voxel_;
+    Eigen::Vector3i end_voxel_;
+    Eigen::Vector3f start_;
+    Eigen::Vector3f end_;
+    LineAlgorithm algorithm_;
+
+    static bool inside(const Eigen::Vector3i& v, const Eigen::Vector3i& lo, const Eigen::Vector3i& hi) {
+        return (v.array() >= lo.array()).all() && (v.array() <= hi.array()).all();
+    }
+
+    // ceil(p / q) for q > 0
+    static long long ceil_div(long long p, long long q) {
+        return p >= 0 ? (p + q - 1) / q : -((-p) / q);
+    }
+
+    // Parametric range [t0, t1] of p0 + t (p1 - p0), t in [0, 1], inside [lo, hi]
+    static bool clip(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1,
+                     const Eigen::Vector3f& lo, const Eigen::Vector3f& hi,
+                     float& t0, float& t1) {
+        t0 = 0.0f;
+        t1 = 1.0f;
+        for (int a = 0; a < 3; ++a) {
+            float d = p1[a] - p0[a];
+            if (d == 0.0f) {
+                if (p0[a] < lo[a] || p0[a] > hi[a]) return false;
+                continue;
+            }
+            float ta = (lo[a] - p0[a]) / d;
+            float tb = (hi[a] - p0[a]) / d;
+            if (ta > tb) std::swap(ta, tb);
+            t0 = std::max(t0, ta);
+            t1 = std::min(t1, tb);
+            if (t0 > t1) return false;
+        }
+        return true;
+    }
+
+    // Step range [k0, k1] of an n-step integer walk that may touch [lo, hi]
+    bool step_range(int n, const Eigen::Vector3i& lo, const Eigen::Vector3i& hi, bool clipped,
+                    int& k0, int& k1) const {
+        k0 = 0;
+        k1 = n;
+        if (!clipped || n == 0) return true;
+        float t0, t1;
+        if (!clip(start_voxel_.cast<float>(), end_voxel_.cast<float>(),
+                  (lo - Eigen::Vector3i::Ones()).cast<float>(),
+                  (hi + Eigen::Vector3i::Ones()).cast<float>(), t0, t1)) {
+            return false;
+        }
+        k0 = std::max(0, static_cast<int>(std::floor(t0 * n)));
+        k1 = std::min(n, static_cast<int>(std::ceil(t1 * n)));
+        return k0 <= k1;
+    }
+
+    template <typename Visitor>
+    bool walk(const Eigen::Vector3i& lo, const Eigen::Vector3i& hi, bool clipped, Visitor& visitor) const {
+        switch (algorithm_) {
+            case LineAlgorithm::DDA:
+                return walk_dda(lo, hi, clipped, visitor);
+            case LineAlgorithm::RLV:
+                return walk_grid(lo, hi, clipped, false, visitor);
+            case LineAlgorithm::SLV:
+                return walk_grid(lo, hi, clipped, true, visitor);
+            default:
+                return walk_bresenham(lo, hi, clipped, visitor);
+        }
+    }
+
+    template <typename Visitor>
+    bool walk_bresenham(const Eigen::Vector3i& lo, const Eigen::Vector3i& hi, bool clipped,
+                        Visitor& visitor) const {
+        const Eigen::Vector3i delta = end_voxel_ - start_voxel_;
+        const Eigen::Vector3i adelta = delta.cwiseAbs();
+        Eigen::Vector3i step;
+        for (int a = 0; a < 3; ++a) step[a] = (start_voxel_[a] < end_voxel_[a]) ? 1 : -1;
+
+        // Dominant axis, ties resolved x before y before z
+        int d = 0;
+        if (adelta.y() > adelta[d]) d = 1;
+        if (adelta.z() > adelta[d]) d = 2;
+        const int a1 = (d + 1) % 3;
+        const int a2 = (d + 2) % 3;
+        const int n = adelta[d];
+
+        int k0, k1;
+        if (!step_range(n, lo, hi, clipped, k0, k1)) return true;
+
+        // Closed-form state after k0 steps: the secondary axis has advanced
+        // ceil((2ak - n) / 2n) times and its error term follows from that.
+        Eigen::Vector3i p = start_voxel_;
+        long long err1 = 2LL * adelta[a1] - n;
+        long long err2 = 2LL * adelta[a2] - n;
+        if (k0 > 0) {
+            long long c1 = std::max(0LL, ceil_div(2LL * adelta[a1] * k0 - n, 2LL * n));
+            long long c2 = std::max(0LL, ceil_div(2LL * adelta[a2] * k0 - n, 2LL * n));
+            p[d] += step[d] * k0;
+            p[a1] += step[a1] * static_cast<int>(c1);
+            p[a2] += step[a2] * static_cast<int>(c2);
+            err1 = 2LL * adelta[a1] * (k0 + 1) - n - 2LL * n * c1;
+            err2 = 2LL * adelta[a2] * (k0 + 1) - n - 2LL * n * c2;
+        }
+
+        bool entered = false;
+        for (int k = k0; k <= k1; ++k) {
+            if (inside(p, lo, hi)) {
+                entered = true;
+                if (!visitor(static_cast<const Eigen::Vector3i&>(p))) return false;
+            } else if (entered) {
+                break;
+            }
+            if (err1 > 0) {
+                p[a1] += step[a1];
+                err1 -= 2LL * n;
+            }
+            if (err2 > 0) {
+                p[a2] += step[a2];
+                err2 -= 2LL * n;
+            }
+            err1 += 2LL * adelta[a1];
+            err2 += 2LL * adelta[a2];
+            p[d] += step[d];
+        }
+        return true;
+    }
+
+    template <typename Visitor>
+    bool walk_dda(const Eigen::Vector3i& lo, const Eigen::Vector3i& hi, bool clipped,
+                  Visitor& visitor) const {
+        const Eigen::Vector3i delta = end_voxel_ - start_voxel_;
+        const int n = delta.cwiseAbs().maxCoeff();
+        if (n == 0) {
+            return !inside(start_voxel_, lo, hi) || visitor(start_voxel_);
+        }
+
+        int k0, k1;
+        if (!step_range(n, lo, hi, clipped, k0, k1)) return true;
+
+        const Eigen::Vector3f inc = delta.cast<float>() / static_cast<float>(n);
+        const Eigen::Vector3f origin = start_voxel_.cast<float>();
+        bool entered = false;
+        for (int k = k0; k <= k1; ++k) {
+            Eigen::Vector3f q = origin + inc * static_cast<float>(k);
+            Eigen::Vector3i p(static_cast<int>(std::round(q.x())),
+                              static_cast<int>(std::round(q.y())),
+                              static_cast<int>(std::round(q.z())));
+            if (inside(p, lo, hi)) {
+                entered = true;
+                if (!visitor(static_cast<const Eigen::Vector3i&>(p))) return false;
+            } else if (entered) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    template <typename Visitor>
+    bool walk_grid(const Eigen::Vector3i& lo, const Eigen::Vector3i& hi, bool clipped, bool supercover,
+                   Visitor& visitor) const {
+        const Eigen::Vector3f dir = end_ - start_;
+        const Eigen::Vector3i first = start_.array().floor().cast<int>();
+        const Eigen::Vector3i last = end_.array().floor().cast<int>();
+
+        const float inf = std::numeric_limits<float>::infinity();
+        Eigen::Vector3i step;
+        Eigen::Vector3f inv;
+        for (int a = 0; a < 3; ++a) {
+            step[a] = dir[a] > 0.0f ? 1 : (dir[a] < 0.0f ? -1 : 0);
+            inv[a] = step[a] != 0 ? 1.0f / dir[a] : 0.0f;
+        }
+        // Time at which the line leaves voxel x along axis a. It is computed
+        // from the voxel, never accumulated, so a clipped walk sees exactly
+        // the crossing times of the full walk and takes the same steps.
+        auto leave = [&](int a, int x) {
+            return step[a] == 0 ? inf : (static_cast<float>(step[a] > 0 ? x + 1 : x) - start_[a]) * inv[a];
+        };
+
+        Eigen::Vector3i v = first;
+        float t_in = -inf;
+        if (clipped) {
+            // The walk enters [lo, hi] at the latest of the crossings that
+            // bring an axis into range
+            for (int a = 0; a < 3; ++a) {
+                if (first[a] < lo[a]) {
+                    if (step[a] <= 0) return true;
+                    t_in = std::max(t_in, leave(a, lo[a] - 1));
+                } else if (first[a] > hi[a]) {
+                    if (step[a] >= 0) return true;
+                    t_in = std::max(t_in, leave(a, hi[a] + 1));
+                }
+            }
+            if (t_in > 1.0f) return true;
+            if (t_in > -inf) {
+                // Voxel of the full walk after the crossings before t_in: a
+                // float estimate, corrected against the crossing times
+                for (int a = 0; a < 3; ++a) {
+                    if (step[a] == 0) continue;
+                    int x = static_cast<int>(std::floor(start_[a] + dir[a] * t_in));
+                    if ((x - first[a]) * step[a] < 0) x = first[a];
+                    while (leave(a, x) < t_in) x += step[a];
+                    while (x != first[a] && leave(a, x - step[a]) >= t_in) x -= step[a];
+                    v[a] = x;
+                }
+            }
+        }
+
+        Eigen::Vector3f t_max(leave(0, v[0]), leave(1, v[1]), leave(2, v[2]));
+        bool entered = false;
+        const int max_steps = (last - v).cwiseAbs().sum();
+        for (int i = 0; i <= max_steps; ++i) {
+            if (!clipped || inside(v, lo, hi)) {
+                entered = true;
+                if (!visitor(static_cast<const Eigen::Vector3i&>(v))) return false;
+            } else if (entered) {
+                break;
+            }
+            if (v == last) break;
+
+            const float t_next = t_max.minCoeff();
+            // Past the end, or through the entry crossings without entering
+            if (t_next > 1.0f || (!entered && t_next > t_in)) break;
+            int axes = 0;
+            for (int a = 0; a < 3; ++a) {
+                if (t_max[a] == t_next) axes |= 1 << a;
+            }
+
+            if (supercover) {
+                // Crossing an edge or corner: visit the voxels sharing it
+                for (int subset = (axes - 1) & axes; subset > 0; subset = (subset - 1) & axes) {
+                    Eigen::Vector3i side = v;
+                    for (int a = 0; a < 3; ++a) {
+                        if (subset & (1 << a)) side[a] += step[a];
+                    }
+                    if (inside(side, lo, hi) && !visitor(static_cast<const Eigen::Vector3i&>(side))) {
+                        return false;
+                    }
+                }
+            } else {
+                axes &= -axes;
+            }
+
+            for (int a = 0; a < 3; ++a) {
+                if (axes & (1 << a)) {
+                    v[a] += step[a];
+                    t_max[a] = leave(a, v[a]);
+                }
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Find the first occupied voxel along a world-space segment
+ * @param grid Grid to query
+ * @param start Segment start in world coordinates
+ * @param end Segment end in world coordinates
+ * @param hit Set to the first occupied voxel if one is found
+ * @param algorithm Traversal to use
+ * @return true if an occupied voxel was found
+ */
+inline bool find_first_occupied(const VoxelGrid& grid,
+                                const Eigen::Vector3f& start,
+                                const Eigen::Vector3f& end,
+                                Eigen::Vector3i& hit,
+                                LineAlgorithm algorithm = LineAlgorithm::BRESENHAM) {
+    LineTraversal line = LineTraversal::from_world(grid, start, end, algorithm);
+    return !line.for_each_voxel(grid.dimensions(), [&](const Eigen::Vector3i& v) {
+        if (grid.get(v)) {
+            hit = v;
+            return false;
+        }
+        return true;
+    });
+}
+
+} // namespace VXZ
@@ -32,10 +32,46 @@ public:
 
     /**
      * @brief Voxelize the spline on CPU
+     *
+     * The spline is flattened to within a quarter voxel and the tube around
+     * each resulting piece is stamped with TubeVoxelizerCPU.
      * @param grid Reference to the voxel grid
      */
     void voxelize(VoxelGrid& grid) override;
 
+    /**
+     * @brief Flatten the spline into a polyline
+     *
+     * Segments are subdivided adaptively until their control polygon lies
+     * within tolerance of the chord, which bounds the distance between the
+     * curve and the polyline by tolerance. Straight stretches therefore
+     * produce few vertices and tight bends many.
+     * Pieces that do not meet end to end (Bezier windows) are concatenated,
+     * so the polyline bridges the gap between them with a straight chord.
+     * @param tolerance Maximum distance between curve and polyline
+     * @return Polyline vertices, empty for fewer than 4 control points
+     */
+    std::vector<Eigen::Vector3f> flatten(float tolerance) const;
+
+    /**
+     * @brief Flatten the spline into one polyline per connected piece
+     *
+     * Catmull-Rom and B-spline segments meet end to end and form one piece.
+     * Bezier segments use overlapping windows of control points, so each
+     * segment is its own piece.
+     * @param tolerance Maximum distance between curve and polyline
+     * @return Polylines in curve order, empty for fewer than 4 control points
+     */
+    std::vector<std::vector<Eigen::Vector3f>> flatten_pieces(float tolerance) const;
+
+    /**
+     * @brief Evaluate a point on one segment of the spline
+     * @param t Parameter in [0, 1] along the segment
+     * @param segment Segment index, in [0, control points - 3)
+     * @return Point on the curve
+     */
+    Eigen::Vector3f evaluate_spline(float t, int segment) const;
+
 private:
     std::vector<Eigen::Vector3f> control_points_;
     float radius_;
@@ -45,9 +81,10 @@ private:
     Eigen::Vector3f evaluate_catmull_rom(float t, int segment) const;
     Eigen::Vector3f evaluate_bspline(float t, int segment) const;
     Eigen::Vector3f evaluate_bezier(float t, int segment) const;
-    Eigen::Vector3f evaluate_spline(float t, int segment) const;
     Eigen::Vector3f evaluate_spline_derivative(float t, int segment) const;
-    bool is_point_in_spline(const Eigen::Vector3f& point) const;
+
+    // Cubic Bezier control points of a segment
+    void bezier_control_points(int segment, Eigen::Vector3f bezier[4]) const;
 };
 
 /**
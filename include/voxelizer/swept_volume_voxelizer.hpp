@@ -0,0 +1,118 @@
+#pragma once
+
+#include "voxelizer_base.hpp"
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Geometry>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief CPU voxelizer for the volume swept by a footprint along a trajectory
+ *
+ * The trajectory is a sequence of samples. The footprint is either a sphere
+ * with a per-sample radius or an oriented box with fixed half extents and a
+ * per-sample orientation. Between samples the pose is interpolated linearly
+ * (slerp for orientation) and stepped conservatively, so the voxelized
+ * volume contains the continuous sweep with no gaps:
+ * - Sphere: each interval is stamped as capsules whose radius is the larger
+ *   of their end radii, split so the radius changes by at most a quarter
+ *   voxel per capsule. Constant radius gives the exact sweep.
+ * - Box: each interval is split until no point of the box moves more than
+ *   half a voxel per step, and every step is stamped with its half extents
+ *   grown by half that motion bound.
+ *
+ * Intervals are processed in parallel in chunks and each footprint row span
+ * is OR-ed atomically into the target grid, so voxelize() accumulates into
+ * whatever the grid already holds.
+ */
+class SweptVolumeVoxelizerCPU : public VoxelizerCPU {
+public:
+    enum class Footprint {
+        SPHERE,
+        BOX
+    };
+
+    /**
+     * @brief Sphere footprint with a radius per sample
+     * @param positions Sample positions (at least one)
+     * @param radii Sphere radius at each sample
+     */
+    SweptVolumeVoxelizerCPU(const std::vector<Eigen::Vector3f>& positions,
+                            const std::vector<float>& radii);
+
+    /**
+     * @brief Oriented box footprint
+     * @param positions Sample positions of the box centre (at least one)
+     * @param orientations Box orientation at each sample
+     * @param half_extents Box half extents in its own frame
+     */
+    SweptVolumeVoxelizerCPU(const std::vector<Eigen::Vector3f>& positions,
+                            const std::vector<Eigen::Quaternionf>& orientations,
+                            const Eigen::Vector3f& half_extents);
+
+    /**
+     * @brief Oriented box swept along a spline
+     *
+     * The spline is flattened with SplineVoxelizerCPU::flatten and the box's
+     * x axis follows the direction of travel, its z axis staying as close to
+     * world up as the heading allows.
+     * @param control_points Spline control points
+     * @param spline_type Spline type as in SplineVoxelizerCPU
+     * @param half_extents Box half extents in its own frame
+     * @param tolerance Maximum distance between spline and sampled path
+     */
+    static SweptVolumeVoxelizerCPU along_spline(const std::vector<Eigen::Vector3f>& control_points,
+                                                int spline_type,
+                                                const Eigen::Vector3f& half_extents,
+                                                float tolerance);
+
+    /**
+     * @brief Voxelize the swept volume, OR-ing it into the grid
+     * @param grid Reference to the voxel grid
+     */
+    void voxelize(VoxelGrid& grid) override;
+
+    /**
+     * @brief Test the swept volume against an occupancy grid
+     *
+     * Uses the same spans as voxelize() without writing, and stops at the
+     * first occupied voxel. Suited to collision-checking many candidate
+     * trajectories against one map.
+     * @param grid Occupancy grid to test against
+     * @return true if any occupied voxel lies inside the swept volume
+     */
+    bool intersects(const VoxelGrid& grid) const;
+
+    /**
+     * @brief Number of trajectory intervals per parallel task
+     */
+    void set_chunk_size(size_t chunk_size) { chunk_size_ = chunk_size > 0 ? chunk_size : 1; }
+
+    Footprint footprint() const { return footprint_; }
+
+private:
+    Footprint footprint_;
+    std::vector<Eigen::Vector3f> positions_;
+    std::vector<float> radii_;
+    std::vector<Eigen::Quaternionf> orientations_;
+    Eigen::Vector3f half_extents_;
+    size_t chunk_size_;
+
+    /**
+     * @brief Call visitor(y, z, x_begin, x_end) for every footprint row span
+     *
+     * Spans are clipped to the grid and half-open. The visitor returns false
+     * to stop; this returns false if any visitor call did.
+     */
+    template <typename SpanVisitor>
+    bool for_each_span(const VoxelGrid& grid, SpanVisitor visitor) const;
+
+    template <typename SpanVisitor>
+    bool sphere_interval(const VoxelGrid& grid, size_t i, SpanVisitor& visitor) const;
+
+    template <typename SpanVisitor>
+    bool box_interval(const VoxelGrid& grid, size_t i, SpanVisitor& visitor) const;
+};
+
+} // namespace VXZ
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "voxelizer_base.hpp"
+#include <eigen3/Eigen/Dense>
+#include <vector>
+
+namespace VXZ {
+
+/**
+ * @brief X-interval of a grid row inside a capsule
+ *
+ * Computes the interval [lo, hi] of x where the point (x, y, z) lies within
+ * radius of the segment ab.
+ * @return false if the row misses the capsule
+ */
+bool capsule_row_span(const Eigen::Vector3f& a, const Eigen::Vector3f& b, float radius,
+                      float y, float z, float& lo, float& hi);
+
+/**
+ * @brief CPU voxelizer for a tube of constant radius around a polyline
+ *
+ * The tube is the union of one capsule per polyline segment. Segments are
+ * binned into tiles of the grid and each tile stamps, row by row, the
+ * x-spans where its capsules cut the row. Only tiles touched by the tube are
+ * visited, so the cost follows the tube volume rather than its bounding box.
+ * Tiles are processed in parallel; a tile is one storage word wide in x, so
+ * no two threads write the same word.
+ *
+ * A voxel is set when its grid_to_world position lies inside the tube, the
+ * same sampling as the other CPU voxelizers.
+ */
+class TubeVoxelizerCPU : public VoxelizerCPU {
+public:
+    /**
+     * @brief Constructor
+     * @param points Polyline vertices (at least one)
+     * @param radius Tube radius in world units
+     */
+    TubeVoxelizerCPU(const std::vector<Eigen::Vector3f>& points, float radius);
+
+    /**
+     * @brief Voxelize the tube on CPU
+     * @param grid Reference to the voxel grid
+     */
+    void voxelize(VoxelGrid& grid) override;
+
+    // Tile extent in voxels; x matches one storage word
+    static constexpr int kTileSizeX = VoxelGrid::kWordBits;
+    static constexpr int kTileSizeYZ = 16;
+
+private:
+    std::vector<Eigen::Vector3f> points_;
+    float radius_;
+};
+
+} // namespace VXZ
@@ -0,0 +1,49 @@
+#include "core/distance_field.hpp"
+#include <stdexcept>
+
+namespace VXZ {
+
+constexpr float DistanceField::kInfinity;
+
+DistanceField::DistanceField(float resolution,
+                             const Eigen::Vector3f& min_bounds,
+                             const Eigen::Vector3i& dimensions,
+                             bool with_nearest)
+    : resolution_(resolution),
+      min_bounds_(min_bounds),
+      dimensions_(dimensions) {
+    const size_t count = static_cast<size_t>(dimensions.x()) * dimensions.y() * dimensions.z();
+    distances_.assign(count, kInfinity);
+    if (with_nearest) {
+        if (count > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+            throw std::length_error("Too many voxels for a nearest-voxel channel");
+        }
+        nearest_.assign(count, -1);
+    }
+}
+
+Eigen::Vector3i DistanceField::position(size_t index) const {
+    const size_t plane = static_cast<size_t>(dimensions_.x()) * dimensions_.y();
+    const int z = static_cast<int>(index / plane);
+    const size_t rest = index % plane;
+    return Eigen::Vector3i(static_cast<int>(rest % dimensions_.x()), static_cast<int>(rest / dimensions_.x()), z);
+}
+
+float DistanceField::distance_at(const Eigen::Vector3f& world_pos) const {
+    const Eigen::Vector3f relative_pos = (world_pos - min_bounds_) / resolution_;
+    const Eigen::Vector3i position = relative_pos.array().floor().cast<int>();
+    if (!is_valid_position(position)) {
+        throw std::out_of_range("Position outside the distance field");
+    }
+    return get(position);
+}
+
+Eigen::Vector3i DistanceField::nearest(const Eigen::Vector3i& position) const {
+    if (nearest_.empty() || !is_valid_position(position)) {
+        return Eigen::Vector3i::Constant(-1);
+    }
+    const int32_t index = nearest_[this->index(position.x(), position.y(), position.z())];
+    return index < 0 ? Eigen::Vector3i::Constant(-1) : this->position(static_cast<size_t>(index));
+}
+
+} // namespace VXZ
@@ -0,0 +1,261 @@
+#include "core/dynamic_distance_field.hpp"
+#include "operator/distance_transform_operator.hpp"
+#include <cmath>
+#include <stdexcept>
+
+namespace VXZ {
+
+constexpr int32_t DynamicDistanceField::kUnreached;
+
+void DynamicDistanceField::BucketQueue::push(int32_t key, int32_t index) {
+    const size_t bucket = static_cast<size_t>(key);
+    if (bucket >= buckets_.size()) {
+        buckets_.resize(bucket + 1);
+    }
+    buckets_[bucket].push_back(index);
+    next_ = std::min(next_, bucket);
+    ++size_;
+}
+
+int32_t DynamicDistanceField::BucketQueue::pop() {
+    while (buckets_[next_].empty()) {
+        ++next_;
+    }
+    const int32_t index = buckets_[next_].back();
+    buckets_[next_].pop_back();
+    --size_;
+    return index;
+}
+
+DynamicDistanceField::DynamicDistanceField(float resolution,
+                                           const Eigen::Vector3f& min_bounds,
+                                           const Eigen::Vector3i& dimensions,
+                                           float max_distance)
+    : occupancy_(resolution, min_bounds,
+                 min_bounds + (dimensions.cast<float>().array() - 0.5f).matrix() * resolution),
+      max_distance_(max_distance) {
+    initialize();
+}
+
+DynamicDistanceField::DynamicDistanceField(const VoxelGrid& grid, float max_distance)
+    : occupancy_(grid),
+      max_distance_(max_distance) {
+    initialize();
+
+    const DistanceField field = DistanceTransformOperator(false, true).apply(grid);
+    const std::vector<int32_t>& nearest = field.nearest_indices();
+    for (size_t i = 0; i < squared_.size(); ++i) {
+        if (nearest[i] < 0) continue;
+        const Eigen::Vector3i d = position(static_cast<int32_t>(i)) - position(nearest[i]);
+        const int32_t squared = d.squaredNorm();
+        if (squared <= max_squared_) {
+            squared_[i] = squared;
+            assign(static_cast<int32_t>(i), nearest[i]);
+        }
+    }
+}
+
+void DynamicDistanceField::initialize() {
+    const Eigen::Vector3i& dims = occupancy_.dimensions();
+    const size_t count = static_cast<size_t>(dims.x()) * dims.y() * dims.z();
+    if (count > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+        throw std::length_error("Too many voxels for a dynamic distance field");
+    }
+    // Squared distances above the grid diagonal cannot occur
+    const double diagonal = static_cast<double>(dims.cast<double>().squaredNorm());
+    const double limit = max_distance_ / occupancy_.resolution();
+    max_squared_ = static_cast<int32_t>(std::min(diagonal, limit * limit));
+    squared_.assign(count, kUnreached);
+    site_.assign(count, -1);
+    raise_.assign(count, 0);
+    first_.assign(count, -1);
+    next_.assign(count, -1);
+    previous_.assign(count, -1);
+}
+
+void DynamicDistanceField::assign(int32_t voxel, int32_t site) {
+    const int32_t old = site_[voxel];
+    if (old == site) return;
+    if (old >= 0) {
+        const int32_t previous = previous_[voxel];
+        const int32_t next = next_[voxel];
+        (previous >= 0 ? next_[previous] : first_[old]) = next;
+        if (next >= 0) previous_[next] = previous;
+    }
+    site_[voxel] = site;
+    previous_[voxel] = -1;
+    next_[voxel] = -1;
+    if (site >= 0) {
+        next_[voxel] = first_[site];
+        if (first_[site] >= 0) previous_[first_[site]] = voxel;
+        first_[site] = voxel;
+    }
+}
+
+Eigen::Vector3i DynamicDistanceField::position(int32_t index) const {
+    const Eigen::Vector3i& dims = occupancy_.dimensions();
+    const int32_t plane = dims.x() * dims.y();
+    return Eigen::Vector3i(index % dims.x(), (index % plane) / dims.x(), index / plane);
+}
+
+void DynamicDistanceField::set_occupied(const Eigen::Vector3i& position) {
+    if (!occupancy_.is_valid_position(position)) {
+        throw std::out_of_range("Position outside the distance field");
+    }
+    if (occupancy_.get(position)) return;
+    occupancy_.set(position, true);
+    const int32_t i = index(position);
+    squared_[i] = 0;
+    assign(i, i);
+    raise_[i] = 0;
+    queue_.push(0, i);
+}
+
+void DynamicDistanceField::set_free(const Eigen::Vector3i& position) {
+    if (!occupancy_.is_valid_position(position)) {
+        throw std::out_of_range("Position outside the distance field");
+    }
+    if (!occupancy_.get(position)) return;
+    occupancy_.set(position, false);
+    const int32_t i = index(position);
+
+    // Voxels measured to this one are not always linked to it through
+    // neighbours with the same obstacle, so they are invalidated directly
+    // from its list rather than left to the raise wave
+    for (int32_t n = first_[i]; n >= 0;) {
+        const int32_t next = next_[n];
+        queue_.push(squared_[n], n);
+        squared_[n] = kUnreached;
+        assign(n, -1);
+        raise_[n] = 1;
+        n = next;
+    }
+}
+
+size_t DynamicDistanceField::update() {
+    size_t processed = 0;
+    while (!queue_.empty()) {
+        const int32_t i = queue_.pop();
+        ++processed;
+        if (raise_[i]) {
+            raise(i);
+        } else if (site_[i] >= 0 && occupancy_.get(position(site_[i]))) {
+            lower(i);
+        }
+    }
+    return processed;
+}
+
+size_t DynamicDistanceField::update(const std::vector<Eigen::Vector3i>& occupied,
+                                    const std::vector<Eigen::Vector3i>& freed) {
+    for (const Eigen::Vector3i& p : freed) set_free(p);
+    for (const Eigen::Vector3i& p : occupied) set_occupied(p);
+    return update();
+}
+
+size_t DynamicDistanceField::update(const VoxelGrid& grid) {
+    const Eigen::Vector3i& dims = occupancy_.dimensions();
+    if (grid.dimensions() != dims) {
+        throw std::invalid_argument("Grid dimensions differ from the distance field");
+    }
+    const size_t words = occupancy_.words_per_row();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            const uint64_t* current = occupancy_.row_data(y, z);
+            const uint64_t* target = grid.row_data(y, z);
+            for (size_t w = 0; w < words; ++w) {
+                for (uint64_t changed = current[w] ^ target[w]; changed; changed &= changed - 1) {
+                    const int bit = __builtin_ctzll(changed);
+                    const Eigen::Vector3i p(static_cast<int>(w) * VoxelGrid::kWordBits + bit, y, z);
+                    if ((target[w] >> bit) & 1) {
+                        set_occupied(p);
+                    } else {
+                        set_free(p);
+                    }
+                }
+            }
+        }
+    }
+    return update();
+}
+
+void DynamicDistanceField::raise(int32_t i) {
+    const Eigen::Vector3i p = position(i);
+    const Eigen::Vector3i& dims = occupancy_.dimensions();
+    for (int dz = -1; dz <= 1; ++dz) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                const Eigen::Vector3i q = p + Eigen::Vector3i(dx, dy, dz);
+                if ((q.array() < 0).any() || (q.array() >= dims.array()).any()) continue;
+                const int32_t n = index(q);
+                if (site_[n] < 0 || raise_[n]) continue;
+                // Requeue with the old distance: invalidated voxels raise
+                // further, intact ones start lower waves back into the gap
+                queue_.push(squared_[n], n);
+                if (!occupancy_.get(position(site_[n]))) {
+                    squared_[n] = kUnreached;
+                    assign(n, -1);
+                    raise_[n] = 1;
+                }
+            }
+        }
+    }
+    raise_[i] = 0;
+}
+
+void DynamicDistanceField::lower(int32_t i) {
+    const Eigen::Vector3i p = position(i);
+    const Eigen::Vector3i site = position(site_[i]);
+    const Eigen::Vector3i& dims = occupancy_.dimensions();
+    for (int dz = -1; dz <= 1; ++dz) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                const Eigen::Vector3i q = p + Eigen::Vector3i(dx, dy, dz);
+                if ((q.array() < 0).any() || (q.array() >= dims.array()).any()) continue;
+                const int32_t n = index(q);
+                if (raise_[n]) continue;
+                const int32_t squared = (q - site).squaredNorm();
+                if (squared < squared_[n] && squared <= max_squared_) {
+                    squared_[n] = squared;
+                    assign(n, site_[i]);
+                    queue_.push(squared, n);
+                }
+            }
+        }
+    }
+}
+
+float DynamicDistanceField::get(const Eigen::Vector3i& position) const {
+    if (!occupancy_.is_valid_position(position)) {
+        throw std::out_of_range("Position outside the distance field");
+    }
+    const int32_t squared = squared_[index(position)];
+    return squared == kUnreached ? DistanceField::kInfinity
+                                 : std::sqrt(static_cast<float>(squared)) * occupancy_.resolution();
+}
+
+float DynamicDistanceField::distance_at(const Eigen::Vector3f& world_pos) const {
+    const Eigen::Vector3f relative_pos = (world_pos - occupancy_.min_bounds()) / occupancy_.resolution();
+    return get(relative_pos.array().floor().cast<int>().matrix());
+}
+
+Eigen::Vector3i DynamicDistanceField::nearest(const Eigen::Vector3i& position) const {
+    if (!occupancy_.is_valid_position(position)) {
+        return Eigen::Vector3i::Constant(-1);
+    }
+    const int32_t site = site_[index(position)];
+    return site < 0 ? Eigen::Vector3i::Constant(-1) : this->position(site);
+}
+
+DistanceField DynamicDistanceField::to_distance_field() const {
+    DistanceField field(occupancy_.resolution(), occupancy_.min_bounds(), occupancy_.dimensions(), true);
+    for (size_t i = 0; i < squared_.size(); ++i) {
+        field.distances()[i] = squared_[i] == kUnreached
+            ? DistanceField::kInfinity
+            : std::sqrt(static_cast<float>(squared_[i])) * occupancy_.resolution();
+    }
+    field.nearest_indices() = site_;
+    return field;
+}
+
+} // namespace VXZ
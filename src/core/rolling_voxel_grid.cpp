@@ -0,0 +1,158 @@
+#include "core/rolling_voxel_grid.hpp"
+#include <stdexcept>
+
+namespace VXZ {
+
+namespace {
+
+int wrap_index(int value, int size) {
+    const int r = value % size;
+    return r < 0 ? r + size : r;
+}
+
+} // namespace
+
+RollingVoxelGrid::RollingVoxelGrid(float resolution,
+                                   const Eigen::Vector3f& min_bounds,
+                                   const Eigen::Vector3f& max_bounds)
+    : storage_(resolution, min_bounds, max_bounds),
+      offset_(Eigen::Vector3i::Zero()),
+      wrap_(Eigen::Vector3i::Zero()) {
+}
+
+Eigen::Vector3f RollingVoxelGrid::min_bounds() const {
+    return storage_.min_bounds() + offset_.cast<float>() * storage_.resolution();
+}
+
+Eigen::Vector3f RollingVoxelGrid::max_bounds() const {
+    return storage_.max_bounds() + offset_.cast<float>() * storage_.resolution();
+}
+
+Eigen::Vector3i RollingVoxelGrid::storage_position(const Eigen::Vector3i& position) const {
+    const Eigen::Vector3i& dims = storage_.dimensions();
+    Eigen::Vector3i p = position + wrap_;
+    for (int a = 0; a < 3; ++a) {
+        if (p[a] >= dims[a]) p[a] -= dims[a];
+    }
+    return p;
+}
+
+bool RollingVoxelGrid::get(const Eigen::Vector3i& position) const {
+    if (!storage_.is_valid_position(position)) {
+        throw std::out_of_range("Grid position out of range");
+    }
+    return storage_.get(storage_position(position));
+}
+
+void RollingVoxelGrid::set(const Eigen::Vector3i& position, bool value) {
+    if (!storage_.is_valid_position(position)) {
+        throw std::out_of_range("Grid position out of range");
+    }
+    storage_.set(storage_position(position), value);
+}
+
+Eigen::Vector3i RollingVoxelGrid::world_to_grid(const Eigen::Vector3f& world_pos) const {
+    Eigen::Vector3f relative_pos = world_pos - min_bounds();
+    return (relative_pos / storage_.resolution()).cast<int>();
+}
+
+Eigen::Vector3f RollingVoxelGrid::grid_to_world(const Eigen::Vector3i& grid_pos) const {
+    return min_bounds() + grid_pos.cast<float>() * storage_.resolution();
+}
+
+template <typename Visitor>
+void RollingVoxelGrid::for_each_storage_range(int axis, int first, int last, Visitor&& visitor) const {
+    const int size = storage_.dimensions()[axis];
+    const int begin = first + wrap_[axis] >= size ? first + wrap_[axis] - size : first + wrap_[axis];
+    const int end = begin + (last - first);
+    if (end <= size) {
+        visitor(begin, end);
+    } else {
+        visitor(begin, size);
+        visitor(0, end - size);
+    }
+}
+
+void RollingVoxelGrid::set_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value) {
+    const Eigen::Vector3i lo = min.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = max.cwiseMin(storage_.dimensions());
+    if ((lo.array() >= hi.array()).any()) {
+        return;
+    }
+    // A logical box is at most two storage ranges per axis
+    for_each_storage_range(2, lo.z(), hi.z(), [&](int z_begin, int z_end) {
+        for_each_storage_range(1, lo.y(), hi.y(), [&](int y_begin, int y_end) {
+            for_each_storage_range(0, lo.x(), hi.x(), [&](int x_begin, int x_end) {
+                for (int z = z_begin; z < z_end; ++z) {
+                    for (int y = y_begin; y < y_end; ++y) {
+                        storage_.set_span(y, z, x_begin, x_end, value);
+                    }
+                }
+            });
+        });
+    });
+}
+
+void RollingVoxelGrid::set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value) {
+    if (!storage_.is_valid_position(min) || !storage_.is_valid_position(max)) {
+        throw std::out_of_range("Region bounds out of range");
+    }
+    set_box(min, max + Eigen::Vector3i::Ones(), value);
+}
+
+void RollingVoxelGrid::scroll(const Eigen::Vector3i& steps) {
+    const Eigen::Vector3i& dims = storage_.dimensions();
+    offset_ += steps;
+    if ((steps.cwiseAbs().array() >= dims.array()).any()) {
+        storage_.clear();
+        for (int a = 0; a < 3; ++a) wrap_[a] = wrap_index(offset_[a], dims[a]);
+        return;
+    }
+    for (int a = 0; a < 3; ++a) wrap_[a] = wrap_index(wrap_[a] + steps[a], dims[a]);
+
+    // Clear the slab entering the window along each axis
+    for (int a = 0; a < 3; ++a) {
+        if (steps[a] == 0) continue;
+        Eigen::Vector3i min = Eigen::Vector3i::Zero();
+        Eigen::Vector3i max = dims;
+        if (steps[a] > 0) {
+            min[a] = dims[a] - steps[a];
+        } else {
+            max[a] = -steps[a];
+        }
+        set_box(min, max, false);
+    }
+}
+
+void RollingVoxelGrid::recenter(const Eigen::Vector3f& world_pos) {
+    const Eigen::Vector3f relative_pos = (world_pos - min_bounds()) / storage_.resolution();
+    const Eigen::Vector3i voxel = relative_pos.array().floor().cast<int>();
+    scroll(voxel - storage_.dimensions() / 2);
+}
+
+VoxelGrid RollingVoxelGrid::to_voxel_grid() const {
+    VoxelGrid grid(storage_.resolution(), min_bounds(), max_bounds());
+    const Eigen::Vector3i& dims = storage_.dimensions();
+    if (grid.dimensions() != dims) {
+        // Rounding of the moved bounds; keep the window size
+        grid = VoxelGrid(storage_.resolution(), min_bounds(),
+                         min_bounds() + (dims.cast<float>().array() - 0.5f).matrix() * storage_.resolution());
+    }
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            const Eigen::Vector3i from = storage_position(Eigen::Vector3i(0, y, z));
+            const uint64_t* source = storage_.row_data(from.y(), from.z());
+            uint64_t* target = grid.row_data(y, z);
+            for (size_t w = 0; w < storage_.words_per_row(); ++w) {
+                for (uint64_t bits = source[w]; bits; bits &= bits - 1) {
+                    int x = static_cast<int>(w) * VoxelGrid::kWordBits + __builtin_ctzll(bits) - wrap_.x();
+                    if (x < 0) x += dims.x();
+                    target[x / VoxelGrid::kWordBits] |= uint64_t(1) << (x % VoxelGrid::kWordBits);
+                }
+            }
+        }
+    }
+    return grid;
+}
+
+} // namespace VXZ
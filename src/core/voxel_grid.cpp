@@ -6,6 +6,8 @@
 
 namespace VXZ {
 
+constexpr int VoxelGrid::kWordBits;
+
 VoxelGrid::VoxelGrid(float resolution,
                     const Eigen::Vector3f& min_bounds,
                     const Eigen::Vector3f& max_bounds)
@@ -24,7 +26,8 @@ VoxelGrid::VoxelGrid(const VoxelGrid& other)
       min_bounds_(other.min_bounds_),
       max_bounds_(other.max_bounds_),
       dimensions_(other.dimensions_),
-      data_(other.data_) {
+      words_per_row_(other.words_per_row_),
+      words_(other.words_) {
 }
 
 VoxelGrid& VoxelGrid::operator=(const VoxelGrid& other) {
@@ -34,7 +37,8 @@ VoxelGrid& VoxelGrid::operator=(const VoxelGrid& other) {
         min_bounds_ = other.min_bounds_;
         max_bounds_ = other.max_bounds_;
         dimensions_ = other.dimensions_;
-        data_ = other.data_;
+        words_per_row_ = other.words_per_row_;
+        words_ = other.words_;
     }
     return *this;
 }
@@ -44,7 +48,8 @@ VoxelGrid::VoxelGrid(VoxelGrid&& other) noexcept
       min_bounds_(std::move(other.min_bounds_)),
       max_bounds_(std::move(other.max_bounds_)),
       dimensions_(std::move(other.dimensions_)),
-      data_(std::move(other.data_)) {
+      words_per_row_(other.words_per_row_),
+      words_(std::move(other.words_)) {
 }
 
 VoxelGrid& VoxelGrid::operator=(VoxelGrid&& other) noexcept {
@@ -54,7 +59,8 @@ VoxelGrid& VoxelGrid::operator=(VoxelGrid&& other) noexcept {
         min_bounds_ = std::move(other.min_bounds_);
         max_bounds_ = std::move(other.max_bounds_);
         dimensions_ = std::move(other.dimensions_);
-        data_ = std::move(other.data_);
+        words_per_row_ = other.words_per_row_;
+        words_ = std::move(other.words_);
     }
     return *this;
 }
@@ -64,8 +70,9 @@ void VoxelGrid::initialize() {
     Eigen::Vector3f size = max_bounds_ - min_bounds_;
     dimensions_ = (size / resolution_).cast<int>() + Eigen::Vector3i::Ones();
     
-    // Allocate memory
-    data_.resize(dimensions_.x() * dimensions_.y() * dimensions_.z(), false);
+    // Allocate memory, one word-aligned run of words per x-row
+    words_per_row_ = (static_cast<size_t>(dimensions_.x()) + kWordBits - 1) / kWordBits;
+    words_.assign(words_per_row_ * dimensions_.y() * dimensions_.z(), 0);
 }
 
 void VoxelGrid::cleanup() {
@@ -76,16 +83,17 @@ bool VoxelGrid::get(const Eigen::Vector3i& position) const {
     if (!is_valid_position(position)) {
         throw std::out_of_range("Grid position out of range");
     }
-    return data_[position.x() + position.y() * dimensions_.x() +
-                position.z() * dimensions_.x() * dimensions_.y()];
+    const uint64_t word = row_data(position.y(), position.z())[position.x() / kWordBits];
+    return (word >> (position.x() % kWordBits)) & 1;
 }
 
 void VoxelGrid::set(const Eigen::Vector3i& position, bool value) {
     if (!is_valid_position(position)) {
         throw std::out_of_range("Grid position out of range");
     }
-    data_[position.x() + position.y() * dimensions_.x() +
-         position.z() * dimensions_.x() * dimensions_.y()] = value;
+    uint64_t& word = row_data(position.y(), position.z())[position.x() / kWordBits];
+    const uint64_t bit = uint64_t(1) << (position.x() % kWordBits);
+    word = value ? (word | bit) : (word & ~bit);
 }
 
 Eigen::Vector3i VoxelGrid::world_to_grid(const Eigen::Vector3f& world_pos) const {
@@ -108,7 +116,14 @@ bool VoxelGrid::is_inside_grid(const Eigen::Vector3i& position) const {
 }
 
 void VoxelGrid::fill(bool value) {
-    std::fill(data_.begin(), data_.end(), value);
+    std::fill(words_.begin(), words_.end(), value ? ~uint64_t(0) : uint64_t(0));
+    if (value && words_per_row_ > 0) {
+        // Keep the padding bits of every row clear
+        const uint64_t tail = row_tail_mask();
+        for (size_t i = words_per_row_ - 1; i < words_.size(); i += words_per_row_) {
+            words_[i] &= tail;
+        }
+    }
 }
 
 void VoxelGrid::set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value) {
@@ -121,22 +136,47 @@ void VoxelGrid::set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& ma
     Eigen::Vector3i grid_min = min.cwiseMax(Eigen::Vector3i::Zero());
     Eigen::Vector3i grid_max = max.cwiseMin(dimensions_ - Eigen::Vector3i::Ones());
     
-    // Set values in the region
-    for (int x = grid_min.x(); x <= grid_max.x(); ++x) {
+    // Set values in the region, one row span at a time
+    for (int z = grid_min.z(); z <= grid_max.z(); ++z) {
         for (int y = grid_min.y(); y <= grid_max.y(); ++y) {
-            for (int z = grid_min.z(); z <= grid_max.z(); ++z) {
-                set(Eigen::Vector3i(x, y, z), value);
-            }
+            set_span(y, z, grid_min.x(), grid_max.x() + 1, value);
         }
     }
 }
 
+void VoxelGrid::set_span(int y, int z, int x_begin, int x_end, bool value) {
+    if (y < 0 || y >= dimensions_.y() || z < 0 || z >= dimensions_.z()) {
+        return;
+    }
+    x_begin = std::max(x_begin, 0);
+    x_end = std::min(x_end, dimensions_.x());
+    if (x_begin >= x_end) {
+        return;
+    }
+
+    uint64_t* row = row_data(y, z);
+    const int first = x_begin / kWordBits;
+    const int last = (x_end - 1) / kWordBits;
+    const uint64_t head = ~uint64_t(0) << (x_begin % kWordBits);
+    const uint64_t tail = ~uint64_t(0) >> (kWordBits - 1 - (x_end - 1) % kWordBits);
+    for (int w = first; w <= last; ++w) {
+        uint64_t mask = ~uint64_t(0);
+        if (w == first) mask &= head;
+        if (w == last) mask &= tail;
+        row[w] = value ? (row[w] | mask) : (row[w] & ~mask);
+    }
+}
+
 size_t VoxelGrid::count_occupied() const {
-    return std::count(data_.begin(), data_.end(), true);
+    size_t count = 0;
+    for (uint64_t word : words_) {
+        count += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return count;
 }
 
 float VoxelGrid::occupancy_rate() const {
-    return static_cast<float>(count_occupied()) / data_.size();
+    return static_cast<float>(count_occupied()) / dimensions_.prod();
 }
 
 void VoxelGrid::save(const std::string &filename) const
@@ -170,14 +210,18 @@ VoxelGrid VoxelGrid::load(const std::string &filename)
     VoxelGrid grid(resolution, min_bounds, max_bounds);
 
     // 读取体素数据
-    std::vector<bool> data(dimensions.prod());
-    for (size_t i = 0; i < data.size(); ++i) {
-        char value;
-        file.read(&value, sizeof(char));
-        data[i] = static_cast<bool>(value);
+    for (int z = 0; z < dimensions.z(); ++z) {
+        for (int y = 0; y < dimensions.y(); ++y) {
+            for (int x = 0; x < dimensions.x(); ++x) {
+                char value;
+                file.read(&value, sizeof(char));
+                if (value && grid.is_valid_position(Eigen::Vector3i(x, y, z))) {
+                    grid.set(x, y, z, true);
+                }
+            }
+        }
     }
 
-    grid.data_ = std::move(data);
     return grid;
 }
 } // namespace VXZ
\ No newline at end of file
@@ -1,11 +1,45 @@
 
 // EnvironmentNAV3D.cpp
 #include "environment/EnvironmentNAV3D.hpp"
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <sbpl/utils/key.h>
 #include <openvdb/openvdb.h>
 #include <openvdb/io/Stream.h>
 
+namespace
+{
+// The named grid of a .vdb file; nullptr if it is not a bool grid
+openvdb::BoolGrid::Ptr ReadBoolGrid(const std::string &filename, const std::string &gridName)
+{
+    openvdb::initialize();
+    openvdb::io::File file(filename);
+    file.open();
+    auto bgrid = openvdb::gridPtrCast<openvdb::BoolGrid>(file.readGrid(gridName));
+    file.close();
+    return bgrid;
+}
+
+// Calls on_tile(const openvdb::CoordBBox&) for every active tile and
+// on_leaf(const LeafNodeType&) for every leaf, so tiles are never expanded
+template <typename TileVisitor, typename LeafVisitor>
+void VisitBoolTree(const openvdb::BoolTree &tree, TileVisitor &&on_tile, LeafVisitor &&on_leaf)
+{
+    // Values above the leaf level are tiles
+    auto tiles = tree.cbeginValueOn();
+    tiles.setMaxDepth(tiles.getLeafDepth() - 1);
+    for (; tiles; ++tiles)
+    {
+        openvdb::CoordBBox box;
+        tiles.getBoundingBox(box);
+        on_tile(box);
+    }
+    for (auto leaf = tree.cbeginLeaf(); leaf; ++leaf)
+        on_leaf(*leaf);
+}
+} // namespace
+
 EnvironmentNAV3D::EnvironmentNAV3D(double x_min, double x_max,
                                    double y_min, double y_max,
                                    double z_min, double z_max,
@@ -15,12 +49,12 @@ EnvironmentNAV3D::EnvironmentNAV3D(double x_min, double x_max,
       miny_(y_min), maxy_(y_max),
       minz_(z_min), maxz_(z_max),
       resolution_(resolution), h_type_(h_type),
-      startID_(-1), goalID_(-1)
+      map_(nullptr), min_clearance_(0.0), startID_(-1), goalID_(-1)
 {
     size_x_ = static_cast<int>(std::ceil((maxx_ - minx_) / resolution_));
     size_y_ = static_cast<int>(std::ceil((maxy_ - miny_) / resolution_));
     size_z_ = static_cast<int>(std::ceil((maxz_ - minz_) / resolution_));
-    grid_.assign(size_x_ * size_y_ * size_z_, 0);
+    grid_ = MakeGrid();
     InitMotionPrimitives(true);
     setNumDims(3);
     setGridSize(size_x_, size_y_, size_z_);
@@ -36,6 +70,8 @@ void EnvironmentNAV3D::SetStart(double wx, double wy, double wz)
     int ix = (wx - minx_) / resolution_, iy = (wy - miny_) / resolution_, iz = (wz - minz_) / resolution_;
     startID_ = StateIDFromCoord(ix, iy, iz);
     setStart(startID_);
+    if (map_)
+        map_->set_focus(Eigen::Vector3f(wx, wy, wz));
 }
 void EnvironmentNAV3D::SetGoal(double wx, double wy, double wz)
 {
@@ -45,8 +81,104 @@ void EnvironmentNAV3D::SetGoal(double wx, double wy, double wz)
 }
 void EnvironmentNAV3D::SetObstacle(int ix, int iy, int iz)
 {
-    if (ix >= 0 && iy >= 0 && iz >= 0 && ix < size_x_ && iy < size_y_ && iz < size_z_)
-        grid_[ToIndex(ix, iy, iz)] = 1;
+    if (ix < 0 || iy < 0 || iz < 0 || ix >= size_x_ || iy >= size_y_ || iz >= size_z_)
+        return;
+    if (map_)
+        map_->set(ToMapVoxel(ix, iy, iz), true);
+    else
+        grid_->set(ix, iy, iz, true);
+    if (distance_field_)
+        distance_field_->set_occupied(Eigen::Vector3i(ix, iy, iz));
+}
+
+void EnvironmentNAV3D::SetObstacleBox(int ix0, int iy0, int iz0, int ix1, int iy1, int iz1)
+{
+    ix0 = std::max(ix0, 0), iy0 = std::max(iy0, 0), iz0 = std::max(iz0, 0);
+    ix1 = std::min(ix1, size_x_ - 1), iy1 = std::min(iy1, size_y_ - 1), iz1 = std::min(iz1, size_z_ - 1);
+    if (ix0 > ix1 || iy0 > iy1 || iz0 > iz1)
+        return;
+    // The map voxels at the cell centres of the box span the box in the map
+    if (map_)
+        map_->set_region(ToMapVoxel(ix0, iy0, iz0), ToMapVoxel(ix1, iy1, iz1));
+    else
+        grid_->set_region(Eigen::Vector3i(ix0, iy0, iz0), Eigen::Vector3i(ix1, iy1, iz1));
+    if (distance_field_)
+        for (int iz = iz0; iz <= iz1; ++iz)
+            for (int iy = iy0; iy <= iy1; ++iy)
+                for (int ix = ix0; ix <= ix1; ++ix)
+                    distance_field_->set_occupied(Eigen::Vector3i(ix, iy, iz));
+}
+
+void EnvironmentNAV3D::ClearObstacle(int ix, int iy, int iz)
+{
+    if (ix < 0 || iy < 0 || iz < 0 || ix >= size_x_ || iy >= size_y_ || iz >= size_z_)
+        return;
+    if (map_)
+        map_->set(ToMapVoxel(ix, iy, iz), false);
+    else
+        grid_->set(ix, iy, iz, false);
+    if (distance_field_)
+        distance_field_->set_free(Eigen::Vector3i(ix, iy, iz));
+}
+
+bool EnvironmentNAV3D::EnableDistanceField(double max_distance)
+{
+    // A field over the whole box would defeat the bounded memory of the map
+    if (map_)
+        return false;
+    distance_field_.reset(new VXZ::DynamicDistanceField(*grid_, static_cast<float>(max_distance)));
+    return true;
+}
+
+void EnvironmentNAV3D::UpdateDistanceField()
+{
+    if (distance_field_)
+        distance_field_->update();
+}
+
+double EnvironmentNAV3D::GetClearance(int ix, int iy, int iz) const
+{
+    if (ix < 0 || iy < 0 || iz < 0 || ix >= size_x_ || iy >= size_y_ || iz >= size_z_)
+        return 0.0;
+    if (!distance_field_)
+        return std::numeric_limits<double>::infinity();
+    return distance_field_->get(ix, iy, iz);
+}
+
+void EnvironmentNAV3D::SetChunkedMap(VXZ::ChunkedMap *map)
+{
+    map_ = map;
+    // The dense grid and the distance field are only kept without a map, so
+    // memory stays bounded
+    if (map_) {
+        grid_.reset();
+        distance_field_.reset();
+    } else {
+        grid_ = MakeGrid();
+    }
+}
+
+std::unique_ptr<VXZ::VoxelGrid> EnvironmentNAV3D::MakeGrid() const
+{
+    // Half a cell of slack keeps the dimensions exact under rounding
+    const Eigen::Vector3f min(minx_, miny_, minz_);
+    const Eigen::Vector3f extent(size_x_ - 0.5f, size_y_ - 0.5f, size_z_ - 0.5f);
+    return std::unique_ptr<VXZ::VoxelGrid>(
+        new VXZ::VoxelGrid(static_cast<float>(resolution_), min, min + extent * static_cast<float>(resolution_)));
+}
+
+bool EnvironmentNAV3D::IsOccupied(int ix, int iy, int iz) const
+{
+    if (ix < 0 || iy < 0 || iz < 0 || ix >= size_x_ || iy >= size_y_ || iz >= size_z_)
+        return true;
+    return map_ ? map_->get(ToMapVoxel(ix, iy, iz)) : grid_->get(ix, iy, iz);
+}
+
+Eigen::Vector3i EnvironmentNAV3D::ToMapVoxel(int ix, int iy, int iz) const
+{
+    return map_->world_to_voxel(Eigen::Vector3f(minx_ + (ix + 0.5) * resolution_,
+                                                miny_ + (iy + 0.5) * resolution_,
+                                                minz_ + (iz + 0.5) * resolution_));
 }
 
 bool EnvironmentNAV3D::LoadFromOctoMap(const std::string &filename)
@@ -57,50 +189,81 @@ bool EnvironmentNAV3D::LoadFromOctoMap(const std::string &filename)
         {
             auto c = it.getCoordinate();
             int ix = (c.x() - minx_) / resolution_, iy = (c.y() - miny_) / resolution_, iz = (c.z() - minz_) / resolution_;
-            if (ix >= 0 && iy >= 0 && iz >= 0 && ix < size_x_ && iy < size_y_ && iz < size_z_)
-                grid_[ToIndex(ix, iy, iz)] = 1;
+            SetObstacle(ix, iy, iz);
         }
     return true;
 }
 bool EnvironmentNAV3D::SaveToOctoMap(const std::string &filename) const
 {
     octomap::OcTree tree(resolution_);
-    for (int iz = 0; iz < size_z_; ++iz)
-        for (int iy = 0; iy < size_y_; ++iy)
-            for (int ix = 0; ix < size_x_; ++ix)
-                if (grid_[ToIndex(ix, iy, iz)])
-                    tree.updateNode(octomap::point3d(minx_ + ix * resolution_, miny_ + iy * resolution_, minz_ + iz * resolution_), true);
+    ForEachOccupied([&](int ix, int iy, int iz)
+                    { tree.updateNode(octomap::point3d(minx_ + ix * resolution_, miny_ + iy * resolution_, minz_ + iz * resolution_), true); });
     tree.writeBinary(filename);
     return true;
 }
 
 bool EnvironmentNAV3D::LoadFromOpenVDB(const std::string &filename, const std::string &gridName)
 {
-    openvdb::initialize();
-    openvdb::io::File file(filename);
-    file.open();
-    auto base = file.readGrid(gridName);
-    auto bgrid = openvdb::gridPtrCast<openvdb::BoolGrid>(base);
-    for (auto iter = bgrid->cbeginValueOn(); iter.test(); ++iter)
-    {
-        auto c = iter.getCoord();
-        if (c.x() >= 0 && c.y() >= 0 && c.z() >= 0 && c.x() < size_x_ && c.y() < size_y_ && c.z() < size_z_)
-            grid_[ToIndex(c.x(), c.y(), c.z())] = 1;
-    }
-    file.close();
+    auto bgrid = ReadBoolGrid(filename, gridName);
+    if (!bgrid)
+        return false;
+    VisitBoolTree(bgrid->tree(),
+                  [&](const openvdb::CoordBBox &box)
+                  { SetObstacleBox(box.min().x(), box.min().y(), box.min().z(), box.max().x(), box.max().y(), box.max().z()); },
+                  [&](const openvdb::BoolTree::LeafNodeType &leaf)
+                  {
+                      for (auto iter = leaf.cbeginValueOn(); iter; ++iter)
+                      {
+                          const openvdb::Coord c = iter.getCoord();
+                          SetObstacle(c.x(), c.y(), c.z());
+                      }
+                  });
     return true;
 }
+bool EnvironmentNAV3D::LoadFromOpenVDB(const std::string &filename, VXZ::VDBTreeStorage &tree,
+                                       const std::string &gridName) const
+{
+    auto bgrid = ReadBoolGrid(filename, gridName);
+    if (!bgrid)
+        return false;
+    // Both trees have 8^3 leaves and nodes of 16^3 and 32^3 children, so the
+    // nodes carry over; those at negative coordinates lie outside the cells
+    std::vector<VXZ::VDBTile> tiles;
+    std::vector<VXZ::VDBLeafEntry> leaves;
+    VisitBoolTree(bgrid->tree(),
+                  [&](const openvdb::CoordBBox &box)
+                  {
+                      const openvdb::Coord o = box.min();
+                      if (o.x() >= 0 && o.y() >= 0 && o.z() >= 0)
+                          tiles.push_back(VXZ::VDBTile{Eigen::Vector3i(o.x(), o.y(), o.z()), box.dim().x()});
+                  },
+                  [&](const openvdb::BoolTree::LeafNodeType &leaf)
+                  {
+                      const openvdb::Coord o = leaf.origin();
+                      if (o.x() < 0 || o.y() < 0 || o.z() < 0)
+                          return;
+                      VXZ::VDBLeafEntry entry{Eigen::Vector3i(o.x(), o.y(), o.z()), VXZ::VDBLeaf()};
+                      // OpenVDB numbers leaf voxels x-major with z fastest
+                      for (auto on = leaf.getValueMask().beginOn(); on; ++on)
+                      {
+                          const openvdb::Index n = on.pos();
+                          entry.leaf.words[n & 7] |= uint64_t(1) << ((n >> 6) | ((n >> 3) & 7) << 3);
+                      }
+                      leaves.push_back(entry);
+                  });
+    return tree.from_nodes(static_cast<float>(resolution_), Eigen::Vector3f(minx_, miny_, minz_),
+                           Eigen::Vector3i(size_x_, size_y_, size_z_), tiles, leaves);
+}
 bool EnvironmentNAV3D::SaveToOpenVDB(const std::string &filename, const std::string &gridName) const
 {
     openvdb::initialize();
     auto bgrid = openvdb::BoolGrid::create(false);
     bgrid->setName(gridName);
     bgrid->setTransform(openvdb::math::Transform::createLinearTransform(resolution_));
-    for (int iz = 0; iz < size_z_; ++iz)
-        for (int iy = 0; iy < size_y_; ++iy)
-            for (int ix = 0; ix < size_x_; ++ix)
-                if (grid_[ToIndex(ix, iy, iz)])
-                    bgrid->tree().setValue(openvdb::Coord(ix, iy, iz), true);
+    // Through an accessor, which caches the leaf of the previous cell
+    auto accessor = bgrid->getAccessor();
+    ForEachOccupied([&](int ix, int iy, int iz)
+                    { accessor.setValue(openvdb::Coord(ix, iy, iz), true); });
     openvdb::io::File file(filename);
     file.write({bgrid});
     file.close();
@@ -141,9 +304,9 @@ void EnvironmentNAV3D::GetSuccs(int s, std::vector<int> *succ, std::vector<int>
         int dx, dy, dz, c;
         std::tie(dx, dy, dz, c) = m;
         int nx = ix + dx, ny = iy + dy, nz = iz + dz;
-        if (nx < 0 || ny < 0 || nz < 0 || nx >= size_x_ || ny >= size_y_ || nz >= size_z_)
+        if (IsOccupied(nx, ny, nz))
             continue;
-        if (grid_[ToIndex(nx, ny, nz)])
+        if (min_clearance_ > 0.0 && GetClearance(nx, ny, nz) < min_clearance_)
             continue;
         int ns = StateIDFromCoord(nx, ny, nz);
         succ->push_back(ns);
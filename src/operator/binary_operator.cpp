@@ -0,0 +1,134 @@
+#include "operator/binary_operator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace VXZ {
+
+namespace {
+
+// 64 bits of a packed row starting at bit `start`; bits outside the row are zero
+inline uint64_t load_bits(const uint64_t* row, int words, int start) {
+    if (start < 0) {
+        return start > -VoxelGrid::kWordBits ? row[0] << -start : 0;
+    }
+    const int index = start / VoxelGrid::kWordBits;
+    const int shift = start % VoxelGrid::kWordBits;
+    const uint64_t low = index < words ? row[index] : 0;
+    if (shift == 0) {
+        return low;
+    }
+    const uint64_t high = index + 1 < words ? row[index + 1] : 0;
+    return (low >> shift) | (high << (VoxelGrid::kWordBits - shift));
+}
+
+template <BooleanOp Op>
+inline uint64_t apply_op(uint64_t a, uint64_t b) {
+    switch (Op) {
+        case BooleanOp::UNION: return a | b;
+        case BooleanOp::INTERSECTION: return a & b;
+        case BooleanOp::DIFFERENCE: return a & ~b;
+        case BooleanOp::XOR: return a ^ b;
+    }
+    return a;
+}
+
+template <BooleanOp Op>
+void combine_rows(const VoxelGrid& grid1, const VoxelGrid& grid2, const Eigen::Vector3i& offset, VoxelGrid& result) {
+    const Eigen::Vector3i dims = grid1.dimensions();
+    const Eigen::Vector3i lo = offset.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = (offset + grid2.dimensions()).cwiseMin(dims);
+    const int words = static_cast<int>(grid1.words_per_row());
+    const int words2 = static_cast<int>(grid2.words_per_row());
+    const int rows = dims.y() * dims.z();
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, rows, 16), [&](const tbb::blocked_range<int>& r) {
+        for (int row = r.begin(); row < r.end(); ++row) {
+            const int y = row % dims.y();
+            const int z = row / dims.y();
+            const uint64_t* a = grid1.row_data(y, z);
+            uint64_t* out = result.row_data(y, z);
+            const bool overlaps = lo.x() < hi.x() && y >= lo.y() && y < hi.y() && z >= lo.z() && z < hi.z();
+            if (!overlaps) {
+                for (int w = 0; w < words; ++w) out[w] = apply_op<Op>(a[w], 0);
+                continue;
+            }
+
+            const uint64_t* b = grid2.row_data(y - offset.y(), z - offset.z());
+            const int w_lo = lo.x() / VoxelGrid::kWordBits;
+            const int w_hi = (hi.x() - 1) / VoxelGrid::kWordBits;
+            for (int w = 0; w < w_lo; ++w) out[w] = apply_op<Op>(a[w], 0);
+            if (offset.x() == 0 && hi.x() == dims.x() && grid2.dimensions().x() == dims.x()) {
+                // Same row layout: straight word-by-word
+                for (int w = w_lo; w <= w_hi; ++w) out[w] = apply_op<Op>(a[w], b[w]);
+            } else {
+                for (int w = w_lo; w <= w_hi; ++w) {
+                    const int bit = w * VoxelGrid::kWordBits;
+                    uint64_t mask = ~uint64_t(0);
+                    if (lo.x() > bit) mask &= ~uint64_t(0) << (lo.x() - bit);
+                    if (hi.x() < bit + VoxelGrid::kWordBits) mask &= ~uint64_t(0) >> (bit + VoxelGrid::kWordBits - hi.x());
+                    out[w] = apply_op<Op>(a[w], load_bits(b, words2, bit - offset.x()) & mask);
+                }
+            }
+            for (int w = w_hi + 1; w < words; ++w) out[w] = apply_op<Op>(a[w], 0);
+        }
+    });
+}
+
+} // namespace
+
+Eigen::Vector3i BinaryOperator::alignmentOffset(const VoxelGrid& grid1, const VoxelGrid& grid2) {
+    const float resolution = grid1.resolution();
+    if (std::abs(grid2.resolution() - resolution) > 1e-6f * resolution) {
+        throw std::invalid_argument("Grids must have the same resolution");
+    }
+    const Eigen::Vector3f steps = (grid2.min_bounds() - grid1.min_bounds()) / resolution;
+    const Eigen::Vector3f rounded = steps.array().round();
+    if ((steps - rounded).cwiseAbs().maxCoeff() > 1e-3f) {
+        throw std::invalid_argument("Grid voxels must be aligned");
+    }
+    return rounded.cast<int>();
+}
+
+void BinaryOperator::loadAlignedRow(const VoxelGrid& grid, const Eigen::Vector3i& offset,
+                                    int y, int z, int width, uint64_t* out) {
+    const int words = (width + VoxelGrid::kWordBits - 1) / VoxelGrid::kWordBits;
+    const int gy = y - offset.y();
+    const int gz = z - offset.z();
+    const int lo = std::max(offset.x(), 0);
+    const int hi = std::min(offset.x() + grid.dimensions().x(), width);
+    if (gy < 0 || gy >= grid.dimensions().y() || gz < 0 || gz >= grid.dimensions().z() || lo >= hi) {
+        std::fill(out, out + words, uint64_t(0));
+        return;
+    }
+    const uint64_t* row = grid.row_data(gy, gz);
+    const int source_words = static_cast<int>(grid.words_per_row());
+    for (int w = 0; w < words; ++w) {
+        const int bit = w * VoxelGrid::kWordBits;
+        if (bit >= hi || bit + VoxelGrid::kWordBits <= lo) {
+            out[w] = 0;
+            continue;
+        }
+        uint64_t mask = ~uint64_t(0);
+        if (lo > bit) mask &= ~uint64_t(0) << (lo - bit);
+        if (hi < bit + VoxelGrid::kWordBits) mask &= ~uint64_t(0) >> (bit + VoxelGrid::kWordBits - hi);
+        out[w] = load_bits(row, source_words, bit - offset.x()) & mask;
+    }
+}
+
+void BinaryOperator::combine(const VoxelGrid& grid1, const VoxelGrid& grid2, BooleanOp op, VoxelGrid& result) {
+    if (result.dimensions() != grid1.dimensions()) {
+        throw std::invalid_argument("Result grid must have the extent of the first grid");
+    }
+    const Eigen::Vector3i offset = alignmentOffset(grid1, grid2);
+    switch (op) {
+        case BooleanOp::UNION: combine_rows<BooleanOp::UNION>(grid1, grid2, offset, result); break;
+        case BooleanOp::INTERSECTION: combine_rows<BooleanOp::INTERSECTION>(grid1, grid2, offset, result); break;
+        case BooleanOp::DIFFERENCE: combine_rows<BooleanOp::DIFFERENCE>(grid1, grid2, offset, result); break;
+        case BooleanOp::XOR: combine_rows<BooleanOp::XOR>(grid1, grid2, offset, result); break;
+    }
+}
+
+} // namespace VXZ
@@ -0,0 +1,16 @@
+#include "operator/closing_operator.hpp"
+#include <stdexcept>
+
+VXZ::ClosingOperator::ClosingOperator(int radius, StructuringElement element)
+    : radius_(radius), element_(element)
+{
+    if (radius < 0) {
+        throw std::invalid_argument("Closing radius must be non-negative");
+    }
+}
+
+bool VXZ::ClosingOperator::apply(VXZ::VoxelGrid &grid) const
+{
+    closing(grid, element_, radius_);
+    return true;
+}
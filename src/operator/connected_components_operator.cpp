@@ -0,0 +1,217 @@
+#include "operator/connected_components_operator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace VXZ {
+
+namespace {
+
+// z slices per brick of the first linking phase
+constexpr int kBrickSlices = 8;
+
+// Occupied voxels [begin, end) of one row
+struct Run {
+    int begin;
+    int end;
+};
+
+class ConcurrentUnionFind {
+public:
+    explicit ConcurrentUnionFind(size_t size) : parent_(new std::atomic<int32_t>[size]) {
+        for (size_t i = 0; i < size; ++i) {
+            parent_[i].store(static_cast<int32_t>(i), std::memory_order_relaxed);
+        }
+    }
+
+    int32_t find(int32_t x) {
+        while (true) {
+            const int32_t p = parent_[x].load(std::memory_order_relaxed);
+            if (p == x) return x;
+            const int32_t gp = parent_[p].load(std::memory_order_relaxed);
+            // Path halving; losing the race only skips the shortcut
+            int32_t expected = p;
+            if (p != gp) parent_[x].compare_exchange_weak(expected, gp, std::memory_order_relaxed);
+            x = gp;
+        }
+    }
+
+    // Roots only ever link under a smaller index, so a set's root is its
+    // smallest element
+    void unite(int32_t a, int32_t b) {
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b) return;
+            if (a < b) std::swap(a, b);
+            int32_t expected = a;
+            if (parent_[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<int32_t>[]> parent_;
+};
+
+// Runs of a packed row, appended to out
+template <typename Out>
+void extract_runs(const uint64_t* row, int words, Out&& out) {
+    int start = -1;
+    for (int w = 0; w < words; ++w) {
+        uint64_t bits = row[w];
+        int bit = 0;
+        while (bit < VoxelGrid::kWordBits) {
+            if (start < 0) {
+                // Next set bit
+                const uint64_t rest = bits >> bit;
+                if (rest == 0) break;
+                bit += __builtin_ctzll(rest);
+                start = w * VoxelGrid::kWordBits + bit;
+            } else {
+                // Next clear bit
+                const uint64_t rest = ~bits >> bit;
+                if (rest == 0) break;
+                bit += __builtin_ctzll(rest);
+                out(Run{start, w * VoxelGrid::kWordBits + bit});
+                start = -1;
+            }
+        }
+    }
+    if (start >= 0) {
+        out(Run{start, words * VoxelGrid::kWordBits});
+    }
+}
+
+} // namespace
+
+ConnectedComponents ConnectedComponentsOperator::apply(const VoxelGrid& grid) const {
+    const Eigen::Vector3i dims = grid.dimensions();
+    const int words = static_cast<int>(grid.words_per_row());
+    const int rows = dims.y() * dims.z();
+
+    // Runs of all rows, row by row; row r owns runs [first[r], first[r + 1])
+    std::vector<int32_t> first(static_cast<size_t>(rows) + 1, 0);
+    tbb::parallel_for(tbb::blocked_range<int>(0, rows, 64), [&](const tbb::blocked_range<int>& r) {
+        for (int row = r.begin(); row < r.end(); ++row) {
+            int32_t count = 0;
+            extract_runs(grid.row_data(row % dims.y(), row / dims.y()), words, [&](const Run&) { ++count; });
+            first[row + 1] = count;
+        }
+    });
+    for (int row = 0; row < rows; ++row) {
+        first[row + 1] += first[row];
+    }
+    std::vector<Run> runs(static_cast<size_t>(first[rows]));
+    tbb::parallel_for(tbb::blocked_range<int>(0, rows, 64), [&](const tbb::blocked_range<int>& r) {
+        for (int row = r.begin(); row < r.end(); ++row) {
+            int32_t next = first[row];
+            extract_runs(grid.row_data(row % dims.y(), row / dims.y()), words, [&](const Run& run) { runs[next++] = run; });
+        }
+    });
+
+    // Rows already visited that touch row (y, z): offsets (dy, dz), and
+    // whether runs that only meet at a corner in x count as touching
+    struct Neighbour {
+        int dy;
+        int dz;
+        bool diagonal_x;
+    };
+    static const Neighbour kSix[] = {{-1, 0, false}, {0, -1, false}};
+    static const Neighbour kEighteen[] = {{-1, 0, true}, {0, -1, true}, {-1, -1, false}, {1, -1, false}};
+    static const Neighbour kTwentySix[] = {{-1, 0, true}, {0, -1, true}, {-1, -1, true}, {1, -1, true}};
+    const Neighbour* neighbours_begin = kTwentySix;
+    const Neighbour* neighbours_end = std::end(kTwentySix);
+    if (connectivity_ == Connectivity::SIX) {
+        neighbours_begin = kSix;
+        neighbours_end = std::end(kSix);
+    } else if (connectivity_ == Connectivity::EIGHTEEN) {
+        neighbours_begin = kEighteen;
+        neighbours_end = std::end(kEighteen);
+    }
+
+    ConcurrentUnionFind sets(runs.size());
+    auto link_row = [&](int y, int z, bool across_brick) {
+        const int row = z * dims.y() + y;
+        for (const Neighbour* n = neighbours_begin; n != neighbours_end; ++n) {
+            // Within a brick only rows of the brick; across, only z - 1
+            if ((n->dz != 0) != across_brick) continue;
+            const int ny = y + n->dy;
+            if (ny < 0 || ny >= dims.y() || z + n->dz < 0) continue;
+            const int other = (z + n->dz) * dims.y() + ny;
+            const int reach = n->diagonal_x ? 1 : 0;
+            // Both run lists are sorted: merge them
+            int32_t a = first[row];
+            int32_t b = first[other];
+            while (a < first[row + 1] && b < first[other + 1]) {
+                if (runs[a].begin < runs[b].end + reach && runs[b].begin < runs[a].end + reach) {
+                    sets.unite(a, b);
+                }
+                if (runs[a].end < runs[b].end) ++a; else ++b;
+            }
+        }
+    };
+
+    const int bricks = (dims.z() + kBrickSlices - 1) / kBrickSlices;
+    tbb::parallel_for(tbb::blocked_range<int>(0, bricks, 1), [&](const tbb::blocked_range<int>& r) {
+        for (int brick = r.begin(); brick < r.end(); ++brick) {
+            const int z_end = std::min((brick + 1) * kBrickSlices, dims.z());
+            for (int z = brick * kBrickSlices; z < z_end; ++z) {
+                for (int y = 0; y < dims.y(); ++y) {
+                    link_row(y, z, false);
+                    // Links to z - 1 inside the brick
+                    if (z > brick * kBrickSlices) link_row(y, z, true);
+                }
+            }
+        }
+    });
+    // Brick borders
+    tbb::parallel_for(tbb::blocked_range<int>(1, bricks, 1), [&](const tbb::blocked_range<int>& r) {
+        for (int brick = r.begin(); brick < r.end(); ++brick) {
+            for (int y = 0; y < dims.y(); ++y) {
+                link_row(y, brick * kBrickSlices, true);
+            }
+        }
+    });
+
+    // Roots are the first run of their set in row order, which numbers the
+    // components by first voxel
+    ConnectedComponents result;
+    result.dimensions = dims;
+    std::vector<int32_t> run_label(runs.size(), 0);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const int32_t root = sets.find(static_cast<int32_t>(i));
+        if (root == static_cast<int32_t>(i)) {
+            result.components.emplace_back();
+            run_label[i] = static_cast<int32_t>(result.components.size());
+        } else {
+            run_label[i] = run_label[root];
+        }
+    }
+
+    for (int row = 0; row < rows; ++row) {
+        const int y = row % dims.y();
+        const int z = row / dims.y();
+        for (int32_t i = first[row]; i < first[row + 1]; ++i) {
+            ComponentStats& stats = result.components[run_label[i] - 1];
+            stats.voxel_count += runs[i].end - runs[i].begin;
+            stats.min = stats.min.cwiseMin(Eigen::Vector3i(runs[i].begin, y, z));
+            stats.max = stats.max.cwiseMax(Eigen::Vector3i(runs[i].end - 1, y, z));
+        }
+    }
+
+    result.labels.assign(static_cast<size_t>(rows) * dims.x(), 0);
+    tbb::parallel_for(tbb::blocked_range<int>(0, rows, 64), [&](const tbb::blocked_range<int>& r) {
+        for (int row = r.begin(); row < r.end(); ++row) {
+            int32_t* out = &result.labels[static_cast<size_t>(row) * dims.x()];
+            for (int32_t i = first[row]; i < first[row + 1]; ++i) {
+                std::fill(out + runs[i].begin, out + runs[i].end, run_label[i]);
+            }
+        }
+    });
+    return result;
+}
+
+} // namespace VXZ
@@ -0,0 +1,14 @@
+#include "operator/difference_operator.hpp"
+#include "core/voxel_grid.hpp"
+
+std::unique_ptr<VXZ::VoxelGrid> VXZ::DifferenceOperator::apply(const VXZ::VoxelGrid &grid1, const VXZ::VoxelGrid &grid2)
+{
+    auto result = createResultGrid(grid1);
+    combine(grid1, grid2, BooleanOp::DIFFERENCE, *result);
+    return result;
+}
+
+void VXZ::DifferenceOperator::apply_in_place(VXZ::VoxelGrid &grid1, const VXZ::VoxelGrid &grid2)
+{
+    combine(grid1, grid2, BooleanOp::DIFFERENCE, grid1);
+}
@@ -0,0 +1,16 @@
+#include "operator/dilate_operator.hpp"
+#include <stdexcept>
+
+VXZ::DilateOperator::DilateOperator(int radius, StructuringElement element)
+    : radius_(radius), element_(element)
+{
+    if (radius < 0) {
+        throw std::invalid_argument("Dilate radius must be non-negative");
+    }
+}
+
+bool VXZ::DilateOperator::apply(VXZ::VoxelGrid &grid) const
+{
+    dilate(grid, element_, radius_);
+    return true;
+}
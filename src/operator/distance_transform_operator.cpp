@@ -0,0 +1,195 @@
+#include "operator/distance_transform_operator.hpp"
+#include "operator/not_operator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace VXZ {
+
+namespace {
+
+// Adjacent x columns per task in the y and z passes: 64 bytes of floats
+constexpr int kColumnBlock = 16;
+
+// Per-thread buffers of the 1-D transform
+struct LineBuffers {
+    std::vector<float> f;
+    std::vector<int32_t> source;
+    std::vector<float> d;
+    std::vector<int32_t> nearest;
+    std::vector<int> v;
+    std::vector<double> z;
+
+    void resize(int n) {
+        f.resize(n);
+        source.resize(n);
+        d.resize(n);
+        nearest.resize(n);
+        v.resize(n);
+        z.resize(n + 1);
+    }
+};
+
+/**
+ * @brief 1-D squared distance transform of f (Felzenszwalb-Huttenlocher)
+ *
+ * d[q] = min over p of (q - p)^2 + f[p]; entries of f at infinity are not
+ * sampled. nearest[q] is source[p] of the minimizing p.
+ */
+void transform_line(int n, LineBuffers& line) {
+    int k = -1;
+    for (int q = 0; q < n; ++q) {
+        if (line.f[q] == DistanceField::kInfinity) continue;
+        if (k < 0) {
+            k = 0;
+            line.v[0] = q;
+            line.z[0] = -std::numeric_limits<double>::infinity();
+            line.z[1] = std::numeric_limits<double>::infinity();
+            continue;
+        }
+        const double fq = line.f[q] + static_cast<double>(q) * q;
+        double s;
+        while (true) {
+            const int p = line.v[k];
+            s = (fq - (line.f[p] + static_cast<double>(p) * p)) / (2.0 * (q - p));
+            if (s > line.z[k]) break;
+            // z[0] is -infinity, so k stays >= 0
+            --k;
+        }
+        ++k;
+        line.v[k] = q;
+        line.z[k] = s;
+        line.z[k + 1] = std::numeric_limits<double>::infinity();
+    }
+
+    if (k < 0) {
+        std::fill(line.d.begin(), line.d.begin() + n, DistanceField::kInfinity);
+        std::fill(line.nearest.begin(), line.nearest.begin() + n, -1);
+        return;
+    }
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+        while (line.z[k + 1] < q) ++k;
+        const int p = line.v[k];
+        line.d[q] = static_cast<float>(static_cast<double>(q - p) * (q - p) + line.f[p]);
+        line.nearest[q] = line.source[p];
+    }
+}
+
+/**
+ * @brief Squared distances in voxels to the occupied voxels of grid
+ *
+ * nearest, if not null, receives the linear index of the nearest voxel.
+ */
+void squared_transform(const VoxelGrid& grid, std::vector<float>& sq, std::vector<int32_t>* nearest) {
+    const Eigen::Vector3i dims = grid.dimensions();
+    const size_t stride_y = static_cast<size_t>(dims.x());
+    const size_t stride_z = stride_y * dims.y();
+    sq.resize(stride_z * dims.z());
+    if (nearest) nearest->resize(sq.size());
+
+    // x pass, straight from the packed rows
+    tbb::parallel_for(tbb::blocked_range<int>(0, dims.y() * dims.z(), 16), [&](const tbb::blocked_range<int>& r) {
+        LineBuffers line;
+        line.resize(dims.x());
+        for (int row = r.begin(); row < r.end(); ++row) {
+            const int y = row % dims.y();
+            const int z = row / dims.y();
+            const uint64_t* bits = grid.row_data(y, z);
+            const size_t base = z * stride_z + y * stride_y;
+            for (int x = 0; x < dims.x(); ++x) {
+                const bool occupied = (bits[x / VoxelGrid::kWordBits] >> (x % VoxelGrid::kWordBits)) & 1;
+                line.f[x] = occupied ? 0.0f : DistanceField::kInfinity;
+                line.source[x] = static_cast<int32_t>(base + x);
+            }
+            transform_line(dims.x(), line);
+            std::copy(line.d.begin(), line.d.begin() + dims.x(), sq.begin() + base);
+            if (nearest) std::copy(line.nearest.begin(), line.nearest.begin() + dims.x(), nearest->begin() + base);
+        }
+    });
+
+    // y and z passes over strided lines. A task takes kColumnBlock adjacent
+    // x columns of one plane, so every strided step reads and writes a full
+    // cache line of samples; the block is transposed into a buffer where
+    // sample i of column c sits at i * kColumnBlock + c
+    auto pass = [&](int n, size_t stride, int planes, auto plane_base) {
+        const int blocks = (dims.x() + kColumnBlock - 1) / kColumnBlock;
+        tbb::parallel_for(tbb::blocked_range<int>(0, planes * blocks, 4), [&](const tbb::blocked_range<int>& r) {
+            LineBuffers line;
+            line.resize(n);
+            std::vector<float> f(static_cast<size_t>(n) * kColumnBlock);
+            std::vector<int32_t> source(nearest ? f.size() : 0);
+            for (int t = r.begin(); t < r.end(); ++t) {
+                const int x0 = (t % blocks) * kColumnBlock;
+                const int width = std::min(kColumnBlock, dims.x() - x0);
+                const size_t base = plane_base(t / blocks) + x0;
+                for (int i = 0; i < n; ++i) {
+                    const size_t at = base + i * stride;
+                    std::copy(sq.begin() + at, sq.begin() + at + width, f.begin() + i * kColumnBlock);
+                    if (nearest) {
+                        std::copy(nearest->begin() + at, nearest->begin() + at + width, source.begin() + i * kColumnBlock);
+                    }
+                }
+                for (int c = 0; c < width; ++c) {
+                    for (int i = 0; i < n; ++i) {
+                        line.f[i] = f[i * kColumnBlock + c];
+                        line.source[i] = nearest ? source[i * kColumnBlock + c] : -1;
+                    }
+                    transform_line(n, line);
+                    for (int i = 0; i < n; ++i) {
+                        f[i * kColumnBlock + c] = line.d[i];
+                        if (nearest) source[i * kColumnBlock + c] = line.nearest[i];
+                    }
+                }
+                for (int i = 0; i < n; ++i) {
+                    const size_t at = base + i * stride;
+                    std::copy(f.begin() + i * kColumnBlock, f.begin() + i * kColumnBlock + width, sq.begin() + at);
+                    if (nearest) {
+                        std::copy(source.begin() + i * kColumnBlock, source.begin() + i * kColumnBlock + width,
+                                  nearest->begin() + at);
+                    }
+                }
+            }
+        });
+    };
+    pass(dims.y(), stride_y, dims.z(), [&](int z) {
+        return static_cast<size_t>(z) * stride_z;
+    });
+    pass(dims.z(), stride_z, dims.y(), [&](int y) {
+        return static_cast<size_t>(y) * stride_y;
+    });
+}
+
+} // namespace
+
+DistanceField DistanceTransformOperator::apply(const VoxelGrid& grid) const {
+    DistanceField field(grid.resolution(), grid.min_bounds(), grid.dimensions(), compute_nearest_);
+    std::vector<int32_t>* nearest = compute_nearest_ ? &field.nearest_indices() : nullptr;
+    std::vector<float>& distances = field.distances();
+    squared_transform(grid, distances, nearest);
+
+    std::vector<float> inside;
+    std::vector<int32_t> inside_nearest;
+    if (signed_distance_) {
+        VoxelGrid complement(grid);
+        NotOperator().apply(complement);
+        squared_transform(complement, inside, compute_nearest_ ? &inside_nearest : nullptr);
+    }
+
+    const float resolution = grid.resolution();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, distances.size(), 4096), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            if (signed_distance_ && distances[i] == 0.0f) {
+                // Occupied voxel
+                distances[i] = -std::sqrt(inside[i]) * resolution;
+                if (nearest) (*nearest)[i] = inside_nearest[i];
+            } else {
+                distances[i] = std::sqrt(distances[i]) * resolution;
+            }
+        }
+    });
+    return field;
+}
+
+} // namespace VXZ
@@ -0,0 +1,16 @@
+#include "operator/erode_operator.hpp"
+#include <stdexcept>
+
+VXZ::ErodeOperator::ErodeOperator(int radius, StructuringElement element)
+    : radius_(radius), element_(element)
+{
+    if (radius < 0) {
+        throw std::invalid_argument("Erode radius must be non-negative");
+    }
+}
+
+bool VXZ::ErodeOperator::apply(VXZ::VoxelGrid &grid) const
+{
+    erode(grid, element_, radius_);
+    return true;
+}
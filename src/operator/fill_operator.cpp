@@ -0,0 +1,255 @@
+#include "operator/fill_operator.hpp"
+#include <algorithm>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace VXZ {
+
+namespace {
+
+// Rows per brick along y and z
+constexpr int kBrickRows = 16;
+
+inline uint64_t span_mask(int w, int begin, int end) {
+    const int lo = std::max(begin - w * VoxelGrid::kWordBits, 0);
+    const int hi = std::min(end - w * VoxelGrid::kWordBits, VoxelGrid::kWordBits);
+    const uint64_t upper = hi == VoxelGrid::kWordBits ? ~uint64_t(0) : (uint64_t(1) << hi) - 1;
+    return upper & (~uint64_t(0) << lo);
+}
+
+/**
+ * @brief out = the empty spans of a row that contain a bit of seeds
+ */
+void fill_spans(const uint64_t* occupied, const uint64_t* seeds, uint64_t* out, int words, uint64_t tail) {
+    std::fill(out, out + words, uint64_t(0));
+    auto visit = [&](int begin, int end) {
+        const int w_begin = begin / VoxelGrid::kWordBits;
+        const int w_end = (end - 1) / VoxelGrid::kWordBits;
+        bool seeded = false;
+        for (int w = w_begin; w <= w_end && !seeded; ++w) {
+            seeded = (seeds[w] & span_mask(w, begin, end)) != 0;
+        }
+        if (!seeded) return;
+        for (int w = w_begin; w <= w_end; ++w) {
+            out[w] |= span_mask(w, begin, end);
+        }
+    };
+
+    int start = -1;
+    for (int w = 0; w < words; ++w) {
+        const uint64_t empty = ~occupied[w] & (w == words - 1 ? tail : ~uint64_t(0));
+        int bit = 0;
+        while (bit < VoxelGrid::kWordBits) {
+            const uint64_t rest = (start < 0 ? empty : ~empty) >> bit;
+            if (rest == 0) break;
+            bit += __builtin_ctzll(rest);
+            if (start < 0) {
+                start = w * VoxelGrid::kWordBits + bit;
+            } else {
+                visit(start, w * VoxelGrid::kWordBits + bit);
+                start = -1;
+            }
+        }
+    }
+    if (start >= 0) {
+        visit(start, words * VoxelGrid::kWordBits);
+    }
+}
+
+struct Brick {
+    int y0, y1, z0, z1;
+    // Reached voxels of the rows just outside the brick, as of the last
+    // exchange: rows y0 - 1 and y1 (one per z), rows z0 - 1 and z1 (one per y)
+    std::vector<uint64_t> y_low, y_high, z_low, z_high;
+    bool active = true;
+};
+
+class Flood {
+public:
+    Flood(const VoxelGrid& grid, VoxelGrid& reached)
+        : grid_(grid),
+          reached_(reached),
+          dims_(grid.dimensions()),
+          words_(static_cast<int>(grid.words_per_row())),
+          tail_(grid.row_tail_mask()),
+          zeros_(static_cast<size_t>(words_), 0) {
+        for (int z0 = 0; z0 < dims_.z(); z0 += kBrickRows) {
+            for (int y0 = 0; y0 < dims_.y(); y0 += kBrickRows) {
+                Brick brick;
+                brick.y0 = y0;
+                brick.z0 = z0;
+                brick.y1 = std::min(y0 + kBrickRows, dims_.y());
+                brick.z1 = std::min(z0 + kBrickRows, dims_.z());
+                const size_t along_z = static_cast<size_t>(brick.z1 - z0) * words_;
+                const size_t along_y = static_cast<size_t>(brick.y1 - y0) * words_;
+                brick.y_low.assign(along_z, 0);
+                brick.y_high.assign(along_z, 0);
+                brick.z_low.assign(along_y, 0);
+                brick.z_high.assign(along_y, 0);
+                bricks_.push_back(std::move(brick));
+            }
+        }
+    }
+
+    // Flood from the spans already in reached
+    void run() {
+        while (true) {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, bricks_.size(), 1), [&](const tbb::blocked_range<size_t>& r) {
+                std::vector<uint64_t> scratch(2 * static_cast<size_t>(words_));
+                for (size_t b = r.begin(); b < r.end(); ++b) {
+                    if (bricks_[b].active) converge(bricks_[b], scratch);
+                }
+            });
+            // Exchange only after all bricks stopped writing
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, bricks_.size(), 1), [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t b = r.begin(); b < r.end(); ++b) {
+                    bricks_[b].active = exchange(bricks_[b]);
+                }
+            });
+            if (std::none_of(bricks_.begin(), bricks_.end(), [](const Brick& b) { return b.active; })) {
+                return;
+            }
+        }
+    }
+
+private:
+    const VoxelGrid& grid_;
+    VoxelGrid& reached_;
+    Eigen::Vector3i dims_;
+    int words_;
+    uint64_t tail_;
+    std::vector<uint64_t> zeros_;
+    std::vector<Brick> bricks_;
+
+    // Reached voxels of row (y, z) as seen from inside brick
+    const uint64_t* row(const Brick& brick, int y, int z) const {
+        if (y < 0 || z < 0 || y >= dims_.y() || z >= dims_.z()) return zeros_.data();
+        if (y == brick.y0 - 1) return &brick.y_low[static_cast<size_t>(z - brick.z0) * words_];
+        if (y == brick.y1) return &brick.y_high[static_cast<size_t>(z - brick.z0) * words_];
+        if (z == brick.z0 - 1) return &brick.z_low[static_cast<size_t>(y - brick.y0) * words_];
+        if (z == brick.z1) return &brick.z_high[static_cast<size_t>(y - brick.y0) * words_];
+        return reached_.row_data(y, z);
+    }
+
+    bool update_row(const Brick& brick, int y, int z, std::vector<uint64_t>& scratch) {
+        const uint64_t* occupied = grid_.row_data(y, z);
+        uint64_t* current = reached_.row_data(y, z);
+        const uint64_t* neighbours[4] = {row(brick, y - 1, z), row(brick, y + 1, z),
+                                         row(brick, y, z - 1), row(brick, y, z + 1)};
+        uint64_t* seeds = scratch.data();
+        bool grows = false;
+        for (int w = 0; w < words_; ++w) {
+            seeds[w] = (neighbours[0][w] | neighbours[1][w] | neighbours[2][w] | neighbours[3][w]) & ~occupied[w];
+            grows |= (seeds[w] & ~current[w]) != 0;
+        }
+        if (!grows) return false;
+        for (int w = 0; w < words_; ++w) seeds[w] |= current[w];
+        fill_spans(occupied, seeds, scratch.data() + words_, words_, tail_);
+        std::copy(scratch.begin() + words_, scratch.begin() + 2 * words_, current);
+        return true;
+    }
+
+    // Sweep the brick up and down until no row grows
+    void converge(const Brick& brick, std::vector<uint64_t>& scratch) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int z = brick.z0; z < brick.z1; ++z) {
+                for (int y = brick.y0; y < brick.y1; ++y) {
+                    changed |= update_row(brick, y, z, scratch);
+                }
+            }
+            for (int z = brick.z1 - 1; z >= brick.z0; --z) {
+                for (int y = brick.y1 - 1; y >= brick.y0; --y) {
+                    changed |= update_row(brick, y, z, scratch);
+                }
+            }
+        }
+    }
+
+    // Copy one outside row; true if it gained voxels
+    bool refresh(std::vector<uint64_t>& halo, size_t slot, int y, int z) {
+        if (y < 0 || z < 0 || y >= dims_.y() || z >= dims_.z()) return false;
+        const uint64_t* source = reached_.row_data(y, z);
+        uint64_t* target = &halo[slot * words_];
+        bool gained = false;
+        for (int w = 0; w < words_; ++w) {
+            gained |= (source[w] & ~target[w]) != 0;
+            target[w] = source[w];
+        }
+        return gained;
+    }
+
+    bool exchange(Brick& brick) {
+        bool gained = false;
+        for (int z = brick.z0; z < brick.z1; ++z) {
+            gained |= refresh(brick.y_low, z - brick.z0, brick.y0 - 1, z);
+            gained |= refresh(brick.y_high, z - brick.z0, brick.y1, z);
+        }
+        for (int y = brick.y0; y < brick.y1; ++y) {
+            gained |= refresh(brick.z_low, y - brick.y0, y, brick.z0 - 1);
+            gained |= refresh(brick.z_high, y - brick.y0, y, brick.z1);
+        }
+        return gained;
+    }
+};
+
+} // namespace
+
+VoxelGrid FillOperator::reachable(const VoxelGrid& grid) const {
+    const Eigen::Vector3i dims = grid.dimensions();
+    const int words = static_cast<int>(grid.words_per_row());
+    const uint64_t tail = grid.row_tail_mask();
+
+    // Seed voxels, then their spans as the start of the flood
+    VoxelGrid seeds(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+    if (seeds_.empty()) {
+        for (int z = 0; z < dims.z(); ++z) {
+            for (int y = 0; y < dims.y(); ++y) {
+                if (y == 0 || z == 0 || y == dims.y() - 1 || z == dims.z() - 1) {
+                    seeds.set_span(y, z, 0, dims.x());
+                } else {
+                    seeds.set_span(y, z, 0, 1);
+                    seeds.set_span(y, z, dims.x() - 1, dims.x());
+                }
+            }
+        }
+    } else {
+        for (const Eigen::Vector3i& seed : seeds_) {
+            if (grid.is_valid_position(seed)) seeds.set(seed, true);
+        }
+    }
+
+    VoxelGrid reached(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+    tbb::parallel_for(tbb::blocked_range<int>(0, dims.y() * dims.z(), 16), [&](const tbb::blocked_range<int>& r) {
+        for (int row = r.begin(); row < r.end(); ++row) {
+            const int y = row % dims.y();
+            const int z = row / dims.y();
+            fill_spans(grid.row_data(y, z), seeds.row_data(y, z), reached.row_data(y, z), words, tail);
+        }
+    });
+
+    Flood(grid, reached).run();
+    return reached;
+}
+
+bool FillOperator::apply(VoxelGrid& grid) const {
+    const VoxelGrid reached = reachable(grid);
+    const Eigen::Vector3i dims = grid.dimensions();
+    const size_t words = grid.words_per_row();
+    const uint64_t tail = grid.row_tail_mask();
+    tbb::parallel_for(tbb::blocked_range<int>(0, dims.y() * dims.z(), 16), [&](const tbb::blocked_range<int>& r) {
+        for (int row = r.begin(); row < r.end(); ++row) {
+            uint64_t* out = grid.row_data(row % dims.y(), row / dims.y());
+            const uint64_t* in = reached.row_data(row % dims.y(), row / dims.y());
+            for (size_t w = 0; w < words; ++w) {
+                // Seeded: add the flooded region; otherwise keep all but the outside
+                out[w] = seeds_.empty() ? ~in[w] : out[w] | in[w];
+            }
+            out[words - 1] &= tail;
+        }
+    });
+    return true;
+}
+
+} // namespace VXZ
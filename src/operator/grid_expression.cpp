@@ -0,0 +1,375 @@
+#include "operator/grid_expression.hpp"
+#include "operator/grid_operator.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace VXZ {
+
+struct GridExpression::Node {
+    enum class Kind { LEAF, NOT, BINARY, DILATE, ERODE };
+
+    Kind kind;
+    BooleanOp op;
+    const VoxelGrid* grid;
+    std::shared_ptr<const Node> lhs;
+    std::shared_ptr<const Node> rhs;
+    // Structuring element of DILATE and ERODE
+    StructuringElement element;
+    int radius;
+};
+
+namespace {
+
+// Rows per brick along y and z, before the halo
+constexpr int kBrickRows = 32;
+
+struct Program;
+
+// Dilated or eroded operand, read by the enclosing program like a grid
+struct Stencil {
+    bool erode;
+    StructuringElement element;
+    int radius;
+    std::shared_ptr<Program> operand;
+};
+
+struct Instruction {
+    enum class Code { LOAD, LOAD_STENCIL, NOT, COMBINE };
+
+    Code code;
+    BooleanOp op;
+    // Leaf index for LOAD, stencil index for LOAD_STENCIL
+    int leaf;
+};
+
+struct Program {
+    std::vector<Instruction> instructions;
+    std::vector<const VoxelGrid*> leaves;
+    // Per leaf, its first voxel in the result frame
+    std::vector<Eigen::Vector3i> offsets;
+    std::vector<Stencil> stencils;
+    int stack_depth = 0;
+    // Rows around the evaluated rows that the stencils read
+    int halo = 0;
+};
+
+// A stencil evaluated for a range of rows: the brick's rows are those
+// asked for, its halo rows those the tile holds
+struct StencilTile {
+    GridBrick brick;
+    VoxelGrid tile;
+};
+
+} // namespace
+
+GridExpression::GridExpression(const VoxelGrid& grid)
+    : node_(std::make_shared<Node>(Node{Node::Kind::LEAF, BooleanOp::UNION, &grid, nullptr, nullptr,
+                                        StructuringElement::BOX, 0})) {
+}
+
+GridExpression::GridExpression(std::shared_ptr<const Node> node)
+    : node_(std::move(node)) {
+}
+
+GridExpression GridExpression::combine(BooleanOp op, const GridExpression& lhs, const GridExpression& rhs) {
+    return GridExpression(std::make_shared<Node>(Node{Node::Kind::BINARY, op, nullptr, lhs.node_, rhs.node_,
+                                                      StructuringElement::BOX, 0}));
+}
+
+GridExpression operator|(const GridExpression& lhs, const GridExpression& rhs) {
+    return GridExpression::combine(BooleanOp::UNION, lhs, rhs);
+}
+
+GridExpression operator&(const GridExpression& lhs, const GridExpression& rhs) {
+    return GridExpression::combine(BooleanOp::INTERSECTION, lhs, rhs);
+}
+
+GridExpression operator-(const GridExpression& lhs, const GridExpression& rhs) {
+    return GridExpression::combine(BooleanOp::DIFFERENCE, lhs, rhs);
+}
+
+GridExpression operator^(const GridExpression& lhs, const GridExpression& rhs) {
+    return GridExpression::combine(BooleanOp::XOR, lhs, rhs);
+}
+
+GridExpression operator~(const GridExpression& operand) {
+    using Node = GridExpression::Node;
+    return GridExpression(std::make_shared<Node>(Node{Node::Kind::NOT, BooleanOp::UNION, nullptr, operand.node_, nullptr,
+                                                      StructuringElement::BOX, 0}));
+}
+
+GridExpression GridExpression::union_of(const std::vector<GridExpression>& operands) {
+    if (operands.empty()) {
+        throw std::invalid_argument("Union of an empty list");
+    }
+    GridExpression result = operands.front();
+    for (size_t i = 1; i < operands.size(); ++i) {
+        result = result | operands[i];
+    }
+    return result;
+}
+
+GridExpression GridExpression::intersection_of(const std::vector<GridExpression>& operands) {
+    if (operands.empty()) {
+        throw std::invalid_argument("Intersection of an empty list");
+    }
+    GridExpression result = operands.front();
+    for (size_t i = 1; i < operands.size(); ++i) {
+        result = result & operands[i];
+    }
+    return result;
+}
+
+GridExpression GridExpression::dilated(StructuringElement element, int radius) const {
+    if (radius < 0) {
+        throw std::invalid_argument("Structuring element radius must be non-negative");
+    }
+    return GridExpression(std::make_shared<Node>(Node{Node::Kind::DILATE, BooleanOp::UNION, nullptr, node_, nullptr,
+                                                      element, radius}));
+}
+
+GridExpression GridExpression::eroded(StructuringElement element, int radius) const {
+    if (radius < 0) {
+        throw std::invalid_argument("Structuring element radius must be non-negative");
+    }
+    return GridExpression(std::make_shared<Node>(Node{Node::Kind::ERODE, BooleanOp::UNION, nullptr, node_, nullptr,
+                                                      element, radius}));
+}
+
+namespace {
+
+// Postfix order; returns the stack depth the subtree needs. Stencil operands
+// compile to programs of their own
+template <typename NodeT>
+int compile(const NodeT& node, Program& program) {
+    switch (node.kind) {
+        case NodeT::Kind::LEAF: {
+            const auto it = std::find(program.leaves.begin(), program.leaves.end(), node.grid);
+            const int leaf = static_cast<int>(it - program.leaves.begin());
+            if (it == program.leaves.end()) {
+                program.leaves.push_back(node.grid);
+            }
+            program.instructions.push_back({Instruction::Code::LOAD, BooleanOp::UNION, leaf});
+            return 1;
+        }
+        case NodeT::Kind::DILATE:
+        case NodeT::Kind::ERODE: {
+            Stencil stencil{node.kind == NodeT::Kind::ERODE, node.element, node.radius, std::make_shared<Program>()};
+            stencil.operand->stack_depth = compile(*node.lhs, *stencil.operand);
+            program.halo = std::max(program.halo, node.radius + stencil.operand->halo);
+            program.stencils.push_back(std::move(stencil));
+            program.instructions.push_back({Instruction::Code::LOAD_STENCIL, BooleanOp::UNION,
+                                            static_cast<int>(program.stencils.size()) - 1});
+            return 1;
+        }
+        case NodeT::Kind::NOT: {
+            const int depth = compile(*node.lhs, program);
+            program.instructions.push_back({Instruction::Code::NOT, BooleanOp::UNION, -1});
+            return depth;
+        }
+        case NodeT::Kind::BINARY:
+        default: {
+            const int lhs = compile(*node.lhs, program);
+            const int rhs = compile(*node.rhs, program);
+            program.instructions.push_back({Instruction::Code::COMBINE, node.op, -1});
+            return std::max(lhs, rhs + 1);
+        }
+    }
+}
+
+inline void combine_words(BooleanOp op, uint64_t* a, const uint64_t* b, int words) {
+    switch (op) {
+        case BooleanOp::UNION:
+            for (int w = 0; w < words; ++w) a[w] |= b[w];
+            break;
+        case BooleanOp::INTERSECTION:
+            for (int w = 0; w < words; ++w) a[w] &= b[w];
+            break;
+        case BooleanOp::DIFFERENCE:
+            for (int w = 0; w < words; ++w) a[w] &= ~b[w];
+            break;
+        case BooleanOp::XOR:
+            for (int w = 0; w < words; ++w) a[w] ^= b[w];
+            break;
+    }
+}
+
+// Offsets of the leaves in the result frame, stencil operands included
+void align(Program& program, const VoxelGrid& result) {
+    for (const VoxelGrid* leaf : program.leaves) {
+        program.offsets.push_back(BinaryOperator::alignmentOffset(result, *leaf));
+    }
+    for (Stencil& stencil : program.stencils) {
+        align(*stencil.operand, result);
+    }
+}
+
+size_t count_loads(const Program& program) {
+    size_t count = static_cast<size_t>(std::count_if(program.instructions.begin(), program.instructions.end(),
+                                                     [](const Instruction& i) { return i.code == Instruction::Code::LOAD; }));
+    for (const Stencil& stencil : program.stencils) {
+        count += count_loads(*stencil.operand);
+    }
+    return count;
+}
+
+bool reads(const Program& program, const VoxelGrid* grid) {
+    if (std::find(program.leaves.begin(), program.leaves.end(), grid) != program.leaves.end()) return true;
+    for (const Stencil& stencil : program.stencils) {
+        if (reads(*stencil.operand, grid)) return true;
+    }
+    return false;
+}
+
+// Run the program on row (y, z) of the result frame; the row is left at the
+// bottom of stack
+void execute(const Program& program, const std::vector<StencilTile>& stencils, const VoxelGrid& frame,
+             int y, int z, uint64_t* stack) {
+    const Eigen::Vector3i& dims = frame.dimensions();
+    const int words = static_cast<int>(frame.words_per_row());
+    const uint64_t tail = frame.row_tail_mask();
+    int top = -1;
+    for (const Instruction& instruction : program.instructions) {
+        switch (instruction.code) {
+            case Instruction::Code::LOAD: {
+                ++top;
+                const VoxelGrid& leaf = *program.leaves[instruction.leaf];
+                const Eigen::Vector3i& offset = program.offsets[instruction.leaf];
+                uint64_t* out = stack + static_cast<size_t>(top) * words;
+                if (offset == Eigen::Vector3i::Zero() && leaf.dimensions() == dims) {
+                    std::copy(leaf.row_data(y, z), leaf.row_data(y, z) + words, out);
+                } else {
+                    BinaryOperator::loadAlignedRow(leaf, offset, y, z, dims.x(), out);
+                }
+                break;
+            }
+            case Instruction::Code::LOAD_STENCIL: {
+                ++top;
+                const StencilTile& stencil = stencils[instruction.leaf];
+                const uint64_t* row = stencil.tile.row_data(y - stencil.brick.halo_y_begin,
+                                                            z - stencil.brick.halo_z_begin);
+                std::copy(row, row + words, stack + static_cast<size_t>(top) * words);
+                break;
+            }
+            case Instruction::Code::NOT: {
+                uint64_t* a = stack + static_cast<size_t>(top) * words;
+                for (int w = 0; w < words; ++w) a[w] = ~a[w];
+                a[words - 1] &= tail;
+                break;
+            }
+            case Instruction::Code::COMBINE: {
+                --top;
+                combine_words(instruction.op, stack + static_cast<size_t>(top) * words,
+                              stack + static_cast<size_t>(top + 1) * words, words);
+                break;
+            }
+        }
+    }
+}
+
+std::vector<StencilTile> evaluate_stencils(const Program& program, const VoxelGrid& frame, const GridBrick& rows);
+
+// Evaluate the brick's rows of the result frame serially, writing row (y, z)
+// to row_out(y, z)
+template <typename RowOut>
+void evaluate_rows(const Program& program, const VoxelGrid& frame, const GridBrick& rows, RowOut row_out) {
+    const std::vector<StencilTile> stencils = evaluate_stencils(program, frame, rows);
+    const size_t words = frame.words_per_row();
+    std::vector<uint64_t> stack(static_cast<size_t>(program.stack_depth) * words);
+    for (int z = rows.z_begin; z < rows.z_end; ++z) {
+        for (int y = rows.y_begin; y < rows.y_end; ++y) {
+            execute(program, stencils, frame, y, z, stack.data());
+            std::copy(stack.begin(), stack.begin() + words, row_out(y, z));
+        }
+    }
+}
+
+// Each stencil of the program for the brick's rows: its operand over the
+// rows grown by the radius, clipped to the frame as dilate() and erode()
+// expect, then dilated or eroded in place
+std::vector<StencilTile> evaluate_stencils(const Program& program, const VoxelGrid& frame, const GridBrick& rows) {
+    const Eigen::Vector3i& dims = frame.dimensions();
+    std::vector<StencilTile> tiles;
+    tiles.reserve(program.stencils.size());
+    for (const Stencil& stencil : program.stencils) {
+        const int r = stencil.radius;
+        const GridBrick grown{rows.y_begin, rows.y_end, rows.z_begin, rows.z_end,
+                              std::max(rows.y_begin - r, 0), std::min(rows.y_end + r, dims.y()),
+                              std::max(rows.z_begin - r, 0), std::min(rows.z_end + r, dims.z())};
+        VoxelGrid tile = make_brick_tile(frame, grown);
+        const GridBrick operand_rows{grown.halo_y_begin, grown.halo_y_end, grown.halo_z_begin, grown.halo_z_end,
+                                     grown.halo_y_begin, grown.halo_y_end, grown.halo_z_begin, grown.halo_z_end};
+        evaluate_rows(*stencil.operand, frame, operand_rows, [&](int y, int z) {
+            return tile.row_data(y - grown.halo_y_begin, z - grown.halo_z_begin);
+        });
+        if (stencil.erode) {
+            erode(tile, stencil.element, r);
+        } else {
+            dilate(tile, stencil.element, r);
+        }
+        tiles.push_back(StencilTile{grown, std::move(tile)});
+    }
+    return tiles;
+}
+
+} // namespace
+
+size_t GridExpression::leaf_count() const {
+    Program program;
+    compile(*node_, program);
+    return count_loads(program);
+}
+
+std::unique_ptr<VoxelGrid> GridExpression::evaluate() const {
+    const Node* leftmost = node_.get();
+    while (leftmost->kind != Node::Kind::LEAF) {
+        leftmost = leftmost->lhs.get();
+    }
+    auto result = std::make_unique<VoxelGrid>(leftmost->grid->resolution(),
+                                              leftmost->grid->min_bounds(),
+                                              leftmost->grid->max_bounds());
+    evaluate_into(*result);
+    return result;
+}
+
+void GridExpression::evaluate_into(VoxelGrid& result) const {
+    Program program;
+    program.stack_depth = compile(*node_, program);
+    align(program, result);
+    const Eigen::Vector3i dims = result.dimensions();
+
+    if (!program.stencils.empty()) {
+        // Bricks read the grids around their own rows, so a result that is
+        // one of the grids is built apart and moved in at the end
+        const int brick = std::max(kBrickRows, 4 * program.halo);
+        std::unique_ptr<VoxelGrid> separate;
+        if (reads(program, &result)) {
+            separate = std::make_unique<VoxelGrid>(result.resolution(), result.min_bounds(), result.max_bounds());
+        }
+        VoxelGrid& output = separate ? *separate : result;
+        parallel_apply_bricks(result, output, brick, 0, [&](const VoxelGrid& frame, VoxelGrid& out, const GridBrick& b) {
+            evaluate_rows(program, frame, b, [&](int y, int z) { return out.row_data(y, z); });
+        });
+        if (separate) {
+            result = std::move(*separate);
+        }
+        return;
+    }
+
+    // A row of the result is only written after all reads of that row, and a
+    // grid aliasing the result is read at offset zero, so in-place is safe.
+    const std::vector<StencilTile> no_stencils;
+    tbb::parallel_for(tbb::blocked_range<int>(0, dims.y() * dims.z(), 16), [&](const tbb::blocked_range<int>& r) {
+        std::vector<uint64_t> stack(static_cast<size_t>(program.stack_depth) * result.words_per_row());
+        for (int row = r.begin(); row < r.end(); ++row) {
+            const int y = row % dims.y();
+            const int z = row / dims.y();
+            execute(program, no_stencils, result, y, z, stack.data());
+            std::copy(stack.begin(), stack.begin() + result.words_per_row(), result.row_data(y, z));
+        }
+    });
+}
+
+} // namespace VXZ
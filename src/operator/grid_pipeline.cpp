@@ -0,0 +1,112 @@
+#include "operator/grid_pipeline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <tbb/combinable.h>
+
+namespace VXZ {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Smallest brick side in rows, so the halo does not dominate small tiles
+constexpr int kMinBrickRows = 8;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+constexpr size_t GridPipeline::kDefaultTileBytes;
+
+GridPipeline& GridPipeline::add(std::shared_ptr<const GridOperator> op, std::string name) {
+    if (!op) {
+        throw std::invalid_argument("Pipeline stage must not be null");
+    }
+    if (name.empty()) {
+        name = "stage " + std::to_string(stages_.size());
+    }
+    stages_.push_back(Stage{std::move(op), std::move(name)});
+    return *this;
+}
+
+std::vector<std::pair<size_t, size_t>> GridPipeline::segments() const {
+    std::vector<std::pair<size_t, size_t>> result;
+    size_t first = 0;
+    while (first < stages_.size()) {
+        size_t last = first + 1;
+        if (stages_[first].op->stencil_radius() >= 0) {
+            while (last < stages_.size() && stages_[last].op->stencil_radius() >= 0) ++last;
+        }
+        result.emplace_back(first, last);
+        first = last;
+    }
+    return result;
+}
+
+bool GridPipeline::run(VoxelGrid& grid) {
+    const Clock::time_point start = Clock::now();
+    timings_.clear();
+    for (const Stage& stage : stages_) {
+        timings_.push_back(StageTiming{stage.name, 0.0, false});
+    }
+
+    bool ok = true;
+    for (const auto& segment : segments()) {
+        if (segment.second - segment.first == 1) {
+            // Nothing to fuse with
+            const Clock::time_point stage_start = Clock::now();
+            ok &= stages_[segment.first].op->apply(grid);
+            timings_[segment.first].seconds = seconds_since(stage_start);
+        } else {
+            ok &= run_fused(grid, segment.first, segment.second);
+        }
+    }
+    total_seconds_ = seconds_since(start);
+    return ok;
+}
+
+bool GridPipeline::run_fused(VoxelGrid& grid, size_t first, size_t last) {
+    int halo = 0;
+    for (size_t i = first; i < last; ++i) {
+        halo += stages_[i].op->stencil_radius();
+    }
+    const size_t words = grid.words_per_row();
+
+    // Square bricks of rows whose tile, halo included, fits tile_bytes_
+    const size_t tile_rows = std::max<size_t>(1, tile_bytes_ / (words * sizeof(uint64_t)));
+    const int tile_side = static_cast<int>(std::sqrt(static_cast<double>(tile_rows)));
+    const int side = std::max({tile_side - 2 * halo, halo, kMinBrickRows});
+
+    // Bricks read the halo from the untouched grid and write the result
+    VoxelGrid result(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+    tbb::combinable<std::vector<double>> seconds([&] { return std::vector<double>(last - first, 0.0); });
+    std::atomic<bool> ok(true);
+    parallel_apply_bricks(grid, result, side, halo, [&](const VoxelGrid& input, VoxelGrid& output, const GridBrick& brick) {
+        VoxelGrid tile = copy_brick_tile(input, brick);
+        std::vector<double>& local = seconds.local();
+        for (size_t i = first; i < last; ++i) {
+            const Clock::time_point stage_start = Clock::now();
+            if (!stages_[i].op->apply(tile)) ok = false;
+            local[i - first] += seconds_since(stage_start);
+        }
+        store_brick_tile(tile, brick, output);
+    });
+    grid = std::move(result);
+
+    seconds.combine_each([&](const std::vector<double>& local) {
+        for (size_t i = first; i < last; ++i) {
+            timings_[i].seconds += local[i - first];
+        }
+    });
+    for (size_t i = first; i < last; ++i) {
+        timings_[i].fused = true;
+    }
+    return ok;
+}
+
+} // namespace VXZ
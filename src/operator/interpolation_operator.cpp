@@ -0,0 +1,253 @@
+#include "operator/interpolation_operator.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <tbb/blocked_range2d.h>
+
+namespace VXZ {
+
+namespace {
+
+// Target rows per brick along y and z
+constexpr int kBrickRows = 8;
+
+struct OccupancySource {
+    const VoxelGrid& grid;
+    float operator()(int x, int y, int z) const {
+        return (grid.row_data(y, z)[x / VoxelGrid::kWordBits] >> (x % VoxelGrid::kWordBits)) & 1 ? 1.0f : 0.0f;
+    }
+};
+
+struct FieldSource {
+    const DistanceField& field;
+    float operator()(int x, int y, int z) const { return field.get(x, y, z); }
+};
+
+// Catmull-Rom weights of the samples at floor(u) - 1 .. floor(u) + 2
+inline void cubic_weights(float t, float w[4]) {
+    w[0] = ((-t + 2.0f) * t - 1.0f) * t * 0.5f;
+    w[1] = ((3.0f * t - 5.0f) * t * t + 2.0f) * 0.5f;
+    w[2] = ((-3.0f * t + 4.0f) * t + 1.0f) * t * 0.5f;
+    w[3] = (t - 1.0f) * t * t * 0.5f;
+}
+
+inline void linear_weights(float t, float w[2]) {
+    w[0] = 1.0f - t;
+    w[1] = t;
+}
+
+/**
+ * @brief Values of a source at continuous voxel coordinates (voxel centres at integers)
+ */
+template <typename Source>
+class Sampler {
+public:
+    Sampler(Source source, const Eigen::Vector3i& dims, InterpolationMode mode, const Eigen::Matrix3f& step, float outside)
+        : source_(source), dims_(dims), mode_(mode), outside_(outside) {
+        if (mode_ != InterpolationMode::MAJORITY) return;
+        // About one sample per source voxel along each edge of the target voxel
+        int count[3];
+        for (int a = 0; a < 3; ++a) {
+            count[a] = std::max(1, static_cast<int>(std::ceil(step.col(a).norm() - 1e-3f)));
+        }
+        for (int k = 0; k < count[2]; ++k) {
+            for (int j = 0; j < count[1]; ++j) {
+                for (int i = 0; i < count[0]; ++i) {
+                    const Eigen::Vector3f fraction((i + 0.5f) / count[0] - 0.5f,
+                                                   (j + 0.5f) / count[1] - 0.5f,
+                                                   (k + 0.5f) / count[2] - 0.5f);
+                    offsets_.push_back(step * fraction);
+                }
+            }
+        }
+    }
+
+    float operator()(float ux, float uy, float uz) const {
+        switch (mode_) {
+            case InterpolationMode::MAJORITY: return majority(ux, uy, uz);
+            case InterpolationMode::TRILINEAR: return interpolate<2>(ux, uy, uz, linear_weights);
+            case InterpolationMode::TRICUBIC: return interpolate<4>(ux, uy, uz, cubic_weights);
+            case InterpolationMode::NEAREST:
+            default: return nearest(ux, uy, uz);
+        }
+    }
+
+private:
+    Source source_;
+    Eigen::Vector3i dims_;
+    InterpolationMode mode_;
+    float outside_;
+    std::vector<Eigen::Vector3f> offsets_;
+
+    bool inside(float ux, float uy, float uz) const {
+        return ux >= -0.5f && uy >= -0.5f && uz >= -0.5f &&
+               ux < dims_.x() - 0.5f && uy < dims_.y() - 0.5f && uz < dims_.z() - 0.5f;
+    }
+
+    float nearest(float ux, float uy, float uz) const {
+        if (!inside(ux, uy, uz)) return outside_;
+        // Clamp: rounding can reach dims at the upper edge
+        const int x = std::min(static_cast<int>(std::floor(ux + 0.5f)), dims_.x() - 1);
+        const int y = std::min(static_cast<int>(std::floor(uy + 0.5f)), dims_.y() - 1);
+        const int z = std::min(static_cast<int>(std::floor(uz + 0.5f)), dims_.z() - 1);
+        return source_(x, y, z);
+    }
+
+    // Mean of the sub-lattice samples inside the source
+    float majority(float ux, float uy, float uz) const {
+        float sum = 0.0f;
+        int count = 0;
+        for (const Eigen::Vector3f& offset : offsets_) {
+            const float x = ux + offset.x();
+            const float y = uy + offset.y();
+            const float z = uz + offset.z();
+            if (!inside(x, y, z)) continue;
+            sum += nearest(x, y, z);
+            ++count;
+        }
+        return count == 0 ? outside_ : sum / count;
+    }
+
+    // Separable N-tap interpolation, with indices clamped at the border
+    template <int N, typename Weights>
+    float interpolate(float ux, float uy, float uz, Weights weights) const {
+        if (!inside(ux, uy, uz)) return outside_;
+        const Eigen::Vector3f u(ux, uy, uz);
+        const Eigen::Vector3f floor = u.array().floor();
+        float w[3][N];
+        int index[3][N];
+        for (int a = 0; a < 3; ++a) {
+            weights(u[a] - floor[a], w[a]);
+            for (int i = 0; i < N; ++i) {
+                const int at = static_cast<int>(floor[a]) - N / 2 + 1 + i;
+                index[a][i] = std::min(std::max(at, 0), dims_[a] - 1);
+            }
+        }
+        float value = 0.0f;
+        for (int k = 0; k < N; ++k) {
+            for (int j = 0; j < N; ++j) {
+                float row = 0.0f;
+                for (int i = 0; i < N; ++i) {
+                    row += w[0][i] * source_(index[0][i], index[1][j], index[2][k]);
+                }
+                value += w[1][j] * w[2][k] * row;
+            }
+        }
+        return std::isfinite(value) ? value : nearest(ux, uy, uz);
+    }
+};
+
+/**
+ * @brief Sample every target voxel; store(y, z, values) receives one row at a time
+ *
+ * origin is the source coordinate of the centre of target voxel (0, 0, 0)
+ * and the columns of step the source offsets of one target voxel along x, y
+ * and z.
+ */
+template <typename Source, typename Store>
+void resample_rows(const Sampler<Source>& sampler,
+                   const Eigen::Vector3f& origin,
+                   const Eigen::Matrix3f& step,
+                   const Eigen::Vector3i& dims,
+                   Store store) {
+    tbb::parallel_for(tbb::blocked_range2d<int>(0, dims.z(), kBrickRows, 0, dims.y(), kBrickRows),
+        [&](const tbb::blocked_range2d<int>& r) {
+            const size_t length = static_cast<size_t>(dims.x());
+            std::vector<float> ux(length), uy(length), uz(length), values(length);
+            const float sx = step(0, 0), sy = step(1, 0), sz = step(2, 0);
+            for (int z = r.rows().begin(); z < r.rows().end(); ++z) {
+                for (int y = r.cols().begin(); y < r.cols().end(); ++y) {
+                    const Eigen::Vector3f base = origin + step.col(1) * static_cast<float>(y) + step.col(2) * static_cast<float>(z);
+                    // Coordinates first, in a loop the compiler vectorizes,
+                    // then the gathers
+                    for (size_t x = 0; x < length; ++x) {
+                        ux[x] = base.x() + sx * x;
+                        uy[x] = base.y() + sy * x;
+                        uz[x] = base.z() + sz * x;
+                    }
+                    for (size_t x = 0; x < length; ++x) {
+                        values[x] = sampler(ux[x], uy[x], uz[x]);
+                    }
+                    store(y, z, values);
+                }
+            }
+        });
+}
+
+} // namespace
+
+InterpolationOperator::InterpolationOperator(float resolution, InterpolationMode mode)
+    : InterpolationOperator(resolution, Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero(), Eigen::Affine3f::Identity(), mode) {
+    has_bounds_ = false;
+}
+
+InterpolationOperator::InterpolationOperator(float resolution,
+                                             const Eigen::Vector3f& min_bounds,
+                                             const Eigen::Vector3f& max_bounds,
+                                             const Eigen::Affine3f& transform,
+                                             InterpolationMode mode)
+    : resolution_(resolution), mode_(mode), has_bounds_(true), min_bounds_(min_bounds), max_bounds_(max_bounds) {
+    if (!(resolution > 0.0f)) {
+        throw std::invalid_argument("Interpolation resolution must be positive");
+    }
+    if (std::abs(transform.linear().determinant()) < 1e-12f) {
+        throw std::invalid_argument("Interpolation transform must be invertible");
+    }
+    inverse_linear_ = transform.linear().inverse();
+    inverse_translation_ = -inverse_linear_ * transform.translation();
+}
+
+Eigen::Affine3f InterpolationOperator::transform() const {
+    Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+    transform.linear() = inverse_linear_.inverse();
+    transform.translation() = -transform.linear() * inverse_translation_;
+    return transform;
+}
+
+bool InterpolationOperator::apply(VoxelGrid& grid) const {
+    grid = resample(grid);
+    return true;
+}
+
+VoxelGrid InterpolationOperator::resample(const VoxelGrid& source) const {
+    VoxelGrid target(resolution_,
+                     has_bounds_ ? min_bounds_ : source.min_bounds(),
+                     has_bounds_ ? max_bounds_ : source.max_bounds());
+    const Eigen::Matrix3f step = inverse_linear_ * (resolution_ / source.resolution());
+    const Eigen::Vector3f centre = target.min_bounds() + Eigen::Vector3f::Constant(0.5f * resolution_);
+    const Eigen::Vector3f origin = (inverse_linear_ * centre + inverse_translation_ - source.min_bounds()) / source.resolution()
+                                   - Eigen::Vector3f::Constant(0.5f);
+
+    const Sampler<OccupancySource> sampler(OccupancySource{source}, source.dimensions(), mode_, step, 0.0f);
+    const size_t words = target.words_per_row();
+    resample_rows(sampler, origin, step, target.dimensions(), [&](int y, int z, const std::vector<float>& values) {
+        uint64_t* row = target.row_data(y, z);
+        std::fill(row, row + words, uint64_t(0));
+        for (size_t x = 0; x < values.size(); ++x) {
+            if (values[x] >= 0.5f) row[x / VoxelGrid::kWordBits] |= uint64_t(1) << (x % VoxelGrid::kWordBits);
+        }
+    });
+    return target;
+}
+
+DistanceField InterpolationOperator::resample(const DistanceField& source, float outside) const {
+    // Same lattice as a VoxelGrid over these bounds
+    const Eigen::Vector3f min_bounds = has_bounds_ ? min_bounds_ : source.min_bounds();
+    const Eigen::Vector3f max_bounds = has_bounds_
+        ? max_bounds_
+        : Eigen::Vector3f(source.min_bounds() + (source.dimensions().cast<float>().array() - 0.5f).matrix() * source.resolution());
+    const Eigen::Vector3i dims = ((max_bounds - min_bounds) / resolution_).cast<int>() + Eigen::Vector3i::Ones();
+    DistanceField target(resolution_, min_bounds, dims);
+
+    const Eigen::Matrix3f step = inverse_linear_ * (resolution_ / source.resolution());
+    const Eigen::Vector3f centre = min_bounds + Eigen::Vector3f::Constant(0.5f * resolution_);
+    const Eigen::Vector3f origin = (inverse_linear_ * centre + inverse_translation_ - source.min_bounds()) / source.resolution()
+                                   - Eigen::Vector3f::Constant(0.5f);
+
+    const Sampler<FieldSource> sampler(FieldSource{source}, source.dimensions(), mode_, step, outside);
+    resample_rows(sampler, origin, step, dims, [&](int y, int z, const std::vector<float>& values) {
+        std::copy(values.begin(), values.end(), target.distances().begin() + target.index(0, y, z));
+    });
+    return target;
+}
+
+} // namespace VXZ
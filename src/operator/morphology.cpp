@@ -0,0 +1,339 @@
+#include "operator/morphology.hpp"
+#include "operator/grid_operator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace VXZ {
+
+namespace {
+
+// Dilation ORs over the window and reads voxels outside the grid as empty;
+// erosion ANDs and reads them as occupied. Fill is the word outside voxels
+// read as: the identity of the combining operation.
+template <bool Erode>
+struct Filter {
+    static constexpr uint64_t kFill = Erode ? ~uint64_t(0) : 0;
+    static uint64_t combine(uint64_t a, uint64_t b) { return Erode ? a & b : a | b; }
+};
+
+template <bool Erode>
+constexpr uint64_t Filter<Erode>::kFill;
+
+// dst[i] = src[i + s]: bits move toward index 0; bits shifted in are fill
+template <bool Erode>
+void shift_down(const uint64_t* src, uint64_t* dst, int words, int s) {
+    const int q = s / VoxelGrid::kWordBits;
+    const int b = s % VoxelGrid::kWordBits;
+    for (int w = 0; w < words; ++w) {
+        const uint64_t low = w + q < words ? src[w + q] : Filter<Erode>::kFill;
+        const uint64_t high = w + q + 1 < words ? src[w + q + 1] : Filter<Erode>::kFill;
+        dst[w] = b == 0 ? low : (low >> b) | (high << (VoxelGrid::kWordBits - b));
+    }
+}
+
+// dst[i] = src[i - s]: bits move toward the row end; bits shifted in are fill
+template <bool Erode>
+void shift_up(const uint64_t* src, uint64_t* dst, int words, int s) {
+    const int q = s / VoxelGrid::kWordBits;
+    const int b = s % VoxelGrid::kWordBits;
+    for (int w = words - 1; w >= 0; --w) {
+        const uint64_t high = w - q >= 0 ? src[w - q] : Filter<Erode>::kFill;
+        const uint64_t low = w - q - 1 >= 0 ? src[w - q - 1] : Filter<Erode>::kFill;
+        dst[w] = b == 0 ? high : (high << b) | (low >> (VoxelGrid::kWordBits - b));
+    }
+}
+
+// span[i] = row[i .. i + r] (forward) or row[i - r .. i] (backward), combined
+template <bool Erode, bool Forward>
+void half_window(const uint64_t* row, int words, int radius, uint64_t* span, uint64_t* shifted) {
+    const int window = radius + 1;
+    std::copy(row, row + words, span);
+    // span covers `length` bits, doubling each step
+    int length = 1;
+    while (length * 2 <= window) {
+        Forward ? shift_down<Erode>(span, shifted, words, length) : shift_up<Erode>(span, shifted, words, length);
+        for (int w = 0; w < words; ++w) span[w] = Filter<Erode>::combine(span[w], shifted[w]);
+        length *= 2;
+    }
+    if (length < window) {
+        // The two spans overlap since length > window / 2
+        Forward ? shift_down<Erode>(span, shifted, words, window - length)
+                : shift_up<Erode>(span, shifted, words, window - length);
+        for (int w = 0; w < words; ++w) span[w] = Filter<Erode>::combine(span[w], shifted[w]);
+    }
+}
+
+// out[i] = row[i - r .. i + r], combined; two half windows so that nothing is
+// shifted past either end of the row. out may be row.
+template <bool Erode>
+void filter_row(const uint64_t* row, uint64_t* out, int words, int radius, uint64_t tail, uint64_t* scratch) {
+    uint64_t* padded = scratch;
+    uint64_t* forward = scratch + words;
+    uint64_t* backward = scratch + 2 * words;
+    uint64_t* shifted = scratch + 3 * words;
+    // The bits past the row end are outside voxels too
+    std::copy(row, row + words, padded);
+    padded[words - 1] |= Filter<Erode>::kFill & ~tail;
+    half_window<Erode, true>(padded, words, radius, forward, shifted);
+    half_window<Erode, false>(padded, words, radius, backward, shifted);
+    for (int w = 0; w < words; ++w) out[w] = Filter<Erode>::combine(forward[w], backward[w]);
+    out[words - 1] &= tail;
+}
+
+// The passes read in and write out, which may be the same grid
+template <bool Erode>
+void filter_x(const VoxelGrid& in, VoxelGrid& out, int radius) {
+    const Eigen::Vector3i dims = in.dimensions();
+    const int words = static_cast<int>(in.words_per_row());
+    const uint64_t tail = in.row_tail_mask();
+    tbb::parallel_for(tbb::blocked_range<int>(0, dims.y() * dims.z(), 16), [&](const tbb::blocked_range<int>& r) {
+        std::vector<uint64_t> scratch(4 * static_cast<size_t>(words));
+        for (int row = r.begin(); row < r.end(); ++row) {
+            const int y = row % dims.y(), z = row / dims.y();
+            filter_row<Erode>(in.row_data(y, z), out.row_data(y, z), words, radius, tail, scratch.data());
+        }
+    });
+}
+
+/**
+ * @brief van Herk/Gil-Werman OR or AND filter over a line of n rows
+ *
+ * in(i) and out(i) return the i-th row of the line; they may be the same
+ * rows, since in is read completely before out is written. Blocks of k = 2r+1 rows get
+ * prefix combinations (g) and suffix combinations (h); the window [i-r, i+r]
+ * then spans at most two blocks and is h[lo] combined with g[hi]. Rows
+ * outside the line are the identity of the combination, so clipped windows
+ * simply drop them.
+ */
+template <bool Erode, typename InAt, typename OutAt>
+void filter_line(InAt in_row, OutAt out_row, int n, int words, int radius, std::vector<uint64_t>& g, std::vector<uint64_t>& h) {
+    const int k = 2 * radius + 1;
+    g.resize(static_cast<size_t>(n) * words);
+    h.resize(static_cast<size_t>(n) * words);
+    for (int i = 0; i < n; ++i) {
+        const uint64_t* in = in_row(i);
+        uint64_t* out = &g[static_cast<size_t>(i) * words];
+        if (i % k == 0) {
+            std::copy(in, in + words, out);
+        } else {
+            const uint64_t* prev = out - words;
+            for (int w = 0; w < words; ++w) out[w] = Filter<Erode>::combine(prev[w], in[w]);
+        }
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        const uint64_t* in = in_row(i);
+        uint64_t* out = &h[static_cast<size_t>(i) * words];
+        if (i % k == k - 1 || i == n - 1) {
+            std::copy(in, in + words, out);
+        } else {
+            const uint64_t* next = out + words;
+            for (int w = 0; w < words; ++w) out[w] = Filter<Erode>::combine(next[w], in[w]);
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        const int lo = std::max(i - radius, 0);
+        const int hi = std::min(i + radius, n - 1);
+        const uint64_t* gh = &g[static_cast<size_t>(hi) * words];
+        const uint64_t* hl = &h[static_cast<size_t>(lo) * words];
+        uint64_t* out = out_row(i);
+        if (lo / k != hi / k) {
+            for (int w = 0; w < words; ++w) out[w] = Filter<Erode>::combine(hl[w], gh[w]);
+        } else if (lo % k == 0) {
+            // Window clipped at the line start
+            std::copy(gh, gh + words, out);
+        } else {
+            // Window clipped at the line end
+            std::copy(hl, hl + words, out);
+        }
+    }
+}
+
+template <bool Erode>
+void filter_y(const VoxelGrid& in, VoxelGrid& out, int radius) {
+    const Eigen::Vector3i dims = in.dimensions();
+    const int words = static_cast<int>(in.words_per_row());
+    tbb::parallel_for(tbb::blocked_range<int>(0, dims.z()), [&](const tbb::blocked_range<int>& r) {
+        std::vector<uint64_t> g, h;
+        for (int z = r.begin(); z < r.end(); ++z) {
+            filter_line<Erode>([&](int y) { return in.row_data(y, z); }, [&](int y) { return out.row_data(y, z); },
+                               dims.y(), words, radius, g, h);
+        }
+    });
+}
+
+template <bool Erode>
+void filter_z(const VoxelGrid& in, VoxelGrid& out, int radius) {
+    const Eigen::Vector3i dims = in.dimensions();
+    const int words = static_cast<int>(in.words_per_row());
+    tbb::parallel_for(tbb::blocked_range<int>(0, dims.y()), [&](const tbb::blocked_range<int>& r) {
+        std::vector<uint64_t> g, h;
+        for (int y = r.begin(); y < r.end(); ++y) {
+            filter_line<Erode>([&](int z) { return in.row_data(y, z); }, [&](int z) { return out.row_data(y, z); },
+                               dims.z(), words, radius, g, h);
+        }
+    });
+}
+
+// target = source filtered by the box; the first pass reads source, the
+// others run on target in place, so a separate target costs no copy
+template <bool Erode>
+void filter_box(const VoxelGrid& source, VoxelGrid& target, const Eigen::Vector3i& half_extent) {
+    const VoxelGrid* in = &source;
+    if (half_extent.x() > 0) { filter_x<Erode>(*in, target, half_extent.x()); in = &target; }
+    if (half_extent.y() > 0) { filter_y<Erode>(*in, target, half_extent.y()); in = &target; }
+    if (half_extent.z() > 0) { filter_z<Erode>(*in, target, half_extent.z()); in = &target; }
+    if (in != &target) {
+        const Eigen::Vector3i dims = source.dimensions();
+        const size_t words = source.words_per_row() * dims.y() * dims.z();
+        std::copy(source.row_data(0, 0), source.row_data(0, 0) + words, target.row_data(0, 0));
+    }
+}
+
+// target = target combined with source, word by word
+template <bool Erode>
+void combine_into(VoxelGrid& target, const VoxelGrid& source) {
+    const Eigen::Vector3i dims = target.dimensions();
+    const size_t words = target.words_per_row() * dims.y() * dims.z();
+    uint64_t* out = target.row_data(0, 0);
+    const uint64_t* in = source.row_data(0, 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, words, 4096), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t w = r.begin(); w < r.end(); ++w) out[w] = Filter<Erode>::combine(out[w], in[w]);
+    });
+}
+
+// Dilation is the union of the dilations by each box of the element, and
+// erosion the intersection of the erosions
+template <bool Erode>
+void filter(VoxelGrid& grid, StructuringElement element, int radius) {
+    const std::vector<Eigen::Vector3i> boxes = structuring_boxes(element, radius);
+    if (boxes.size() > 1) {
+        // The other boxes filter the untouched grid into the combination,
+        // through one reused buffer; the first box then runs on the grid itself
+        VoxelGrid combined(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+        filter_box<Erode>(grid, combined, boxes[1]);
+        if (boxes.size() > 2) {
+            VoxelGrid part(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+            for (size_t i = 2; i < boxes.size(); ++i) {
+                filter_box<Erode>(grid, part, boxes[i]);
+                combine_into<Erode>(combined, part);
+            }
+        }
+        filter_box<Erode>(grid, grid, boxes.front());
+        combine_into<Erode>(grid, combined);
+        return;
+    }
+    filter_box<Erode>(grid, grid, boxes.front());
+}
+
+} // namespace
+
+std::vector<Eigen::Vector3i> structuring_boxes(StructuringElement element, int radius) {
+    if (radius < 0) {
+        throw std::invalid_argument("Structuring element radius must be non-negative");
+    }
+    switch (element) {
+        case StructuringElement::BOX:
+            return {Eigen::Vector3i::Constant(radius)};
+        case StructuringElement::CROSS:
+            return {Eigen::Vector3i(radius, 0, 0), Eigen::Vector3i(0, radius, 0), Eigen::Vector3i(0, 0, radius)};
+        case StructuringElement::SPHERE:
+        default:
+            break;
+    }
+
+    // Boxes with a corner near the sphere along a few directions, with all
+    // axis permutations: the axes, near-axis, near-diagonal of a face and the
+    // space diagonal
+    static const float directions[][3] = {
+        {1.0f, 0.0f, 0.0f},
+        {0.94f, 0.24f, 0.24f},
+        {0.69f, 0.69f, 0.2f},
+        {0.577f, 0.577f, 0.577f},
+    };
+    std::vector<Eigen::Vector3i> boxes;
+    for (const auto& direction : directions) {
+        Eigen::Vector3i extent;
+        for (int a = 0; a < 3; ++a) {
+            extent[a] = static_cast<int>(std::floor(direction[a] * radius + 1e-4f));
+        }
+        // Keep the box inside the ball
+        while (extent.squaredNorm() > radius * radius) {
+            int largest = 0;
+            extent.maxCoeff(&largest);
+            --extent[largest];
+        }
+        std::sort(extent.data(), extent.data() + 3);
+        do {
+            boxes.push_back(extent);
+        } while (std::next_permutation(extent.data(), extent.data() + 3));
+    }
+
+    // Drop boxes contained in another one
+    std::vector<Eigen::Vector3i> kept;
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        bool contained = false;
+        for (size_t j = 0; j < boxes.size() && !contained; ++j) {
+            if (i == j) continue;
+            const bool inside = (boxes[i].array() <= boxes[j].array()).all();
+            contained = inside && (boxes[i] != boxes[j] || j < i);
+        }
+        if (!contained) kept.push_back(boxes[i]);
+    }
+    return kept;
+}
+
+void dilate(VoxelGrid& grid, StructuringElement element, int radius) {
+    filter<false>(grid, element, radius);
+}
+
+void erode(VoxelGrid& grid, StructuringElement element, int radius) {
+    filter<true>(grid, element, radius);
+}
+
+namespace {
+
+// Rows per brick along y and z, before the halo
+constexpr int kBrickRows = 32;
+
+template <typename Steps>
+void fused_by_brick(VoxelGrid& grid, int radius, Steps steps) {
+    if (radius < 0) {
+        throw std::invalid_argument("Structuring element radius must be non-negative");
+    }
+    // Both steps reach r voxels, so 2r rows of context keep a brick exact.
+    // Bricks of at least four halos keep a tile within 1.5 bricks a side, so
+    // the halo adds at most 1.25x the brick's own work
+    const int halo = 2 * radius;
+    const int brick = std::max(kBrickRows, 4 * halo);
+
+    // Tiles are clipped to the grid, so the grid border keeps the semantics
+    // of the unfused operations; every output row is written by one brick
+    VoxelGrid result(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+    parallel_apply_bricks(grid, result, brick, halo, [&](const VoxelGrid& input, VoxelGrid& output, const GridBrick& b) {
+        VoxelGrid tile = copy_brick_tile(input, b);
+        steps(tile);
+        store_brick_tile(tile, b, output);
+    });
+    grid = std::move(result);
+}
+
+} // namespace
+
+void opening(VoxelGrid& grid, StructuringElement element, int radius) {
+    fused_by_brick(grid, radius, [&](VoxelGrid& tile) {
+        erode(tile, element, radius);
+        dilate(tile, element, radius);
+    });
+}
+
+void closing(VoxelGrid& grid, StructuringElement element, int radius) {
+    fused_by_brick(grid, radius, [&](VoxelGrid& tile) {
+        dilate(tile, element, radius);
+        erode(tile, element, radius);
+    });
+}
+
+} // namespace VXZ
@@ -0,0 +1,14 @@
+#include "operator/not_operator.hpp"
+
+bool VXZ::NotOperator::apply(VXZ::VoxelGrid &grid) const
+{
+    const uint64_t tail = grid.row_tail_mask();
+    parallel_apply_rows(grid, [tail](uint64_t* data, size_t words, int, int) {
+        for (size_t w = 0; w < words; ++w) {
+            data[w] = ~data[w];
+        }
+        // Padding bits past the row end stay clear
+        data[words - 1] &= tail;
+    });
+    return true;
+}
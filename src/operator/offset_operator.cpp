@@ -0,0 +1,16 @@
+#include "operator/offset_operator.hpp"
+
+VXZ::OffsetOperator::OffsetOperator(int distance, StructuringElement element)
+    : distance_(distance), element_(element)
+{
+}
+
+bool VXZ::OffsetOperator::apply(VXZ::VoxelGrid &grid) const
+{
+    if (distance_ > 0) {
+        dilate(grid, element_, distance_);
+    } else if (distance_ < 0) {
+        erode(grid, element_, -distance_);
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#include "operator/opening_operator.hpp"
+#include <stdexcept>
+
+VXZ::OpeningOperator::OpeningOperator(int radius, StructuringElement element)
+    : radius_(radius), element_(element)
+{
+    if (radius < 0) {
+        throw std::invalid_argument("Opening radius must be non-negative");
+    }
+}
+
+bool VXZ::OpeningOperator::apply(VXZ::VoxelGrid &grid) const
+{
+    opening(grid, element_, radius_);
+    return true;
+}
@@ -0,0 +1,294 @@
+#include "operator/smooth_operator.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <tbb/blocked_range2d.h>
+
+namespace VXZ {
+
+namespace {
+
+// Voxels of x per task in the y and z passes
+constexpr int kColumnGrain = 1024;
+
+// Rows per brick along y and z of the majority filter, before the halo
+constexpr int kBrickRows = 32;
+
+inline int clamp(int i, int n) {
+    return std::min(std::max(i, 0), n - 1);
+}
+
+inline bool is_finite(float v) { return std::isfinite(v); }
+inline bool is_finite(int32_t) { return true; }
+
+/**
+ * @brief Sliding box sum along one x-row, times scale
+ *
+ * The running sum only holds finite samples. Windows with a non-finite
+ * sample are summed directly, so inf and NaN come out as in a plain sum
+ * instead of poisoning the rest of the row through inf - inf.
+ */
+template <typename T, typename Sum>
+void box_row(T* row, int n, int radius, Sum scale, std::vector<T>& line) {
+    line.assign(row, row + n);
+    Sum sum = 0;
+    int non_finite = 0;
+    auto add = [&](T v, int sign) {
+        if (is_finite(v)) sum += sign * static_cast<Sum>(v); else non_finite += sign;
+    };
+    for (int k = -radius; k <= radius; ++k) {
+        add(line[clamp(k, n)], 1);
+    }
+    for (int i = 0; i < n; ++i) {
+        if (non_finite == 0) {
+            row[i] = static_cast<T>(sum * scale);
+        } else {
+            Sum direct = 0;
+            for (int k = -radius; k <= radius; ++k) direct += line[clamp(i + k, n)];
+            row[i] = static_cast<T>(direct * scale);
+        }
+        add(line[clamp(i + radius + 1, n)], 1);
+        add(line[clamp(i - radius, n)], -1);
+    }
+}
+
+/**
+ * @brief Gaussian along one x-row
+ */
+void gaussian_row(float* row, int n, const std::vector<float>& weights, std::vector<float>& line) {
+    const int radius = static_cast<int>(weights.size()) / 2;
+    // Border-padded copy, so that every tap is a shifted contiguous read
+    line.resize(static_cast<size_t>(n) + 2 * radius);
+    for (int i = 0; i < n + 2 * radius; ++i) {
+        line[i] = row[clamp(i - radius, n)];
+    }
+    std::fill(row, row + n, 0.0f);
+    for (int k = 0; k <= 2 * radius; ++k) {
+        const float w = weights[k];
+        const float* shifted = line.data() + k;
+        for (int i = 0; i < n; ++i) {
+            row[i] += w * shifted[i];
+        }
+    }
+}
+
+/**
+ * @brief Sliding box sum across count x-rows, columns [x_begin, x_end)
+ *
+ * Row j of in starts at in + j * stride; the sums go to the same places in out.
+ * Non-finite samples are handled as in box_row.
+ */
+template <typename T, typename Sum>
+void box_columns(const T* in, T* out, size_t stride, int count, int x_begin, int x_end, int radius, Sum scale,
+                 std::vector<Sum>& sum) {
+    const int width = x_end - x_begin;
+    sum.assign(static_cast<size_t>(width), 0);
+    // Non-finite samples per column window, see box_row
+    std::vector<int> non_finite(static_cast<size_t>(width), 0);
+    bool any_non_finite = false;
+    auto row = [&](int j) { return in + static_cast<size_t>(clamp(j, count)) * stride + x_begin; };
+    for (int k = -radius; k <= radius; ++k) {
+        const T* r = row(k);
+        for (int x = 0; x < width; ++x) {
+            if (is_finite(r[x])) sum[x] += r[x]; else { ++non_finite[x]; any_non_finite = true; }
+        }
+    }
+    auto slide = [&](int x, const T* enter, const T* leave) {
+        if (is_finite(enter[x])) sum[x] += enter[x]; else ++non_finite[x];
+        if (is_finite(leave[x])) sum[x] -= leave[x]; else --non_finite[x];
+    };
+    for (int j = 0; j < count; ++j) {
+        T* o = out + static_cast<size_t>(j) * stride + x_begin;
+        const T* enter = row(j + radius + 1);
+        const T* leave = row(j - radius);
+        if (!any_non_finite) {
+            // Everything seen so far is finite: the vectorizable path
+            for (int x = 0; x < width; ++x) o[x] = static_cast<T>(sum[x] * scale);
+            bool finite = true;
+            for (int x = 0; x < width; ++x) finite &= is_finite(enter[x]);
+            if (finite) {
+                for (int x = 0; x < width; ++x) sum[x] += static_cast<Sum>(enter[x]) - static_cast<Sum>(leave[x]);
+            } else {
+                any_non_finite = true;
+                for (int x = 0; x < width; ++x) slide(x, enter, leave);
+            }
+            continue;
+        }
+        for (int x = 0; x < width; ++x) {
+            if (non_finite[x] > 0) {
+                Sum direct = 0;
+                for (int k = -radius; k <= radius; ++k) direct += row(j + k)[x];
+                o[x] = static_cast<T>(direct * scale);
+            } else {
+                o[x] = static_cast<T>(sum[x] * scale);
+            }
+            slide(x, enter, leave);
+        }
+    }
+}
+
+/**
+ * @brief Gaussian across count x-rows, columns [x_begin, x_end); see box_columns
+ */
+void gaussian_columns(const float* in, float* out, size_t stride, int count, int x_begin, int x_end,
+                      const std::vector<float>& weights) {
+    const int radius = static_cast<int>(weights.size()) / 2;
+    const int width = x_end - x_begin;
+    for (int j = 0; j < count; ++j) {
+        float* o = out + static_cast<size_t>(j) * stride + x_begin;
+        std::fill(o, o + width, 0.0f);
+        for (int k = -radius; k <= radius; ++k) {
+            const float w = weights[k + radius];
+            const float* r = in + static_cast<size_t>(clamp(j + k, count)) * stride + x_begin;
+            for (int x = 0; x < width; ++x) {
+                o[x] += w * r[x];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Runs the three passes; values end up in values, scratch is clobbered
+ *
+ * row(ptr, n, line) filters one x-row in place; columns(in, out, stride,
+ * count, x_begin, x_end) filters across rows.
+ */
+template <typename T, typename Row, typename Columns>
+void separable(T* values, std::vector<T>& scratch, const Eigen::Vector3i& dims, Row row, Columns columns) {
+    const int nx = dims.x(), ny = dims.y(), nz = dims.z();
+    const size_t plane = static_cast<size_t>(nx) * ny;
+    tbb::parallel_for(tbb::blocked_range<int>(0, ny * nz, 64), [&](const tbb::blocked_range<int>& r) {
+        std::vector<T> line;
+        for (int i = r.begin(); i < r.end(); ++i) {
+            row(values + static_cast<size_t>(i) * nx, nx, line);
+        }
+    });
+    // y: values -> scratch, one line of rows per z plane
+    tbb::parallel_for(tbb::blocked_range2d<int>(0, nz, 1, 0, nx, kColumnGrain), [&](const tbb::blocked_range2d<int>& r) {
+        for (int z = r.rows().begin(); z < r.rows().end(); ++z) {
+            columns(values + z * plane, scratch.data() + z * plane, static_cast<size_t>(nx), ny,
+                    r.cols().begin(), r.cols().end());
+        }
+    });
+    // z: scratch -> values, one line of rows per y
+    tbb::parallel_for(tbb::blocked_range2d<int>(0, ny, 1, 0, nx, kColumnGrain), [&](const tbb::blocked_range2d<int>& r) {
+        for (int y = r.rows().begin(); y < r.rows().end(); ++y) {
+            const size_t offset = static_cast<size_t>(y) * nx;
+            columns(scratch.data() + offset, values + offset, plane, nz, r.cols().begin(), r.cols().end());
+        }
+    });
+}
+
+/**
+ * @brief Majority filter of a whole grid, through two int32 counts per voxel
+ */
+void majority_filter(VoxelGrid& grid, int radius) {
+    const Eigen::Vector3i dims = grid.dimensions();
+    const int nx = dims.x();
+    const int rows = dims.y() * dims.z();
+
+    // Box counts of occupied voxels
+    std::vector<int32_t> counts(static_cast<size_t>(rows) * nx);
+    tbb::parallel_for(tbb::blocked_range<int>(0, rows, 64), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            const uint64_t* row = grid.row_data(i % dims.y(), i / dims.y());
+            int32_t* out = &counts[static_cast<size_t>(i) * nx];
+            for (int x = 0; x < nx; ++x) {
+                out[x] = (row[x / VoxelGrid::kWordBits] >> (x % VoxelGrid::kWordBits)) & 1;
+            }
+        }
+    });
+    std::vector<int32_t> scratch(counts.size());
+    separable(counts.data(), scratch, dims,
+        [&](int32_t* row, int n, std::vector<int32_t>& line) { box_row<int32_t, int32_t>(row, n, radius, 1, line); },
+        [&](const int32_t* in, int32_t* out, size_t stride, int count, int x_begin, int x_end) {
+            std::vector<int32_t> sum;
+            box_columns<int32_t, int32_t>(in, out, stride, count, x_begin, x_end, radius, 1, sum);
+        });
+
+    const int64_t side = 2 * radius + 1;
+    const int64_t volume = side * side * side;
+    const size_t words = grid.words_per_row();
+    tbb::parallel_for(tbb::blocked_range<int>(0, rows, 64), [&](const tbb::blocked_range<int>& r) {
+        for (int i = r.begin(); i < r.end(); ++i) {
+            uint64_t* row = grid.row_data(i % dims.y(), i / dims.y());
+            const int32_t* in = &counts[static_cast<size_t>(i) * nx];
+            std::fill(row, row + words, uint64_t(0));
+            for (int x = 0; x < nx; ++x) {
+                if (2 * static_cast<int64_t>(in[x]) > volume) {
+                    row[x / VoxelGrid::kWordBits] |= uint64_t(1) << (x % VoxelGrid::kWordBits);
+                }
+            }
+        }
+    });
+}
+
+} // namespace
+
+SmoothOperator::SmoothOperator(int radius, SmoothingKernel kernel, float sigma)
+    : radius_(radius), kernel_(kernel), sigma_(sigma) {
+    if (radius < 0 || sigma < 0.0f) {
+        throw std::invalid_argument("Smoothing radius and sigma must be non-negative");
+    }
+    if (sigma_ == 0.0f) {
+        sigma_ = radius_ / 3.0f;
+    }
+    weights_.assign(static_cast<size_t>(2 * radius_ + 1), 0.0f);
+    float total = 0.0f;
+    for (int k = -radius_; k <= radius_; ++k) {
+        const float w = sigma_ > 0.0f ? std::exp(-0.5f * k * k / (sigma_ * sigma_)) : (k == 0 ? 1.0f : 0.0f);
+        weights_[k + radius_] = w;
+        total += w;
+    }
+    for (float& w : weights_) {
+        w /= total;
+    }
+}
+
+void SmoothOperator::apply(float* values, const Eigen::Vector3i& dims) const {
+    if (radius_ == 0 || (dims.array() <= 0).any()) return;
+    std::vector<float> scratch(static_cast<size_t>(dims.prod()));
+    if (kernel_ == SmoothingKernel::BOX) {
+        const double scale = 1.0 / (2 * radius_ + 1);
+        separable(values, scratch, dims,
+            [&](float* row, int n, std::vector<float>& line) { box_row<float, double>(row, n, radius_, scale, line); },
+            [&](const float* in, float* out, size_t stride, int count, int x_begin, int x_end) {
+                std::vector<double> sum;
+                box_columns<float, double>(in, out, stride, count, x_begin, x_end, radius_, scale, sum);
+            });
+    } else {
+        separable(values, scratch, dims,
+            [&](float* row, int n, std::vector<float>& line) { gaussian_row(row, n, weights_, line); },
+            [&](const float* in, float* out, size_t stride, int count, int x_begin, int x_end) {
+                gaussian_columns(in, out, stride, count, x_begin, x_end, weights_);
+            });
+    }
+}
+
+bool SmoothOperator::apply(DistanceField& field) const {
+    apply(field.distances().data(), field.dimensions());
+    return true;
+}
+
+bool SmoothOperator::apply(VoxelGrid& grid) const {
+    if (radius_ == 0) return true;
+    // The counts take 8 bytes per voxel, so beyond one brick the filter runs
+    // per brick of rows with a halo of radius_ rows, and only the tiles in
+    // flight hold counts. Tiles are clipped to the grid, so the border
+    // still repeats the border voxels.
+    const int brick = std::max(kBrickRows, 4 * radius_);
+    const Eigen::Vector3i& dims = grid.dimensions();
+    if (dims.y() <= brick && dims.z() <= brick) {
+        majority_filter(grid, radius_);
+        return true;
+    }
+    VoxelGrid result(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+    VXZ::parallel_apply_bricks(grid, result, brick, radius_, [&](const VoxelGrid& input, VoxelGrid& output, const GridBrick& b) {
+        VoxelGrid tile = copy_brick_tile(input, b);
+        majority_filter(tile, radius_);
+        store_brick_tile(tile, b, output);
+    });
+    grid = std::move(result);
+    return true;
+}
+
+} // namespace VXZ
@@ -0,0 +1,14 @@
+#include "operator/xor_operator.hpp"
+#include "core/voxel_grid.hpp"
+
+std::unique_ptr<VXZ::VoxelGrid> VXZ::XorOperator::apply(const VXZ::VoxelGrid &grid1, const VXZ::VoxelGrid &grid2)
+{
+    auto result = createResultGrid(grid1);
+    combine(grid1, grid2, BooleanOp::XOR, *result);
+    return result;
+}
+
+void VXZ::XorOperator::apply_in_place(VXZ::VoxelGrid &grid1, const VXZ::VoxelGrid &grid2)
+{
+    combine(grid1, grid2, BooleanOp::XOR, grid1);
+}
@@ -1,5 +1,6 @@
 // LazyThetaStarPlanner.cpp
 #include "LazyThetaStarPlanner.h"
+#include "voxelizer/line_traversal.hpp"
 #include <chrono>
 #include <cmath>
 #include <iostream>
@@ -82,37 +83,11 @@ bool LazyThetaStarPlanner::LineOfSight(StateID s1, StateID s2) const {
     env_->GridCoordFromStateID(s1, x0,y0,z0);
     env_->GridCoordFromStateID(s2, x1,y1,z1);
     // Bresenham as in ThetaStar
-    int dx = abs(x1-x0), dy = abs(y1-y0), dz = abs(z1-z0);
-    int sx = x1>x0?1:-1, sy = y1>y0?1:-1, sz = z1>z0?1:-1;
-    int err1, err2, dx2=dx*2, dy2=dy*2, dz2=dz*2;
-    int cx=x0, cy=y0, cz=z0;
-    auto check=[&](){ return env_->IsObstacle(env_->StateIDFromCoord(cx,cy,cz)); };
-    if(dx>=dy && dx>=dz) {
-        err1=dy2-dx; err2=dz2-dx;
-        for(int i=0;i<dx;i++){
-            if(err1>0){ cy+=sy; err1-=dx2; }
-            if(err2>0){ cz+=sz; err2-=dx2; }
-            cx+=sx; err1+=dy2; err2+=dz2;
-            if(check()) return false;
-        }
-    } else if(dy>=dx && dy>=dz) {
-        err1=dx2-dy; err2=dz2-dy;
-        for(int i=0;i<dy;i++){
-            if(err1>0){ cx+=sx; err1-=dy2; }
-            if(err2>0){ cz+=sz; err2-=dy2; }
-            cy+=sy; err1+=dx2; err2+=dz2;
-            if(check()) return false;
-        }
-    } else {
-        err1=dx2-dz; err2=dy2-dz;
-        for(int i=0;i<dz;i++){
-            if(err1>0){ cx+=sx; err1-=dz2; }
-            if(err2>0){ cy+=sy; err2-=dz2; }
-            cz+=sz; err1+=dx2; err2+=dy2;
-            if(check()) return false;
-        }
-    }
-    return true;
+    const Eigen::Vector3i from(x0, y0, z0);
+    VXZ::LineTraversal line(from, Eigen::Vector3i(x1, y1, z1), VXZ::LineAlgorithm::BRESENHAM);
+    return line.for_each_voxel([&](const Eigen::Vector3i& v) {
+        return v == from || !env_->IsOccupied(v.x(), v.y(), v.z());
+    });
 }
 
 double LazyThetaStarPlanner::Heuristic(StateID s1, StateID s2) const {
@@ -0,0 +1,589 @@
+#include "storage/chunked_map.hpp"
+#include "storage/svo.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <sys/stat.h>
+
+namespace VXZ {
+
+constexpr int ChunkedMap::kDefaultChunkSize;
+constexpr size_t ChunkedMap::kDefaultMaxResidentChunks;
+
+namespace {
+
+int floor_div(int value, int divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Test the inclusive box [lo, hi] of a grid on the packed rows
+bool grid_any_in_box(const VoxelGrid& grid, const Eigen::Vector3i& lo, const Eigen::Vector3i& hi) {
+    const int w0 = lo.x() / VoxelGrid::kWordBits;
+    const int w1 = hi.x() / VoxelGrid::kWordBits;
+    const uint64_t first = ~uint64_t(0) << (lo.x() % VoxelGrid::kWordBits);
+    const uint64_t last = ~uint64_t(0) >> (VoxelGrid::kWordBits - 1 - hi.x() % VoxelGrid::kWordBits);
+    for (int z = lo.z(); z <= hi.z(); ++z) {
+        for (int y = lo.y(); y <= hi.y(); ++y) {
+            const uint64_t* row = grid.row_data(y, z);
+            for (int w = w0; w <= w1; ++w) {
+                uint64_t mask = ~uint64_t(0);
+                if (w == w0) mask &= first;
+                if (w == w1) mask &= last;
+                if (row[w] & mask) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Append the occupied voxels of the inclusive box [lo, hi] of a grid, offset by origin
+void append_occupied(const VoxelGrid& grid, const Eigen::Vector3i& lo, const Eigen::Vector3i& hi,
+                     const Eigen::Vector3i& origin, std::vector<Eigen::Vector3i>& voxels) {
+    const int w0 = lo.x() / VoxelGrid::kWordBits;
+    const int w1 = hi.x() / VoxelGrid::kWordBits;
+    const uint64_t first = ~uint64_t(0) << (lo.x() % VoxelGrid::kWordBits);
+    const uint64_t last = ~uint64_t(0) >> (VoxelGrid::kWordBits - 1 - hi.x() % VoxelGrid::kWordBits);
+    for (int z = lo.z(); z <= hi.z(); ++z) {
+        for (int y = lo.y(); y <= hi.y(); ++y) {
+            const uint64_t* row = grid.row_data(y, z);
+            for (int w = w0; w <= w1; ++w) {
+                uint64_t word = row[w];
+                if (w == w0) word &= first;
+                if (w == w1) word &= last;
+                while (word) {
+                    const int b = __builtin_ctzll(word);
+                    word &= word - 1;
+                    voxels.push_back(origin + Eigen::Vector3i(w * VoxelGrid::kWordBits + b, y, z));
+                }
+            }
+        }
+    }
+}
+
+int chebyshev(const Eigen::Vector3i& a, const Eigen::Vector3i& b) {
+    return (a - b).cwiseAbs().maxCoeff();
+}
+
+// Chunks of the cube of the given radius, nearest rings first
+void append_cube(const Eigen::Vector3i& center, int radius, std::vector<Eigen::Vector3i>& chunks) {
+    for (int ring = 0; ring <= radius; ++ring) {
+        for (int z = -ring; z <= ring; ++z) {
+            for (int y = -ring; y <= ring; ++y) {
+                for (int x = -ring; x <= ring; ++x) {
+                    if (std::max(std::abs(x), std::max(std::abs(y), std::abs(z))) == ring) {
+                        chunks.push_back(center + Eigen::Vector3i(x, y, z));
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+size_t ChunkedMap::ChunkHash::operator()(const Eigen::Vector3i& key) const {
+    return static_cast<size_t>(key.x()) * 73856093u ^ static_cast<size_t>(key.y()) * 19349663u ^
+           static_cast<size_t>(key.z()) * 83492791u;
+}
+
+ChunkedMap::ChunkedMap(float resolution, const std::string& spill_directory,
+                       int chunk_size, size_t max_resident_chunks)
+    : resolution_(resolution),
+      chunk_size_(chunk_size),
+      directory_(spill_directory),
+      max_resident_(max_resident_chunks),
+      load_radius_(2),
+      unload_radius_(3),
+      prefetch_distance_(2),
+      spilling_(0),
+      epochs_(0),
+      focus_(Eigen::Vector3i::Zero()),
+      lookahead_(Eigen::Vector3i::Zero()),
+      pending_(0) {
+    if (!(resolution > 0.0f) || chunk_size < 4) {
+        throw std::invalid_argument("ChunkedMap needs a positive resolution and chunks of at least 4 voxels");
+    }
+    if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("Cannot create chunk directory " + directory_);
+    }
+}
+
+ChunkedMap::~ChunkedMap() {
+    flush();
+}
+
+Eigen::Vector3i ChunkedMap::world_to_voxel(const Eigen::Vector3f& world_pos) const {
+    return (world_pos / resolution_).array().floor().cast<int>();
+}
+
+Eigen::Vector3f ChunkedMap::voxel_to_world(const Eigen::Vector3i& voxel) const {
+    return (voxel.cast<float>().array() + 0.5f) * resolution_;
+}
+
+Eigen::Vector3i ChunkedMap::chunk_of(const Eigen::Vector3i& voxel) const {
+    return Eigen::Vector3i(floor_div(voxel.x(), chunk_size_),
+                           floor_div(voxel.y(), chunk_size_),
+                           floor_div(voxel.z(), chunk_size_));
+}
+
+std::string ChunkedMap::chunk_path(const Eigen::Vector3i& chunk) const {
+    return directory_ + "/chunk_" + std::to_string(chunk.x()) + "_" + std::to_string(chunk.y()) + "_" +
+           std::to_string(chunk.z()) + ".svo";
+}
+
+VoxelGrid ChunkedMap::make_chunk_grid(const Eigen::Vector3i& chunk) const {
+    // Half a voxel of slack keeps the dimensions exact under rounding
+    const Eigen::Vector3f min = (chunk * chunk_size_).cast<float>() * resolution_;
+    return VoxelGrid(resolution_, min, min + Eigen::Vector3f::Constant((chunk_size_ - 0.5f) * resolution_));
+}
+
+std::shared_ptr<VoxelGrid> ChunkedMap::read_chunk(const Eigen::Vector3i& chunk) const {
+    const std::string path = chunk_path(chunk);
+    if (!std::ifstream(path, std::ios::binary)) {
+        return nullptr;
+    }
+    SVOStorage svo;
+    std::shared_ptr<VoxelGrid> grid = std::make_shared<VoxelGrid>(make_chunk_grid(chunk));
+    if (!svo.load(path) || !svo.to_voxel_grid(*grid) ||
+        grid->dimensions() != Eigen::Vector3i::Constant(chunk_size_)) {
+        throw std::runtime_error("Cannot read chunk file " + path);
+    }
+    return grid;
+}
+
+bool ChunkedMap::write_chunk(const Eigen::Vector3i& chunk, const VoxelGrid& grid) const {
+    // Write aside and rename, so a chunk file is always complete
+    const std::string path = chunk_path(chunk);
+    const std::string staging = path + ".tmp";
+    SVOStorage svo;
+    return svo.from_voxel_grid(grid) && svo.save(staging) && std::rename(staging.c_str(), path.c_str()) == 0;
+}
+
+int ChunkedMap::focus_distance(const Eigen::Vector3i& chunk) const {
+    return std::min(chebyshev(chunk, focus_), chebyshev(chunk, lookahead_));
+}
+
+ChunkedMap::Chunk& ChunkedMap::resident(const Eigen::Vector3i& chunk, std::unique_lock<std::mutex>& lock) const {
+    for (;;) {
+        ChunkTable::iterator it = chunks_.find(chunk);
+        if (it == chunks_.end()) {
+            // A load in flight already holds a slot
+            make_room(chunk, lock);
+            it = chunks_.find(chunk);
+            if (it == chunks_.end()) {
+                it = add_loading(chunk);
+            }
+        }
+        if (it->second.state != ChunkState::LOADING) {
+            return it->second;
+        }
+
+        // Read it here rather than wait for a background load, which may be
+        // queued behind the calling task
+        const uint64_t epoch = it->second.epoch;
+        lock.unlock();
+        std::shared_ptr<VoxelGrid> grid;
+        try {
+            grid = read_chunk(chunk);
+        } catch (const std::runtime_error&) {
+            lock.lock();
+            it = chunks_.find(chunk);
+            if (it != chunks_.end() && it->second.epoch == epoch && it->second.state == ChunkState::LOADING) {
+                chunks_.erase(it);
+            }
+            throw;
+        }
+        lock.lock();
+        it = chunks_.find(chunk);
+        if (it == chunks_.end() || it->second.epoch != epoch) {
+            // Edited and spilled, or cancelled, while the file was read
+            continue;
+        }
+        if (it->second.state == ChunkState::LOADING) {
+            it->second.state = ChunkState::READY;
+            it->second.grid = std::move(grid);
+        }
+        return it->second;
+    }
+}
+
+VoxelGrid* ChunkedMap::writable(const Eigen::Vector3i& chunk, bool create, std::unique_lock<std::mutex>& lock) {
+    for (;;) {
+        Chunk& entry = resident(chunk, lock);
+        if (entry.state == ChunkState::SPILLING) {
+            if (entry.writing) {
+                // Keep it once written, then look again
+                entry.wanted = true;
+                drained_.wait(lock);
+                continue;
+            }
+            // Not started yet; the queued spill finds it ready and skips it
+            entry.state = ChunkState::READY;
+            --spilling_;
+        }
+        if (!entry.grid) {
+            if (!create) {
+                return nullptr;
+            }
+            entry.grid = std::make_shared<VoxelGrid>(make_chunk_grid(chunk));
+        }
+        entry.dirty = true;
+        return entry.grid.get();
+    }
+}
+
+bool ChunkedMap::get(const Eigen::Vector3i& voxel) const {
+    const Eigen::Vector3i chunk = chunk_of(voxel);
+    std::unique_lock<std::mutex> lock(mutex_);
+    Chunk& entry = resident(chunk, lock);
+    if (entry.state == ChunkState::SPILLING) {
+        entry.wanted = true;
+    }
+    return entry.grid && entry.grid->get(voxel - chunk * chunk_size_);
+}
+
+void ChunkedMap::set(const Eigen::Vector3i& voxel, bool value) {
+    const Eigen::Vector3i chunk = chunk_of(voxel);
+    const Eigen::Vector3i local = voxel - chunk * chunk_size_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    const Chunk& entry = resident(chunk, lock);
+    if ((entry.grid && entry.grid->get(local)) == value) {
+        return;
+    }
+    writable(chunk, true, lock)->set(local, value);
+}
+
+void ChunkedMap::set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value) {
+    const Eigen::Vector3i first = chunk_of(min);
+    const Eigen::Vector3i last = chunk_of(max);
+    for (int cz = first.z(); cz <= last.z(); ++cz) {
+        for (int cy = first.y(); cy <= last.y(); ++cy) {
+            for (int cx = first.x(); cx <= last.x(); ++cx) {
+                const Eigen::Vector3i chunk(cx, cy, cz);
+                const Eigen::Vector3i origin = chunk * chunk_size_;
+                const Eigen::Vector3i lo = (min - origin).cwiseMax(Eigen::Vector3i::Zero());
+                const Eigen::Vector3i hi = (max - origin).cwiseMin(Eigen::Vector3i::Constant(chunk_size_ - 1));
+                std::unique_lock<std::mutex> lock(mutex_);
+                VoxelGrid* grid = writable(chunk, value, lock);
+                if (!grid) continue;
+                for (int z = lo.z(); z <= hi.z(); ++z) {
+                    for (int y = lo.y(); y <= hi.y(); ++y) {
+                        grid->set_span(y, z, lo.x(), hi.x() + 1, value);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool ChunkedMap::any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+    if ((min.array() > max.array()).any()) {
+        return false;
+    }
+    const Eigen::Vector3i first = chunk_of(min);
+    const Eigen::Vector3i last = chunk_of(max);
+    for (int cz = first.z(); cz <= last.z(); ++cz) {
+        for (int cy = first.y(); cy <= last.y(); ++cy) {
+            for (int cx = first.x(); cx <= last.x(); ++cx) {
+                const Eigen::Vector3i chunk(cx, cy, cz);
+                const Eigen::Vector3i origin = chunk * chunk_size_;
+                std::unique_lock<std::mutex> lock(mutex_);
+                Chunk& entry = resident(chunk, lock);
+                if (entry.state == ChunkState::SPILLING) {
+                    entry.wanted = true;
+                }
+                if (entry.grid &&
+                    grid_any_in_box(*entry.grid, (min - origin).cwiseMax(Eigen::Vector3i::Zero()),
+                                    (max - origin).cwiseMin(Eigen::Vector3i::Constant(chunk_size_ - 1)))) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void ChunkedMap::for_each_occupied(const Eigen::Vector3i& min, const Eigen::Vector3i& max,
+                                   const std::function<void(const Eigen::Vector3i&)>& visitor) const {
+    if ((min.array() > max.array()).any()) {
+        return;
+    }
+    const Eigen::Vector3i first = chunk_of(min);
+    const Eigen::Vector3i last = chunk_of(max);
+    std::vector<Eigen::Vector3i> voxels;
+    for (int cz = first.z(); cz <= last.z(); ++cz) {
+        for (int cy = first.y(); cy <= last.y(); ++cy) {
+            for (int cx = first.x(); cx <= last.x(); ++cx) {
+                const Eigen::Vector3i chunk(cx, cy, cz);
+                const Eigen::Vector3i origin = chunk * chunk_size_;
+                const Eigen::Vector3i lo = (min - origin).cwiseMax(Eigen::Vector3i::Zero());
+                const Eigen::Vector3i hi = (max - origin).cwiseMin(Eigen::Vector3i::Constant(chunk_size_ - 1));
+                voxels.clear();
+                std::unique_lock<std::mutex> lock(mutex_);
+                ChunkTable::const_iterator it = chunks_.find(chunk);
+                if (it != chunks_.end() && it->second.state != ChunkState::LOADING) {
+                    if (it->second.grid) {
+                        append_occupied(*it->second.grid, lo, hi, origin, voxels);
+                    }
+                    lock.unlock();
+                } else {
+                    // Read past the table, so the resident set is left alone
+                    lock.unlock();
+                    const std::shared_ptr<VoxelGrid> grid = read_chunk(chunk);
+                    if (grid) {
+                        append_occupied(*grid, lo, hi, origin, voxels);
+                    }
+                }
+                for (const Eigen::Vector3i& voxel : voxels) {
+                    visitor(voxel);
+                }
+            }
+        }
+    }
+}
+
+void ChunkedMap::run_background(std::function<void()> task) const {
+    ++pending_;
+    arena_.enqueue([this, task]() {
+        task();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) {
+            idle_.notify_all();
+        }
+    });
+}
+
+ChunkedMap::ChunkTable::iterator ChunkedMap::add_loading(const Eigen::Vector3i& chunk) const {
+    Chunk entry;
+    entry.epoch = ++epochs_;
+    return chunks_.emplace(chunk, entry).first;
+}
+
+void ChunkedMap::schedule_load(const Eigen::Vector3i& chunk) const {
+    // The entry holds the chunk's slot while it loads
+    const uint64_t epoch = add_loading(chunk)->second.epoch;
+    run_background([this, chunk, epoch]() {
+        std::shared_ptr<VoxelGrid> grid;
+        bool ok = true;
+        try {
+            grid = read_chunk(chunk);
+        } catch (const std::runtime_error&) {
+            ok = false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        ChunkTable::iterator it = chunks_.find(chunk);
+        // Loaded meanwhile, or cancelled and perhaps queued again
+        if (it == chunks_.end() || it->second.epoch != epoch || it->second.state != ChunkState::LOADING) {
+            return;
+        }
+        if (ok) {
+            it->second.state = ChunkState::READY;
+            it->second.grid = std::move(grid);
+        } else {
+            // Dropped, so the next query reads it again and reports the error
+            chunks_.erase(it);
+        }
+    });
+}
+
+void ChunkedMap::unload(ChunkTable::iterator it) const {
+    Chunk& entry = it->second;
+    if (!entry.dirty || !entry.grid) {
+        chunks_.erase(it);
+        return;
+    }
+
+    entry.state = ChunkState::SPILLING;
+    entry.wanted = false;
+    ++spilling_;
+    const Eigen::Vector3i chunk = it->first;
+    run_background([this, chunk]() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ChunkTable::iterator it = chunks_.find(chunk);
+        // Edited or already written by a query making room
+        if (it == chunks_.end() || it->second.state != ChunkState::SPILLING || it->second.writing) {
+            return;
+        }
+        write_spill(chunk, lock);
+        // Loads held back for this slot
+        schedule_loads();
+    });
+}
+
+bool ChunkedMap::write_spill(const Eigen::Vector3i& chunk, std::unique_lock<std::mutex>& lock) const {
+    Chunk& claimed = chunks_.find(chunk)->second;
+    claimed.writing = true;
+    const std::shared_ptr<VoxelGrid> grid = claimed.grid;
+    lock.unlock();
+    const bool ok = write_chunk(chunk, *grid);
+    lock.lock();
+
+    // The entry stays while it is written: only ready and loading entries are removed
+    ChunkTable::iterator it = chunks_.find(chunk);
+    Chunk& entry = it->second;
+    entry.writing = false;
+    --spilling_;
+    if (!ok) {
+        // Kept in memory rather than lost; retried on the next unload
+        entry.state = ChunkState::READY;
+    } else if (entry.wanted) {
+        entry.state = ChunkState::READY;
+        entry.dirty = false;
+    } else {
+        chunks_.erase(it);
+    }
+    drained_.notify_all();
+    return ok;
+}
+
+void ChunkedMap::make_room(const Eigen::Vector3i& keep, std::unique_lock<std::mutex>& lock) const {
+    while (chunks_.size() >= max_resident_) {
+        ChunkTable::iterator queued = chunks_.end(), loading = chunks_.end();
+        bool writing = false;
+        for (ChunkTable::iterator it = chunks_.begin(); it != chunks_.end(); ++it) {
+            if (it->second.state == ChunkState::SPILLING) {
+                if (!it->second.writing) queued = it;
+                writing = writing || it->second.writing;
+            } else if (it->second.state == ChunkState::LOADING && it->first != keep) {
+                loading = it;
+            }
+        }
+
+        if (queued != chunks_.end()) {
+            // Already chosen for eviction; write it here instead of waiting for the task
+            if (!write_spill(queued->first, lock)) return;
+        } else if (evict_beyond(-1, &keep)) {
+            // Dropped, or spilling and written on the next pass
+        } else if (loading != chunks_.end()) {
+            // Cancel a background load; its task finds the entry gone
+            chunks_.erase(loading);
+        } else if (writing) {
+            drained_.wait(lock);
+        } else {
+            return;
+        }
+    }
+}
+
+bool ChunkedMap::evict_beyond(int distance, const Eigen::Vector3i* keep) const {
+    ChunkTable::iterator victim = chunks_.end();
+    int farthest = distance;
+    for (ChunkTable::iterator it = chunks_.begin(); it != chunks_.end(); ++it) {
+        if (it->second.state != ChunkState::READY || (keep && it->first == *keep)) {
+            continue;
+        }
+        const int d = focus_distance(it->first);
+        if (d > farthest) {
+            farthest = d;
+            victim = it;
+        }
+    }
+    if (victim == chunks_.end()) {
+        return false;
+    }
+    unload(victim);
+    return true;
+}
+
+void ChunkedMap::enforce_limit() const {
+    // Spills free their slots once written
+    while (chunks_.size() - spilling_ > max_resident_ && evict_beyond(-1, nullptr)) {
+    }
+}
+
+void ChunkedMap::set_focus(const Eigen::Vector3f& world_pos, const Eigen::Vector3f& velocity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    focus_ = chunk_of(world_to_voxel(world_pos));
+    lookahead_ = focus_;
+    if (prefetch_distance_ > 0 && velocity.norm() > 0.0f) {
+        const Eigen::Vector3f ahead = velocity.normalized() * static_cast<float>(prefetch_distance_);
+        lookahead_ += ahead.array().round().cast<int>().matrix();
+    }
+
+    std::vector<Eigen::Vector3i> far;
+    for (const auto& entry : chunks_) {
+        if (entry.second.state == ChunkState::READY && focus_distance(entry.first) > unload_radius_) {
+            far.push_back(entry.first);
+        }
+    }
+    for (const Eigen::Vector3i& chunk : far) {
+        unload(chunks_.find(chunk));
+    }
+    schedule_loads();
+}
+
+void ChunkedMap::schedule_loads() const {
+    // Around the focus first, then ahead of it
+    std::vector<Eigen::Vector3i> wanted;
+    append_cube(focus_, load_radius_, wanted);
+    if (lookahead_ != focus_) {
+        append_cube(lookahead_, load_radius_, wanted);
+    }
+    for (const Eigen::Vector3i& chunk : wanted) {
+        if (chunks_.count(chunk)) continue;
+        while (chunks_.size() >= max_resident_) {
+            const size_t spilling = spilling_;
+            if (!evict_beyond(focus_distance(chunk), nullptr)) {
+                return;
+            }
+            if (spilling_ != spilling) {
+                // The slot frees once the spill is written, which calls back here
+                return;
+            }
+        }
+        schedule_load(chunk);
+    }
+}
+
+void ChunkedMap::set_radii(int load_radius, int unload_radius) {
+    if (load_radius < 0 || unload_radius < load_radius) {
+        throw std::invalid_argument("ChunkedMap radii must satisfy 0 <= load_radius <= unload_radius");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    load_radius_ = load_radius;
+    unload_radius_ = unload_radius;
+}
+
+void ChunkedMap::wait() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+bool ChunkedMap::flush() {
+    wait();
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool ok = true;
+    for (auto& entry : chunks_) {
+        Chunk& chunk = entry.second;
+        if (chunk.state != ChunkState::READY || !chunk.dirty || !chunk.grid) continue;
+        if (write_chunk(entry.first, *chunk.grid)) {
+            chunk.dirty = false;
+        } else {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool ChunkedMap::is_resident(const Eigen::Vector3i& chunk) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ChunkTable::const_iterator it = chunks_.find(chunk);
+    return it != chunks_.end() && it->second.state != ChunkState::LOADING;
+}
+
+size_t ChunkedMap::resident_chunks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size();
+}
+
+void ChunkedMap::set_max_resident_chunks(size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_resident_ = count;
+    enforce_limit();
+}
+
+} // namespace VXZ
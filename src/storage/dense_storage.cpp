@@ -0,0 +1,152 @@
+#include "storage/dense_storage.hpp"
+#include "voxelizer/line_traversal.hpp"
+#include <fstream>
+#include <cstring>
+
+namespace VXZ {
+
+namespace {
+
+const char kMagic[4] = {'V', 'X', 'D', 'N'};
+const uint32_t kVersion = 1;
+
+} // namespace
+
+DenseStorage::DenseStorage() {
+}
+
+DenseStorage::DenseStorage(const VXZ::VoxelGrid& grid)
+    : grid_(std::make_unique<VoxelGrid>(grid)) {
+}
+
+bool DenseStorage::save(const std::string& filename) const {
+    if (!grid_) {
+        return false;
+    }
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        return false;
+    }
+
+    // Write header
+    const float resolution = grid_->resolution();
+    ofs.write(kMagic, sizeof(kMagic));
+    ofs.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+    ofs.write(reinterpret_cast<const char*>(&resolution), sizeof(resolution));
+    ofs.write(reinterpret_cast<const char*>(grid_->min_bounds().data()), 3 * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(grid_->max_bounds().data()), 3 * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(grid_->dimensions().data()), 3 * sizeof(int));
+
+    // Rows are contiguous, so the packed words go out in one piece
+    const Eigen::Vector3i& dims = grid_->dimensions();
+    const size_t words = grid_->words_per_row() * dims.y() * dims.z();
+    ofs.write(reinterpret_cast<const char*>(grid_->row_data(0, 0)), words * sizeof(uint64_t));
+    return ofs.good();
+}
+
+bool DenseStorage::load(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+
+    // Read header
+    char magic[4];
+    uint32_t version = 0;
+    float resolution;
+    Eigen::Vector3f min_bounds, max_bounds;
+    Eigen::Vector3i dimensions;
+    ifs.read(magic, sizeof(magic));
+    ifs.read(reinterpret_cast<char*>(&version), sizeof(version));
+    ifs.read(reinterpret_cast<char*>(&resolution), sizeof(resolution));
+    ifs.read(reinterpret_cast<char*>(min_bounds.data()), 3 * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(max_bounds.data()), 3 * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(dimensions.data()), 3 * sizeof(int));
+    if (!ifs || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) {
+        return false;
+    }
+
+    std::unique_ptr<VoxelGrid> grid = std::make_unique<VoxelGrid>(resolution, min_bounds, max_bounds);
+    if (grid->dimensions() != dimensions) {
+        return false;
+    }
+    const size_t words = grid->words_per_row() * dimensions.y() * dimensions.z();
+    ifs.read(reinterpret_cast<char*>(grid->row_data(0, 0)), words * sizeof(uint64_t));
+    if (!ifs) {
+        return false;
+    }
+    grid_ = std::move(grid);
+    return true;
+}
+
+size_t DenseStorage::get_size() const {
+    if (!grid_) {
+        return sizeof(*this);
+    }
+    const Eigen::Vector3i& dims = grid_->dimensions();
+    return sizeof(*this) + sizeof(VoxelGrid) + grid_->words_per_row() * dims.y() * dims.z() * sizeof(uint64_t);
+}
+
+bool DenseStorage::to_voxel_grid(VXZ::VoxelGrid& grid) const {
+    if (!grid_) {
+        return false;
+    }
+    grid = *grid_;
+    return true;
+}
+
+bool DenseStorage::from_voxel_grid(const VXZ::VoxelGrid& grid) {
+    grid_ = std::make_unique<VoxelGrid>(grid);
+    return true;
+}
+
+bool DenseStorage::get(const Eigen::Vector3i& position) const {
+    if (!grid_) {
+        throw std::out_of_range("Position outside dense storage grid");
+    }
+    return grid_->get(position);
+}
+
+Eigen::Vector3i DenseStorage::dimensions() const {
+    return grid_ ? grid_->dimensions() : Eigen::Vector3i::Zero();
+}
+
+bool DenseStorage::any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+    if (!grid_) {
+        return false;
+    }
+    const Eigen::Vector3i lo = min.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = max.cwiseMin(grid_->dimensions() - Eigen::Vector3i::Ones());
+    if ((lo.array() > hi.array()).any()) {
+        return false;
+    }
+
+    // Word range of the x-span and the masks of its first and last word
+    const int w0 = lo.x() / VoxelGrid::kWordBits;
+    const int w1 = hi.x() / VoxelGrid::kWordBits;
+    const uint64_t first = ~uint64_t(0) << (lo.x() % VoxelGrid::kWordBits);
+    const uint64_t last = ~uint64_t(0) >> (VoxelGrid::kWordBits - 1 - hi.x() % VoxelGrid::kWordBits);
+    for (int z = lo.z(); z <= hi.z(); ++z) {
+        for (int y = lo.y(); y <= hi.y(); ++y) {
+            const uint64_t* row = grid_->row_data(y, z);
+            for (int w = w0; w <= w1; ++w) {
+                uint64_t mask = ~uint64_t(0);
+                if (w == w0) mask &= first;
+                if (w == w1) mask &= last;
+                if (row[w] & mask) return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool DenseStorage::raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                           float max_distance, Eigen::Vector3i& hit) const {
+    if (!grid_ || direction.squaredNorm() == 0.0f) {
+        return false;
+    }
+    const Eigen::Vector3f end = origin + direction.normalized() * max_distance;
+    return find_first_occupied(*grid_, origin, end, hit, LineAlgorithm::RLV);
+}
+
+} // namespace VXZ
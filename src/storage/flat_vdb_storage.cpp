@@ -0,0 +1,126 @@
+#include "storage/flat_vdb_storage.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace VXZ {
+
+FlatVDBStorage::FlatVDBStorage() : mapped_(nullptr), mapped_size_(0) {
+}
+
+FlatVDBStorage::~FlatVDBStorage() {
+    release();
+}
+
+void FlatVDBStorage::release() {
+    if (mapped_) {
+        munmap(mapped_, mapped_size_);
+        mapped_ = nullptr;
+        mapped_size_ = 0;
+    }
+    std::vector<uint64_t>().swap(buffer_);
+    view_ = VDBTreeView();
+}
+
+bool FlatVDBStorage::attach_buffer(std::vector<uint64_t>& buffer) {
+    VDBTreeView view;
+    if (!view.attach(buffer.data(), buffer.size() * sizeof(uint64_t))) {
+        return false;
+    }
+    release();
+    buffer_.swap(buffer);
+    // Swapping keeps the storage, so the view stays valid
+    view_ = view;
+    return true;
+}
+
+bool FlatVDBStorage::save(const std::string& filename) const {
+    if (!view_.header) {
+        return false;
+    }
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        return false;
+    }
+    const char* data = reinterpret_cast<const char*>(view_.header);
+    const size_t size = mapped_ ? mapped_size_ : buffer_.size() * sizeof(uint64_t);
+    ofs.write(data, size);
+    return ofs.good();
+}
+
+bool FlatVDBStorage::load(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+    if (!ifs) {
+        return false;
+    }
+    const std::streamoff size = ifs.tellg();
+    if (size < static_cast<std::streamoff>(sizeof(VDBHeader))) {
+        return false;
+    }
+    std::vector<uint64_t> buffer((static_cast<size_t>(size) + 7) / 8);
+    ifs.seekg(0);
+    ifs.read(reinterpret_cast<char*>(buffer.data()), size);
+    if (!ifs) {
+        return false;
+    }
+    return attach_buffer(buffer);
+}
+
+bool FlatVDBStorage::map(const std::string& filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(VDBHeader))) {
+        close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    VDBTreeView view;
+    if (!view.attach(data, size)) {
+        munmap(data, size);
+        return false;
+    }
+    release();
+    mapped_ = data;
+    mapped_size_ = size;
+    view_ = view;
+    return true;
+}
+
+size_t FlatVDBStorage::get_size() const {
+    return sizeof(*this) + buffer_.size() * sizeof(uint64_t) + mapped_size_;
+}
+
+bool FlatVDBStorage::to_voxel_grid(VXZ::VoxelGrid& grid) const {
+    return view_.to_voxel_grid(grid);
+}
+
+bool FlatVDBStorage::from_voxel_grid(const VXZ::VoxelGrid& grid) {
+    VDBTreeStorage tree;
+    return tree.from_voxel_grid(grid) && from_tree(tree);
+}
+
+bool FlatVDBStorage::from_tree(const VDBTreeStorage& storage) {
+    std::vector<uint64_t> buffer = storage.flatten();
+    return attach_buffer(buffer);
+}
+
+bool FlatVDBStorage::get(const Eigen::Vector3i& position) const {
+    if ((position.array() < 0).any() || (position.array() >= dimensions().array()).any()) {
+        throw std::out_of_range("Position outside VDB grid");
+    }
+    return view_.get(position);
+}
+
+} // namespace VXZ
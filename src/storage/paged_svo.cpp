@@ -0,0 +1,492 @@
+#include "storage/paged_svo.hpp"
+#include "voxelizer/line_traversal.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace VXZ {
+
+constexpr size_t PagedSVOStorage::kPageAlignment;
+constexpr int PagedSVOStorage::kDefaultPageSize;
+constexpr size_t PagedSVOStorage::kDefaultMaxResidentPages;
+
+static_assert(sizeof(PagedSVOHeader) % 8 == 0, "Paged SVO sections must stay 8-byte aligned");
+static_assert(sizeof(PagedSVOPage) == 16, "PagedSVOPage must stay 16 bytes");
+
+namespace {
+
+const char kMagic[4] = {'V', 'X', 'S', 'P'};
+const uint32_t kVersion = 1;
+
+// Append raw bytes to a word buffer, padding to whole words
+void append(std::vector<uint64_t>& buffer, const void* data, size_t bytes) {
+    const size_t begin = buffer.size();
+    buffer.resize(begin + (bytes + 7) / 8, 0);
+    if (bytes > 0) {
+        std::memcpy(&buffer[begin], data, bytes);
+    }
+}
+
+size_t page_extent(const PagedSVOPage& page) {
+    return page.node_count * sizeof(SVONode) + page.brick_count * sizeof(uint64_t);
+}
+
+// System pages of a mapped page: all touched ones, or only those it covers
+void system_pages(const char* data, const PagedSVOPage& page, bool covered, char*& first, size_t& length) {
+    const uintptr_t system_page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(data) + page.offset;
+    const uintptr_t end = begin + page_extent(page);
+    uintptr_t lo = begin / system_page * system_page;
+    uintptr_t hi = (end + system_page - 1) / system_page * system_page;
+    if (covered) {
+        lo = (begin + system_page - 1) / system_page * system_page;
+        hi = end / system_page * system_page;
+    }
+    first = reinterpret_cast<char*>(lo);
+    length = hi > lo ? hi - lo : 0;
+}
+
+// Copy the subtree below an SVO node breadth-first with local child indices
+void copy_subtree(const SVOStorage& svo, uint32_t root, int levels,
+                  std::vector<SVONode>& nodes, std::vector<uint64_t>& bricks) {
+    nodes.assign(1, svo.nodes()[root]);
+    bricks.clear();
+    size_t level_begin = 0;
+    for (int l = levels; l >= 1; --l) {
+        const size_t level_end = nodes.size();
+        for (size_t k = level_begin; k < level_end; ++k) {
+            const SVONode node = nodes[k];
+            const uint32_t stored = static_cast<uint32_t>(__builtin_popcount(node.child_mask & ~node.full_mask));
+            nodes[k].first_child = static_cast<uint32_t>(l == 1 ? bricks.size() : nodes.size());
+            for (uint32_t j = 0; j < stored; ++j) {
+                if (l == 1) {
+                    bricks.push_back(svo.bricks()[node.first_child + j]);
+                } else {
+                    nodes.push_back(svo.nodes()[node.first_child + j]);
+                }
+            }
+        }
+        level_begin = level_end;
+    }
+}
+
+} // namespace
+
+PagedSVOStorage::PagedSVOStorage()
+    : mapped_(nullptr),
+      mapped_size_(0),
+      data_(nullptr),
+      header_(nullptr),
+      top_(nullptr),
+      pages_(nullptr),
+      top_levels_(0),
+      dimensions_(Eigen::Vector3i::Zero()),
+      max_resident_(kDefaultMaxResidentPages) {
+}
+
+PagedSVOStorage::~PagedSVOStorage() {
+    release();
+}
+
+void PagedSVOStorage::release() {
+    if (mapped_) {
+        munmap(mapped_, mapped_size_);
+        mapped_ = nullptr;
+        mapped_size_ = 0;
+    }
+    std::vector<uint64_t>().swap(buffer_);
+    data_ = nullptr;
+    header_ = nullptr;
+    top_ = nullptr;
+    pages_ = nullptr;
+    top_levels_ = 0;
+    dimensions_ = Eigen::Vector3i::Zero();
+    lru_.clear();
+    lru_position_.clear();
+    checked_.clear();
+}
+
+bool PagedSVOStorage::attach(const char* data, size_t size) {
+    if (size < sizeof(PagedSVOHeader)) {
+        return false;
+    }
+    const PagedSVOHeader* header = reinterpret_cast<const PagedSVOHeader*>(data);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion ||
+        header->depth < 1 || header->depth > 28 || header->page_depth < 1 || header->page_depth > header->depth ||
+        header->root_size != (SVOStorage::kBrickSize << header->depth) ||
+        (header->depth > header->page_depth) != (header->top_node_count > 0) ||
+        (header->top_node_count == 0 && header->page_count != 1) ||
+        header->top_node_count > (uint64_t(1) << 32) || header->page_count > (uint64_t(1) << 32) ||
+        header->dimensions[0] < 1 || header->dimensions[1] < 1 || header->dimensions[2] < 1 ||
+        header->dimensions[0] > header->root_size || header->dimensions[1] > header->root_size ||
+        header->dimensions[2] > header->root_size) {
+        return false;
+    }
+    const size_t tables = sizeof(PagedSVOHeader) + header->top_node_count * sizeof(SVONode) +
+                          header->page_count * sizeof(PagedSVOPage);
+    if (size < tables) {
+        return false;
+    }
+    const SVONode* top = reinterpret_cast<const SVONode*>(data + sizeof(PagedSVOHeader));
+    const PagedSVOPage* pages = reinterpret_cast<const PagedSVOPage*>(top + header->top_node_count);
+    for (uint64_t p = 0; p < header->page_count; ++p) {
+        if (pages[p].node_count == 0 || pages[p].offset % kPageAlignment != 0 ||
+            pages[p].offset < tables || pages[p].offset + page_extent(pages[p]) > size) {
+            return false;
+        }
+    }
+    // Child indices of the top levels; get() and the traversals follow them
+    // unchecked. Those of the pages are checked by acquire().
+    if (header->top_node_count > 0 &&
+        !SVOStorage::valid_tree(top, header->top_node_count, header->page_count, header->depth - header->page_depth)) {
+        return false;
+    }
+
+    data_ = data;
+    header_ = header;
+    top_ = top;
+    pages_ = pages;
+    top_levels_ = header->depth - header->page_depth;
+    dimensions_ = Eigen::Vector3i(header->dimensions[0], header->dimensions[1], header->dimensions[2]);
+    lru_.clear();
+    lru_position_.assign(header->page_count, lru_.end());
+    checked_.assign(header->page_count, PageCheck::UNCHECKED);
+    return true;
+}
+
+bool PagedSVOStorage::from_svo(const SVOStorage& svo, int page_size) {
+    if (svo.nodes().empty() || page_size < 2 * SVOStorage::kBrickSize || (page_size & (page_size - 1)) != 0) {
+        return false;
+    }
+    int page_depth = 0;
+    while ((SVOStorage::kBrickSize << page_depth) < page_size) {
+        ++page_depth;
+    }
+    page_depth = std::min(page_depth, svo.depth());
+    const int top_levels = svo.depth() - page_depth;
+
+    // Top levels breadth-first; the last one points at pages
+    std::vector<SVONode> top;
+    std::vector<uint32_t> page_roots;
+    if (top_levels == 0) {
+        page_roots.push_back(svo.root());
+    } else {
+        top.push_back(svo.nodes()[svo.root()]);
+        size_t level_begin = 0;
+        for (int l = top_levels; l >= 1; --l) {
+            const size_t level_end = top.size();
+            for (size_t k = level_begin; k < level_end; ++k) {
+                const SVONode node = top[k];
+                const uint32_t stored = static_cast<uint32_t>(__builtin_popcount(node.child_mask & ~node.full_mask));
+                top[k].first_child = static_cast<uint32_t>(l == 1 ? page_roots.size() : top.size());
+                for (uint32_t j = 0; j < stored; ++j) {
+                    if (l == 1) {
+                        page_roots.push_back(node.first_child + j);
+                    } else {
+                        top.push_back(svo.nodes()[node.first_child + j]);
+                    }
+                }
+            }
+            level_begin = level_end;
+        }
+    }
+
+    PagedSVOHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.resolution = svo.resolution();
+    for (int i = 0; i < 3; ++i) {
+        header.min_bounds[i] = svo.min_bounds()[i];
+        header.max_bounds[i] = svo.max_bounds()[i];
+        header.dimensions[i] = svo.dimensions()[i];
+    }
+    header.root_size = svo.root_size();
+    header.depth = svo.depth();
+    header.page_depth = page_depth;
+    header.top_node_count = top.size();
+    header.page_count = page_roots.size();
+
+    // Header, top levels and a page table filled in below
+    std::vector<uint64_t> buffer;
+    append(buffer, &header, sizeof(header));
+    append(buffer, top.data(), top.size() * sizeof(SVONode));
+    const size_t table = buffer.size();
+    buffer.resize(table + page_roots.size() * sizeof(PagedSVOPage) / 8, 0);
+
+    const size_t words_per_alignment = kPageAlignment / 8;
+    std::vector<SVONode> nodes;
+    std::vector<uint64_t> bricks;
+    for (size_t p = 0; p < page_roots.size(); ++p) {
+        copy_subtree(svo, page_roots[p], page_depth, nodes, bricks);
+        buffer.resize((buffer.size() + words_per_alignment - 1) / words_per_alignment * words_per_alignment, 0);
+        PagedSVOPage page;
+        page.offset = buffer.size() * 8;
+        page.node_count = static_cast<uint32_t>(nodes.size());
+        page.brick_count = static_cast<uint32_t>(bricks.size());
+        std::memcpy(&buffer[table + p * sizeof(PagedSVOPage) / 8], &page, sizeof(page));
+        append(buffer, nodes.data(), nodes.size() * sizeof(SVONode));
+        append(buffer, bricks.data(), bricks.size() * sizeof(uint64_t));
+    }
+
+    release();
+    buffer_.swap(buffer);
+    return attach(reinterpret_cast<const char*>(buffer_.data()), buffer_.size() * sizeof(uint64_t));
+}
+
+bool PagedSVOStorage::from_voxel_grid(const VXZ::VoxelGrid& grid) {
+    SVOStorage svo;
+    return svo.from_voxel_grid(grid) && from_svo(svo);
+}
+
+bool PagedSVOStorage::save(const std::string& filename) const {
+    if (!header_) {
+        return false;
+    }
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        return false;
+    }
+    const size_t size = mapped_ ? mapped_size_ : buffer_.size() * sizeof(uint64_t);
+    ofs.write(data_, size);
+    return ofs.good();
+}
+
+bool PagedSVOStorage::load(const std::string& filename) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(PagedSVOHeader))) {
+        close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    // Pages are read when queried, not ahead
+    madvise(data, size, MADV_RANDOM);
+
+    release();
+    mapped_ = data;
+    mapped_size_ = size;
+    if (!attach(static_cast<const char*>(data), size)) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+size_t PagedSVOStorage::get_size() const {
+    size_t size = sizeof(*this) + buffer_.size() * sizeof(uint64_t);
+    if (mapped_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size += sizeof(PagedSVOHeader) + header_->top_node_count * sizeof(SVONode) +
+                header_->page_count * sizeof(PagedSVOPage);
+        for (uint32_t page : lru_) {
+            size += page_extent(pages_[page]);
+        }
+    }
+    return size;
+}
+
+size_t PagedSVOStorage::resident_pages() const {
+    if (!mapped_) {
+        return page_count();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
+void PagedSVOStorage::set_max_resident_pages(size_t count) {
+    max_resident_ = std::max<size_t>(count, 1);
+    if (mapped_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evict_to(max_resident_);
+    }
+}
+
+// Requires mutex_
+void PagedSVOStorage::evict_to(size_t count) const {
+    while (lru_.size() > count) {
+        const uint32_t page = lru_.back();
+        lru_.pop_back();
+        lru_position_[page] = lru_.end();
+
+        // The mapping is private and read-only, so dropped pages are read
+        // again from the file if a reader still touches them. System pages
+        // shared with a neighbour are left alone.
+        char* first;
+        size_t length;
+        system_pages(data_, pages_[page], true, first, length);
+        if (length > 0) {
+            madvise(first, length, MADV_DONTNEED);
+        }
+    }
+}
+
+PagedSVOStorage::PageView PagedSVOStorage::acquire(uint32_t page) const {
+    const char* base = data_ + pages_[page].offset;
+    PageView view;
+    view.nodes = reinterpret_cast<const SVONode*>(base);
+    view.bricks = reinterpret_cast<const uint64_t*>(base + pages_[page].node_count * sizeof(SVONode));
+    if (!mapped_) {
+        return view;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (lru_position_[page] != lru_.end()) {
+        lru_.splice(lru_.begin(), lru_, lru_position_[page]);
+        return view;
+    }
+    if (checked_[page] == PageCheck::UNCHECKED) {
+        // Read outside the lock; threads racing here reach the same verdict
+        lock.unlock();
+        const bool valid = SVOStorage::valid_tree(view.nodes, pages_[page].node_count, pages_[page].brick_count,
+                                                  header_->page_depth);
+        lock.lock();
+        checked_[page] = valid ? PageCheck::VALID : PageCheck::CORRUPT;
+    }
+    if (checked_[page] == PageCheck::CORRUPT) {
+        throw std::runtime_error("Corrupt page " + std::to_string(page) + " in paged SVO file");
+    }
+    if (lru_position_[page] != lru_.end()) {
+        lru_.splice(lru_.begin(), lru_, lru_position_[page]);
+        return view;
+    }
+
+    // Fault the whole subtree in at once
+    char* first;
+    size_t length;
+    system_pages(data_, pages_[page], false, first, length);
+    madvise(first, length, MADV_WILLNEED);
+    lru_.push_front(page);
+    lru_position_[page] = lru_.begin();
+    evict_to(max_resident_);
+    return view;
+}
+
+bool PagedSVOStorage::get(const Eigen::Vector3i& position) const {
+    if ((position.array() < 0).any() || (position.array() >= dimensions_.array()).any()) {
+        throw std::out_of_range("Position outside paged SVO grid");
+    }
+
+    int half = header_->root_size / 2;
+    uint32_t page = 0;
+    if (top_levels_ > 0) {
+        uint32_t index = 0;
+        for (int level = top_levels_;; --level) {
+            const SVONode& node = top_[index];
+            const int child = ((position.x() & half) ? 1 : 0) |
+                              ((position.y() & half) ? 2 : 0) |
+                              ((position.z() & half) ? 4 : 0);
+            if (!(node.child_mask & (1u << child))) return false;
+            if (node.full_mask & (1u << child)) return true;
+            index = node.first_child + node.child_offset(child);
+            half >>= 1;
+            if (level == 1) break;
+        }
+        page = index;
+    }
+
+    const PageView view = acquire(page);
+    uint32_t index = 0;
+    for (int level = header_->page_depth;; --level) {
+        const SVONode& node = view.nodes[index];
+        const int child = ((position.x() & half) ? 1 : 0) |
+                          ((position.y() & half) ? 2 : 0) |
+                          ((position.z() & half) ? 4 : 0);
+        if (!(node.child_mask & (1u << child))) return false;
+        if (node.full_mask & (1u << child)) return true;
+        index = node.first_child + node.child_offset(child);
+        if (level == 1) {
+            const int bit = (position.x() & 3) + 4 * (position.y() & 3) + 16 * (position.z() & 3);
+            return (view.bricks[index] >> bit) & 1;
+        }
+        half >>= 1;
+    }
+}
+
+bool PagedSVOStorage::any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+    if (!header_) {
+        return false;
+    }
+    const Eigen::Vector3i lo = min.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = max.cwiseMin(dimensions_ - Eigen::Vector3i::Ones());
+    if ((lo.array() > hi.array()).any()) {
+        return false;
+    }
+
+    auto enter = [&](const Eigen::Vector3i& origin, int size) {
+        return (origin.array() <= hi.array()).all() && (origin.array() + size > lo.array()).all();
+    };
+    auto on_full = [](const Eigen::Vector3i&, int) { return false; };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        return (mask & SVOStorage::brick_box_mask(lo - origin, hi - origin)) == 0;
+    };
+    return !visit(enter, on_full, on_brick);
+}
+
+bool PagedSVOStorage::raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                              float max_distance, Eigen::Vector3i& hit) const {
+    if (!header_ || direction.squaredNorm() == 0.0f) {
+        return false;
+    }
+    const Eigen::Vector3f min_bounds(header_->min_bounds[0], header_->min_bounds[1], header_->min_bounds[2]);
+    const Eigen::Vector3f end = origin + direction.normalized() * max_distance;
+    LineTraversal line(Eigen::Vector3f((origin - min_bounds) / header_->resolution),
+                       Eigen::Vector3f((end - min_bounds) / header_->resolution), LineAlgorithm::RLV);
+    return !line.for_each_voxel(dimensions_, [&](const Eigen::Vector3i& v) {
+        if (get(v)) {
+            hit = v;
+            return false;
+        }
+        return true;
+    });
+}
+
+bool PagedSVOStorage::to_voxel_grid(VXZ::VoxelGrid& grid) const {
+    if (!header_) {
+        return false;
+    }
+    grid = VoxelGrid(header_->resolution,
+                     Eigen::Vector3f(header_->min_bounds[0], header_->min_bounds[1], header_->min_bounds[2]),
+                     Eigen::Vector3f(header_->max_bounds[0], header_->max_bounds[1], header_->max_bounds[2]));
+    if (grid.dimensions() != dimensions_) {
+        return false;
+    }
+
+    const Eigen::Vector3i dims = dimensions_;
+    auto enter = [](const Eigen::Vector3i&, int) { return true; };
+    auto on_full = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z) {
+            for (int y = origin.y(); y < end.y(); ++y) {
+                grid.set_span(y, z, origin.x(), end.x());
+            }
+        }
+        return true;
+    };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        SVOStorage::write_brick(grid, origin, mask);
+        return true;
+    };
+    try {
+        visit(enter, on_full, on_brick);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace VXZ
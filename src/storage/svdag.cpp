@@ -0,0 +1,434 @@
+#include "storage/svdag.hpp"
+#include "voxelizer/line_traversal.hpp"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace VXZ {
+
+constexpr int SVDAGStorage::kMirrorShift;
+constexpr uint32_t SVDAGStorage::kIndexMask;
+
+namespace {
+
+const char kMagic[4] = {'V', 'X', 'D', 'G'};
+const uint32_t kVersion = 1;
+
+struct KeyHash {
+    size_t operator()(const std::vector<uint32_t>& key) const {
+        uint64_t h = 1469598103934665603ull;
+        for (uint32_t v : key) {
+            h = (h ^ v) * 1099511628211ull;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+uint32_t stored_mask(uint32_t header) {
+    return header & ~(header >> 8) & 0xFF;
+}
+
+// Index of the reference to stored child s after the header
+uint32_t reference_slot(uint32_t header, int s) {
+    return 1 + static_cast<uint32_t>(__builtin_popcount(stored_mask(header) & ((1u << s) - 1)));
+}
+
+// Node key of the mirror image of a node given by its masks and the
+// references of its eight children (only stored ones are read)
+void mirrored_key(uint8_t child_mask, uint8_t full_mask, const uint32_t* children, int mirror,
+                  std::vector<uint32_t>& key) {
+    uint32_t mirrored_child = 0, mirrored_full = 0;
+    for (int c = 0; c < 8; ++c) {
+        const int s = c ^ mirror;
+        mirrored_child |= ((child_mask >> s) & 1u) << c;
+        mirrored_full |= ((full_mask >> s) & 1u) << c;
+    }
+    key.clear();
+    key.push_back(mirrored_child | mirrored_full << 8);
+    for (int c = 0; c < 8; ++c) {
+        const int s = c ^ mirror;
+        if ((child_mask & ~full_mask) & (1u << s)) {
+            key.push_back(children[s] ^ (static_cast<uint32_t>(mirror) << SVDAGStorage::kMirrorShift));
+        }
+    }
+}
+
+/**
+ * @brief Whether every node and brick reachable from root lies within the
+ * arrays, with depth node levels above the bricks
+ *
+ * Subtrees are shared, so a node may be reached many times and even at
+ * several levels; each (node, level) pair is checked once. Without symmetry
+ * no reference may carry mirror bits.
+ */
+bool valid_dag(const std::vector<uint32_t>& nodes, uint64_t brick_count, uint32_t root, int depth,
+               bool symmetric) {
+    const uint32_t mirror_bits = ~SVDAGStorage::kIndexMask;
+    std::vector<uint32_t> checked_levels(nodes.size(), 0);
+    std::vector<std::pair<uint32_t, int>> stack{{root, depth}};
+    while (!stack.empty()) {
+        const uint32_t reference = stack.back().first;
+        const int level = stack.back().second;
+        stack.pop_back();
+        if (!symmetric && (reference & mirror_bits)) return false;
+        const uint32_t index = reference & SVDAGStorage::kIndexMask;
+        if (level == 0) {
+            if (index >= brick_count) return false;
+            continue;
+        }
+        if (index >= nodes.size()) return false;
+        if (checked_levels[index] & (1u << level)) continue;
+        checked_levels[index] |= 1u << level;
+
+        const uint32_t header = nodes[index];
+        const uint32_t child_mask = header & 0xFF, full_mask = (header >> 8) & 0xFF;
+        if ((header >> 16) != 0 || (full_mask & ~child_mask)) return false;
+        const uint32_t stored = static_cast<uint32_t>(__builtin_popcount(stored_mask(header)));
+        if (static_cast<uint64_t>(index) + stored >= nodes.size()) return false;
+        for (uint32_t r = 1; r <= stored; ++r) {
+            stack.emplace_back(nodes[index + r], level - 1);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+SVDAGStorage::SVDAGStorage(bool symmetric)
+    : symmetric_(symmetric),
+      resolution_(0.0f),
+      min_bounds_(Eigen::Vector3f::Zero()),
+      max_bounds_(Eigen::Vector3f::Zero()),
+      dimensions_(Eigen::Vector3i::Zero()),
+      root_size_(0),
+      depth_(0),
+      root_(0) {
+}
+
+uint64_t SVDAGStorage::mirror_brick(uint64_t mask, int mirror) {
+    if (mirror & 1) {
+        // Reverse the 4 bits of every x-row
+        mask = ((mask & 0x1111111111111111ull) << 3) | ((mask & 0x2222222222222222ull) << 1) |
+               ((mask & 0x4444444444444444ull) >> 1) | ((mask & 0x8888888888888888ull) >> 3);
+    }
+    if (mirror & 2) {
+        // Reverse the 4 rows of every z-slice
+        mask = ((mask & 0x000F000F000F000Full) << 12) | ((mask & 0x00F000F000F000F0ull) << 4) |
+               ((mask & 0x0F000F000F000F00ull) >> 4) | ((mask & 0xF000F000F000F000ull) >> 12);
+    }
+    if (mirror & 4) {
+        // Reverse the 4 slices
+        mask = (mask << 48) | ((mask & 0x00000000FFFF0000ull) << 16) |
+               ((mask & 0x0000FFFF00000000ull) >> 16) | (mask >> 48);
+    }
+    return mask;
+}
+
+bool SVDAGStorage::save(const std::string& filename) const {
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        return false;
+    }
+
+    // Write header
+    const uint8_t symmetric = symmetric_ ? 1 : 0;
+    const uint64_t node_words = nodes_.size();
+    const uint64_t brick_count = bricks_.size();
+    ofs.write(kMagic, sizeof(kMagic));
+    ofs.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+    ofs.write(reinterpret_cast<const char*>(&symmetric), sizeof(symmetric));
+    ofs.write(reinterpret_cast<const char*>(&resolution_), sizeof(resolution_));
+    ofs.write(reinterpret_cast<const char*>(min_bounds_.data()), 3 * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(max_bounds_.data()), 3 * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(dimensions_.data()), 3 * sizeof(int));
+    ofs.write(reinterpret_cast<const char*>(&root_size_), sizeof(root_size_));
+    ofs.write(reinterpret_cast<const char*>(&depth_), sizeof(depth_));
+    ofs.write(reinterpret_cast<const char*>(&root_), sizeof(root_));
+    ofs.write(reinterpret_cast<const char*>(&node_words), sizeof(node_words));
+    ofs.write(reinterpret_cast<const char*>(&brick_count), sizeof(brick_count));
+
+    // Write both arrays in one piece each
+    ofs.write(reinterpret_cast<const char*>(nodes_.data()), node_words * sizeof(uint32_t));
+    ofs.write(reinterpret_cast<const char*>(bricks_.data()), brick_count * sizeof(uint64_t));
+    return ofs.good();
+}
+
+bool SVDAGStorage::load(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+
+    // Read header
+    char magic[4];
+    uint32_t version = 0;
+    ifs.read(magic, sizeof(magic));
+    ifs.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!ifs || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) {
+        return false;
+    }
+
+    uint8_t symmetric;
+    float resolution;
+    Eigen::Vector3f min_bounds, max_bounds;
+    Eigen::Vector3i dimensions;
+    int root_size, depth;
+    uint32_t root;
+    uint64_t node_words, brick_count;
+    ifs.read(reinterpret_cast<char*>(&symmetric), sizeof(symmetric));
+    ifs.read(reinterpret_cast<char*>(&resolution), sizeof(resolution));
+    ifs.read(reinterpret_cast<char*>(min_bounds.data()), 3 * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(max_bounds.data()), 3 * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(dimensions.data()), 3 * sizeof(int));
+    ifs.read(reinterpret_cast<char*>(&root_size), sizeof(root_size));
+    ifs.read(reinterpret_cast<char*>(&depth), sizeof(depth));
+    ifs.read(reinterpret_cast<char*>(&root), sizeof(root));
+    ifs.read(reinterpret_cast<char*>(&node_words), sizeof(node_words));
+    ifs.read(reinterpret_cast<char*>(&brick_count), sizeof(brick_count));
+    if (!ifs || node_words == 0 || depth < 1 || depth > 28 ||
+        root_size != (SVOStorage::kBrickSize << depth) || (dimensions.array() < 1).any() ||
+        (dimensions.array() > root_size).any()) {
+        return false;
+    }
+    // The arrays must fit in the rest of the file before anything is allocated
+    const std::streampos arrays = ifs.tellg();
+    ifs.seekg(0, std::ios::end);
+    const uint64_t remaining = static_cast<uint64_t>(ifs.tellg() - arrays);
+    ifs.seekg(arrays);
+    if (node_words > remaining / sizeof(uint32_t) ||
+        brick_count > (remaining - node_words * sizeof(uint32_t)) / sizeof(uint64_t)) {
+        return false;
+    }
+
+    // Read both arrays in one piece each
+    std::vector<uint32_t> nodes(node_words);
+    std::vector<uint64_t> bricks(brick_count);
+    ifs.read(reinterpret_cast<char*>(nodes.data()), node_words * sizeof(uint32_t));
+    ifs.read(reinterpret_cast<char*>(bricks.data()), brick_count * sizeof(uint64_t));
+    if (!ifs || !valid_dag(nodes, brick_count, root, depth, symmetric != 0)) {
+        return false;
+    }
+
+    symmetric_ = symmetric != 0;
+    resolution_ = resolution;
+    min_bounds_ = min_bounds;
+    max_bounds_ = max_bounds;
+    dimensions_ = dimensions;
+    root_size_ = root_size;
+    depth_ = depth;
+    root_ = root;
+    nodes_.swap(nodes);
+    bricks_.swap(bricks);
+    return true;
+}
+
+size_t SVDAGStorage::get_size() const {
+    return sizeof(*this) + nodes_.size() * sizeof(uint32_t) + bricks_.size() * sizeof(uint64_t);
+}
+
+bool SVDAGStorage::to_voxel_grid(VXZ::VoxelGrid& grid) const {
+    if (nodes_.empty()) {
+        return false;
+    }
+    grid = VoxelGrid(resolution_, min_bounds_, max_bounds_);
+    if (grid.dimensions() != dimensions_) {
+        return false;
+    }
+
+    const Eigen::Vector3i dims = dimensions_;
+    auto enter = [](const Eigen::Vector3i&, int) { return true; };
+    auto on_full = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z) {
+            for (int y = origin.y(); y < end.y(); ++y) {
+                grid.set_span(y, z, origin.x(), end.x());
+            }
+        }
+        return true;
+    };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        SVOStorage::write_brick(grid, origin, mask);
+        return true;
+    };
+    visit_node(root_, Eigen::Vector3i::Zero(), root_size_, 0, enter, on_full, on_brick);
+    return true;
+}
+
+bool SVDAGStorage::from_voxel_grid(const VXZ::VoxelGrid& grid) {
+    SVOStorage svo;
+    return svo.from_voxel_grid(grid) && from_svo(svo);
+}
+
+bool SVDAGStorage::from_svo(const SVOStorage& svo) {
+    // The merge walks the breadth-first levels
+    if (!svo.is_compact()) {
+        SVOStorage compacted(svo);
+        compacted.compact();
+        return from_svo(compacted);
+    }
+    const BlockArray<SVONode>& svo_nodes = svo.nodes();
+    const BlockArray<uint64_t>& svo_bricks = svo.bricks();
+    if (svo_nodes.empty()) {
+        return false;
+    }
+    const int depth = svo.depth();
+    const int mirrors = symmetric_ ? 8 : 1;
+
+    // Ranges of the breadth-first SVO levels
+    std::vector<size_t> level_begin(depth + 1), level_end(depth + 1);
+    level_begin[depth] = 0;
+    level_end[depth] = 1;
+    for (int l = depth; l > 1; --l) {
+        size_t stored = 0;
+        for (size_t k = level_begin[l]; k < level_end[l]; ++k) {
+            stored += __builtin_popcount(svo_nodes[k].child_mask & ~svo_nodes[k].full_mask);
+        }
+        level_begin[l - 1] = level_end[l];
+        level_end[l - 1] = level_end[l] + stored;
+    }
+
+    // Merge bricks; a brick is referenced as the mirror image of its canonical form
+    std::vector<uint64_t> bricks;
+    std::vector<uint32_t> child_refs(svo_bricks.size());
+    std::unordered_map<uint64_t, uint32_t> brick_ids;
+    for (size_t i = 0; i < svo_bricks.size(); ++i) {
+        uint64_t canonical = svo_bricks[i];
+        int mirror = 0;
+        for (int m = 1; m < mirrors; ++m) {
+            const uint64_t image = mirror_brick(svo_bricks[i], m);
+            if (image < canonical) {
+                canonical = image;
+                mirror = m;
+            }
+        }
+        auto it = brick_ids.emplace(canonical, static_cast<uint32_t>(bricks.size())).first;
+        if (it->second == bricks.size()) {
+            bricks.push_back(canonical);
+        }
+        child_refs[i] = it->second | static_cast<uint32_t>(mirror) << kMirrorShift;
+    }
+    if (bricks.size() > kIndexMask) {
+        return false;
+    }
+
+    // Merge node levels bottom-up on masks and merged child references
+    std::vector<uint32_t> nodes;
+    std::unordered_map<std::vector<uint32_t>, uint32_t, KeyHash> node_ids;
+    std::vector<uint32_t> key, best;
+    for (int l = 1; l <= depth; ++l) {
+        const size_t child_base = l == 1 ? 0 : level_begin[l - 1];
+        std::vector<uint32_t> refs(level_end[l] - level_begin[l]);
+        for (size_t k = level_begin[l]; k < level_end[l]; ++k) {
+            const SVONode& node = svo_nodes[k];
+            uint32_t children[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            for (int s = 0; s < 8; ++s) {
+                if ((node.child_mask & ~node.full_mask) & (1u << s)) {
+                    children[s] = child_refs[node.first_child - child_base + node.child_offset(s)];
+                }
+            }
+
+            int mirror = 0;
+            mirrored_key(node.child_mask, node.full_mask, children, 0, best);
+            for (int m = 1; m < mirrors; ++m) {
+                mirrored_key(node.child_mask, node.full_mask, children, m, key);
+                if (key < best) {
+                    best.swap(key);
+                    mirror = m;
+                }
+            }
+
+            auto it = node_ids.emplace(best, static_cast<uint32_t>(nodes.size())).first;
+            if (it->second == nodes.size()) {
+                nodes.insert(nodes.end(), best.begin(), best.end());
+            }
+            refs[k - level_begin[l]] = it->second | static_cast<uint32_t>(mirror) << kMirrorShift;
+        }
+        if (nodes.size() > kIndexMask) {
+            return false;
+        }
+        child_refs.swap(refs);
+    }
+
+    resolution_ = svo.resolution();
+    min_bounds_ = svo.min_bounds();
+    max_bounds_ = svo.max_bounds();
+    dimensions_ = svo.dimensions();
+    root_size_ = svo.root_size();
+    depth_ = depth;
+    root_ = child_refs[0];
+    nodes_.swap(nodes);
+    bricks_.swap(bricks);
+    return true;
+}
+
+bool SVDAGStorage::get(const Eigen::Vector3i& position) const {
+    if ((position.array() < 0).any() || (position.array() >= dimensions_.array()).any()) {
+        throw std::out_of_range("Position outside SVDAG grid");
+    }
+
+    uint32_t reference = root_;
+    int mirror = 0;
+    int half = root_size_ / 2;
+    for (int level = depth_;; --level) {
+        mirror ^= static_cast<int>(reference >> kMirrorShift);
+        const uint32_t index = reference & kIndexMask;
+        const uint32_t header = nodes_[index];
+        const int child = ((position.x() & half) ? 1 : 0) |
+                          ((position.y() & half) ? 2 : 0) |
+                          ((position.z() & half) ? 4 : 0);
+        const int s = child ^ mirror;
+        if (!(header & (1u << s))) return false;
+        if (header & (0x100u << s)) return true;
+        reference = nodes_[index + reference_slot(header, s)];
+        if (level == 1) {
+            mirror ^= static_cast<int>(reference >> kMirrorShift);
+            int x = position.x() & 3, y = position.y() & 3, z = position.z() & 3;
+            if (mirror & 1) x = 3 - x;
+            if (mirror & 2) y = 3 - y;
+            if (mirror & 4) z = 3 - z;
+            return (bricks_[reference & kIndexMask] >> (x + 4 * y + 16 * z)) & 1;
+        }
+        half >>= 1;
+    }
+}
+
+bool SVDAGStorage::any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+    if (nodes_.empty()) {
+        return false;
+    }
+    const Eigen::Vector3i lo = min.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = max.cwiseMin(dimensions_ - Eigen::Vector3i::Ones());
+    if ((lo.array() > hi.array()).any()) {
+        return false;
+    }
+
+    auto enter = [&](const Eigen::Vector3i& origin, int size) {
+        return (origin.array() <= hi.array()).all() && (origin.array() + size > lo.array()).all();
+    };
+    auto on_full = [](const Eigen::Vector3i&, int) { return false; };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        return (mask & SVOStorage::brick_box_mask(lo - origin, hi - origin)) == 0;
+    };
+    return !visit_node(root_, Eigen::Vector3i::Zero(), root_size_, 0, enter, on_full, on_brick);
+}
+
+bool SVDAGStorage::raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                           float max_distance, Eigen::Vector3i& hit) const {
+    if (nodes_.empty() || direction.squaredNorm() == 0.0f) {
+        return false;
+    }
+    const Eigen::Vector3f end = origin + direction.normalized() * max_distance;
+    LineTraversal line(Eigen::Vector3f((origin - min_bounds_) / resolution_),
+                       Eigen::Vector3f((end - min_bounds_) / resolution_), LineAlgorithm::RLV);
+    return !line.for_each_voxel(dimensions_, [&](const Eigen::Vector3i& v) {
+        if (get(v)) {
+            hit = v;
+            return false;
+        }
+        return true;
+    });
+}
+
+} // namespace VXZ
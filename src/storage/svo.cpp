@@ -1,25 +1,129 @@
 #include "storage/svo.hpp"
+#include "voxelizer/line_traversal.hpp"
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
 #include <fstream>
-#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
 
 namespace VXZ {
 
-SVOStorage::SVOStorage() : max_depth_(0), resolution_(0) {
-    root_ = std::make_unique<SVONode>();
+constexpr int SVOStorage::kBrickSize;
+
+static_assert(sizeof(SVONode) == 8, "SVONode must stay 8 bytes");
+
+namespace {
+
+const char kMagic[4] = {'V', 'X', 'S', 'O'};
+const uint32_t kVersion = 1;
+
+enum CellState : uint8_t {
+    EMPTY = 0,
+    FULL = 1,
+    MIXED = 2
+};
+
+// Empty/full/mixed state of every cell of one octree level
+struct LevelStates {
+    Eigen::Vector3i cells;
+    std::vector<uint8_t> state;
+
+    size_t index(const Eigen::Vector3i& c) const {
+        return (static_cast<size_t>(c.z()) * cells.y() + c.y()) * cells.x() + c.x();
+    }
+    // Cells past the grid are padding and read as empty
+    uint8_t at(const Eigen::Vector3i& c) const {
+        if ((c.array() >= cells.array()).any()) return EMPTY;
+        return state[index(c)];
+    }
+};
+
+Eigen::Vector3i child_offset(int i) {
+    return Eigen::Vector3i(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+}
+
+// Occupancy of the row of bricks (by, bz), bit x + 4y + 16z of each brick.
+// A row word holds the x-rows of 16 consecutive bricks.
+void extract_brick_row(const VoxelGrid& grid, int by, int bz, int bricks_x, uint64_t* masks) {
+    const Eigen::Vector3i& dims = grid.dimensions();
+    const int bricks_per_word = VoxelGrid::kWordBits / SVOStorage::kBrickSize;
+    std::fill(masks, masks + bricks_x, uint64_t(0));
+    for (int dz = 0; dz < SVOStorage::kBrickSize; ++dz) {
+        const int z = bz * SVOStorage::kBrickSize + dz;
+        if (z >= dims.z()) break;
+        for (int dy = 0; dy < SVOStorage::kBrickSize; ++dy) {
+            const int y = by * SVOStorage::kBrickSize + dy;
+            if (y >= dims.y()) break;
+            // Bits past the end of a row are zero, so padding stays empty
+            const uint64_t* row = grid.row_data(y, z);
+            const int shift = 4 * dy + 16 * dz;
+            for (size_t w = 0; w < grid.words_per_row(); ++w) {
+                const uint64_t word = row[w];
+                if (word == 0) continue;
+                const int bx0 = static_cast<int>(w) * bricks_per_word;
+                const int n = std::min(bricks_per_word, bricks_x - bx0);
+                for (int k = 0; k < n; ++k) {
+                    masks[bx0 + k] |= ((word >> (SVOStorage::kBrickSize * k)) & 0xF) << shift;
+                }
+            }
+        }
+    }
+}
+
+uint8_t brick_state(uint64_t mask) {
+    return mask == 0 ? EMPTY : (~mask == 0 ? FULL : MIXED);
+}
+
+} // namespace
+
+SVOStorage::SVOStorage()
+    : resolution_(0.0f),
+      min_bounds_(Eigen::Vector3f::Zero()),
+      max_bounds_(Eigen::Vector3f::Zero()),
+      dimensions_(Eigen::Vector3i::Zero()),
+      root_size_(0),
+      depth_(0),
+      root_(0),
+      compact_(true),
+      compact_size_(0) {
 }
 
 bool SVOStorage::save(const std::string& filename) const {
+    // The file holds the breadth-first layout
+    if (!compact_) {
+        SVOStorage compacted(*this);
+        compacted.compact();
+        return compacted.save(filename);
+    }
+
     std::ofstream ofs(filename, std::ios::binary);
     if (!ofs) {
         return false;
     }
 
     // Write header
-    ofs.write(reinterpret_cast<const char*>(&max_depth_), sizeof(max_depth_));
+    const uint64_t node_count = nodes_.size();
+    const uint64_t brick_count = bricks_.size();
+    ofs.write(kMagic, sizeof(kMagic));
+    ofs.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
     ofs.write(reinterpret_cast<const char*>(&resolution_), sizeof(resolution_));
+    ofs.write(reinterpret_cast<const char*>(min_bounds_.data()), 3 * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(max_bounds_.data()), 3 * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(dimensions_.data()), 3 * sizeof(int));
+    ofs.write(reinterpret_cast<const char*>(&root_size_), sizeof(root_size_));
+    ofs.write(reinterpret_cast<const char*>(&depth_), sizeof(depth_));
+    ofs.write(reinterpret_cast<const char*>(&node_count), sizeof(node_count));
+    ofs.write(reinterpret_cast<const char*>(&brick_count), sizeof(brick_count));
 
-    // Write tree structure
-    save_node(root_.get(), ofs);
+    // Write both arrays block by block
+    nodes_.for_each_block([&](const SVONode* data, size_t count) {
+        ofs.write(reinterpret_cast<const char*>(data), count * sizeof(SVONode));
+    });
+    bricks_.for_each_block([&](const uint64_t* data, size_t count) {
+        ofs.write(reinterpret_cast<const char*>(data), count * sizeof(uint64_t));
+    });
     return ofs.good();
 }
 
@@ -30,167 +134,549 @@ bool SVOStorage::load(const std::string& filename) {
     }
 
     // Read header
-    ifs.read(reinterpret_cast<char*>(&max_depth_), sizeof(max_depth_));
-    ifs.read(reinterpret_cast<char*>(&resolution_), sizeof(resolution_));
+    char magic[4];
+    uint32_t version = 0;
+    ifs.read(magic, sizeof(magic));
+    ifs.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!ifs || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) {
+        return false;
+    }
+
+    float resolution;
+    Eigen::Vector3f min_bounds, max_bounds;
+    Eigen::Vector3i dimensions;
+    int root_size, depth;
+    uint64_t node_count, brick_count;
+    ifs.read(reinterpret_cast<char*>(&resolution), sizeof(resolution));
+    ifs.read(reinterpret_cast<char*>(min_bounds.data()), 3 * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(max_bounds.data()), 3 * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(dimensions.data()), 3 * sizeof(int));
+    ifs.read(reinterpret_cast<char*>(&root_size), sizeof(root_size));
+    ifs.read(reinterpret_cast<char*>(&depth), sizeof(depth));
+    ifs.read(reinterpret_cast<char*>(&node_count), sizeof(node_count));
+    ifs.read(reinterpret_cast<char*>(&brick_count), sizeof(brick_count));
+    if (!ifs || node_count == 0 || depth < 1 || depth > 28 ||
+        root_size != (kBrickSize << depth) || (dimensions.array() < 1).any() || (dimensions.array() > root_size).any()) {
+        return false;
+    }
+    // The arrays must fit in the rest of the file before anything is allocated
+    const std::streampos arrays = ifs.tellg();
+    ifs.seekg(0, std::ios::end);
+    const uint64_t remaining = static_cast<uint64_t>(ifs.tellg() - arrays);
+    ifs.seekg(arrays);
+    if (node_count > remaining / sizeof(SVONode) ||
+        brick_count > (remaining - node_count * sizeof(SVONode)) / sizeof(uint64_t)) {
+        return false;
+    }
+
+    // Read both arrays in one piece each
+    std::vector<SVONode> nodes(node_count);
+    std::vector<uint64_t> bricks(brick_count);
+    ifs.read(reinterpret_cast<char*>(nodes.data()), node_count * sizeof(SVONode));
+    ifs.read(reinterpret_cast<char*>(bricks.data()), brick_count * sizeof(uint64_t));
+    if (!ifs || !valid_tree(nodes.data(), nodes.size(), brick_count, depth)) {
+        return false;
+    }
 
-    // Read tree structure
-    load_node(root_.get(), ifs);
-    return ifs.good();
+    resolution_ = resolution;
+    min_bounds_ = min_bounds;
+    max_bounds_ = max_bounds;
+    dimensions_ = dimensions;
+    root_size_ = root_size;
+    depth_ = depth;
+    root_ = 0;
+    nodes_.assign(nodes);
+    bricks_.assign(bricks);
+    compact_ = true;
+    compact_size_ = nodes_.size() + bricks_.size();
+    return true;
 }
 
 size_t SVOStorage::get_size() const {
-    return calculate_node_size(root_.get());
+    return sizeof(*this) + nodes_.size() * sizeof(SVONode) + bricks_.size() * sizeof(uint64_t);
 }
 
 bool SVOStorage::to_voxel_grid(VXZ::VoxelGrid& grid) const {
-    if (!root_) {
+    if (nodes_.empty()) {
+        return false;
+    }
+    grid = VoxelGrid(resolution_, min_bounds_, max_bounds_);
+    if (grid.dimensions() != dimensions_) {
         return false;
     }
-    // Create grid with appropriate resolution
-    // grid.resize(resolution_, resolution_, resolution_);
-    
-    // Convert tree to grid
-    node_to_grid(root_.get(), grid, 0, 0, 0, resolution_);
+
+    const Eigen::Vector3i dims = dimensions_;
+    auto on_full = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z) {
+            for (int y = origin.y(); y < end.y(); ++y) {
+                grid.set_span(y, z, origin.x(), end.x());
+            }
+        }
+        return true;
+    };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        write_brick(grid, origin, mask);
+        return true;
+    };
+    auto enter = [](const Eigen::Vector3i&, int) { return true; };
+    visit_node(root_, Eigen::Vector3i::Zero(), root_size_, enter, on_full, on_brick);
     return true;
 }
 
+// Bottom-up build: leaf bricks are read from the packed rows in parallel,
+// reduced to empty/full/mixed states level by level, and the stored nodes
+// are then laid out top-down, each level placed with a prefix sum over the
+// stored child counts of the level above.
 bool SVOStorage::from_voxel_grid(const VXZ::VoxelGrid& grid) {
-    if (grid.get_size_x() != grid.get_size_y() || 
-        grid.get_size_x() != grid.get_size_z()) {
-        return false; // Only support cubic grids
-    }
-
-    resolution_ = grid.get_size_x();
-    max_depth_ = static_cast<size_t>(std::log2(resolution_));
-    
-    // Reset root node
-    root_ = std::make_unique<SVONode>();
-    
-    // Build tree
-    build_node(root_.get(), grid, 0, 0, 0, resolution_, 0);
-    return true;
-}
+    const Eigen::Vector3i dims = grid.dimensions();
+    if ((dims.array() <= 0).any()) {
+        return false;
+    }
 
-void SVOStorage::build_node(SVONode* node, const VXZ::VoxelGrid& grid,
-                          size_t x, size_t y, size_t z,
-                          size_t size, size_t depth) {
-    if (size == 1) {
-        // Leaf node
-        node->is_leaf = true;
-        // Use Eigen::Vector3i to get the voxel value
-        Eigen::Vector3i position(x, y, z);
-        node->value = grid.get(position);
-        return;
+    // Smallest power-of-two cube holding the grid with at least one node level
+    int root_size = 2 * kBrickSize;
+    int depth = 1;
+    while (root_size < dims.maxCoeff()) {
+        root_size *= 2;
+        ++depth;
+    }
+
+    // Leaf bricks and their states
+    std::vector<LevelStates> levels(depth + 1);
+    LevelStates& leaves = levels[0];
+    leaves.cells = (dims + Eigen::Vector3i::Constant(kBrickSize - 1)) / kBrickSize;
+    leaves.state.resize(leaves.cells.prod());
+    std::vector<uint64_t> brick_masks(leaves.cells.prod());
+    tbb::parallel_for(tbb::blocked_range<int>(0, leaves.cells.y() * leaves.cells.z()),
+                      [&](const tbb::blocked_range<int>& r) {
+        for (int row = r.begin(); row != r.end(); ++row) {
+            const int by = row % leaves.cells.y();
+            const int bz = row / leaves.cells.y();
+            const size_t begin = leaves.index(Eigen::Vector3i(0, by, bz));
+            extract_brick_row(grid, by, bz, leaves.cells.x(), &brick_masks[begin]);
+            for (int bx = 0; bx < leaves.cells.x(); ++bx) {
+                leaves.state[begin + bx] = brick_state(brick_masks[begin + bx]);
+            }
+        }
+    });
+
+    // States of the node levels, bottom-up
+    for (int l = 1; l <= depth; ++l) {
+        const LevelStates& below = levels[l - 1];
+        LevelStates& level = levels[l];
+        level.cells = (below.cells + Eigen::Vector3i::Ones()) / 2;
+        level.state.resize(level.cells.prod());
+        tbb::parallel_for(tbb::blocked_range<int>(0, level.cells.z()), [&](const tbb::blocked_range<int>& r) {
+            for (int z = r.begin(); z != r.end(); ++z) {
+                for (int y = 0; y < level.cells.y(); ++y) {
+                    for (int x = 0; x < level.cells.x(); ++x) {
+                        const Eigen::Vector3i c(x, y, z);
+                        int full = 0, empty = 0;
+                        for (int i = 0; i < 8; ++i) {
+                            const uint8_t s = below.at(2 * c + child_offset(i));
+                            full += s == FULL;
+                            empty += s == EMPTY;
+                        }
+                        level.state[level.index(c)] = empty == 8 ? EMPTY : (full == 8 ? FULL : MIXED);
+                    }
+                }
+            }
+        });
     }
 
-    size_t half_size = size / 2;
-    bool all_same = true;
-    bool first_value = grid.get_voxel(x, y, z);
+    // Lay out the stored nodes top-down, one level after the other
+    std::vector<SVONode> nodes(1);
+    std::vector<uint64_t> bricks;
+    std::vector<Eigen::Vector3i> current(1, Eigen::Vector3i::Zero());
+    std::vector<Eigen::Vector3i> next;
+    for (int l = depth; l >= 1; --l) {
+        const LevelStates& below = levels[l - 1];
+        const size_t level_begin = nodes.size() - current.size();
 
-    // Check if all voxels in this region have the same value
-    for (size_t i = 0; i < size; ++i) {
-        for (size_t j = 0; j < size; ++j) {
-            for (size_t k = 0; k < size; ++k) {
-                if (grid.get_voxel(x + i, y + j, z + k) != first_value) {
-                    all_same = false;
-                    break;
+        // Masks of the level and the number of stored children of each node
+        std::vector<uint32_t> offsets(current.size() + 1, 0);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, current.size()), [&](const tbb::blocked_range<size_t>& r) {
+            for (size_t k = r.begin(); k != r.end(); ++k) {
+                SVONode& node = nodes[level_begin + k];
+                for (int i = 0; i < 8; ++i) {
+                    const uint8_t s = below.at(2 * current[k] + child_offset(i));
+                    if (s == EMPTY) continue;
+                    node.child_mask |= 1u << i;
+                    if (s == FULL) node.full_mask |= 1u << i;
                 }
+                offsets[k + 1] = __builtin_popcount(node.child_mask & ~node.full_mask);
             }
-            if (!all_same) break;
+        });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        // Place the stored children
+        const size_t child_begin = l == 1 ? 0 : nodes.size();
+        if (l == 1) {
+            bricks.resize(offsets.back());
+        } else {
+            nodes.resize(nodes.size() + offsets.back());
+            next.resize(offsets.back());
         }
-        if (!all_same) break;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, current.size()), [&](const tbb::blocked_range<size_t>& r) {
+            for (size_t k = r.begin(); k != r.end(); ++k) {
+                SVONode& node = nodes[level_begin + k];
+                node.first_child = static_cast<uint32_t>(child_begin + offsets[k]);
+                uint32_t j = offsets[k];
+                for (int i = 0; i < 8; ++i) {
+                    if (!(node.child_mask & ~node.full_mask & (1u << i))) continue;
+                    const Eigen::Vector3i c = 2 * current[k] + child_offset(i);
+                    if (l == 1) {
+                        bricks[j++] = brick_masks[below.index(c)];
+                    } else {
+                        next[j++] = c;
+                    }
+                }
+            }
+        });
+        current.swap(next);
     }
 
-    if (all_same) {
-        // All voxels are the same, create leaf node
-        node->is_leaf = true;
-        node->value = first_value;
-        return;
+    resolution_ = grid.resolution();
+    min_bounds_ = grid.min_bounds();
+    max_bounds_ = grid.max_bounds();
+    dimensions_ = dims;
+    root_size_ = root_size;
+    depth_ = depth;
+    root_ = 0;
+    nodes_.assign(nodes);
+    bricks_.assign(bricks);
+    compact_ = true;
+    compact_size_ = nodes_.size() + bricks_.size();
+    return true;
+}
+
+bool SVOStorage::get(const Eigen::Vector3i& position) const {
+    if ((position.array() < 0).any() || (position.array() >= dimensions_.array()).any()) {
+        throw std::out_of_range("Position outside SVO grid");
+    }
+
+    uint32_t index = root_;
+    int half = root_size_ / 2;
+    for (int level = depth_;; --level) {
+        const SVONode& node = nodes_[index];
+        const int child = ((position.x() & half) ? 1 : 0) |
+                          ((position.y() & half) ? 2 : 0) |
+                          ((position.z() & half) ? 4 : 0);
+        if (!(node.child_mask & (1u << child))) return false;
+        if (node.full_mask & (1u << child)) return true;
+        index = node.first_child + node.child_offset(child);
+        if (level == 1) {
+            const int bit = (position.x() & 3) + 4 * (position.y() & 3) + 16 * (position.z() & 3);
+            return (bricks_[index] >> bit) & 1;
+        }
+        half >>= 1;
+    }
+}
+
+bool SVOStorage::any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+    if (nodes_.empty()) {
+        return false;
+    }
+    const Eigen::Vector3i lo = min.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = max.cwiseMin(dimensions_ - Eigen::Vector3i::Ones());
+    if ((lo.array() > hi.array()).any()) {
+        return false;
     }
 
-    // Create children nodes
-    for (size_t i = 0; i < 8; ++i) {
-        size_t child_x = x + ((i & 1) ? half_size : 0);
-        size_t child_y = y + ((i & 2) ? half_size : 0);
-        size_t child_z = z + ((i & 4) ? half_size : 0);
+    auto enter = [&](const Eigen::Vector3i& origin, int size) {
+        return (origin.array() <= hi.array()).all() && (origin.array() + size > lo.array()).all();
+    };
+    auto on_full = [](const Eigen::Vector3i&, int) { return false; };
+    auto on_brick = [&](const Eigen::Vector3i& origin, uint64_t mask) {
+        return (mask & brick_box_mask(lo - origin, hi - origin)) == 0;
+    };
+    return !visit_node(root_, Eigen::Vector3i::Zero(), root_size_, enter, on_full, on_brick);
+}
 
-        node->children[i] = std::make_unique<SVONode>();
-        build_node(node->children[i].get(), grid,
-                  child_x, child_y, child_z,
-                  half_size, depth + 1);
+bool SVOStorage::raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                         float max_distance, Eigen::Vector3i& hit) const {
+    if (nodes_.empty() || direction.squaredNorm() == 0.0f) {
+        return false;
     }
+    const Eigen::Vector3f end = origin + direction.normalized() * max_distance;
+    LineTraversal line(Eigen::Vector3f((origin - min_bounds_) / resolution_),
+                       Eigen::Vector3f((end - min_bounds_) / resolution_), LineAlgorithm::RLV);
+    return !line.for_each_voxel(dimensions_, [&](const Eigen::Vector3i& v) {
+        if (get(v)) {
+            hit = v;
+            return false;
+        }
+        return true;
+    });
 }
 
-void SVOStorage::save_node(const SVONode* node, std::ofstream& ofs) const {
-    // Save node type and value
-    ofs.write(reinterpret_cast<const char*>(&node->is_leaf), sizeof(node->is_leaf));
-    ofs.write(reinterpret_cast<const char*>(&node->value), sizeof(node->value));
+void SVOStorage::set(const Eigen::Vector3i& position, bool value) {
+    SVOEditBatch batch;
+    batch.set(position, value);
+    apply(batch);
+}
 
-    if (!node->is_leaf) {
-        // Save children
-        for (const auto& child : node->children) {
-            if (child) {
-                save_node(child.get(), ofs);
-            }
+void SVOStorage::set_region(const Eigen::Vector3i& min, const Eigen::Vector3i& max, bool value) {
+    SVOEditBatch batch;
+    batch.set_region(min, max, value);
+    apply(batch);
+}
+
+void SVOStorage::apply(const SVOEditBatch& batch) {
+    auto inside = [&](const Eigen::Vector3i& p) {
+        return (p.array() >= 0).all() && (p.array() < dimensions_.array()).all();
+    };
+    std::vector<uint32_t> ids;
+    for (size_t i = 0; i < batch.edits().size(); ++i) {
+        const SVOEditBatch::Edit& edit = batch.edits()[i];
+        if (!inside(edit.min) || !inside(edit.max)) {
+            throw std::out_of_range("Edit outside SVO grid");
+        }
+        if ((edit.min.array() <= edit.max.array()).all()) {
+            ids.push_back(static_cast<uint32_t>(i));
         }
     }
+    if (ids.empty()) {
+        return;
+    }
+
+    EditCell root;
+    root.state = MIXED;
+    root.node = nodes_[root_];
+    root.brick = 0;
+    const EditCell result = apply_edits(root, Eigen::Vector3i::Zero(), root_size_, batch.edits(), ids);
+    if (result.state == MIXED && result.node == root.node) {
+        return;
+    }
+
+    // The root is always a node, even when uniform
+    SVONode node = result.node;
+    if (result.state != MIXED) {
+        node = SVONode();
+        node.child_mask = node.full_mask = result.state == FULL ? 0xFF : 0;
+    }
+    root_ = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(node);
+    compact_ = false;
+    if (nodes_.size() + bricks_.size() > 2 * compact_size_ + BlockArray<SVONode>::kBlockSize) {
+        compact();
+    }
 }
 
-void SVOStorage::load_node(SVONode* node, std::ifstream& ifs) {
-    // Load node type and value
-    ifs.read(reinterpret_cast<char*>(&node->is_leaf), sizeof(node->is_leaf));
-    ifs.read(reinterpret_cast<char*>(&node->value), sizeof(node->value));
+SVOStorage::EditCell SVOStorage::child_cell(const EditCell& cell, int child, int half) const {
+    EditCell result;
+    result.state = cell.state;
+    result.brick = 0;
+    if (cell.state != MIXED) {
+        return result;
+    }
+    const SVONode& node = cell.node;
+    if (!(node.child_mask & (1u << child))) {
+        result.state = EMPTY;
+    } else if (node.full_mask & (1u << child)) {
+        result.state = FULL;
+    } else if (half == kBrickSize) {
+        result.brick = bricks_[node.first_child + node.child_offset(child)];
+    } else {
+        result.node = nodes_[node.first_child + node.child_offset(child)];
+    }
+    return result;
+}
+
+// Returns the new state of a cube; the cell itself if nothing changed. The
+// stored children of a changed node are appended as one new sibling group.
+SVOStorage::EditCell SVOStorage::apply_edits(const EditCell& cell, const Eigen::Vector3i& origin, int size,
+                                             const std::vector<SVOEditBatch::Edit>& edits,
+                                             const std::vector<uint32_t>& ids) {
+    // Edits before the last one covering the cube no longer matter. Padding
+    // is always empty, so clearing only needs to cover the part in the grid.
+    const Eigen::Vector3i end = origin + Eigen::Vector3i::Constant(size - 1);
+    const Eigen::Vector3i clipped_end = end.cwiseMin(dimensions_ - Eigen::Vector3i::Ones());
+    EditCell base = cell;
+    size_t first = 0;
+    for (size_t k = ids.size(); k-- > 0;) {
+        const SVOEditBatch::Edit& edit = edits[ids[k]];
+        const Eigen::Vector3i& covered_end = edit.value ? end : clipped_end;
+        if ((edit.min.array() <= origin.array()).all() && (edit.max.array() >= covered_end.array()).all()) {
+            base.state = edit.value ? FULL : EMPTY;
+            first = k + 1;
+            break;
+        }
+    }
+    if (first == ids.size()) {
+        return base.state == cell.state && cell.state != MIXED ? cell : base;
+    }
+
+    if (size == kBrickSize) {
+        uint64_t mask = base.state == FULL ? ~uint64_t(0) : (base.state == EMPTY ? 0 : base.brick);
+        for (size_t k = first; k < ids.size(); ++k) {
+            const SVOEditBatch::Edit& edit = edits[ids[k]];
+            const uint64_t bits = brick_box_mask(edit.min - origin, edit.max - origin);
+            mask = edit.value ? mask | bits : mask & ~bits;
+        }
+        EditCell result;
+        result.state = brick_state(mask);
+        result.brick = result.state == MIXED ? mask : 0;
+        if (result.state == cell.state && (result.state != MIXED || mask == cell.brick)) {
+            return cell;
+        }
+        return result;
+    }
 
-    if (!node->is_leaf) {
-        // Load children
-        for (auto& child : node->children) {
-            child = std::make_unique<SVONode>();
-            load_node(child.get(), ifs);
+    // Edit the children that the remaining edits touch
+    const int half = size / 2;
+    EditCell children[8];
+    bool changed = base.state != cell.state;
+    std::vector<uint32_t> child_ids;
+    for (int i = 0; i < 8; ++i) {
+        children[i] = child_cell(base, i, half);
+        const Eigen::Vector3i child_origin = origin + half * child_offset(i);
+        const Eigen::Vector3i child_end = child_origin + Eigen::Vector3i::Constant(half - 1);
+        child_ids.clear();
+        for (size_t k = first; k < ids.size(); ++k) {
+            const SVOEditBatch::Edit& edit = edits[ids[k]];
+            if ((edit.min.array() <= child_end.array()).all() && (edit.max.array() >= child_origin.array()).all()) {
+                child_ids.push_back(ids[k]);
+            }
+        }
+        if (child_ids.empty()) continue;
+        const EditCell edited = apply_edits(children[i], child_origin, half, edits, child_ids);
+        const bool same = edited.state == children[i].state &&
+                          (edited.state != MIXED || (half == kBrickSize ? edited.brick == children[i].brick
+                                                                        : edited.node == children[i].node));
+        if (!same) {
+            children[i] = edited;
+            changed = true;
         }
     }
+    if (!changed) {
+        return cell;
+    }
+
+    // Collapse uniform nodes, otherwise place the stored children together
+    EditCell result;
+    result.brick = 0;
+    result.node = SVONode();
+    for (int i = 0; i < 8; ++i) {
+        if (children[i].state == EMPTY) continue;
+        result.node.child_mask |= 1u << i;
+        if (children[i].state == FULL) result.node.full_mask |= 1u << i;
+    }
+    if (result.node.child_mask == 0) {
+        result.state = EMPTY;
+        return result;
+    }
+    if (result.node.full_mask == 0xFF) {
+        result.state = FULL;
+        return result;
+    }
+    result.state = MIXED;
+    result.node.first_child = static_cast<uint32_t>(half == kBrickSize ? bricks_.size() : nodes_.size());
+    for (int i = 0; i < 8; ++i) {
+        if (children[i].state != MIXED) continue;
+        if (half == kBrickSize) {
+            bricks_.push_back(children[i].brick);
+        } else {
+            nodes_.push_back(children[i].node);
+        }
+    }
+    return result;
 }
 
-void SVOStorage::node_to_grid(const SVONode* node, VXZ::VoxelGrid& grid,
-                            size_t x, size_t y, size_t z,
-                            size_t size) const {
-    if (node->is_leaf) {
-        // Fill region with leaf value
-        for (size_t i = 0; i < size; ++i) {
-            for (size_t j = 0; j < size; ++j) {
-                for (size_t k = 0; k < size; ++k) {
-                    grid.set(Eigen::Vector3i(x + i, y + j, z + k), node->value);
+void SVOStorage::compact() {
+    if (nodes_.empty()) {
+        return;
+    }
+
+    // Copy the reachable nodes level by level from the root
+    std::vector<SVONode> nodes(1, nodes_[root_]);
+    std::vector<uint64_t> bricks;
+    size_t level_begin = 0;
+    for (int l = depth_; l >= 1; --l) {
+        const size_t level_end = nodes.size();
+        for (size_t k = level_begin; k < level_end; ++k) {
+            const SVONode node = nodes[k];
+            const uint32_t stored = static_cast<uint32_t>(__builtin_popcount(node.child_mask & ~node.full_mask));
+            nodes[k].first_child = static_cast<uint32_t>(l == 1 ? bricks.size() : nodes.size());
+            for (uint32_t j = 0; j < stored; ++j) {
+                if (l == 1) {
+                    bricks.push_back(bricks_[node.first_child + j]);
+                } else {
+                    nodes.push_back(nodes_[node.first_child + j]);
                 }
             }
         }
-    } else {
-        // Process children
-        size_t half_size = size / 2;
-        for (size_t i = 0; i < 8; ++i) {
-            if (node->children[i]) {
-                size_t child_x = x + ((i & 1) ? half_size : 0);
-                size_t child_y = y + ((i & 2) ? half_size : 0);
-                size_t child_z = z + ((i & 4) ? half_size : 0);
-
-                node_to_grid(node->children[i].get(), grid,
-                           child_x, child_y, child_z,
-                           half_size);
+        level_begin = level_end;
+    }
+
+    root_ = 0;
+    nodes_.assign(nodes);
+    bricks_.assign(bricks);
+    compact_ = true;
+    compact_size_ = nodes_.size() + bricks_.size();
+}
+
+bool SVOStorage::valid_tree(const SVONode* nodes, size_t node_count, uint64_t leaf_count, int depth) {
+    if (node_count == 0) {
+        return false;
+    }
+    // Every node may be reached once only, which also rules out cycles
+    std::vector<uint8_t> seen(node_count, 0);
+    std::vector<uint32_t> level{0};
+    seen[0] = 1;
+    for (int l = depth; l >= 1 && !level.empty(); --l) {
+        std::vector<uint32_t> next;
+        for (uint32_t index : level) {
+            const SVONode& node = nodes[index];
+            if (node.full_mask & ~node.child_mask) return false;
+            const uint64_t end = static_cast<uint64_t>(node.first_child) +
+                                 static_cast<uint64_t>(__builtin_popcount(node.child_mask & ~node.full_mask));
+            if (l == 1) {
+                if (end > leaf_count) return false;
+                continue;
             }
+            if (end > node_count) return false;
+            for (uint64_t c = node.first_child; c < end; ++c) {
+                if (seen[c]) return false;
+                seen[c] = 1;
+                next.push_back(static_cast<uint32_t>(c));
+            }
+        }
+        level.swap(next);
+    }
+    return true;
+}
+
+uint64_t SVOStorage::brick_box_mask(const Eigen::Vector3i& min, const Eigen::Vector3i& max) {
+    const Eigen::Vector3i lo = min.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = max.cwiseMin(Eigen::Vector3i::Constant(kBrickSize - 1));
+    if ((lo.array() > hi.array()).any()) {
+        return 0;
+    }
+    const uint64_t row = ((2u << hi.x()) - 1) & ~((1u << lo.x()) - 1);
+    uint64_t mask = 0;
+    for (int z = lo.z(); z <= hi.z(); ++z) {
+        for (int y = lo.y(); y <= hi.y(); ++y) {
+            mask |= row << (4 * y + 16 * z);
         }
     }
+    return mask;
 }
 
-size_t SVOStorage::calculate_node_size(const SVONode* node) const {
-    size_t size = sizeof(SVONode);
-    
-    if (!node->is_leaf) {
-        for (const auto& child : node->children) {
-            if (child) {
-                size += calculate_node_size(child.get());
+void SVOStorage::write_brick(VXZ::VoxelGrid& grid, const Eigen::Vector3i& origin, uint64_t mask) {
+    const Eigen::Vector3i& dims = grid.dimensions();
+    const int x = origin.x();
+    const uint64_t x_mask = x + kBrickSize > dims.x() ? (1u << (dims.x() - x)) - 1 : 0xF;
+    for (int dz = 0; dz < kBrickSize && origin.z() + dz < dims.z(); ++dz) {
+        for (int dy = 0; dy < kBrickSize && origin.y() + dy < dims.y(); ++dy) {
+            const uint64_t bits = (mask >> (4 * dy + 16 * dz)) & x_mask;
+            if (bits) {
+                grid.row_data(origin.y() + dy, origin.z() + dz)[x / VoxelGrid::kWordBits] |=
+                    bits << (x % VoxelGrid::kWordBits);
             }
         }
     }
-    
-    return size;
 }
 
-} // namespace VXZ 
\ No newline at end of file
+} // namespace VXZ
@@ -0,0 +1,387 @@
+#include "storage/svo_raycaster.hpp"
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace VXZ {
+
+constexpr int SVORaycaster::kMaxPacketSize;
+
+namespace {
+
+// Inverse used for direction components that are (almost) zero
+const float kMaxInverse = 1e30f;
+
+// Ray mirrored into the positive octant, in grid coordinates of the padded
+// octree cube; the parameter t is the world distance along the ray
+struct RaySetup {
+    Eigen::Vector3f origin;
+    Eigen::Vector3f direction;
+    Eigen::Vector3f inverse;
+    int octant;
+    float max_t;
+};
+
+bool setup_ray(const SVOStorage& svo, const SVORay& ray, RaySetup& setup) {
+    if (svo.nodes().empty() || ray.direction.squaredNorm() == 0.0f) {
+        return false;
+    }
+    const float root = static_cast<float>(svo.root_size());
+    setup.origin = (ray.origin - svo.min_bounds()) / svo.resolution();
+    setup.direction = ray.direction.normalized() / svo.resolution();
+    setup.octant = 0;
+    for (int a = 0; a < 3; ++a) {
+        if (setup.direction[a] < 0.0f) {
+            setup.octant |= 1 << a;
+            setup.origin[a] = root - setup.origin[a];
+            setup.direction[a] = -setup.direction[a];
+        }
+        setup.inverse[a] = setup.direction[a] > 1.0f / kMaxInverse ? 1.0f / setup.direction[a] : kMaxInverse;
+    }
+    setup.max_t = ray.max_distance;
+    return true;
+}
+
+SVORayHit miss() {
+    SVORayHit hit;
+    hit.hit = false;
+    hit.distance = 0.0f;
+    hit.voxel = Eigen::Vector3i::Zero();
+    return hit;
+}
+
+Eigen::Vector3i octant_offset(int c) {
+    return Eigen::Vector3i(c & 1, (c >> 1) & 1, (c >> 2) & 1);
+}
+
+// Brick bits of the eight 2^3 octants of a brick
+struct BrickOctants {
+    uint64_t masks[8];
+    BrickOctants() {
+        for (int r = 0; r < 8; ++r) {
+            const Eigen::Vector3i lo = 2 * octant_offset(r);
+            masks[r] = SVOStorage::brick_box_mask(lo, lo + Eigen::Vector3i::Ones());
+        }
+    }
+};
+
+const BrickOctants kBrickOctants;
+
+// Brick bit of a voxel given in mirrored brick-local coordinates; flip holds
+// 3 in the fields of mirrored axes, since 3 - l == l ^ 3
+int brick_bit(const Eigen::Vector3i& local, int flip) {
+    return (local.x() | local.y() << 2 | local.z() << 4) ^ flip;
+}
+
+int brick_flip(int octant) {
+    return (octant & 1 ? 3 : 0) | (octant & 2 ? 3 << 2 : 0) | (octant & 4 ? 3 << 4 : 0);
+}
+
+// Voxel where a ray enters a full cube, back in unmirrored grid coordinates
+Eigen::Vector3i entry_voxel(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, float t,
+                            const Eigen::Vector3i& min, int size, int octant, int root) {
+    const Eigen::Vector3f p = origin + t * direction;
+    Eigen::Vector3i voxel;
+    for (int a = 0; a < 3; ++a) {
+        const int v = std::min(std::max(static_cast<int>(std::floor(p[a])), min[a]), min[a] + size - 1);
+        voxel[a] = octant & (1 << a) ? root - 1 - v : v;
+    }
+    return voxel;
+}
+
+// First child crossed, from the plane through which the ray enters the node
+int first_child(const Eigen::Vector3f& t0, const Eigen::Vector3f& tm) {
+    int c = 0;
+    if (t0.x() >= t0.y() && t0.x() >= t0.z()) {
+        if (tm.y() < t0.x()) c |= 2;
+        if (tm.z() < t0.x()) c |= 4;
+    } else if (t0.y() >= t0.z()) {
+        if (tm.x() < t0.y()) c |= 1;
+        if (tm.z() < t0.y()) c |= 4;
+    } else {
+        if (tm.x() < t0.z()) c |= 1;
+        if (tm.y() < t0.z()) c |= 2;
+    }
+    return c;
+}
+
+// Child crossed after c, through its nearest exit plane; 8 leaves the node
+int next_child(int c, const Eigen::Vector3f& t1) {
+    const int axis = t1.x() < t1.y() ? (t1.x() < t1.z() ? 0 : 2) : (t1.y() < t1.z() ? 1 : 2);
+    return (c >> axis) & 1 ? 8 : c | (1 << axis);
+}
+
+// Revelles traversal of one ray in the mirrored octree
+class RayTraversal {
+public:
+    RayTraversal(const SVOStorage& svo, const RaySetup& ray)
+        : svo_(svo), ray_(ray), flip_(brick_flip(ray.octant)), hit_(miss()) {}
+
+    SVORayHit run() {
+        const float root = static_cast<float>(svo_.root_size());
+        const Eigen::Vector3f t0 = (-ray_.origin).cwiseProduct(ray_.inverse);
+        const Eigen::Vector3f t1 = (Eigen::Vector3f::Constant(root) - ray_.origin).cwiseProduct(ray_.inverse);
+        if (t0.maxCoeff() <= t1.minCoeff() && t1.minCoeff() >= 0.0f && t0.maxCoeff() <= ray_.max_t) {
+            node(svo_.root(), Eigen::Vector3i::Zero(), svo_.root_size(), t0, t1);
+        }
+        return hit_;
+    }
+
+private:
+    const SVOStorage& svo_;
+    const RaySetup& ray_;
+    const int flip_;
+    SVORayHit hit_;
+
+    // Parameters of child c from those of its parent
+    static void child_range(int c, const Eigen::Vector3f& t0, const Eigen::Vector3f& tm, const Eigen::Vector3f& t1,
+                            Eigen::Vector3f& c0, Eigen::Vector3f& c1) {
+        for (int a = 0; a < 3; ++a) {
+            const bool upper = (c >> a) & 1;
+            c0[a] = upper ? tm[a] : t0[a];
+            c1[a] = upper ? t1[a] : tm[a];
+        }
+    }
+
+    Eigen::Vector3f mid(const Eigen::Vector3i& min, int half) const {
+        return (min.cast<float>() + Eigen::Vector3f::Constant(static_cast<float>(half)) - ray_.origin)
+            .cwiseProduct(ray_.inverse);
+    }
+
+    void record(const Eigen::Vector3i& min, int size, float entry) {
+        const float t = std::max(entry, 0.0f);
+        hit_.hit = true;
+        hit_.distance = t;
+        hit_.voxel = entry_voxel(ray_.origin, ray_.direction, t, min, size, ray_.octant, svo_.root_size());
+    }
+
+    bool node(uint32_t index, const Eigen::Vector3i& min, int size,
+              const Eigen::Vector3f& t0, const Eigen::Vector3f& t1) {
+        const SVONode& n = svo_.nodes()[index];
+        const int half = size / 2;
+        const Eigen::Vector3f tm = mid(min, half);
+        Eigen::Vector3f c0, c1;
+        for (int c = first_child(t0, tm); c < 8; c = next_child(c, c1)) {
+            child_range(c, t0, tm, t1, c0, c1);
+            const int r = c ^ ray_.octant;
+            if (!(n.child_mask & (1u << r))) continue;
+            const float entry = c0.maxCoeff();
+            if (entry > ray_.max_t) return false;
+            if (c1.minCoeff() < 0.0f) continue;
+
+            const Eigen::Vector3i child_min = min + half * octant_offset(c);
+            if (n.full_mask & (1u << r)) {
+                record(child_min, half, entry);
+                return true;
+            }
+            const uint32_t child = n.first_child + n.child_offset(r);
+            if (half == SVOStorage::kBrickSize) {
+                if (brick(svo_.bricks()[child], child_min, Eigen::Vector3i::Zero(), half, c0, c1)) return true;
+            } else if (node(child, child_min, half, c0, c1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Octree levels inside a brick; local is the mirrored brick-local corner
+    bool brick(uint64_t mask, const Eigen::Vector3i& min, const Eigen::Vector3i& local, int size,
+               const Eigen::Vector3f& t0, const Eigen::Vector3f& t1) {
+        const int half = size / 2;
+        const Eigen::Vector3f tm = mid(min, half);
+        Eigen::Vector3f c0, c1;
+        for (int c = first_child(t0, tm); c < 8; c = next_child(c, c1)) {
+            child_range(c, t0, tm, t1, c0, c1);
+            const Eigen::Vector3i child_local = local + half * octant_offset(c);
+            const uint64_t bits = half == 1 ? uint64_t(1) << brick_bit(child_local, flip_)
+                                            : kBrickOctants.masks[c ^ ray_.octant];
+            if (!(mask & bits)) continue;
+            const float entry = c0.maxCoeff();
+            if (entry > ray_.max_t) return false;
+            if (c1.minCoeff() < 0.0f) continue;
+
+            const Eigen::Vector3i child_min = min + half * octant_offset(c);
+            if ((mask & bits) == bits) {
+                record(child_min, half, entry);
+                return true;
+            }
+            if (brick(mask, child_min, child_local, half, c0, c1)) return true;
+        }
+        return false;
+    }
+};
+
+// Lockstep traversal of rays that share a direction octant
+template <int Width>
+class PacketTraversal {
+public:
+    typedef Eigen::Array<float, Width, 1> Lanes;
+    typedef Eigen::Array<bool, Width, 1> LaneMask;
+
+    PacketTraversal(const SVOStorage& svo, const RaySetup* rays, const int* lanes, int count,
+                    int octant, SVORayHit* hits)
+        : svo_(svo), rays_(rays), lanes_(lanes), count_(count), octant_(octant),
+          flip_(brick_flip(octant)), hits_(hits) {
+        for (int i = 0; i < Width; ++i) {
+            const RaySetup& ray = rays_[lanes_[std::min(i, count_ - 1)]];
+            for (int a = 0; a < 3; ++a) {
+                origin_[a][i] = ray.origin[a];
+                inverse_[a][i] = ray.inverse[a];
+            }
+            // Padding lanes start finished
+            max_t_[i] = i < count_ ? ray.max_t : -1.0f;
+        }
+    }
+
+    void run() {
+        Lanes entry;
+        const LaneMask active = overlap(Eigen::Vector3i::Zero(), svo_.root_size(), entry);
+        max_t_ = active.select(max_t_, Lanes::Constant(-1.0f));
+        if (!done()) {
+            node(svo_.root(), Eigen::Vector3i::Zero(), svo_.root_size());
+        }
+    }
+
+private:
+    const SVOStorage& svo_;
+    const RaySetup* rays_;
+    const int* lanes_;
+    const int count_;
+    const int octant_;
+    const int flip_;
+    SVORayHit* hits_;
+    Lanes origin_[3];
+    Lanes inverse_[3];
+    // Negative once a lane has hit
+    Lanes max_t_;
+
+    bool done() const { return (max_t_ < 0.0f).all(); }
+
+    // Lanes whose remaining ray crosses the cube [min, min + size)
+    LaneMask overlap(const Eigen::Vector3i& min, int size, Lanes& entry) const {
+        Lanes t0[3], t1[3];
+        for (int a = 0; a < 3; ++a) {
+            t0[a] = (static_cast<float>(min[a]) - origin_[a]) * inverse_[a];
+            t1[a] = t0[a] + static_cast<float>(size) * inverse_[a];
+        }
+        entry = t0[0].max(t0[1]).max(t0[2]);
+        const Lanes exit = t1[0].min(t1[1]).min(t1[2]);
+        return (entry <= exit) && (exit >= 0.0f) && (entry <= max_t_);
+    }
+
+    void record(const LaneMask& active, const Lanes& entry, const Eigen::Vector3i& min, int size) {
+        for (int i = 0; i < count_; ++i) {
+            if (!active[i]) continue;
+            const RaySetup& ray = rays_[lanes_[i]];
+            const float t = std::max(entry[i], 0.0f);
+            SVORayHit& hit = hits_[lanes_[i]];
+            hit.hit = true;
+            hit.distance = t;
+            hit.voxel = entry_voxel(ray.origin, ray.direction, t, min, size, octant_, svo_.root_size());
+            max_t_[i] = -1.0f;
+        }
+    }
+
+    void node(uint32_t index, const Eigen::Vector3i& min, int size) {
+        const SVONode& n = svo_.nodes()[index];
+        const int half = size / 2;
+        Lanes entry;
+        for (int c = 0; c < 8; ++c) {
+            const int r = c ^ octant_;
+            if (!(n.child_mask & (1u << r))) continue;
+            const Eigen::Vector3i child_min = min + half * octant_offset(c);
+            const LaneMask active = overlap(child_min, half, entry);
+            if (!active.any()) continue;
+
+            if (n.full_mask & (1u << r)) {
+                record(active, entry, child_min, half);
+            } else {
+                const uint32_t child = n.first_child + n.child_offset(r);
+                if (half == SVOStorage::kBrickSize) {
+                    brick(svo_.bricks()[child], child_min, Eigen::Vector3i::Zero(), half);
+                } else {
+                    node(child, child_min, half);
+                }
+            }
+            if (done()) return;
+        }
+    }
+
+    void brick(uint64_t mask, const Eigen::Vector3i& min, const Eigen::Vector3i& local, int size) {
+        const int half = size / 2;
+        Lanes entry;
+        for (int c = 0; c < 8; ++c) {
+            const Eigen::Vector3i child_local = local + half * octant_offset(c);
+            const uint64_t bits = half == 1 ? uint64_t(1) << brick_bit(child_local, flip_)
+                                            : kBrickOctants.masks[c ^ octant_];
+            if (!(mask & bits)) continue;
+            const Eigen::Vector3i child_min = min + half * octant_offset(c);
+            const LaneMask active = overlap(child_min, half, entry);
+            if (!active.any()) continue;
+
+            if ((mask & bits) == bits) {
+                record(active, entry, child_min, half);
+            } else {
+                brick(mask, child_min, child_local, half);
+            }
+            if (done()) return;
+        }
+    }
+};
+
+} // namespace
+
+SVORaycaster::SVORaycaster(const SVOStorage& svo) : svo_(svo) {
+}
+
+SVORayHit SVORaycaster::cast(const SVORay& ray) const {
+    RaySetup setup;
+    if (!setup_ray(svo_, ray, setup)) {
+        return miss();
+    }
+    return RayTraversal(svo_, setup).run();
+}
+
+void SVORaycaster::cast_packet(const SVORay* rays, int count, SVORayHit* hits) const {
+    if (count > kMaxPacketSize) {
+        throw std::invalid_argument("Ray packet larger than kMaxPacketSize");
+    }
+
+    // Group the rays by direction octant
+    RaySetup setups[kMaxPacketSize];
+    int lanes[8][kMaxPacketSize];
+    int lane_count[8] = {0};
+    for (int i = 0; i < count; ++i) {
+        hits[i] = miss();
+        if (setup_ray(svo_, rays[i], setups[i])) {
+            const int octant = setups[i].octant;
+            lanes[octant][lane_count[octant]++] = i;
+        }
+    }
+
+    for (int octant = 0; octant < 8; ++octant) {
+        const int n = lane_count[octant];
+        if (n == 0) continue;
+        if (n <= 8) {
+            PacketTraversal<8>(svo_, setups, lanes[octant], n, octant, hits).run();
+        } else {
+            PacketTraversal<16>(svo_, setups, lanes[octant], n, octant, hits).run();
+        }
+    }
+}
+
+void SVORaycaster::cast_batch(const std::vector<SVORay>& rays, std::vector<SVORayHit>& hits) const {
+    hits.resize(rays.size());
+    const size_t packets = (rays.size() + kMaxPacketSize - 1) / kMaxPacketSize;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, packets, 16), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t p = r.begin(); p != r.end(); ++p) {
+            const size_t begin = p * kMaxPacketSize;
+            const int count = static_cast<int>(std::min<size_t>(kMaxPacketSize, rays.size() - begin));
+            cast_packet(&rays[begin], count, &hits[begin]);
+        }
+    });
+}
+
+} // namespace VXZ
@@ -0,0 +1,696 @@
+#include "storage/vdb_tree_storage.hpp"
+#include "voxelizer/line_traversal.hpp"
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+namespace VXZ {
+
+constexpr int VDBTreeView::kLeafDim;
+constexpr int VDBTreeView::kLowerDim;
+constexpr int VDBTreeView::kUpperDim;
+
+static_assert(sizeof(VDBHeader) % 8 == 0, "VDB sections must stay 8-byte aligned");
+static_assert(sizeof(VDBRootEntry) % 8 == 0, "VDB sections must stay 8-byte aligned");
+static_assert(sizeof(VDBUpperNode) % 8 == 0, "VDB sections must stay 8-byte aligned");
+static_assert(sizeof(VDBLowerNode) % 8 == 0, "VDB sections must stay 8-byte aligned");
+
+namespace {
+
+const char kMagic[4] = {'V', 'X', 'N', 'V'};
+const uint32_t kVersion = 1;
+
+enum BlockState {
+    EMPTY,
+    FULL,
+    MIXED
+};
+
+// Lower node built by one task, with its leaves in slot order
+struct LowerBlock {
+    VDBLowerNode node;
+    std::vector<VDBLeaf> leaves;
+    BlockState state;
+};
+
+template <typename Node>
+void clear_node(Node& node, const Eigen::Vector3i& origin) {
+    std::memset(&node, 0, sizeof(Node));
+    node.origin[0] = origin.x();
+    node.origin[1] = origin.y();
+    node.origin[2] = origin.z();
+}
+
+template <typename Node>
+void compute_prefix(Node& node) {
+    uint32_t count = 0;
+    for (int w = 0; w < Node::kWords; ++w) {
+        node.prefix[w] = count;
+        count += static_cast<uint32_t>(__builtin_popcountll(node.child_mask[w]));
+    }
+}
+
+// Masks, prefix table and child range of one internal node
+template <typename Node>
+bool valid_node(const Node& node, uint64_t child_count) {
+    uint64_t count = 0;
+    for (int w = 0; w < Node::kWords; ++w) {
+        if ((node.child_mask[w] & node.tile_mask[w]) != 0 || node.prefix[w] != count) {
+            return false;
+        }
+        count += static_cast<uint64_t>(__builtin_popcountll(node.child_mask[w]));
+    }
+    return node.first_child + count <= child_count;
+}
+
+size_t flat_size(const VDBHeader& header) {
+    return sizeof(VDBHeader) + header.root_count * sizeof(VDBRootEntry) +
+           header.upper_count * sizeof(VDBUpperNode) + header.lower_count * sizeof(VDBLowerNode) +
+           header.leaf_count * sizeof(VDBLeaf);
+}
+
+// Leaf bits inside the leaf-local box [lo, hi], per z word
+uint64_t leaf_plane_mask(const Eigen::Vector3i& lo, const Eigen::Vector3i& hi) {
+    const uint64_t row = ((uint64_t(2) << hi.x()) - 1) & ~((uint64_t(1) << lo.x()) - 1);
+    uint64_t mask = 0;
+    for (int y = lo.y(); y <= hi.y(); ++y) {
+        mask |= row << (8 * y);
+    }
+    return mask;
+}
+
+// Build the lower node whose 128^3 block starts at origin
+void build_lower(const VoxelGrid& grid, const Eigen::Vector3i& origin, LowerBlock& block) {
+    const Eigen::Vector3i& dims = grid.dimensions();
+    const int leaf_dim = VDBTreeView::kLeafDim;
+    const int lower_dim = VDBTreeView::kLowerDim;
+    std::vector<VDBLeaf> dense(VDBLowerNode::kSlots);
+    std::memset(dense.data(), 0, dense.size() * sizeof(VDBLeaf));
+
+    // A row word holds one byte of eight neighbouring leaves
+    const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(lower_dim)).cwiseMin(dims);
+    const size_t w_begin = origin.x() / VoxelGrid::kWordBits;
+    const size_t w_end = std::min(grid.words_per_row(), (static_cast<size_t>(end.x()) + 63) / VoxelGrid::kWordBits);
+    for (int z = origin.z(); z < end.z(); ++z) {
+        for (int y = origin.y(); y < end.y(); ++y) {
+            const uint64_t* row = grid.row_data(y, z);
+            const int ly = y - origin.y(), lz = z - origin.z();
+            const int slot_yz = ((ly / leaf_dim) << 4) | ((lz / leaf_dim) << 8);
+            for (size_t w = w_begin; w < w_end; ++w) {
+                const uint64_t word = row[w];
+                if (word == 0) continue;
+                for (int k = 0; k < 8; ++k) {
+                    const uint64_t byte = (word >> (8 * k)) & 0xFF;
+                    if (byte == 0) continue;
+                    const int lx = static_cast<int>(w - w_begin) * 8 + k;
+                    dense[slot_yz | lx].words[lz % leaf_dim] |= byte << (8 * (ly % leaf_dim));
+                }
+            }
+        }
+    }
+
+    clear_node(block.node, origin);
+    int tiles = 0;
+    for (int slot = 0; slot < VDBLowerNode::kSlots; ++slot) {
+        const VDBLeaf& leaf = dense[slot];
+        bool full = true, empty = true;
+        for (int z = 0; z < leaf_dim; ++z) {
+            full = full && ~leaf.words[z] == 0;
+            empty = empty && leaf.words[z] == 0;
+        }
+        if (empty) continue;
+        if (full) {
+            block.node.tile_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+            ++tiles;
+        } else {
+            block.node.child_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+            block.leaves.push_back(leaf);
+        }
+    }
+    compute_prefix(block.node);
+    if (tiles == VDBLowerNode::kSlots) {
+        block.state = FULL;
+    } else if (tiles == 0 && block.leaves.empty()) {
+        block.state = EMPTY;
+    } else {
+        block.state = MIXED;
+    }
+}
+
+} // namespace
+
+VDBTreeView::VDBTreeView()
+    : header(nullptr), roots(nullptr), uppers(nullptr), lowers(nullptr), leaves(nullptr) {
+}
+
+bool VDBTreeView::attach(const void* data, size_t size) {
+    if (!data || size < sizeof(VDBHeader) || reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+        return false;
+    }
+    const VDBHeader* h = static_cast<const VDBHeader*>(data);
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion) {
+        return false;
+    }
+    const uint64_t limit = uint64_t(1) << 40;
+    if (h->root_count > limit || h->upper_count > limit || h->lower_count > limit ||
+        h->leaf_count > limit || size < flat_size(*h)) {
+        return false;
+    }
+
+    const char* p = static_cast<const char*>(data) + sizeof(VDBHeader);
+    header = h;
+    roots = reinterpret_cast<const VDBRootEntry*>(p);
+    p += h->root_count * sizeof(VDBRootEntry);
+    uppers = reinterpret_cast<const VDBUpperNode*>(p);
+    p += h->upper_count * sizeof(VDBUpperNode);
+    lowers = reinterpret_cast<const VDBLowerNode*>(p);
+    p += h->lower_count * sizeof(VDBLowerNode);
+    leaves = reinterpret_cast<const VDBLeaf*>(p);
+    if (!valid()) {
+        *this = VDBTreeView();
+        return false;
+    }
+    return true;
+}
+
+bool VDBTreeView::valid() const {
+    if (!header) {
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (header->dimensions[i] < 1) return false;
+    }
+    for (uint64_t r = 0; r < header->root_count; ++r) {
+        if (roots[r].upper >= header->upper_count || (r > 0 && roots[r - 1].key >= roots[r].key)) {
+            return false;
+        }
+        const VDBUpperNode& upper = uppers[roots[r].upper];
+        const Eigen::Vector3i origin(upper.origin[0], upper.origin[1], upper.origin[2]);
+        const Eigen::Vector3i block = origin / kUpperDim;
+        if ((origin.array() < 0).any() || block * kUpperDim != origin || root_key(origin) != roots[r].key) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header->upper_count; ++i) {
+        if (!valid_node(uppers[i], header->lower_count)) return false;
+    }
+    for (uint64_t i = 0; i < header->lower_count; ++i) {
+        if (!valid_node(lowers[i], header->leaf_count)) return false;
+    }
+    return true;
+}
+
+Eigen::Vector3i VDBTreeView::dimensions() const {
+    if (!header) {
+        return Eigen::Vector3i::Zero();
+    }
+    return Eigen::Vector3i(header->dimensions[0], header->dimensions[1], header->dimensions[2]);
+}
+
+uint64_t VDBTreeView::root_key(const Eigen::Vector3i& position) {
+    const int shift = 3 + VDBLowerNode::kLog2 + VDBUpperNode::kLog2;
+    return (static_cast<uint64_t>(position.x() >> shift) & 0x1FFFFF) |
+           (static_cast<uint64_t>(position.y() >> shift) & 0x1FFFFF) << 21 |
+           (static_cast<uint64_t>(position.z() >> shift) & 0x1FFFFF) << 42;
+}
+
+const VDBUpperNode* VDBTreeView::find_upper(uint64_t key) const {
+    const VDBRootEntry* end = roots + header->root_count;
+    const VDBRootEntry* it = std::lower_bound(roots, end, key, [](const VDBRootEntry& e, uint64_t k) {
+        return e.key < k;
+    });
+    return it != end && it->key == key ? &uppers[it->upper] : nullptr;
+}
+
+bool VDBTreeView::get(const Eigen::Vector3i& position) const {
+    if (!header) {
+        return false;
+    }
+    const VDBUpperNode* upper = find_upper(root_key(position));
+    if (!upper) {
+        return false;
+    }
+    const int x = position.x(), y = position.y(), z = position.z();
+    const int upper_slot = ((x >> 7) & 31) | ((y >> 7) & 31) << 5 | ((z >> 7) & 31) << 10;
+    if (upper->is_tile(upper_slot)) return true;
+    if (!upper->is_child(upper_slot)) return false;
+
+    const VDBLowerNode& lower = lowers[upper->child_index(upper_slot)];
+    const int lower_slot = ((x >> 3) & 15) | ((y >> 3) & 15) << 4 | ((z >> 3) & 15) << 8;
+    if (lower.is_tile(lower_slot)) return true;
+    if (!lower.is_child(lower_slot)) return false;
+
+    const VDBLeaf& leaf = leaves[lower.child_index(lower_slot)];
+    return (leaf.words[z & 7] >> ((x & 7) | (y & 7) << 3)) & 1;
+}
+
+bool VDBTreeView::any_in_box(const Eigen::Vector3i& min, const Eigen::Vector3i& max) const {
+    if (!header) {
+        return false;
+    }
+    const Eigen::Vector3i lo = min.cwiseMax(Eigen::Vector3i::Zero());
+    const Eigen::Vector3i hi = max.cwiseMin(dimensions() - Eigen::Vector3i::Ones());
+    if ((lo.array() > hi.array()).any()) {
+        return false;
+    }
+
+    for (uint64_t r = 0; r < header->root_count; ++r) {
+        const VDBUpperNode& upper = uppers[roots[r].upper];
+        const Eigen::Vector3i uo(upper.origin[0], upper.origin[1], upper.origin[2]);
+        const Eigen::Vector3i ulo = (lo - uo).cwiseMax(Eigen::Vector3i::Zero());
+        const Eigen::Vector3i uhi = (hi - uo).cwiseMin(Eigen::Vector3i::Constant(kUpperDim - 1));
+        if ((ulo.array() > uhi.array()).any()) continue;
+
+        const Eigen::Vector3i s0 = ulo / kLowerDim, s1 = uhi / kLowerDim;
+        for (int sz = s0.z(); sz <= s1.z(); ++sz)
+        for (int sy = s0.y(); sy <= s1.y(); ++sy)
+        for (int sx = s0.x(); sx <= s1.x(); ++sx) {
+            const int slot = sx | sy << 5 | sz << 10;
+            if (upper.is_tile(slot)) return true;
+            if (!upper.is_child(slot)) continue;
+
+            const VDBLowerNode& lower = lowers[upper.child_index(slot)];
+            const Eigen::Vector3i lo_origin = uo + kLowerDim * Eigen::Vector3i(sx, sy, sz);
+            const Eigen::Vector3i llo = (lo - lo_origin).cwiseMax(Eigen::Vector3i::Zero());
+            const Eigen::Vector3i lhi = (hi - lo_origin).cwiseMin(Eigen::Vector3i::Constant(kLowerDim - 1));
+            const Eigen::Vector3i t0 = llo / kLeafDim, t1 = lhi / kLeafDim;
+            for (int tz = t0.z(); tz <= t1.z(); ++tz)
+            for (int ty = t0.y(); ty <= t1.y(); ++ty)
+            for (int tx = t0.x(); tx <= t1.x(); ++tx) {
+                const int leaf_slot = tx | ty << 4 | tz << 8;
+                if (lower.is_tile(leaf_slot)) return true;
+                if (!lower.is_child(leaf_slot)) continue;
+
+                const VDBLeaf& leaf = leaves[lower.child_index(leaf_slot)];
+                const Eigen::Vector3i leaf_origin = kLeafDim * Eigen::Vector3i(tx, ty, tz);
+                const Eigen::Vector3i blo = (llo - leaf_origin).cwiseMax(Eigen::Vector3i::Zero());
+                const Eigen::Vector3i bhi = (lhi - leaf_origin).cwiseMin(Eigen::Vector3i::Constant(kLeafDim - 1));
+                const uint64_t plane = leaf_plane_mask(blo, bhi);
+                for (int z = blo.z(); z <= bhi.z(); ++z) {
+                    if (leaf.words[z] & plane) return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool VDBTreeView::raycast(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+                          float max_distance, Eigen::Vector3i& hit) const {
+    if (!header || direction.squaredNorm() == 0.0f) {
+        return false;
+    }
+    const Eigen::Vector3f min_bounds(header->min_bounds[0], header->min_bounds[1], header->min_bounds[2]);
+    const Eigen::Vector3f end = origin + direction.normalized() * max_distance;
+    LineTraversal line(Eigen::Vector3f((origin - min_bounds) / header->resolution),
+                       Eigen::Vector3f((end - min_bounds) / header->resolution), LineAlgorithm::RLV);
+    return !line.for_each_voxel(dimensions(), [&](const Eigen::Vector3i& v) {
+        if (get(v)) {
+            hit = v;
+            return false;
+        }
+        return true;
+    });
+}
+
+bool VDBTreeView::to_voxel_grid(VXZ::VoxelGrid& grid) const {
+    if (!header) {
+        return false;
+    }
+    grid = VoxelGrid(header->resolution,
+                     Eigen::Vector3f(header->min_bounds[0], header->min_bounds[1], header->min_bounds[2]),
+                     Eigen::Vector3f(header->max_bounds[0], header->max_bounds[1], header->max_bounds[2]));
+    const Eigen::Vector3i dims = dimensions();
+    if (grid.dimensions() != dims) {
+        return false;
+    }
+
+    auto on_tile = [&](const Eigen::Vector3i& origin, int size) {
+        const Eigen::Vector3i end = (origin + Eigen::Vector3i::Constant(size)).cwiseMin(dims);
+        for (int z = origin.z(); z < end.z(); ++z) {
+            for (int y = origin.y(); y < end.y(); ++y) {
+                grid.set_span(y, z, origin.x(), end.x());
+            }
+        }
+    };
+    auto on_leaf = [&](const Eigen::Vector3i& origin, const VDBLeaf& leaf) {
+        const int x = origin.x();
+        if (x >= dims.x()) return;
+        const uint64_t x_mask = x + kLeafDim > dims.x() ? (uint64_t(1) << (dims.x() - x)) - 1 : 0xFF;
+        for (int z = 0; z < kLeafDim && origin.z() + z < dims.z(); ++z) {
+            for (int y = 0; y < kLeafDim && origin.y() + y < dims.y(); ++y) {
+                const uint64_t byte = (leaf.words[z] >> (8 * y)) & x_mask;
+                if (byte) {
+                    grid.row_data(origin.y() + y, origin.z() + z)[x / VoxelGrid::kWordBits] |=
+                        byte << (x % VoxelGrid::kWordBits);
+                }
+            }
+        }
+    };
+    visit(on_tile, on_leaf);
+    return true;
+}
+
+VDBTreeStorage::VDBTreeStorage() {
+    std::memset(&header_, 0, sizeof(header_));
+    std::memcpy(header_.magic, kMagic, sizeof(kMagic));
+    header_.version = kVersion;
+    update_view();
+}
+
+void VDBTreeStorage::update_view() {
+    header_.root_count = roots_.size();
+    header_.upper_count = uppers_.size();
+    header_.lower_count = lowers_.size();
+    header_.leaf_count = leaves_.size();
+    view_.header = &header_;
+    view_.roots = roots_.data();
+    view_.uppers = uppers_.data();
+    view_.lowers = lowers_.data();
+    view_.leaves = leaves_.data();
+}
+
+bool VDBTreeStorage::save(const std::string& filename) const {
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) {
+        return false;
+    }
+    ofs.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+    ofs.write(reinterpret_cast<const char*>(roots_.data()), roots_.size() * sizeof(VDBRootEntry));
+    ofs.write(reinterpret_cast<const char*>(uppers_.data()), uppers_.size() * sizeof(VDBUpperNode));
+    ofs.write(reinterpret_cast<const char*>(lowers_.data()), lowers_.size() * sizeof(VDBLowerNode));
+    ofs.write(reinterpret_cast<const char*>(leaves_.data()), leaves_.size() * sizeof(VDBLeaf));
+    return ofs.good();
+}
+
+bool VDBTreeStorage::load(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+
+    // Read header
+    VDBHeader header;
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    // The per-section cap only keeps flat_size from overflowing
+    const uint64_t limit = uint64_t(1) << 40;
+    if (!ifs || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.root_count > limit || header.upper_count > limit ||
+        header.lower_count > limit || header.leaf_count > limit) {
+        return false;
+    }
+    // The sections must fit in the file before anything is allocated, as in attach()
+    ifs.seekg(0, std::ios::end);
+    const std::streamoff file_size = ifs.tellg();
+    ifs.seekg(sizeof(VDBHeader));
+    if (file_size < 0 || static_cast<uint64_t>(file_size) < flat_size(header)) {
+        return false;
+    }
+
+    // Read each section in one piece
+    std::vector<VDBRootEntry> roots(header.root_count);
+    std::vector<VDBUpperNode> uppers(header.upper_count);
+    std::vector<VDBLowerNode> lowers(header.lower_count);
+    std::vector<VDBLeaf> leaves(header.leaf_count);
+    ifs.read(reinterpret_cast<char*>(roots.data()), roots.size() * sizeof(VDBRootEntry));
+    ifs.read(reinterpret_cast<char*>(uppers.data()), uppers.size() * sizeof(VDBUpperNode));
+    ifs.read(reinterpret_cast<char*>(lowers.data()), lowers.size() * sizeof(VDBLowerNode));
+    ifs.read(reinterpret_cast<char*>(leaves.data()), leaves.size() * sizeof(VDBLeaf));
+    if (!ifs) {
+        return false;
+    }
+    VDBTreeView view;
+    view.header = &header;
+    view.roots = roots.data();
+    view.uppers = uppers.data();
+    view.lowers = lowers.data();
+    view.leaves = leaves.data();
+    if (!view.valid()) {
+        return false;
+    }
+
+    header_ = header;
+    roots_.swap(roots);
+    uppers_.swap(uppers);
+    lowers_.swap(lowers);
+    leaves_.swap(leaves);
+    update_view();
+    return true;
+}
+
+size_t VDBTreeStorage::get_size() const {
+    return sizeof(*this) + flat_size(header_) - sizeof(VDBHeader);
+}
+
+bool VDBTreeStorage::to_voxel_grid(VXZ::VoxelGrid& grid) const {
+    return view_.to_voxel_grid(grid);
+}
+
+bool VDBTreeStorage::from_voxel_grid(const VXZ::VoxelGrid& grid) {
+    const Eigen::Vector3i dims = grid.dimensions();
+    if ((dims.array() <= 0).any()) {
+        return false;
+    }
+    const int lower_dim = VDBTreeView::kLowerDim;
+    const int upper_dim = VDBTreeView::kUpperDim;
+    const int per_upper = upper_dim / lower_dim;
+
+    // Lower nodes in parallel, one 128^3 block per task
+    const Eigen::Vector3i lower_blocks = (dims + Eigen::Vector3i::Constant(lower_dim - 1)) / lower_dim;
+    std::vector<LowerBlock> blocks(lower_blocks.prod());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, blocks.size(), 1), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+            const int bx = static_cast<int>(i % lower_blocks.x());
+            const int by = static_cast<int>((i / lower_blocks.x()) % lower_blocks.y());
+            const int bz = static_cast<int>(i / (static_cast<size_t>(lower_blocks.x()) * lower_blocks.y()));
+            build_lower(grid, lower_dim * Eigen::Vector3i(bx, by, bz), blocks[i]);
+        }
+    });
+
+    // Assemble upper nodes in root key order; children follow in slot order
+    std::vector<VDBRootEntry> roots;
+    std::vector<VDBUpperNode> uppers;
+    std::vector<VDBLowerNode> lowers;
+    std::vector<VDBLeaf> leaves;
+    const Eigen::Vector3i upper_blocks = (dims + Eigen::Vector3i::Constant(upper_dim - 1)) / upper_dim;
+    std::unique_ptr<VDBUpperNode> upper(new VDBUpperNode);
+    for (int uz = 0; uz < upper_blocks.z(); ++uz)
+    for (int uy = 0; uy < upper_blocks.y(); ++uy)
+    for (int ux = 0; ux < upper_blocks.x(); ++ux) {
+        const Eigen::Vector3i upper_origin = upper_dim * Eigen::Vector3i(ux, uy, uz);
+        clear_node(*upper, upper_origin);
+        upper->first_child = static_cast<uint32_t>(lowers.size());
+        bool occupied = false;
+        for (int slot = 0; slot < VDBUpperNode::kSlots; ++slot) {
+            const Eigen::Vector3i b = per_upper * Eigen::Vector3i(ux, uy, uz) +
+                                      Eigen::Vector3i(slot & 31, (slot >> 5) & 31, slot >> 10);
+            if ((b.array() >= lower_blocks.array()).any()) continue;
+            LowerBlock& block = blocks[(static_cast<size_t>(b.z()) * lower_blocks.y() + b.y()) * lower_blocks.x() + b.x()];
+            if (block.state == EMPTY) continue;
+            occupied = true;
+            if (block.state == FULL) {
+                upper->tile_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+                continue;
+            }
+            upper->child_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+            block.node.first_child = static_cast<uint32_t>(leaves.size());
+            leaves.insert(leaves.end(), block.leaves.begin(), block.leaves.end());
+            std::vector<VDBLeaf>().swap(block.leaves);
+            lowers.push_back(block.node);
+        }
+        if (!occupied) continue;
+        compute_prefix(*upper);
+        roots.push_back(VDBRootEntry{VDBTreeView::root_key(upper_origin), static_cast<uint32_t>(uppers.size()), 0});
+        uppers.push_back(*upper);
+    }
+    if (leaves.size() > 0xFFFFFFFFull || lowers.size() > 0xFFFFFFFFull) {
+        return false;
+    }
+
+    header_.resolution = grid.resolution();
+    for (int i = 0; i < 3; ++i) {
+        header_.min_bounds[i] = grid.min_bounds()[i];
+        header_.max_bounds[i] = grid.max_bounds()[i];
+        header_.dimensions[i] = dims[i];
+    }
+    roots_.swap(roots);
+    uppers_.swap(uppers);
+    lowers_.swap(lowers);
+    leaves_.swap(leaves);
+    update_view();
+    return true;
+}
+
+bool VDBTreeStorage::from_nodes(float resolution, const Eigen::Vector3f& min_bounds, const Eigen::Vector3i& dimensions,
+                                const std::vector<VDBTile>& tiles, const std::vector<VDBLeafEntry>& leaves) {
+    if ((dimensions.array() <= 0).any()) {
+        return false;
+    }
+    const int leaf_dim = VDBTreeView::kLeafDim;
+    const int lower_dim = VDBTreeView::kLowerDim;
+    const int upper_dim = VDBTreeView::kUpperDim;
+
+    // Sparse upper nodes in root key order, each with its lower nodes by slot
+    struct PendingLower {
+        uint64_t tile_mask[VDBLowerNode::kWords] = {};
+        std::map<int, VDBLeaf> leaves;
+    };
+    struct PendingUpper {
+        Eigen::Vector3i origin;
+        std::vector<uint64_t> tile_mask;
+        std::map<int, PendingLower> lowers;
+    };
+    std::map<uint64_t, PendingUpper> pending;
+    auto upper_of = [&](const Eigen::Vector3i& position) -> PendingUpper& {
+        PendingUpper& upper = pending[VDBTreeView::root_key(position)];
+        if (upper.tile_mask.empty()) {
+            upper.origin = position / upper_dim * upper_dim;
+            upper.tile_mask.assign(VDBUpperNode::kWords, 0);
+        }
+        return upper;
+    };
+    auto upper_slot = [](const Eigen::Vector3i& p) {
+        return ((p.x() >> 7) & 31) | ((p.y() >> 7) & 31) << 5 | ((p.z() >> 7) & 31) << 10;
+    };
+    auto lower_slot = [](const Eigen::Vector3i& p) {
+        return ((p.x() >> 3) & 15) | ((p.y() >> 3) & 15) << 4 | ((p.z() >> 3) & 15) << 8;
+    };
+    auto placed = [](const Eigen::Vector3i& origin, int size) {
+        return (origin.array() >= 0).all() && origin.x() % size == 0 && origin.y() % size == 0 &&
+               origin.z() % size == 0;
+    };
+
+    for (const VDBTile& tile : tiles) {
+        if ((tile.size != leaf_dim && tile.size != lower_dim && tile.size != upper_dim) ||
+            !placed(tile.origin, tile.size)) {
+            return false;
+        }
+        PendingUpper& upper = upper_of(tile.origin);
+        if (tile.size == upper_dim) {
+            std::fill(upper.tile_mask.begin(), upper.tile_mask.end(), ~uint64_t(0));
+        } else if (tile.size == lower_dim) {
+            const int slot = upper_slot(tile.origin);
+            upper.tile_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+        } else {
+            const int slot = lower_slot(tile.origin);
+            upper.lowers[upper_slot(tile.origin)].tile_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+        }
+    }
+    for (const VDBLeafEntry& entry : leaves) {
+        if (!placed(entry.origin, leaf_dim)) {
+            return false;
+        }
+        VDBLeaf& leaf = upper_of(entry.origin).lowers[upper_slot(entry.origin)].leaves.emplace(
+            lower_slot(entry.origin), VDBLeaf()).first->second;
+        for (int z = 0; z < leaf_dim; ++z) {
+            leaf.words[z] |= entry.leaf.words[z];
+        }
+    }
+
+    // Emit in the order from_voxel_grid() does: children in slot order,
+    // with uniform leaves and lower nodes folded into tiles
+    std::vector<VDBRootEntry> roots;
+    std::vector<VDBUpperNode> uppers;
+    std::vector<VDBLowerNode> lowers;
+    std::vector<VDBLeaf> node_leaves;
+    std::unique_ptr<VDBUpperNode> upper(new VDBUpperNode);
+    VDBLowerNode lower;
+    for (auto& entry : pending) {
+        PendingUpper& source = entry.second;
+        clear_node(*upper, source.origin);
+        std::memcpy(upper->tile_mask, source.tile_mask.data(), sizeof(upper->tile_mask));
+        upper->first_child = static_cast<uint32_t>(lowers.size());
+        for (auto& slot_lower : source.lowers) {
+            const int slot = slot_lower.first;
+            if (upper->is_tile(slot)) continue;
+            const Eigen::Vector3i lower_origin = source.origin + lower_dim * Eigen::Vector3i(
+                slot & 31, (slot >> 5) & 31, slot >> 10);
+            clear_node(lower, lower_origin);
+            std::memcpy(lower.tile_mask, slot_lower.second.tile_mask, sizeof(lower.tile_mask));
+            lower.first_child = static_cast<uint32_t>(node_leaves.size());
+            for (const auto& slot_leaf : slot_lower.second.leaves) {
+                const int leaf_slot = slot_leaf.first;
+                const VDBLeaf& leaf = slot_leaf.second;
+                if (lower.is_tile(leaf_slot)) continue;
+                bool full = true, empty = true;
+                for (int z = 0; z < leaf_dim; ++z) {
+                    full = full && ~leaf.words[z] == 0;
+                    empty = empty && leaf.words[z] == 0;
+                }
+                if (empty) continue;
+                if (full) {
+                    lower.tile_mask[leaf_slot >> 6] |= uint64_t(1) << (leaf_slot & 63);
+                } else {
+                    lower.child_mask[leaf_slot >> 6] |= uint64_t(1) << (leaf_slot & 63);
+                    node_leaves.push_back(leaf);
+                }
+            }
+            int tiles_in_lower = 0, children = 0;
+            for (int w = 0; w < VDBLowerNode::kWords; ++w) {
+                tiles_in_lower += __builtin_popcountll(lower.tile_mask[w]);
+                children += __builtin_popcountll(lower.child_mask[w]);
+            }
+            if (tiles_in_lower == VDBLowerNode::kSlots) {
+                upper->tile_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+            } else if (tiles_in_lower > 0 || children > 0) {
+                compute_prefix(lower);
+                upper->child_mask[slot >> 6] |= uint64_t(1) << (slot & 63);
+                lowers.push_back(lower);
+            }
+        }
+        bool occupied = false;
+        for (int w = 0; w < VDBUpperNode::kWords && !occupied; ++w) {
+            occupied = (upper->child_mask[w] | upper->tile_mask[w]) != 0;
+        }
+        if (!occupied) continue;
+        compute_prefix(*upper);
+        roots.push_back(VDBRootEntry{entry.first, static_cast<uint32_t>(uppers.size()), 0});
+        uppers.push_back(*upper);
+    }
+    if (node_leaves.size() > 0xFFFFFFFFull || lowers.size() > 0xFFFFFFFFull) {
+        return false;
+    }
+
+    // Half a voxel of slack keeps the dimensions exact under rounding
+    header_.resolution = resolution;
+    for (int i = 0; i < 3; ++i) {
+        header_.min_bounds[i] = min_bounds[i];
+        header_.max_bounds[i] = min_bounds[i] + (dimensions[i] - 0.5f) * resolution;
+        header_.dimensions[i] = dimensions[i];
+    }
+    roots_.swap(roots);
+    uppers_.swap(uppers);
+    lowers_.swap(lowers);
+    leaves_.swap(node_leaves);
+    update_view();
+    return true;
+}
+
+bool VDBTreeStorage::get(const Eigen::Vector3i& position) const {
+    if ((position.array() < 0).any() || (position.array() >= dimensions().array()).any()) {
+        throw std::out_of_range("Position outside VDB grid");
+    }
+    return view_.get(position);
+}
+
+std::vector<uint64_t> VDBTreeStorage::flatten() const {
+    std::vector<uint64_t> buffer(flat_size(header_) / sizeof(uint64_t));
+    char* p = reinterpret_cast<char*>(buffer.data());
+    auto append = [&](const void* data, size_t bytes) {
+        std::memcpy(p, data, bytes);
+        p += bytes;
+    };
+    append(&header_, sizeof(header_));
+    append(roots_.data(), roots_.size() * sizeof(VDBRootEntry));
+    append(uppers_.data(), uppers_.size() * sizeof(VDBUpperNode));
+    append(lowers_.data(), lowers_.size() * sizeof(VDBLowerNode));
+    append(leaves_.data(), leaves_.size() * sizeof(VDBLeaf));
+    return buffer;
+}
+
+} // namespace VXZ
@@ -1,36 +1,40 @@
 #include "storage/voxelstorage.hpp"
+#include "storage/dense_storage.hpp"
+#include "storage/svo.hpp"
+#include "storage/svdag.hpp"
+#include "storage/vdb_tree_storage.hpp"
+#include "storage/flat_vdb_storage.hpp"
+#include "storage/paged_svo.hpp"
 #include <stdexcept>
-#include <fstream>
-#include <unordered_map>
-#include <queue>
-#include <cstring>
 
 namespace VXZ {
 
-// VoxelStorageFactory implementation
-// std::unique_ptr<VoxelStorage> VoxelStorageFactory::create(
-//     const std::string& type,
-//     const VXZ::VoxelGrid& grid
-// ) {
-//     // if (type == "svo") {
-//     //     return std::make_unique<SVOStorage>(grid);        
-//     // }
-     
-//     //else if (type == "ssvdag") {
-//     //     return std::make_unique<SSVDAGStorage>(grid);
-//     // } else if (type == "svdag") {
-//     //     return std::make_unique<SVDAGStorage>(grid);
-//     // } else if (type == "openvdb") {
-//     //     return std::make_unique<OpenVDBStorage>(grid);
-//     // } else if (type == "nanovdb") {
-//     //     return std::make_unique<NanoVDBStorage>(grid);
-//     // } else {
-//     //     throw std::invalid_argument("Unknown storage type: " + type);
-//     // }
-// }
+std::unique_ptr<VoxelStorage> VoxelStorageFactory::create(const std::string& type) {
+    if (type == "dense") {
+        return std::make_unique<DenseStorage>();
+    } else if (type == "svo") {
+        return std::make_unique<SVOStorage>();
+    } else if (type == "svdag") {
+        return std::make_unique<SVDAGStorage>(false);
+    } else if (type == "ssvdag") {
+        return std::make_unique<SVDAGStorage>(true);
+    } else if (type == "vdb_tree") {
+        return std::make_unique<VDBTreeStorage>();
+    } else if (type == "flat_vdb") {
+        return std::make_unique<FlatVDBStorage>();
+    } else if (type == "paged_svo") {
+        return std::make_unique<PagedSVOStorage>();
+    } else {
+        throw std::invalid_argument("Unknown storage type: " + type);
+    }
+}
 
+std::unique_ptr<VoxelStorage> VoxelStorageFactory::create(const std::string& type, const VXZ::VoxelGrid& grid) {
+    std::unique_ptr<VoxelStorage> storage = create(type);
+    if (!storage->from_voxel_grid(grid)) {
+        throw std::runtime_error("Storage type " + type + " cannot hold this grid");
+    }
+    return storage;
+}
 
-
-// ... (rest of NanoVDBStorage implementation)
-
-} // namespace VXZ 
\ No newline at end of file
+} // namespace VXZ
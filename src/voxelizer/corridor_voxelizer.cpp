@@ -1,4 +1,5 @@
 #include "voxelizer/corridor_voxelizer.hpp"
+#include "voxelizer/spline_voxelizer.hpp"
 
 #include <cmath>
 
@@ -54,60 +55,16 @@ Eigen::Vector3f CorridorVoxelizerCPU::evaluate_spline_derivative(float t, int se
     
     return result;
 }
-// Point-in-Corridor Test
-// Description: Determines if a point is within the corridor's radius of any spline segment
-// Reference:
-// - "Distance from Point to Line Segment" by Sunday#include "corridor_voxelizer.hpp"t).norm();
-           
-bool CorridorVoxelizerCPU::is_point_in_corridor(const Eigen::Vector3f &point) const
-{
-    return false;
-}  
 
 // Corridor Voxelization Algorithm
 // Description: Voxelizes a 3D corridor defined by a Catmull-Rom spline and radius
+// The spline is flattened adaptively and only the tube around it is stamped,
+// see SplineVoxelizerCPU::voxelize.
 // Reference:
 // - "Voxelization: A Survey" by Kaufman et al. (1993)
-// - "Efficient Voxelization Using Projection-based Methods" by Huang et al. (2013)
-// - "Real-Time Voxelization for Global Illumination" by Crassin et al. (2011)
 void CorridorVoxelizerCPU::voxelize(VoxelGrid& grid) {
-    // Get grid dimensions
-    Eigen::Vector3i dims = grid.dimensions();
-    
-    // Calculate bounding box of corridor
-    Eigen::Vector3f min_bound = control_points_[0];
-    Eigen::Vector3f max_bound = control_points_[0];
-    
-    for (const auto& point : control_points_) {
-        min_bound = min_bound.cwiseMin(point);
-        max_bound = max_bound.cwiseMax(point);
-    }
-    
-    // Add radius to bounds
-    min_bound.array() -= radius_;
-    max_bound.array() += radius_;
-    
-    // Convert bounds to grid coordinates
-    Eigen::Vector3i grid_min = grid.world_to_grid(min_bound);
-    Eigen::Vector3i grid_max = grid.world_to_grid(max_bound);
-    
-    // Clamp to grid bounds
-    grid_min = grid_min.cwiseMax(Eigen::Vector3i::Zero());
-    grid_max = grid_max.cwiseMin(dims - Eigen::Vector3i::Ones());
-    
-    // Iterate through grid points in bounding box
-    for (int z = grid_min.z(); z <= grid_max.z(); ++z) {
-        for (int y = grid_min.y(); y <= grid_max.y(); ++y) {
-            for (int x = grid_min.x(); x <= grid_max.x(); ++x) {
-                Eigen::Vector3i grid_pos(x, y, z);
-                Eigen::Vector3f world_pos = grid.grid_to_world(grid_pos);
-                
-                if (is_point_in_corridor(world_pos)) {
-                    grid.set(grid_pos, true);
-                }
-            }
-        }
-    }
+    SplineVoxelizerCPU spline(control_points_, radius_, 0);
+    spline.voxelize(grid);
 }
 
 void CorridorVoxelizerGPU::voxelize(VoxelGrid &grid)
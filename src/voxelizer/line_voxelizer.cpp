@@ -1,4 +1,5 @@
 #include "voxelizer/line_voxelizer.hpp"
+#include "voxelizer/line_traversal.hpp"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -102,89 +103,11 @@ void LineVoxelizerCPU::voxelize_slv(VoxelGrid& grid) {
 // - "An Efficient and Robust Ray-Box Intersection Algorithm" by Williams et al. (2005)
 void LineVoxelizerCPU::voxelize_ilv(VoxelGrid& grid) {
     // Integer-only Line Voxelisation algorithm
-    Eigen::Vector3i start_grid = grid.world_to_grid(start_);
-    Eigen::Vector3i end_grid = grid.world_to_grid(end_);
-    
-    int dx = abs(end_grid.x() - start_grid.x());
-    int dy = abs(end_grid.y() - start_grid.y());
-    int dz = abs(end_grid.z() - start_grid.z());
-    
-    int step_x = (start_grid.x() < end_grid.x()) ? 1 : -1;
-    int step_y = (start_grid.y() < end_grid.y()) ? 1 : -1;
-    int step_z = (start_grid.z() < end_grid.z()) ? 1 : -1;
-    
-    int x = start_grid.x();
-    int y = start_grid.y();
-    int z = start_grid.z();
-    
-    // Determine dominant direction
-    if (dx >= dy && dx >= dz) {
-        int err_1 = 2 * dy - dx;
-        int err_2 = 2 * dz - dx;
-        
-        for (int i = 0; i <= dx; ++i) {
-            if (grid.is_inside_grid(Eigen::Vector3i(x, y, z))) {
-                grid.set(Eigen::Vector3i(x, y, z), true);
-            }
-            
-            if (err_1 > 0) {
-                y += step_y;
-                err_1 -= 2 * dx;
-            }
-            if (err_2 > 0) {
-                z += step_z;
-                err_2 -= 2 * dx;
-            }
-            
-            err_1 += 2 * dy;
-            err_2 += 2 * dz;
-            x += step_x;
-        }
-    } else if (dy >= dx && dy >= dz) {
-        int err_1 = 2 * dx - dy;
-        int err_2 = 2 * dz - dy;
-        
-        for (int i = 0; i <= dy; ++i) {
-            if (grid.is_inside_grid(Eigen::Vector3i(x, y, z))) {
-                grid.set(Eigen::Vector3i(x, y, z), true);
-            }
-            
-            if (err_1 > 0) {
-                x += step_x;
-                err_1 -= 2 * dy;
-            }
-            if (err_2 > 0) {
-                z += step_z;
-                err_2 -= 2 * dy;
-            }
-            
-            err_1 += 2 * dx;
-            err_2 += 2 * dz;
-            y += step_y;
-        }
-    } else {
-        int err_1 = 2 * dx - dz;
-        int err_2 = 2 * dy - dz;
-        
-        for (int i = 0; i <= dz; ++i) {
-            if (grid.is_inside_grid(Eigen::Vector3i(x, y, z))) {
-                grid.set(Eigen::Vector3i(x, y, z), true);
-            }
-            
-            if (err_1 > 0) {
-                x += step_x;
-                err_1 -= 2 * dz;
-            }
-            if (err_2 > 0) {
-                y += step_y;
-                err_2 -= 2 * dz;
-            }
-            
-            err_1 += 2 * dx;
-            err_2 += 2 * dy;
-            z += step_z;
-        }
-    }
+    LineTraversal line(grid.world_to_grid(start_), grid.world_to_grid(end_), LineAlgorithm::ILV);
+    line.for_each_voxel(grid.dimensions(), [&grid](const Eigen::Vector3i& voxel) {
+        grid.set(voxel, true);
+        return true;
+    });
 }
 
 // 3D Digital Differential Analyser (DDA)
@@ -194,38 +117,11 @@ void LineVoxelizerCPU::voxelize_ilv(VoxelGrid& grid) {
 // - "Fundamentals of Computer Graphics" by Shirley and Marschner (2009)
 void LineVoxelizerCPU::voxelize_dda(VoxelGrid& grid) {
     // 3D Digital Differential Analyser algorithm
-    Eigen::Vector3i start_grid = grid.world_to_grid(start_);
-    Eigen::Vector3i end_grid = grid.world_to_grid(end_);
-    
-    int dx = end_grid.x() - start_grid.x();
-    int dy = end_grid.y() - start_grid.y();
-    int dz = end_grid.z() - start_grid.z();
-    
-    int steps = std::max({abs(dx), abs(dy), abs(dz)});
-    
-    float x_inc = static_cast<float>(dx) / steps;
-    float y_inc = static_cast<float>(dy) / steps;
-    float z_inc = static_cast<float>(dz) / steps;
-    
-    float x = start_grid.x();
-    float y = start_grid.y();
-    float z = start_grid.z();
-    
-    for (int i = 0; i <= steps; ++i) {
-        Eigen::Vector3i grid_pos(
-            static_cast<int>(round(x)),
-            static_cast<int>(round(y)),
-            static_cast<int>(round(z))
-        );
-        
-        if (grid.is_inside_grid(grid_pos)) {
-            grid.set(grid_pos, true);
-        }
-        
-        x += x_inc;
-        y += y_inc;
-        z += z_inc;
-    }
+    LineTraversal line(grid.world_to_grid(start_), grid.world_to_grid(end_), LineAlgorithm::DDA);
+    line.for_each_voxel(grid.dimensions(), [&grid](const Eigen::Vector3i& voxel) {
+        grid.set(voxel, true);
+        return true;
+    });
 }
 
 // 3D Bresenham's Algorithm
@@ -236,89 +132,11 @@ void LineVoxelizerCPU::voxelize_dda(VoxelGrid& grid) {
 // - "3D Bresenham's Algorithm" by Kaufman (1987)
 void LineVoxelizerCPU::voxelize_bresenham(VoxelGrid& grid) {
     // 3D Bresenham's algorithm
-    Eigen::Vector3i start_grid = grid.world_to_grid(start_);
-    Eigen::Vector3i end_grid = grid.world_to_grid(end_);
-    
-    int dx = abs(end_grid.x() - start_grid.x());
-    int dy = abs(end_grid.y() - start_grid.y());
-    int dz = abs(end_grid.z() - start_grid.z());
-    
-    int step_x = (start_grid.x() < end_grid.x()) ? 1 : -1;
-    int step_y = (start_grid.y() < end_grid.y()) ? 1 : -1;
-    int step_z = (start_grid.z() < end_grid.z()) ? 1 : -1;
-    
-    int x = start_grid.x();
-    int y = start_grid.y();
-    int z = start_grid.z();
-    
-    // Determine dominant direction
-    if (dx >= dy && dx >= dz) {
-        int err_1 = 2 * dy - dx;
-        int err_2 = 2 * dz - dx;
-        
-        for (int i = 0; i <= dx; ++i) {
-            if (grid.is_inside_grid(Eigen::Vector3i(x, y, z))) {
-                grid.set(Eigen::Vector3i(x, y, z), true);
-            }
-            
-            if (err_1 > 0) {
-                y += step_y;
-                err_1 -= 2 * dx;
-            }
-            if (err_2 > 0) {
-                z += step_z;
-                err_2 -= 2 * dx;
-            }
-            
-            err_1 += 2 * dy;
-            err_2 += 2 * dz;
-            x += step_x;
-        }
-    } else if (dy >= dx && dy >= dz) {
-        int err_1 = 2 * dx - dy;
-        int err_2 = 2 * dz - dy;
-        
-        for (int i = 0; i <= dy; ++i) {
-            if (grid.is_inside_grid(Eigen::Vector3i(x, y, z))) {
-                grid.set(Eigen::Vector3i(x, y, z), true);
-            }
-            
-            if (err_1 > 0) {
-                x += step_x;
-                err_1 -= 2 * dy;
-            }
-            if (err_2 > 0) {
-                z += step_z;
-                err_2 -= 2 * dy;
-            }
-            
-            err_1 += 2 * dx;
-            err_2 += 2 * dz;
-            y += step_y;
-        }
-    } else {
-        int err_1 = 2 * dx - dz;
-        int err_2 = 2 * dy - dz;
-        
-        for (int i = 0; i <= dz; ++i) {
-            if (grid.is_inside_grid(Eigen::Vector3i(x, y, z))) {
-                grid.set(Eigen::Vector3i(x, y, z), true);
-            }
-            
-            if (err_1 > 0) {
-                x += step_x;
-                err_1 -= 2 * dz;
-            }
-            if (err_2 > 0) {
-                y += step_y;
-                err_2 -= 2 * dz;
-            }
-            
-            err_1 += 2 * dx;
-            err_2 += 2 * dy;
-            z += step_z;
-        }
-    }
+    LineTraversal line(grid.world_to_grid(start_), grid.world_to_grid(end_), LineAlgorithm::BRESENHAM);
+    line.for_each_voxel(grid.dimensions(), [&grid](const Eigen::Vector3i& voxel) {
+        grid.set(voxel, true);
+        return true;
+    });
 }
 
 void LineVoxelizerCPU::voxelize_tripod(VoxelGrid &grid){
@@ -1,6 +1,8 @@
 #include "voxelizer/spline_voxelizer.hpp"
+#include "voxelizer/tube_voxelizer.hpp"
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
 
 namespace VXZ {
 
@@ -76,66 +78,108 @@ Eigen::Vector3f SplineVoxelizerCPU::evaluate_spline_derivative(float t, int segm
     return (p2 - p1) / (2 * h);
 }
 
-bool SplineVoxelizerCPU::is_point_in_spline(const Eigen::Vector3f& point) const {
-    const int num_segments = control_points_.size() - 3;
-    const int steps_per_segment = 100;
-    const float step_size = 1.0f / steps_per_segment;
+void SplineVoxelizerCPU::bezier_control_points(int segment, Eigen::Vector3f bezier[4]) const {
+    const auto& p0 = control_points_[segment];
+    const auto& p1 = control_points_[segment + 1];
+    const auto& p2 = control_points_[segment + 2];
+    const auto& p3 = control_points_[segment + 3];
+
+    switch (spline_type_) {
+        case 0:
+            bezier[0] = p1;
+            bezier[1] = p1 + (p2 - p0) / 6.0f;
+            bezier[2] = p2 - (p3 - p1) / 6.0f;
+            bezier[3] = p2;
+            break;
+        case 1:
+            bezier[0] = (p0 + 4.0f * p1 + p2) / 6.0f;
+            bezier[1] = (2.0f * p1 + p2) / 3.0f;
+            bezier[2] = (p1 + 2.0f * p2) / 3.0f;
+            bezier[3] = (p1 + 4.0f * p2 + p3) / 6.0f;
+            break;
+        case 2:
+            bezier[0] = p0;
+            bezier[1] = p1;
+            bezier[2] = p2;
+            bezier[3] = p3;
+            break;
+        default: throw std::runtime_error("Invalid spline type");
+    }
+}
+
+std::vector<std::vector<Eigen::Vector3f>> SplineVoxelizerCPU::flatten_pieces(float tolerance) const {
+    std::vector<std::vector<Eigen::Vector3f>> pieces;
+    const int num_segments = static_cast<int>(control_points_.size()) - 3;
+    if (num_segments <= 0) {
+        return pieces;
+    }
+
+    // Distance from a point to the chord ab
+    auto chord_distance = [](const Eigen::Vector3f& p, const Eigen::Vector3f& a, const Eigen::Vector3f& b) {
+        Eigen::Vector3f ab = b - a;
+        float len2 = ab.squaredNorm();
+        float t = len2 > 0.0f ? std::max(0.0f, std::min(1.0f, (p - a).dot(ab) / len2)) : 0.0f;
+        return (p - (a + t * ab)).norm();
+    };
+
+    struct Arc {
+        Eigen::Vector3f b[4];
+        int depth;
+    };
+    const int max_depth = 24;
 
     for (int segment = 0; segment < num_segments; ++segment) {
-        for (int step = 0; step < steps_per_segment; ++step) {
-            float t = step * step_size;
-            Eigen::Vector3f spline_point = evaluate_spline(t, segment);
-            Eigen::Vector3f derivative = evaluate_spline_derivative(t, segment);
-            
-            // Calculate distance from point to spline
-            Eigen::Vector3f diff = point - spline_point;
-            float distance = diff.norm();
-            
-            // Check if point is within radius of spline
-            if (distance <= radius_) {
-                return true;
+        Arc root;
+        root.depth = 0;
+        bezier_control_points(segment, root.b);
+        // Bezier windows overlap, so their segments do not meet end to end
+        if (pieces.empty() || pieces.back().back() != root.b[0]) {
+            pieces.emplace_back(1, root.b[0]);
+        }
+        std::vector<Eigen::Vector3f>& polyline = pieces.back();
+
+        // Depth-first de Casteljau subdivision, first half on top so that
+        // vertices come out in curve order
+        std::vector<Arc> stack(1, root);
+        while (!stack.empty()) {
+            Arc arc = stack.back();
+            stack.pop_back();
+            const Eigen::Vector3f* b = arc.b;
+            float flatness = std::max(chord_distance(b[1], b[0], b[3]), chord_distance(b[2], b[0], b[3]));
+            if (flatness <= tolerance || arc.depth >= max_depth) {
+                polyline.push_back(b[3]);
+                continue;
             }
+
+            Eigen::Vector3f b01 = 0.5f * (b[0] + b[1]);
+            Eigen::Vector3f b12 = 0.5f * (b[1] + b[2]);
+            Eigen::Vector3f b23 = 0.5f * (b[2] + b[3]);
+            Eigen::Vector3f b012 = 0.5f * (b01 + b12);
+            Eigen::Vector3f b123 = 0.5f * (b12 + b23);
+            Eigen::Vector3f mid = 0.5f * (b012 + b123);
+
+            Arc left = {{b[0], b01, b012, mid}, arc.depth + 1};
+            Arc right = {{mid, b123, b23, b[3]}, arc.depth + 1};
+            stack.push_back(right);
+            stack.push_back(left);
         }
     }
-    return false;
+    return pieces;
 }
 
-void SplineVoxelizerCPU::voxelize(VoxelGrid& grid) {
-    // Get grid dimensions and resolution
-    const auto& dims = grid.dimensions();
-    const auto& resolution = grid.resolution();
-    const auto& min_bounds = grid.min_bounds();
-    const auto& max_bounds = grid.max_bounds();
-
-    // Calculate bounding box of spline
-    Eigen::Vector3f min_point = control_points_[0];
-    Eigen::Vector3f max_point = control_points_[0];
-    for (const auto& point : control_points_) {
-        min_point = min_point.cwiseMin(point);
-        max_point = max_point.cwiseMax(point);
+std::vector<Eigen::Vector3f> SplineVoxelizerCPU::flatten(float tolerance) const {
+    std::vector<Eigen::Vector3f> polyline;
+    for (const auto& piece : flatten_pieces(tolerance)) {
+        polyline.insert(polyline.end(), piece.begin(), piece.end());
     }
-    min_point.array() -= radius_;
-    max_point.array() += radius_;
-
-    // Convert to grid coordinates
-    Eigen::Vector3i min_grid = grid.world_to_grid(min_point);
-    Eigen::Vector3i max_grid = grid.world_to_grid(max_point);
-
-    // Clamp to grid bounds
-    min_grid = min_grid.cwiseMax(Eigen::Vector3i::Zero());
-    max_grid = max_grid.cwiseMin(dims - Eigen::Vector3i::Ones());
-
-    // Voxelize spline
-    for (int z = min_grid.z(); z <= max_grid.z(); ++z) {
-        for (int y = min_grid.y(); y <= max_grid.y(); ++y) {
-            for (int x = min_grid.x(); x <= max_grid.x(); ++x) {
-                Eigen::Vector3i grid_pos(x, y, z);
-                Eigen::Vector3f world_pos = grid.grid_to_world(grid_pos);
-                if (is_point_in_spline(world_pos)) {
-                    grid.set(grid_pos, true);
-                }
-            }
-        }
+    return polyline;
+}
+
+void SplineVoxelizerCPU::voxelize(VoxelGrid& grid) {
+    // One tube per piece, so no chord is stamped across a gap between segments
+    for (const auto& piece : flatten_pieces(0.25f * grid.resolution())) {
+        TubeVoxelizerCPU tube(piece, radius_);
+        tube.voxelize(grid);
     }
 }
 
@@ -0,0 +1,264 @@
+#include "voxelizer/swept_volume_voxelizer.hpp"
+#include "voxelizer/spline_voxelizer.hpp"
+#include "voxelizer/tube_voxelizer.hpp"
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace VXZ {
+
+namespace {
+
+// Interval [lo, hi] of x where (x, y, z) lies inside the oriented box
+bool box_row_span(const Eigen::Vector3f& center, const Eigen::Matrix3f& rotation,
+                  const Eigen::Vector3f& half_extents, float y, float z, float& lo, float& hi) {
+    // Row in box coordinates: o + x d, with x the world x coordinate
+    const Eigen::Vector3f o = rotation.transpose() * (Eigen::Vector3f(0.0f, y, z) - center);
+    const Eigen::Vector3f d = rotation.row(0).transpose();
+    lo = -std::numeric_limits<float>::infinity();
+    hi = std::numeric_limits<float>::infinity();
+    for (int a = 0; a < 3; ++a) {
+        if (std::abs(d[a]) < 1e-7f) {
+            if (std::abs(o[a]) > half_extents[a]) return false;
+            continue;
+        }
+        float t0 = (-half_extents[a] - o[a]) / d[a];
+        float t1 = (half_extents[a] - o[a]) / d[a];
+        if (t0 > t1) std::swap(t0, t1);
+        lo = std::max(lo, t0);
+        hi = std::min(hi, t1);
+        if (lo > hi) return false;
+    }
+    return true;
+}
+
+// Rows of the grid whose sample points may fall in [lo, hi]
+bool row_range(const VoxelGrid& grid, const Eigen::Vector3f& lo, const Eigen::Vector3f& hi,
+               Eigen::Vector3i& vlo, Eigen::Vector3i& vhi) {
+    const Eigen::Vector3f a = (lo - grid.min_bounds()) / grid.resolution();
+    const Eigen::Vector3f b = (hi - grid.min_bounds()) / grid.resolution();
+    const Eigen::Vector3f top = (grid.dimensions() - Eigen::Vector3i::Ones()).cast<float>();
+    const Eigen::Vector3f fa = a.array().ceil().max(0.0f).matrix();
+    const Eigen::Vector3f fb = b.array().floor().min(top.array()).matrix();
+    if ((fa.array() > fb.array()).any()) return false;
+    vlo = fa.cast<int>();
+    vhi = fb.cast<int>();
+    return true;
+}
+
+// Hand the voxels of world interval [lo, hi] on row (y, z) to the visitor
+template <typename SpanVisitor>
+bool emit_span(const VoxelGrid& grid, int y, int z, float lo, float hi, SpanVisitor& visitor) {
+    const float resolution = grid.resolution();
+    const float x0 = std::max(0.0f, std::ceil((lo - grid.min_bounds().x()) / resolution));
+    const float x1 = std::min(static_cast<float>(grid.dimensions().x() - 1),
+                              std::floor((hi - grid.min_bounds().x()) / resolution));
+    if (x0 > x1) return true;
+    return visitor(y, z, static_cast<int>(x0), static_cast<int>(x1) + 1);
+}
+
+// Mask of bits [b0, b1] of a word
+uint64_t bit_range(int b0, int b1) {
+    return (~uint64_t(0) << b0) & (~uint64_t(0) >> (VoxelGrid::kWordBits - 1 - b1));
+}
+
+} // namespace
+
+SweptVolumeVoxelizerCPU::SweptVolumeVoxelizerCPU(const std::vector<Eigen::Vector3f>& positions,
+                                                 const std::vector<float>& radii)
+    : footprint_(Footprint::SPHERE),
+      positions_(positions),
+      radii_(radii),
+      half_extents_(Eigen::Vector3f::Zero()),
+      chunk_size_(16) {
+    if (positions.empty()) {
+        throw std::invalid_argument("Trajectory must have at least 1 sample");
+    }
+    if (radii.size() != positions.size()) {
+        throw std::invalid_argument("Trajectory needs one radius per sample");
+    }
+}
+
+SweptVolumeVoxelizerCPU::SweptVolumeVoxelizerCPU(const std::vector<Eigen::Vector3f>& positions,
+                                                 const std::vector<Eigen::Quaternionf>& orientations,
+                                                 const Eigen::Vector3f& half_extents)
+    : footprint_(Footprint::BOX),
+      positions_(positions),
+      orientations_(orientations),
+      half_extents_(half_extents),
+      chunk_size_(16) {
+    if (positions.empty()) {
+        throw std::invalid_argument("Trajectory must have at least 1 sample");
+    }
+    if (orientations.size() != positions.size()) {
+        throw std::invalid_argument("Trajectory needs one orientation per sample");
+    }
+    for (auto& q : orientations_) {
+        q.normalize();
+    }
+}
+
+SweptVolumeVoxelizerCPU SweptVolumeVoxelizerCPU::along_spline(const std::vector<Eigen::Vector3f>& control_points,
+                                                              int spline_type,
+                                                              const Eigen::Vector3f& half_extents,
+                                                              float tolerance) {
+    SplineVoxelizerCPU spline(control_points, 0.0f, spline_type);
+    std::vector<Eigen::Vector3f> path = spline.flatten(tolerance);
+    if (path.empty()) {
+        throw std::invalid_argument("Spline must have at least 4 control points");
+    }
+
+    std::vector<Eigen::Quaternionf> orientations(path.size(), Eigen::Quaternionf::Identity());
+    for (size_t i = 0; i < path.size(); ++i) {
+        Eigen::Vector3f heading = Eigen::Vector3f::Zero();
+        if (i + 1 < path.size()) {
+            heading = path[i + 1] - path[i];
+        } else if (i > 0) {
+            heading = path[i] - path[i - 1];
+        }
+        if (heading.squaredNorm() == 0.0f) {
+            if (i > 0) orientations[i] = orientations[i - 1];
+            continue;
+        }
+        Eigen::Vector3f x_axis = heading.normalized();
+        Eigen::Vector3f y_axis = Eigen::Vector3f::UnitZ().cross(x_axis);
+        if (y_axis.squaredNorm() < 1e-12f) {
+            y_axis = Eigen::Vector3f::UnitY();
+        }
+        y_axis.normalize();
+        Eigen::Matrix3f frame;
+        frame.col(0) = x_axis;
+        frame.col(1) = y_axis;
+        frame.col(2) = x_axis.cross(y_axis);
+        orientations[i] = Eigen::Quaternionf(frame);
+    }
+    return SweptVolumeVoxelizerCPU(path, orientations, half_extents);
+}
+
+template <typename SpanVisitor>
+bool SweptVolumeVoxelizerCPU::sphere_interval(const VoxelGrid& grid, size_t i, SpanVisitor& visitor) const {
+    const size_t j = std::min(i + 1, positions_.size() - 1);
+    const Eigen::Vector3f& a = positions_[i];
+    const Eigen::Vector3f& b = positions_[j];
+    const float ra = radii_[i];
+    const float rb = radii_[j];
+
+    // Capsules with the larger end radius over-cover by at most the radius
+    // change of a piece, which is kept to a quarter voxel
+    const int pieces = std::max(1, static_cast<int>(std::ceil(std::abs(rb - ra) / (0.25f * grid.resolution()))));
+    for (int k = 0; k < pieces; ++k) {
+        const float t0 = static_cast<float>(k) / pieces;
+        const float t1 = static_cast<float>(k + 1) / pieces;
+        const Eigen::Vector3f p0 = a + (b - a) * t0;
+        const Eigen::Vector3f p1 = a + (b - a) * t1;
+        const float radius = std::max(ra + (rb - ra) * t0, ra + (rb - ra) * t1);
+
+        Eigen::Vector3i vlo, vhi;
+        if (!row_range(grid, p0.cwiseMin(p1).array() - radius, p0.cwiseMax(p1).array() + radius, vlo, vhi)) {
+            continue;
+        }
+        for (int z = vlo.z(); z <= vhi.z(); ++z) {
+            const float wz = grid.min_bounds().z() + z * grid.resolution();
+            for (int y = vlo.y(); y <= vhi.y(); ++y) {
+                const float wy = grid.min_bounds().y() + y * grid.resolution();
+                float lo, hi;
+                if (capsule_row_span(p0, p1, radius, wy, wz, lo, hi) && !emit_span(grid, y, z, lo, hi, visitor)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <typename SpanVisitor>
+bool SweptVolumeVoxelizerCPU::box_interval(const VoxelGrid& grid, size_t i, SpanVisitor& visitor) const {
+    const size_t j = std::min(i + 1, positions_.size() - 1);
+    const Eigen::Vector3f& p0 = positions_[i];
+    const Eigen::Vector3f& p1 = positions_[j];
+    const Eigen::Quaternionf& q0 = orientations_[i];
+    const Eigen::Quaternionf& q1 = orientations_[j];
+
+    // Bound on how far any point of the box travels over the interval
+    const float motion = (p1 - p0).norm() + q0.angularDistance(q1) * half_extents_.norm();
+    const int steps = std::max(1, static_cast<int>(std::ceil(motion / (0.5f * grid.resolution()))));
+    const Eigen::Vector3f extents = half_extents_.array() + 0.5f * motion / steps;
+
+    // The interval's end pose is the next interval's start; only the last
+    // interval stamps it
+    const int last = (j + 1 == positions_.size()) ? steps : steps - 1;
+    for (int k = 0; k <= last; ++k) {
+        const float t = static_cast<float>(k) / steps;
+        const Eigen::Vector3f center = p0 + (p1 - p0) * t;
+        const Eigen::Matrix3f rotation = q0.slerp(t, q1).toRotationMatrix();
+
+        const Eigen::Vector3f reach = rotation.cwiseAbs() * extents;
+        Eigen::Vector3i vlo, vhi;
+        if (!row_range(grid, center - reach, center + reach, vlo, vhi)) {
+            continue;
+        }
+        for (int z = vlo.z(); z <= vhi.z(); ++z) {
+            const float wz = grid.min_bounds().z() + z * grid.resolution();
+            for (int y = vlo.y(); y <= vhi.y(); ++y) {
+                const float wy = grid.min_bounds().y() + y * grid.resolution();
+                float lo, hi;
+                if (box_row_span(center, rotation, extents, wy, wz, lo, hi) &&
+                    !emit_span(grid, y, z, lo, hi, visitor)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <typename SpanVisitor>
+bool SweptVolumeVoxelizerCPU::for_each_span(const VoxelGrid& grid, SpanVisitor visitor) const {
+    const size_t intervals = positions_.size() > 1 ? positions_.size() - 1 : 1;
+    std::atomic<bool> stopped(false);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, intervals, chunk_size_), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+            if (stopped.load(std::memory_order_relaxed)) return;
+            bool go = footprint_ == Footprint::SPHERE ? sphere_interval(grid, i, visitor)
+                                                      : box_interval(grid, i, visitor);
+            if (!go) stopped.store(true, std::memory_order_relaxed);
+        }
+    });
+    return !stopped.load();
+}
+
+void SweptVolumeVoxelizerCPU::voxelize(VoxelGrid& grid) {
+    // Chunks overlap in space, so words are OR-ed atomically
+    for_each_span(grid, [&grid](int y, int z, int x_begin, int x_end) {
+        uint64_t* row = grid.row_data(y, z);
+        const int first = x_begin / VoxelGrid::kWordBits;
+        const int last = (x_end - 1) / VoxelGrid::kWordBits;
+        for (int w = first; w <= last; ++w) {
+            const int b0 = w == first ? x_begin % VoxelGrid::kWordBits : 0;
+            const int b1 = w == last ? (x_end - 1) % VoxelGrid::kWordBits : VoxelGrid::kWordBits - 1;
+            __atomic_fetch_or(&row[w], bit_range(b0, b1), __ATOMIC_RELAXED);
+        }
+        return true;
+    });
+}
+
+bool SweptVolumeVoxelizerCPU::intersects(const VoxelGrid& grid) const {
+    const bool clear = for_each_span(grid, [&grid](int y, int z, int x_begin, int x_end) {
+        const uint64_t* row = grid.row_data(y, z);
+        const int first = x_begin / VoxelGrid::kWordBits;
+        const int last = (x_end - 1) / VoxelGrid::kWordBits;
+        for (int w = first; w <= last; ++w) {
+            const int b0 = w == first ? x_begin % VoxelGrid::kWordBits : 0;
+            const int b1 = w == last ? (x_end - 1) % VoxelGrid::kWordBits : VoxelGrid::kWordBits - 1;
+            if (row[w] & bit_range(b0, b1)) return false;
+        }
+        return true;
+    });
+    return !clear;
+}
+
+} // namespace VXZ
@@ -0,0 +1,180 @@
+#include "voxelizer/tube_voxelizer.hpp"
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace VXZ {
+
+constexpr int TubeVoxelizerCPU::kTileSizeX;
+constexpr int TubeVoxelizerCPU::kTileSizeYZ;
+
+namespace {
+
+// Extend [lo, hi] by the x-interval where (x, y, z) lies within sqrt(r2) of c
+void sphere_row_span(const Eigen::Vector3f& c, float r2, float y, float z, float& lo, float& hi) {
+    float dyz2 = (y - c.y()) * (y - c.y()) + (z - c.z()) * (z - c.z());
+    if (dyz2 <= r2) {
+        float h = std::sqrt(r2 - dyz2);
+        lo = std::min(lo, c.x() - h);
+        hi = std::max(hi, c.x() + h);
+    }
+}
+
+} // namespace
+
+// The capsule is convex, so the union of its cylinder and end-sphere
+// intervals is a single interval.
+bool capsule_row_span(const Eigen::Vector3f& a, const Eigen::Vector3f& b, float radius,
+                      float y, float z, float& lo, float& hi) {
+    const float r2 = radius * radius;
+    lo = std::numeric_limits<float>::infinity();
+    hi = -std::numeric_limits<float>::infinity();
+    sphere_row_span(a, r2, y, z, lo, hi);
+    sphere_row_span(b, r2, y, z, lo, hi);
+
+    const Eigen::Vector3f d = b - a;
+    const float len2 = d.squaredNorm();
+    if (len2 > 0.0f) {
+        // Row point relative to a: w(x) = w0 + x * e_x
+        const Eigen::Vector3f w0(-a.x(), y - a.y(), z - a.z());
+        const float wd = w0.dot(d);
+
+        // Axial parameter s(x) = (wd + x d.x) / len2 must lie in [0, 1]
+        float s_lo = -std::numeric_limits<float>::infinity();
+        float s_hi = std::numeric_limits<float>::infinity();
+        if (d.x() != 0.0f) {
+            s_lo = -wd / d.x();
+            s_hi = (len2 - wd) / d.x();
+            if (s_lo > s_hi) std::swap(s_lo, s_hi);
+        } else if (wd < 0.0f || wd > len2) {
+            s_lo = 1.0f;
+            s_hi = 0.0f;
+        }
+
+        // Squared distance to the axis: alpha x^2 + beta x + gamma + r2
+        const float alpha = 1.0f - d.x() * d.x() / len2;
+        const float beta = 2.0f * (w0.x() - wd * d.x() / len2);
+        const float gamma = w0.squaredNorm() - wd * wd / len2 - r2;
+
+        float c_lo = 1.0f, c_hi = 0.0f;
+        if (alpha < 1e-6f) {
+            // Axis parallel to the row: distance is constant along it
+            if (gamma <= 0.0f) {
+                c_lo = s_lo;
+                c_hi = s_hi;
+            }
+        } else {
+            float disc = beta * beta - 4.0f * alpha * gamma;
+            if (disc >= 0.0f) {
+                float root = std::sqrt(disc);
+                c_lo = std::max((-beta - root) / (2.0f * alpha), s_lo);
+                c_hi = std::min((-beta + root) / (2.0f * alpha), s_hi);
+            }
+        }
+        if (c_lo <= c_hi) {
+            lo = std::min(lo, c_lo);
+            hi = std::max(hi, c_hi);
+        }
+    }
+    return lo <= hi;
+}
+
+TubeVoxelizerCPU::TubeVoxelizerCPU(const std::vector<Eigen::Vector3f>& points, float radius)
+    : points_(points), radius_(radius) {
+    if (points.empty()) {
+        throw std::invalid_argument("Tube must have at least 1 point");
+    }
+}
+
+void TubeVoxelizerCPU::voxelize(VoxelGrid& grid) {
+    const float resolution = grid.resolution();
+    const Eigen::Vector3f& origin = grid.min_bounds();
+    const Eigen::Vector3i dims = grid.dimensions();
+
+    // Split long segments so that each one touches only the tiles near it
+    const float max_length = kTileSizeYZ * resolution;
+    std::vector<Eigen::Vector3f> starts, ends;
+    if (points_.size() == 1) {
+        starts.push_back(points_[0]);
+        ends.push_back(points_[0]);
+    }
+    for (size_t i = 0; i + 1 < points_.size(); ++i) {
+        const Eigen::Vector3f& a = points_[i];
+        const Eigen::Vector3f& b = points_[i + 1];
+        int pieces = std::max(1, static_cast<int>(std::ceil((b - a).norm() / max_length)));
+        for (int k = 0; k < pieces; ++k) {
+            starts.push_back(a + (b - a) * (static_cast<float>(k) / pieces));
+            ends.push_back(a + (b - a) * (static_cast<float>(k + 1) / pieces));
+        }
+    }
+
+    // Bin segments into the tiles overlapped by their inflated bounding box
+    const Eigen::Vector3i tile_size(kTileSizeX, kTileSizeYZ, kTileSizeYZ);
+    const Eigen::Vector3i tiles = (dims + tile_size - Eigen::Vector3i::Ones()).cwiseQuotient(tile_size);
+    std::unordered_map<long long, std::vector<int>> bins;
+    for (size_t i = 0; i < starts.size(); ++i) {
+        Eigen::Vector3f lo = (starts[i].cwiseMin(ends[i]) - origin).array() - radius_;
+        Eigen::Vector3f hi = (starts[i].cwiseMax(ends[i]) - origin).array() + radius_;
+        Eigen::Vector3i vlo = (lo / resolution).array().ceil().cast<int>();
+        Eigen::Vector3i vhi = (hi / resolution).array().floor().cast<int>();
+        vlo = vlo.cwiseMax(Eigen::Vector3i::Zero());
+        vhi = vhi.cwiseMin(dims - Eigen::Vector3i::Ones());
+        if ((vlo.array() > vhi.array()).any()) continue;
+
+        Eigen::Vector3i tlo = vlo.cwiseQuotient(tile_size);
+        Eigen::Vector3i thi = vhi.cwiseQuotient(tile_size);
+        for (int tz = tlo.z(); tz <= thi.z(); ++tz) {
+            for (int ty = tlo.y(); ty <= thi.y(); ++ty) {
+                for (int tx = tlo.x(); tx <= thi.x(); ++tx) {
+                    long long key = tx + static_cast<long long>(tiles.x()) *
+                                         (ty + static_cast<long long>(tiles.y()) * tz);
+                    bins[key].push_back(static_cast<int>(i));
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<long long, std::vector<int>>> work(bins.begin(), bins.end());
+
+    // Stamp capsule spans tile by tile; a tile owns one word of each of its rows
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, work.size()), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t t = r.begin(); t != r.end(); ++t) {
+            const long long key = work[t].first;
+            const std::vector<int>& segments = work[t].second;
+            const int tx = static_cast<int>(key % tiles.x());
+            const int ty = static_cast<int>((key / tiles.x()) % tiles.y());
+            const int tz = static_cast<int>(key / (static_cast<long long>(tiles.x()) * tiles.y()));
+
+            const int x0 = tx * kTileSizeX;
+            const int x1 = std::min(dims.x(), x0 + kTileSizeX) - 1;
+            const int y1 = std::min(dims.y(), (ty + 1) * kTileSizeYZ);
+            const int z1 = std::min(dims.z(), (tz + 1) * kTileSizeYZ);
+            for (int z = tz * kTileSizeYZ; z < z1; ++z) {
+                const float wz = origin.z() + z * resolution;
+                for (int y = ty * kTileSizeYZ; y < y1; ++y) {
+                    const float wy = origin.y() + y * resolution;
+                    uint64_t mask = 0;
+                    for (int s : segments) {
+                        float lo, hi;
+                        if (!capsule_row_span(starts[s], ends[s], radius_, wy, wz, lo, hi)) continue;
+                        float f0 = std::max(static_cast<float>(x0), std::ceil((lo - origin.x()) / resolution));
+                        float f1 = std::min(static_cast<float>(x1), std::floor((hi - origin.x()) / resolution));
+                        if (f0 > f1) continue;
+                        const int b0 = static_cast<int>(f0) - x0;
+                        const int b1 = static_cast<int>(f1) - x0;
+                        mask |= (~uint64_t(0) << b0) & (~uint64_t(0) >> (VoxelGrid::kWordBits - 1 - b1));
+                    }
+                    if (mask) {
+                        grid.row_data(y, z)[tx] |= mask;
+                    }
+                }
+            }
+        }
+    });
+}
+
+} // namespace VXZ
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <core/dynamic_distance_field.hpp>
+#include <operator/distance_transform_operator.hpp>
+#include <random>
+
+using namespace VXZ;
+
+namespace {
+
+VoxelGrid make_grid() {
+    return VoxelGrid(0.5f, Eigen::Vector3f(-2, -2, 0), Eigen::Vector3f(-2 + 0.5f * 31.5f, -2 + 0.5f * 23.5f, 0.5f * 17.5f));
+}
+
+// Every voxel measures to an occupied voxel at the reported distance, and
+// the distance matches the exact transform
+void expect_consistent(const DynamicDistanceField& dynamic, const VoxelGrid& grid, float max_distance) {
+    const DistanceField exact = DistanceTransformOperator().apply(grid);
+    const Eigen::Vector3i& dims = grid.dimensions();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                const Eigen::Vector3i p(x, y, z);
+                const float expected = exact.get(p) <= max_distance ? exact.get(p) : DistanceField::kInfinity;
+                if (expected == DistanceField::kInfinity) {
+                    ASSERT_EQ(dynamic.get(p), DistanceField::kInfinity) << x << " " << y << " " << z;
+                    continue;
+                }
+                ASSERT_NEAR(dynamic.get(p), expected, 1e-4f) << x << " " << y << " " << z;
+                ASSERT_TRUE(grid.get(dynamic.nearest(p)));
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(DynamicDistanceFieldTest, ChangeSetsMatchFullTransform) {
+    VoxelGrid grid = make_grid();
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> coord(0, 1 << 20);
+    auto random_position = [&]() {
+        const Eigen::Vector3i& dims = grid.dimensions();
+        return Eigen::Vector3i(coord(rng) % dims.x(), coord(rng) % dims.y(), coord(rng) % dims.z());
+    };
+    for (int i = 0; i < 40; ++i) grid.set(random_position(), true);
+
+    for (float max_distance : {DistanceField::kInfinity, 2.0f}) {
+        VoxelGrid current(grid);
+        DynamicDistanceField field(current, max_distance);
+        expect_consistent(field, current, max_distance);
+
+        for (int round = 0; round < 10; ++round) {
+            std::vector<Eigen::Vector3i> occupied, freed;
+            const Eigen::Vector3i& dims = current.dimensions();
+            for (int z = 0; z < dims.z() && freed.size() < 4; ++z) {
+                for (int y = 0; y < dims.y() && freed.size() < 4; ++y) {
+                    for (int x = 0; x < dims.x() && freed.size() < 4; ++x) {
+                        if (current.get(x, y, z) && coord(rng) % 3 == 0) {
+                            current.set(x, y, z, false);
+                            freed.emplace_back(x, y, z);
+                        }
+                    }
+                }
+            }
+            for (int i = 0; i < 5; ++i) {
+                const Eigen::Vector3i p = random_position();
+                if (current.get(p)) continue;
+                current.set(p, true);
+                occupied.push_back(p);
+            }
+            field.update(occupied, freed);
+            expect_consistent(field, current, max_distance);
+        }
+    }
+}
+
+TEST(DynamicDistanceFieldTest, UpdateFromGridIsLocal) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(63.5f));
+    grid.set(10, 10, 10, true);
+    grid.set(50, 50, 50, true);
+    DynamicDistanceField field(grid, 3.0f);
+    EXPECT_FLOAT_EQ(field.get(12, 10, 10), 2.0f);
+    EXPECT_EQ(field.get(30, 30, 30), DistanceField::kInfinity);
+
+    // Moving one obstacle only touches its neighbourhood
+    grid.set(10, 10, 10, false);
+    grid.set(11, 10, 10, true);
+    const size_t processed = field.update(grid);
+    EXPECT_LT(processed, 64u * 64u * 64u / 100u);
+    EXPECT_FLOAT_EQ(field.get(12, 10, 10), 1.0f);
+    EXPECT_EQ(field.nearest(Eigen::Vector3i(12, 10, 10)), Eigen::Vector3i(11, 10, 10));
+    EXPECT_FLOAT_EQ(field.get(52, 50, 50), 2.0f);
+    expect_consistent(field, grid, 3.0f);
+
+    EXPECT_THROW(field.set_occupied(Eigen::Vector3i(64, 0, 0)), std::out_of_range);
+    EXPECT_THROW(field.update(VoxelGrid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(9.5f))),
+                 std::invalid_argument);
+}
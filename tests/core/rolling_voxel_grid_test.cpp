@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <core/rolling_voxel_grid.hpp>
+#include <random>
+
+using namespace VXZ;
+
+namespace {
+
+// Compare the window with voxels given by global index (window offset + position)
+void expect_window(const RollingVoxelGrid& rolling, const std::vector<Eigen::Vector3i>& occupied) {
+    const Eigen::Vector3i dims = rolling.dimensions();
+    VoxelGrid expected(rolling.resolution(), Eigen::Vector3f::Zero(), (dims.cast<float>().array() - 0.5f).matrix());
+    for (const Eigen::Vector3i& g : occupied) {
+        const Eigen::Vector3i p = g - rolling.offset();
+        if (expected.is_valid_position(p)) expected.set(p, true);
+    }
+    for (int z = 0; z < dims.z(); ++z)
+        for (int y = 0; y < dims.y(); ++y)
+            for (int x = 0; x < dims.x(); ++x)
+                ASSERT_EQ(rolling.get(x, y, z), expected.get(x, y, z)) << x << " " << y << " " << z;
+}
+
+} // namespace
+
+TEST(RollingVoxelGridTest, ScrollKeepsWorldAnchoredVoxels) {
+    RollingVoxelGrid rolling(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(69.0f, 40.0f, 23.0f));
+    ASSERT_EQ(rolling.dimensions(), Eigen::Vector3i(70, 41, 24));
+
+    std::vector<Eigen::Vector3i> occupied;
+    std::mt19937 rng(9);
+    const std::vector<Eigen::Vector3i> moves = {
+        {3, 0, 0}, {0, -5, 2}, {-7, 4, -1}, {65, 1, 0}, {0, 0, 0}, {1, 1, 1}, {-69, -40, -23}, {2, 30, -20}};
+    for (const Eigen::Vector3i& move : moves) {
+        for (int i = 0; i < 300; ++i) {
+            const Eigen::Vector3i p(rng() % 70, rng() % 41, rng() % 24);
+            rolling.set(p, true);
+            occupied.push_back(p + rolling.offset());
+        }
+        rolling.set_region(Eigen::Vector3i(60, 2, 3), Eigen::Vector3i(69, 38, 5));
+        for (int z = 3; z <= 5; ++z)
+            for (int y = 2; y <= 38; ++y)
+                for (int x = 60; x <= 69; ++x) occupied.push_back(Eigen::Vector3i(x, y, z) + rolling.offset());
+
+        rolling.scroll(move);
+        // Voxels that left the window are gone for good
+        std::vector<Eigen::Vector3i> kept;
+        for (const Eigen::Vector3i& g : occupied) {
+            if (rolling.is_valid_position(g - rolling.offset())) kept.push_back(g);
+        }
+        occupied.swap(kept);
+        SCOPED_TRACE(move.transpose());
+        expect_window(rolling, occupied);
+    }
+
+    // Large jumps clear the window
+    rolling.scroll(Eigen::Vector3i(0, 0, 24));
+    EXPECT_EQ(rolling.count_occupied(), 0u);
+    EXPECT_THROW(rolling.get(70, 0, 0), std::out_of_range);
+}
+
+TEST(RollingVoxelGridTest, CoordinatesFollowTheWindow) {
+    RollingVoxelGrid rolling(0.5f, Eigen::Vector3f(-10.0f, -10.0f, 0.0f), Eigen::Vector3f(9.5f, 9.5f, 4.5f));
+    const Eigen::Vector3f point(1.2f, -3.7f, 2.2f);
+    const Eigen::Vector3i before = rolling.world_to_grid(point);
+    rolling.set(before, true);
+
+    rolling.scroll(Eigen::Vector3i(4, -2, 1));
+    EXPECT_TRUE(rolling.min_bounds().isApprox(Eigen::Vector3f(-8.0f, -11.0f, 0.5f)));
+    const Eigen::Vector3i after = rolling.world_to_grid(point);
+    EXPECT_EQ(after, before - Eigen::Vector3i(4, -2, 1));
+    EXPECT_TRUE(rolling.get(after));
+    EXPECT_TRUE(rolling.grid_to_world(after).isApprox(rolling.min_bounds() + after.cast<float>() * 0.5f));
+
+    // Recentering puts the point in the middle voxel
+    rolling.recenter(point);
+    EXPECT_EQ(rolling.world_to_grid(point), rolling.dimensions() / 2);
+    EXPECT_TRUE(rolling.get(rolling.dimensions() / 2));
+
+    const VoxelGrid copy = rolling.to_voxel_grid();
+    EXPECT_EQ(copy.dimensions(), rolling.dimensions());
+    EXPECT_TRUE(copy.min_bounds().isApprox(rolling.min_bounds()));
+    EXPECT_EQ(copy.count_occupied(), 1u);
+    EXPECT_TRUE(copy.get(rolling.dimensions().x() / 2, rolling.dimensions().y() / 2, rolling.dimensions().z() / 2));
+    EXPECT_TRUE(rolling.storage().get(rolling.storage_position(rolling.dimensions() / 2)));
+}
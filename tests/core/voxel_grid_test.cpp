@@ -80,4 +80,23 @@ TEST_F(VoxelGridTest, ValidationTest) {
     EXPECT_FALSE(grid->is_valid_position(Eigen::Vector3i(0, 10, 0)));
     EXPECT_FALSE(grid->is_valid_position(Eigen::Vector3i(0, 0, -1)));
     EXPECT_FALSE(grid->is_valid_position(Eigen::Vector3i(0, 0, 10)));
-} 
\ No newline at end of file
+} 
+
+TEST_F(VoxelGridTest, SpanAndFillTest) {
+    VoxelGrid wide(1.0f, Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(129.0f, 2.0f, 2.0f));
+    wide.set_span(1, 1, 60, 70);
+    wide.set_span(1, 1, -5, 2);
+    wide.set_span(0, 1, 125, 500);
+    EXPECT_EQ(wide.count_occupied(), 10u + 2u + 5u);
+    EXPECT_TRUE(wide.get(69, 1, 1));
+    EXPECT_FALSE(wide.get(70, 1, 1));
+    EXPECT_TRUE(wide.get(129, 0, 1));
+
+    wide.set_span(1, 1, 62, 64, false);
+    EXPECT_FALSE(wide.get(63, 1, 1));
+    EXPECT_TRUE(wide.get(64, 1, 1));
+
+    // Padding bits past the end of each row stay clear
+    wide.fill(true);
+    EXPECT_EQ(wide.count_occupied(), static_cast<size_t>(wide.dimensions().prod()));
+}
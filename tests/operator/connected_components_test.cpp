@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/connected_components_operator.hpp>
+#include <map>
+#include <queue>
+#include <random>
+
+using namespace VXZ;
+
+namespace {
+
+// Breadth-first labeling straight from the definition
+std::vector<int> reference_labels(const VoxelGrid& grid, int connectivity) {
+    const Eigen::Vector3i& dims = grid.dimensions();
+    auto index = [&](const Eigen::Vector3i& p) { return (p.z() * dims.y() + p.y()) * dims.x() + p.x(); };
+    std::vector<int> labels(static_cast<size_t>(dims.prod()), 0);
+    int next = 0;
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                const Eigen::Vector3i start(x, y, z);
+                if (!grid.get(start) || labels[index(start)]) continue;
+                labels[index(start)] = ++next;
+                std::queue<Eigen::Vector3i> open;
+                open.push(start);
+                while (!open.empty()) {
+                    const Eigen::Vector3i p = open.front();
+                    open.pop();
+                    for (int dz = -1; dz <= 1; ++dz) {
+                        for (int dy = -1; dy <= 1; ++dy) {
+                            for (int dx = -1; dx <= 1; ++dx) {
+                                const int order = std::abs(dx) + std::abs(dy) + std::abs(dz);
+                                if (order == 0 || (connectivity == 6 && order > 1) || (connectivity == 18 && order > 2)) continue;
+                                const Eigen::Vector3i q = p + Eigen::Vector3i(dx, dy, dz);
+                                if (!grid.is_valid_position(q) || !grid.get(q) || labels[index(q)]) continue;
+                                labels[index(q)] = next;
+                                open.push(q);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return labels;
+}
+
+} // namespace
+
+TEST(ConnectedComponentsTest, MatchesFloodFill) {
+    // Rows across word boundaries and several bricks in z
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(129.5f, 20.5f, 30.5f));
+    std::mt19937 rng(17);
+    std::bernoulli_distribution occupied(0.25);
+    const Eigen::Vector3i& dims = grid.dimensions();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                grid.set(x, y, z, occupied(rng));
+            }
+        }
+    }
+
+    for (Connectivity connectivity : {Connectivity::SIX, Connectivity::EIGHTEEN, Connectivity::TWENTY_SIX}) {
+        SCOPED_TRACE(static_cast<int>(connectivity));
+        const ConnectedComponents components = ConnectedComponentsOperator(connectivity).apply(grid);
+        const std::vector<int> expected = reference_labels(grid, static_cast<int>(connectivity));
+        // Both number components by first voxel, so labels agree exactly
+        ASSERT_EQ(components.labels.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(components.labels[i], expected[i]) << i;
+        }
+
+        std::map<int, size_t> counts;
+        for (int label : expected) {
+            if (label) ++counts[label];
+        }
+        ASSERT_EQ(components.count(), counts.size());
+        for (const auto& entry : counts) {
+            EXPECT_EQ(components.components[entry.first - 1].voxel_count, entry.second);
+        }
+    }
+}
+
+TEST(ConnectedComponentsTest, ConnectivityAndStats) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(15.5f));
+    grid.set_region(Eigen::Vector3i(1, 1, 1), Eigen::Vector3i(3, 4, 5), true);
+    // Touches the block along an edge only
+    grid.set(4, 5, 3, true);
+    // Touches that voxel at a corner only
+    grid.set(5, 6, 4, true);
+
+    const ConnectedComponents six = ConnectedComponentsOperator(Connectivity::SIX).apply(grid);
+    EXPECT_EQ(six.count(), 3u);
+    EXPECT_EQ(six.components[0].voxel_count, 3u * 4u * 5u);
+    EXPECT_EQ(six.components[0].min, Eigen::Vector3i(1, 1, 1));
+    EXPECT_EQ(six.components[0].max, Eigen::Vector3i(3, 4, 5));
+    EXPECT_EQ(six.label(0, 0, 0), 0);
+    EXPECT_EQ(six.label(2, 2, 2), 1);
+
+    EXPECT_EQ(ConnectedComponentsOperator(Connectivity::EIGHTEEN).apply(grid).count(), 2u);
+    const ConnectedComponents all = ConnectedComponentsOperator().apply(grid);
+    EXPECT_EQ(all.count(), 1u);
+    EXPECT_EQ(all.components[0].max, Eigen::Vector3i(5, 6, 5));
+    EXPECT_EQ(all.label(5, 6, 4), 1);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/distance_transform_operator.hpp>
+#include <cmath>
+#include <random>
+
+using namespace VXZ;
+
+namespace {
+
+// Distance to the nearest voxel with the given value, straight from the definition
+float brute_force_distance(const VoxelGrid& grid, const Eigen::Vector3i& p, bool value) {
+    const Eigen::Vector3i& dims = grid.dimensions();
+    int best = -1;
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                if (grid.get(x, y, z) != value) continue;
+                const int d = (Eigen::Vector3i(x, y, z) - p).squaredNorm();
+                if (best < 0 || d < best) best = d;
+            }
+        }
+    }
+    return best < 0 ? DistanceField::kInfinity : std::sqrt(static_cast<float>(best)) * grid.resolution();
+}
+
+} // namespace
+
+TEST(DistanceTransformTest, MatchesBruteForce) {
+    VoxelGrid grid(0.5f, Eigen::Vector3f(1, 2, 3), Eigen::Vector3f(1 + 0.5f * 22.5f, 2 + 0.5f * 16.5f, 3 + 0.5f * 12.5f));
+    std::mt19937 rng(3);
+    std::bernoulli_distribution occupied(0.03);
+    const Eigen::Vector3i& dims = grid.dimensions();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                grid.set(x, y, z, occupied(rng));
+            }
+        }
+    }
+
+    const DistanceField unsigned_field = DistanceTransformOperator(false, true).apply(grid);
+    const DistanceField signed_field = DistanceTransformOperator(true, true).apply(grid);
+    ASSERT_EQ(unsigned_field.dimensions(), dims);
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                const Eigen::Vector3i p(x, y, z);
+                const float outside = brute_force_distance(grid, p, true);
+                EXPECT_NEAR(unsigned_field.get(p), outside, 1e-4f);
+
+                // The nearest voxel is occupied and at the reported distance
+                const Eigen::Vector3i nearest = unsigned_field.nearest(p);
+                ASSERT_TRUE(grid.get(nearest));
+                EXPECT_NEAR((nearest - p).cast<float>().norm() * grid.resolution(), outside, 1e-4f);
+
+                if (grid.get(p)) {
+                    EXPECT_NEAR(signed_field.get(p), -brute_force_distance(grid, p, false), 1e-4f);
+                    EXPECT_FALSE(grid.get(signed_field.nearest(p)));
+                } else {
+                    EXPECT_NEAR(signed_field.get(p), outside, 1e-4f);
+                }
+            }
+        }
+    }
+
+    const Eigen::Vector3f centre = grid.grid_to_world(Eigen::Vector3i(4, 5, 6)) + Eigen::Vector3f::Constant(0.25f);
+    EXPECT_EQ(unsigned_field.distance_at(centre), unsigned_field.get(4, 5, 6));
+    EXPECT_THROW(unsigned_field.distance_at(Eigen::Vector3f::Zero()), std::out_of_range);
+}
+
+TEST(DistanceTransformTest, EmptyAndSingleVoxel) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(99.5f));
+    const DistanceField empty = DistanceTransformOperator().apply(grid);
+    EXPECT_EQ(empty.get(50, 50, 50), DistanceField::kInfinity);
+    EXPECT_FALSE(empty.has_nearest());
+    EXPECT_EQ(empty.nearest(Eigen::Vector3i(1, 2, 3)), Eigen::Vector3i::Constant(-1));
+
+    grid.set(10, 20, 30, true);
+    const DistanceField field = DistanceTransformOperator().apply(grid);
+    EXPECT_EQ(field.get(10, 20, 30), 0.0f);
+    EXPECT_FLOAT_EQ(field.get(13, 24, 30), 5.0f);
+    EXPECT_FLOAT_EQ(field.get(99, 99, 99), std::sqrt(89.0f * 89.0f + 79.0f * 79.0f + 69.0f * 69.0f));
+}
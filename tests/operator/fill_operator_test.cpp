@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/fill_operator.hpp>
+#include "operator_test_helpers.hpp"
+#include <queue>
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+namespace {
+
+// Empty voxels face-connected to the starts, by breadth-first search
+VoxelGrid reference_reachable(const VoxelGrid& grid, const std::vector<Eigen::Vector3i>& starts) {
+    VoxelGrid reached(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+    std::queue<Eigen::Vector3i> open;
+    for (const Eigen::Vector3i& s : starts) {
+        if (grid.is_valid_position(s) && !grid.get(s) && !reached.get(s)) {
+            reached.set(s, true);
+            open.push(s);
+        }
+    }
+    const Eigen::Vector3i steps[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    while (!open.empty()) {
+        const Eigen::Vector3i p = open.front();
+        open.pop();
+        for (const Eigen::Vector3i& step : steps) {
+            const Eigen::Vector3i q = p + step;
+            if (!grid.is_valid_position(q) || grid.get(q) || reached.get(q)) continue;
+            reached.set(q, true);
+            open.push(q);
+        }
+    }
+    return reached;
+}
+
+std::vector<Eigen::Vector3i> border(const Eigen::Vector3i& dims) {
+    std::vector<Eigen::Vector3i> voxels;
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                if (x == 0 || y == 0 || z == 0 || x == dims.x() - 1 || y == dims.y() - 1 || z == dims.z() - 1) {
+                    voxels.emplace_back(x, y, z);
+                }
+            }
+        }
+    }
+    return voxels;
+}
+
+} // namespace
+
+TEST(FillOperatorTest, ReachableMatchesBreadthFirstSearch) {
+    // Rows across word boundaries and several bricks in y and z; the density
+    // leaves long winding paths through the empty voxels
+    const VoxelGrid grid = test::random_grid(Eigen::Vector3i(100, 41, 36), 0.6, 5);
+    const Eigen::Vector3i& dims = grid.dimensions();
+
+    expect_same(reference_reachable(grid, border(dims)), FillOperator().reachable(grid));
+
+    const std::vector<Eigen::Vector3i> seeds = {{50, 20, 17}, {3, 38, 30}, {98, 0, 34}, {-1, 2, 2}};
+    expect_same(reference_reachable(grid, seeds), FillOperator(seeds).reachable(grid));
+}
+
+TEST(FillOperatorTest, SolidifiesClosedShell) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(69.5f, 39.5f, 39.5f));
+    // Hollow box [10, 60) x [5, 35) x [5, 35) with a closed cavity wall inside
+    for (int z = 5; z < 35; ++z) {
+        for (int y = 5; y < 35; ++y) {
+            const bool face = z == 5 || z == 34 || y == 5 || y == 34;
+            if (face) {
+                grid.set_span(y, z, 10, 60);
+            } else {
+                grid.set_span(y, z, 10, 11);
+                grid.set_span(y, z, 59, 60);
+            }
+        }
+    }
+    VoxelGrid original = grid;
+
+    ASSERT_TRUE(FillOperator().apply(grid));
+    const Eigen::Vector3i& dims = grid.dimensions();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                const bool inside = x >= 10 && x < 60 && y >= 5 && y < 35 && z >= 5 && z < 35;
+                ASSERT_EQ(grid.get(x, y, z), inside) << x << " " << y << " " << z;
+            }
+        }
+    }
+
+    // A hole in the shell lets the outside in, so nothing is added
+    original.set(Eigen::Vector3i(59, 20, 20), false);
+    VoxelGrid open_shell = original;
+    FillOperator().apply(open_shell);
+    expect_same(original, open_shell);
+
+    // Seeded fill adds only the region of the seed
+    VoxelGrid seeded = original;
+    FillOperator({Eigen::Vector3i(0, 0, 0)}).apply(seeded);
+    for (int x = 0; x < dims.x(); ++x) {
+        EXPECT_TRUE(seeded.get(x, 20, 20));
+    }
+}
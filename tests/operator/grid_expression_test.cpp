@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/grid_expression.hpp>
+#include <operator/union_operator.hpp>
+#include <operator/intersection_operator.hpp>
+#include <operator/difference_operator.hpp>
+#include <operator/xor_operator.hpp>
+#include <operator/not_operator.hpp>
+#include <operator/morphology.hpp>
+#include "operator_test_helpers.hpp"
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+TEST(GridExpressionTest, MatchesChainedOperators) {
+    // Wide rows so that offsets cross word boundaries
+    const VoxelGrid a = test::random_grid(Eigen::Vector3i::Constant(70), 0.4, 1, Eigen::Vector3f(0, 0, 0));
+    const VoxelGrid b = test::random_grid(Eigen::Vector3i::Constant(70), 0.4, 2, Eigen::Vector3f(5, -3, 2));
+    const VoxelGrid c = test::random_grid(Eigen::Vector3i::Constant(70), 0.4, 3, Eigen::Vector3f(-66, 4, -1));
+    const VoxelGrid d = test::random_grid(Eigen::Vector3i::Constant(40), 0.4, 4, Eigen::Vector3f(1, 1, 1));
+
+    UnionOperator union_op;
+    IntersectionOperator intersection_op;
+    DifferenceOperator difference_op;
+    XorOperator xor_op;
+
+    // ((a | b) & ~c) - (d ^ b)
+    auto expected = union_op.apply(a, b);
+    // ~c over a's extent; outside c the complement is occupied
+    VoxelGrid full(a);
+    full.fill(true);
+    auto not_c = difference_op.apply(full, c);
+    intersection_op.apply_in_place(*expected, *not_c);
+    // d ^ b over a's extent, where b also counts outside d
+    VoxelGrid empty(a);
+    empty.clear();
+    auto db = union_op.apply(empty, d);
+    xor_op.apply_in_place(*db, b);
+    difference_op.apply_in_place(*expected, *db);
+
+    const GridExpression expression = ((GridExpression(a) | b) & ~GridExpression(c)) - (GridExpression(d) ^ b);
+    EXPECT_EQ(expression.leaf_count(), 5u);
+    auto result = expression.evaluate();
+    expect_same(*expected, *result);
+
+    // Lists of layers
+    auto expected_union = union_op.apply(a, b);
+    union_op.apply_in_place(*expected_union, c);
+    union_op.apply_in_place(*expected_union, d);
+    expect_same(*expected_union, *GridExpression::union_of({a, b, c, d}).evaluate());
+
+    auto expected_intersection = intersection_op.apply(a, b);
+    intersection_op.apply_in_place(*expected_intersection, d);
+    expect_same(*expected_intersection, *GridExpression::intersection_of({a, b, d}).evaluate());
+}
+
+TEST(GridExpressionTest, EvaluateIntoAliasedGrid) {
+    VoxelGrid a = test::random_grid(Eigen::Vector3i::Constant(30), 0.4, 5, Eigen::Vector3f(0, 0, 0));
+    const VoxelGrid b = test::random_grid(Eigen::Vector3i::Constant(30), 0.4, 6, Eigen::Vector3f(3, 2, 1));
+
+    XorOperator xor_op;
+    auto expected = xor_op.apply(a, b);
+    NotOperator().apply(*expected);
+
+    (~(GridExpression(a) ^ b)).evaluate_into(a);
+    expect_same(*expected, a);
+
+    VoxelGrid misaligned(0.5f, Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(10, 10, 10));
+    EXPECT_THROW((GridExpression(a) | misaligned).evaluate(), std::invalid_argument);
+    EXPECT_THROW(GridExpression::union_of({}), std::invalid_argument);
+}
+
+TEST(GridExpressionTest, StencilsMatchMorphology) {
+    // Several bricks along y and z, and grids offset from the result
+    const VoxelGrid a = test::random_grid(Eigen::Vector3i::Constant(70), 0.4, 7, Eigen::Vector3f(0, 0, 0));
+    const VoxelGrid b = test::random_grid(Eigen::Vector3i::Constant(70), 0.4, 8, Eigen::Vector3f(-4, 3, 6));
+    const VoxelGrid c = test::random_grid(Eigen::Vector3i::Constant(50), 0.4, 9, Eigen::Vector3f(10, -7, 2));
+
+    UnionOperator union_op;
+    IntersectionOperator intersection_op;
+    VoxelGrid empty(a);
+    empty.clear();
+
+    // ((a dilated & ~b) eroded) | (c dilated), each over a's extent
+    VoxelGrid dilated_a(a);
+    dilate(dilated_a, StructuringElement::BOX, 2);
+    VoxelGrid full(a);
+    full.fill(true);
+    auto expected = DifferenceOperator().apply(full, b);
+    intersection_op.apply_in_place(*expected, dilated_a);
+    erode(*expected, StructuringElement::SPHERE, 1);
+    auto dilated_c = union_op.apply(empty, c);
+    dilate(*dilated_c, StructuringElement::CROSS, 3);
+    union_op.apply_in_place(*expected, *dilated_c);
+
+    const GridExpression expression =
+        (GridExpression(a).dilated(StructuringElement::BOX, 2) & ~GridExpression(b)).eroded(StructuringElement::SPHERE, 1) |
+        GridExpression(c).dilated(StructuringElement::CROSS, 3);
+    EXPECT_EQ(expression.leaf_count(), 3u);
+    expect_same(*expected, *expression.evaluate());
+
+    // In place, where bricks read rows other bricks write
+    VoxelGrid in_place(a);
+    auto expected_shell = DifferenceOperator().apply(dilated_a, a);
+    (GridExpression(in_place).dilated(StructuringElement::BOX, 2) - in_place).evaluate_into(in_place);
+    expect_same(*expected_shell, in_place);
+
+    EXPECT_THROW(GridExpression(a).eroded(StructuringElement::BOX, -1), std::invalid_argument);
+}
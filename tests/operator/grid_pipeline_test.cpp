@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/grid_pipeline.hpp>
+#include <operator/dilate_operator.hpp>
+#include <operator/erode_operator.hpp>
+#include <operator/closing_operator.hpp>
+#include <operator/not_operator.hpp>
+#include <operator/fill_operator.hpp>
+#include <operator/opening_operator.hpp>
+#include <operator/smooth_operator.hpp>
+#include "operator_test_helpers.hpp"
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+TEST(GridPipelineTest, FusedStagesMatchSequentialPasses) {
+    std::vector<std::shared_ptr<const GridOperator>> ops = {
+        std::make_shared<DilateOperator>(1, StructuringElement::SPHERE),
+        std::make_shared<ClosingOperator>(2),
+        std::make_shared<SmoothOperator>(1),
+        std::make_shared<ErodeOperator>(1, StructuringElement::CROSS),
+        std::make_shared<NotOperator>(),
+    };
+    // Small tiles, so that the grid splits into many bricks
+    GridPipeline pipeline(4 * 1024);
+    for (const auto& op : ops) {
+        pipeline.add(op);
+    }
+    ASSERT_EQ(pipeline.segments().size(), 1u);
+
+    VoxelGrid expected = test::random_grid(Eigen::Vector3i(100, 61, 46), 0.08, 9);
+    VoxelGrid grid = expected;
+    for (const auto& op : ops) {
+        op->apply(expected);
+    }
+    ASSERT_TRUE(pipeline.run(grid));
+    expect_same(expected, grid);
+
+    ASSERT_EQ(pipeline.timings().size(), ops.size());
+    for (const auto& timing : pipeline.timings()) {
+        EXPECT_TRUE(timing.fused);
+        EXPECT_GE(timing.seconds, 0.0);
+    }
+    EXPECT_EQ(pipeline.timings()[2].name, "stage 2");
+}
+
+TEST(GridPipelineTest, UnboundedStagesSplitSegments) {
+    GridPipeline pipeline(8 * 1024);
+    pipeline.add(std::make_shared<DilateOperator>(2), "dilate")
+            .add(std::make_shared<FillOperator>(), "fill")
+            .add(std::make_shared<ErodeOperator>(1), "erode")
+            .add(std::make_shared<OpeningOperator>(1), "open");
+    const std::vector<std::pair<size_t, size_t>> segments = pipeline.segments();
+    ASSERT_EQ(segments.size(), 3u);
+    EXPECT_EQ(segments[0], std::make_pair(size_t(0), size_t(1)));
+    EXPECT_EQ(segments[1], std::make_pair(size_t(1), size_t(2)));
+    EXPECT_EQ(segments[2], std::make_pair(size_t(2), size_t(4)));
+
+    VoxelGrid expected = test::random_grid(Eigen::Vector3i(100, 61, 46), 0.02, 4);
+    VoxelGrid grid = expected;
+    DilateOperator(2).apply(expected);
+    FillOperator().apply(expected);
+    ErodeOperator(1).apply(expected);
+    OpeningOperator(1).apply(expected);
+    ASSERT_TRUE(pipeline.run(grid));
+    expect_same(expected, grid);
+    EXPECT_EQ(pipeline.timings()[1].name, "fill");
+    EXPECT_FALSE(pipeline.timings()[1].fused);
+    EXPECT_TRUE(pipeline.timings()[3].fused);
+
+    EXPECT_THROW(pipeline.add(nullptr), std::invalid_argument);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/interpolation_operator.hpp>
+#include <random>
+
+using namespace VXZ;
+
+namespace {
+
+// Exactly n voxels per axis at the given resolution
+VoxelGrid make_grid(float resolution, const Eigen::Vector3i& n) {
+    return VoxelGrid(resolution, Eigen::Vector3f::Zero(), (n.cast<float>().array() - 0.5f).matrix() * resolution);
+}
+
+} // namespace
+
+TEST(InterpolationOperatorTest, MajorityDownsampling) {
+    // 5 cm to 20 cm: every coarse voxel covers 4x4x4 fine voxels
+    VoxelGrid fine = make_grid(0.05f, Eigen::Vector3i(80, 40, 24));
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> density(0.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int bz = 0; bz < 6; ++bz) {
+        for (int by = 0; by < 10; ++by) {
+            for (int bx = 0; bx < 20; ++bx) {
+                const float p = density(rng);
+                for (int i = 0; i < 64; ++i) {
+                    fine.set(4 * bx + i % 4, 4 * by + i / 4 % 4, 4 * bz + i / 16, unit(rng) < p);
+                }
+            }
+        }
+    }
+
+    const VoxelGrid coarse = InterpolationOperator(0.2f, InterpolationMode::MAJORITY).resample(fine);
+    ASSERT_EQ(coarse.dimensions(), Eigen::Vector3i(20, 10, 6));
+    for (int bz = 0; bz < 6; ++bz) {
+        for (int by = 0; by < 10; ++by) {
+            for (int bx = 0; bx < 20; ++bx) {
+                int count = 0;
+                for (int i = 0; i < 64; ++i) {
+                    count += fine.get(4 * bx + i % 4, 4 * by + i / 4 % 4, 4 * bz + i / 16);
+                }
+                ASSERT_EQ(coarse.get(bx, by, bz), count >= 32) << bx << " " << by << " " << bz;
+            }
+        }
+    }
+
+    // Nearest upsampling back gives every fine voxel its coarse parent
+    const VoxelGrid back = InterpolationOperator(0.05f).resample(coarse);
+    for (int z = 0; z < 24; ++z) {
+        for (int y = 0; y < 40; ++y) {
+            for (int x = 0; x < 80; ++x) {
+                ASSERT_EQ(back.get(x, y, z), coarse.get(x / 4, y / 4, z / 4));
+            }
+        }
+    }
+}
+
+TEST(InterpolationOperatorTest, AffineTransform) {
+    VoxelGrid source = make_grid(0.1f, Eigen::Vector3i(70, 30, 10));
+    std::mt19937 rng(3);
+    std::bernoulli_distribution occupied(0.3);
+    for (int z = 0; z < 10; ++z) {
+        for (int y = 0; y < 30; ++y) {
+            for (int x = 0; x < 70; ++x) {
+                source.set(x, y, z, occupied(rng));
+            }
+        }
+    }
+
+    // Quarter turn about z, then a shift by whole voxels
+    Eigen::Affine3f transform = Eigen::Translation3f(3.0f, 0.2f, 0.0f) * Eigen::AngleAxisf(static_cast<float>(M_PI / 2), Eigen::Vector3f::UnitZ());
+    const InterpolationOperator op(0.1f, Eigen::Vector3f::Zero(), Eigen::Vector3f(3.95f, 7.45f, 0.95f), transform);
+    const VoxelGrid target = op.resample(source);
+    ASSERT_EQ(target.dimensions(), Eigen::Vector3i(40, 75, 10));
+    for (int z = 0; z < 10; ++z) {
+        for (int y = 0; y < 75; ++y) {
+            for (int x = 0; x < 40; ++x) {
+                // Source voxel under target voxel (x, y, z), if any
+                const int sx = y - 2;
+                const int sy = 29 - x;
+                const bool expected = sx >= 0 && sx < 70 && sy >= 0 && source.get(sx, sy, z);
+                ASSERT_EQ(target.get(x, y, z), expected) << x << " " << y << " " << z;
+            }
+        }
+    }
+    EXPECT_TRUE(op.transform().isApprox(transform));
+
+    EXPECT_THROW(InterpolationOperator(0.0f), std::invalid_argument);
+    EXPECT_THROW(InterpolationOperator(0.1f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones(),
+                                       Eigen::Affine3f(Eigen::Scaling(1.0f, 0.0f, 1.0f))),
+                 std::invalid_argument);
+}
+
+TEST(InterpolationOperatorTest, FloatChannels) {
+    // A linear field is reproduced exactly by both interpolations
+    DistanceField source(0.2f, Eigen::Vector3f::Zero(), Eigen::Vector3i(20, 20, 20));
+    auto linear = [](const Eigen::Vector3f& p) { return 0.5f + 2.0f * p.x() - p.y() + 0.25f * p.z(); };
+    for (int z = 0; z < 20; ++z) {
+        for (int y = 0; y < 20; ++y) {
+            for (int x = 0; x < 20; ++x) {
+                source.set(x, y, z, linear((Eigen::Vector3f(x, y, z) + Eigen::Vector3f::Constant(0.5f)) * 0.2f));
+            }
+        }
+    }
+    for (InterpolationMode mode : {InterpolationMode::TRILINEAR, InterpolationMode::TRICUBIC}) {
+        const InterpolationOperator op(0.05f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(3.95f), Eigen::Affine3f::Identity(), mode);
+        const DistanceField target = op.resample(source);
+        ASSERT_EQ(target.dimensions(), Eigen::Vector3i(80, 80, 80));
+        // Away from the clamped border
+        for (int z = 8; z < 72; z += 3) {
+            for (int y = 8; y < 72; y += 3) {
+                for (int x = 8; x < 72; x += 3) {
+                    const Eigen::Vector3f p = (Eigen::Vector3f(x, y, z) + Eigen::Vector3f::Constant(0.5f)) * 0.05f;
+                    ASSERT_NEAR(target.get(x, y, z), linear(p), 1e-4f);
+                }
+            }
+        }
+    }
+
+    // Non-finite neighbours fall back to the nearest value; outside takes the outside value
+    source.set(10, 10, 10, DistanceField::kInfinity);
+    const InterpolationOperator op(0.2f, Eigen::Vector3f(0.1f, 0.0f, 0.0f), Eigen::Vector3f(5.05f, 3.95f, 3.95f),
+                                   Eigen::Affine3f::Identity(), InterpolationMode::TRILINEAR);
+    const DistanceField shifted = op.resample(source, -1.0f);
+    EXPECT_EQ(shifted.get(9, 10, 10), source.get(10, 10, 10));
+    EXPECT_FLOAT_EQ(shifted.get(3, 3, 3), 0.5f * (source.get(3, 3, 3) + source.get(4, 3, 3)));
+    EXPECT_EQ(shifted.get(20, 3, 3), -1.0f);
+}
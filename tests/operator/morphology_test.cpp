@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/dilate_operator.hpp>
+#include <operator/erode_operator.hpp>
+#include <operator/not_operator.hpp>
+#include <operator/opening_operator.hpp>
+#include <operator/closing_operator.hpp>
+#include <operator/offset_operator.hpp>
+#include "operator_test_helpers.hpp"
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+namespace {
+
+bool in_element(const Eigen::Vector3i& d, StructuringElement element, int radius) {
+    for (const Eigen::Vector3i& box : structuring_boxes(element, radius)) {
+        if ((d.cwiseAbs().array() <= box.array()).all()) return true;
+    }
+    return false;
+}
+
+// Dilation straight from the definition
+VoxelGrid brute_force_dilate(const VoxelGrid& grid, StructuringElement element, int radius) {
+    std::vector<Eigen::Vector3i> offsets;
+    for (int dz = -radius; dz <= radius; ++dz) {
+        for (int dy = -radius; dy <= radius; ++dy) {
+            for (int dx = -radius; dx <= radius; ++dx) {
+                if (in_element(Eigen::Vector3i(dx, dy, dz), element, radius)) {
+                    offsets.emplace_back(dx, dy, dz);
+                }
+            }
+        }
+    }
+    VoxelGrid result(grid);
+    result.clear();
+    const Eigen::Vector3i& dims = grid.dimensions();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                if (!grid.get(x, y, z)) continue;
+                for (const Eigen::Vector3i& offset : offsets) {
+                    const Eigen::Vector3i p = Eigen::Vector3i(x, y, z) + offset;
+                    if (grid.is_valid_position(p)) {
+                        result.set(p, true);
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(MorphologyTest, StructuringElements) {
+    EXPECT_EQ(structuring_boxes(StructuringElement::BOX, 3).size(), 1u);
+    EXPECT_EQ(structuring_boxes(StructuringElement::CROSS, 3).size(), 3u);
+    EXPECT_THROW(structuring_boxes(StructuringElement::BOX, -1), std::invalid_argument);
+    EXPECT_THROW(DilateOperator(-1), std::invalid_argument);
+
+    // The sphere lies in the ball, contains the cross and is exact for small radii
+    for (int radius = 0; radius <= 6; ++radius) {
+        for (int z = -radius; z <= radius; ++z) {
+            for (int y = -radius; y <= radius; ++y) {
+                for (int x = -radius; x <= radius; ++x) {
+                    const Eigen::Vector3i d(x, y, z);
+                    const bool sphere = in_element(d, StructuringElement::SPHERE, radius);
+                    if (sphere) {
+                        EXPECT_LE(d.squaredNorm(), radius * radius);
+                    }
+                    if (in_element(d, StructuringElement::CROSS, radius)) {
+                        EXPECT_TRUE(sphere);
+                    }
+                    if (radius <= 2) {
+                        EXPECT_EQ(sphere, d.squaredNorm() <= radius * radius);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(MorphologyTest, DilateMatchesDefinition) {
+    // Rows longer than a word so the x pass crosses word boundaries
+    const VoxelGrid grid = test::random_grid(Eigen::Vector3i(140, 13, 11), 0.01, 7);
+    for (StructuringElement element : {StructuringElement::BOX, StructuringElement::CROSS, StructuringElement::SPHERE}) {
+        for (int radius : {0, 1, 2, 5, 9}) {
+            VoxelGrid dilated(grid);
+            EXPECT_TRUE(DilateOperator(radius, element).apply(dilated));
+            SCOPED_TRACE(radius);
+            expect_same(brute_force_dilate(grid, element, radius), dilated);
+        }
+    }
+
+    // Shifts of more than a word
+    VoxelGrid point(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(199.5f, 9.5f, 9.5f));
+    point.set(100, 5, 5, true);
+    DilateOperator(70).apply(point);
+    EXPECT_EQ(point.count_occupied(), 141u * 10u * 10u);
+    EXPECT_TRUE(point.get(30, 0, 9));
+    EXPECT_FALSE(point.get(29, 0, 9));
+    EXPECT_TRUE(point.get(170, 9, 0));
+    EXPECT_FALSE(point.get(171, 9, 0));
+}
+
+TEST(MorphologyTest, ErodeIsDualOfDilate) {
+    const VoxelGrid grid = test::random_grid(Eigen::Vector3i(70, 20, 9), 0.9, 11);
+    for (StructuringElement element : {StructuringElement::BOX, StructuringElement::SPHERE}) {
+        VoxelGrid eroded(grid);
+        ErodeOperator(3, element).apply(eroded);
+
+        VoxelGrid complement(grid);
+        NotOperator().apply(complement);
+        VoxelGrid expected = brute_force_dilate(complement, element, 3);
+        NotOperator().apply(expected);
+        expect_same(expected, eroded);
+    }
+
+    // Shifts of more than a word along x, where the border fills in set bits
+    const VoxelGrid wide = test::random_grid(Eigen::Vector3i(150, 6, 5), 0.999, 12);
+    VoxelGrid eroded(wide);
+    ErodeOperator(67, StructuringElement::CROSS).apply(eroded);
+    VoxelGrid complement(wide);
+    NotOperator().apply(complement);
+    VoxelGrid expected = brute_force_dilate(complement, StructuringElement::CROSS, 67);
+    NotOperator().apply(expected);
+    expect_same(expected, eroded);
+
+    // A solid block shrinks by the radius away from the grid border
+    VoxelGrid block(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(19.5f));
+    block.set_region(Eigen::Vector3i(4, 4, 4), Eigen::Vector3i(15, 15, 15), true);
+    ErodeOperator(2).apply(block);
+    EXPECT_EQ(block.count_occupied(), 8u * 8u * 8u);
+    EXPECT_TRUE(block.get(6, 6, 6));
+    EXPECT_FALSE(block.get(5, 6, 6));
+}
+
+TEST(MorphologyTest, FusedOpeningAndClosingMatchUnfused) {
+    // Several bricks along y and z so that halos matter
+    const VoxelGrid grid = test::random_grid(Eigen::Vector3i(70, 75, 66), 0.5, 13);
+    for (StructuringElement element : {StructuringElement::BOX, StructuringElement::SPHERE}) {
+        for (int radius : {1, 3, 20}) {
+            SCOPED_TRACE(radius);
+            VoxelGrid expected(grid);
+            erode(expected, element, radius);
+            dilate(expected, element, radius);
+            VoxelGrid opened(grid);
+            EXPECT_TRUE(OpeningOperator(radius, element).apply(opened));
+            expect_same(expected, opened);
+
+            expected = grid;
+            dilate(expected, element, radius);
+            erode(expected, element, radius);
+            VoxelGrid closed(grid);
+            EXPECT_TRUE(ClosingOperator(radius, element).apply(closed));
+            expect_same(expected, closed);
+        }
+    }
+    EXPECT_THROW(ClosingOperator(-1), std::invalid_argument);
+}
+
+TEST(MorphologyTest, Offset) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(19.5f));
+    grid.set_region(Eigen::Vector3i(5, 5, 5), Eigen::Vector3i(14, 14, 14), true);
+
+    VoxelGrid grown(grid);
+    OffsetOperator(2, StructuringElement::BOX).apply(grown);
+    EXPECT_EQ(grown.count_occupied(), 14u * 14u * 14u);
+
+    VoxelGrid shrunk(grid);
+    OffsetOperator(-2, StructuringElement::BOX).apply(shrunk);
+    EXPECT_EQ(shrunk.count_occupied(), 6u * 6u * 6u);
+
+    VoxelGrid unchanged(grid);
+    OffsetOperator(0).apply(unchanged);
+    expect_same(grid, unchanged);
+}
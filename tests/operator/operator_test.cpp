@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
 #include <core/voxel_grid.hpp>
-#include <operator/UnionOperator.hpp>
-#include <operator/IntersectionOperator.hpp>
-#include <operator/DifferenceOperator.hpp>
+#include <operator/union_operator.hpp>
+#include <operator/intersection_operator.hpp>
+#include <operator/difference_operator.hpp>
+#include <operator/xor_operator.hpp>
+#include <operator/not_operator.hpp>
+#include <algorithm>
+#include <random>
 
 using namespace VXZ;
 
@@ -73,4 +77,155 @@ TEST_F(OperatorTest, DifferenceOperatorTest) {
             }
         }
     }
-} 
\ No newline at end of file
+}
+
+TEST_F(OperatorTest, XorAndNotOperatorTest) {
+    XorOperator xor_op;
+    auto result = xor_op.apply(*grid1, *grid2);
+    NotOperator not_op;
+    VoxelGrid inverted(*grid1);
+    ASSERT_TRUE(not_op.apply(inverted));
+    for (int x = 0; x < 10; x++) {
+        for (int y = 0; y < 10; y++) {
+            for (int z = 0; z < 10; z++) {
+                EXPECT_EQ(result->get(x, y, z), grid1->get(x, y, z) != grid2->get(x, y, z));
+                EXPECT_EQ(inverted.get(x, y, z), !grid1->get(x, y, z));
+            }
+        }
+    }
+    EXPECT_EQ(inverted.count_occupied() + grid1->count_occupied(), static_cast<size_t>(grid1->dimensions().prod()));
+}
+
+TEST_F(OperatorTest, InPlaceMatchesCopyingVariants) {
+    std::vector<std::unique_ptr<BinaryOperator>> ops;
+    ops.emplace_back(new UnionOperator());
+    ops.emplace_back(new IntersectionOperator());
+    ops.emplace_back(new DifferenceOperator());
+    ops.emplace_back(new XorOperator());
+    for (auto& op : ops) {
+        auto expected = op->apply(*grid1, *grid2);
+        VoxelGrid target(*grid1);
+        op->apply_in_place(target, *grid2);
+        EXPECT_EQ(target.count_occupied(), expected->count_occupied());
+        IntersectionOperator both;
+        EXPECT_EQ(both.apply(target, *expected)->count_occupied(), expected->count_occupied());
+    }
+}
+
+TEST(BooleanOperatorTest, OverlappingExtents) {
+    // Wide rows, offset by a number of voxels that is not a multiple of the word size
+    VoxelGrid a(0.5f, Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(99.5f, 4.0f, 3.0f));
+    VoxelGrid b(0.5f, Eigen::Vector3f(18.5f, -1.0f, 1.0f), Eigen::Vector3f(118.5f, 2.0f, 6.0f));
+    std::mt19937 rng(2);
+    for (int i = 0; i < 800; ++i) {
+        a.set(rng() % a.dimensions().x(), rng() % a.dimensions().y(), rng() % a.dimensions().z(), true);
+        b.set(rng() % b.dimensions().x(), rng() % b.dimensions().y(), rng() % b.dimensions().z(), true);
+    }
+    const Eigen::Vector3i offset(37, -2, 2);
+
+    auto b_at = [&](int x, int y, int z) {
+        const Eigen::Vector3i p = Eigen::Vector3i(x, y, z) - offset;
+        return b.is_valid_position(p) && b.get(p);
+    };
+    UnionOperator union_op;
+    IntersectionOperator intersection_op;
+    DifferenceOperator difference_op;
+    XorOperator xor_op;
+    auto u = union_op.apply(a, b);
+    auto n = intersection_op.apply(a, b);
+    auto d = difference_op.apply(a, b);
+    auto x = xor_op.apply(a, b);
+    ASSERT_EQ(u->dimensions(), a.dimensions());
+    for (int k = 0; k < a.dimensions().z(); ++k)
+        for (int j = 0; j < a.dimensions().y(); ++j)
+            for (int i = 0; i < a.dimensions().x(); ++i) {
+                const bool va = a.get(i, j, k);
+                const bool vb = b_at(i, j, k);
+                ASSERT_EQ(u->get(i, j, k), va || vb);
+                ASSERT_EQ(n->get(i, j, k), va && vb);
+                ASSERT_EQ(d->get(i, j, k), va && !vb);
+                ASSERT_EQ(x->get(i, j, k), va != vb);
+            }
+
+    // Extents that do not overlap at all leave only grid1's own contribution
+    VoxelGrid far(0.5f, Eigen::Vector3f(500.0f, 0.0f, 0.0f), Eigen::Vector3f(510.0f, 4.0f, 3.0f));
+    EXPECT_EQ(union_op.apply(a, far)->count_occupied(), a.count_occupied());
+    EXPECT_EQ(intersection_op.apply(a, far)->count_occupied(), 0u);
+
+    VoxelGrid shifted(0.5f, Eigen::Vector3f(0.25f, 0.0f, 0.0f), Eigen::Vector3f(10.0f, 4.0f, 3.0f));
+    VoxelGrid coarse(1.0f, Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(10.0f, 4.0f, 3.0f));
+    EXPECT_THROW(union_op.apply(a, shifted), std::invalid_argument);
+    EXPECT_THROW(union_op.apply_in_place(a, coarse), std::invalid_argument);
+}
+
+namespace {
+
+// Exercises the parallel_apply primitives of GridOperator
+class CheckerboardOperator : public GridOperator {
+public:
+    bool apply(VoxelGrid& grid) const override {
+        parallel_apply(grid, [&](int x, int y, int z) { grid.set(x, y, z, (x + y + z) % 2 == 0); });
+        return true;
+    }
+};
+
+// Moves every row one step up in y; reads its neighbour row through the halo
+class ShiftOperator : public GridOperator {
+public:
+    bool apply(VoxelGrid& grid) const override {
+        const size_t words = grid.words_per_row();
+        parallel_apply_bricks(grid, 4, 1, [words](const VoxelGrid& input, VoxelGrid& output, const GridBrick& brick) {
+            for (int z = brick.z_begin; z < brick.z_end; ++z) {
+                for (int y = brick.y_begin; y < brick.y_end; ++y) {
+                    uint64_t* out = output.row_data(y, z);
+                    if (y == 0) {
+                        std::fill(out, out + words, uint64_t(0));
+                    } else {
+                        std::copy(input.row_data(y - 1, z), input.row_data(y - 1, z) + words, out);
+                    }
+                }
+            }
+        });
+        return true;
+    }
+};
+
+} // namespace
+
+TEST(GridOperatorTest, ParallelApplyPrimitives) {
+    // Rows of several words, so per-voxel writes would share words if tasks split rows
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(199.5f, 17.5f, 9.5f));
+    const Eigen::Vector3i& dims = grid.dimensions();
+    CheckerboardOperator().apply(grid);
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                ASSERT_EQ(grid.get(x, y, z), (x + y + z) % 2 == 0);
+            }
+        }
+    }
+
+    ShiftOperator().apply(grid);
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                ASSERT_EQ(grid.get(x, y, z), y > 0 && (x + y + z) % 2 == 1);
+            }
+        }
+    }
+
+    // Two-grid bricks: tiles copied with their halo and stored back give the input
+    VoxelGrid copy(grid.resolution(), grid.min_bounds(), grid.max_bounds());
+    parallel_apply_bricks(grid, copy, 4, 2, [](const VoxelGrid& input, VoxelGrid& output, const GridBrick& brick) {
+        store_brick_tile(copy_brick_tile(input, brick), brick, output);
+    });
+    EXPECT_TRUE(std::equal(grid.row_data(0, 0), grid.row_data(0, 0) + grid.words_per_row() * dims.y() * dims.z(),
+                           copy.row_data(0, 0)));
+    VoxelGrid smaller(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(9.5f, 9.5f, 9.5f));
+    EXPECT_THROW(parallel_apply_bricks(grid, smaller, 4, 0, [](const VoxelGrid&, VoxelGrid&, const GridBrick&) {}),
+                 std::invalid_argument);
+
+    // Rows, through NotOperator
+    NotOperator().apply(grid);
+    EXPECT_EQ(grid.count_occupied(), static_cast<size_t>(dims.prod()) - (static_cast<size_t>(dims.prod()) - dims.x() * dims.z()) / 2);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <random>
+
+// Grids and checks shared by the operator tests
+
+namespace VXZ {
+namespace test {
+
+/**
+ * @brief Grid of size voxels at resolution 1 with its first voxel at origin
+ *
+ * Each voxel is occupied with probability density, drawn in x-fastest order
+ * from a generator seeded with seed.
+ */
+inline VoxelGrid random_grid(const Eigen::Vector3i& size, double density, unsigned seed,
+                             const Eigen::Vector3f& origin = Eigen::Vector3f::Zero()) {
+    VoxelGrid grid(1.0f, origin, origin + (size.cast<float>().array() - 0.5f).matrix());
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution occupied(density);
+    for (int z = 0; z < size.z(); ++z)
+        for (int y = 0; y < size.y(); ++y)
+            for (int x = 0; x < size.x(); ++x)
+                grid.set(x, y, z, occupied(rng));
+    return grid;
+}
+
+/**
+ * @brief Check that two grids have the same dimensions and voxels
+ *
+ * Stops at the first mismatch.
+ */
+inline void expect_same(const VoxelGrid& expected, const VoxelGrid& actual) {
+    const Eigen::Vector3i& dims = expected.dimensions();
+    ASSERT_EQ(actual.dimensions(), dims);
+    for (int z = 0; z < dims.z(); ++z)
+        for (int y = 0; y < dims.y(); ++y)
+            for (int x = 0; x < dims.x(); ++x)
+                ASSERT_EQ(actual.get(x, y, z), expected.get(x, y, z)) << x << " " << y << " " << z;
+}
+
+} // namespace test
+} // namespace VXZ
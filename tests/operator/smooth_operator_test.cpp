@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <operator/smooth_operator.hpp>
+#include <cmath>
+#include <random>
+
+using namespace VXZ;
+
+namespace {
+
+int clamp(int i, int n) {
+    return std::min(std::max(i, 0), n - 1);
+}
+
+// Direct 3-D convolution with the product kernel w(dx) w(dy) w(dz), border repeated
+std::vector<float> reference_smooth(const std::vector<float>& values, const Eigen::Vector3i& dims,
+                                    const std::vector<double>& w) {
+    const int radius = static_cast<int>(w.size()) / 2;
+    auto at = [&](int x, int y, int z) {
+        return values[(static_cast<size_t>(clamp(z, dims.z())) * dims.y() + clamp(y, dims.y())) * dims.x() + clamp(x, dims.x())];
+    };
+    std::vector<float> out(values.size());
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                double sum = 0.0;
+                for (int dz = -radius; dz <= radius; ++dz) {
+                    for (int dy = -radius; dy <= radius; ++dy) {
+                        for (int dx = -radius; dx <= radius; ++dx) {
+                            sum += w[dx + radius] * w[dy + radius] * w[dz + radius] * at(x + dx, y + dy, z + dz);
+                        }
+                    }
+                }
+                out[(static_cast<size_t>(z) * dims.y() + y) * dims.x() + x] = static_cast<float>(sum);
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(SmoothOperatorTest, MatchesDirectConvolution) {
+    const Eigen::Vector3i dims(37, 23, 11);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    std::vector<float> values(static_cast<size_t>(dims.prod()));
+    for (float& v : values) v = value(rng);
+
+    const int radius = 3;
+    std::vector<double> box(2 * radius + 1, 1.0 / (2 * radius + 1));
+    std::vector<double> gaussian(2 * radius + 1);
+    double total = 0.0;
+    for (int k = -radius; k <= radius; ++k) {
+        gaussian[k + radius] = std::exp(-0.5 * k * k / (1.5 * 1.5));
+        total += gaussian[k + radius];
+    }
+    for (double& w : gaussian) w /= total;
+
+    std::vector<float> smoothed = values;
+    SmoothOperator(radius, SmoothingKernel::BOX).apply(smoothed.data(), dims);
+    std::vector<float> expected = reference_smooth(values, dims, box);
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_NEAR(smoothed[i], expected[i], 1e-5f) << i;
+    }
+
+    smoothed = values;
+    SmoothOperator(radius, SmoothingKernel::GAUSSIAN, 1.5f).apply(smoothed.data(), dims);
+    expected = reference_smooth(values, dims, gaussian);
+    for (size_t i = 0; i < values.size(); ++i) {
+        ASSERT_NEAR(smoothed[i], expected[i], 1e-5f) << i;
+    }
+
+    // Through a distance field; constants are preserved
+    DistanceField field(0.1f, Eigen::Vector3f::Zero(), dims);
+    std::fill(field.distances().begin(), field.distances().end(), 2.5f);
+    ASSERT_TRUE(SmoothOperator(4, SmoothingKernel::BOX).apply(field));
+    for (float d : field.distances()) {
+        ASSERT_NEAR(d, 2.5f, 1e-5f);
+    }
+
+    EXPECT_THROW(SmoothOperator(-1), std::invalid_argument);
+    EXPECT_THROW(SmoothOperator(1, SmoothingKernel::GAUSSIAN, -1.0f), std::invalid_argument);
+}
+
+TEST(SmoothOperatorTest, BoxKeepsInfiniteSamplesLocal) {
+    // A capped distance field: infinite samples in a finite field
+    const Eigen::Vector3i dims(16, 9, 7);
+    std::mt19937 rng(31);
+    std::uniform_real_distribution<float> value(0.0f, 2.0f);
+    std::vector<float> values(static_cast<size_t>(dims.prod()));
+    for (float& v : values) v = value(rng);
+    values[3] = DistanceField::kInfinity;
+    values[(static_cast<size_t>(4) * dims.y() + 5) * dims.x() + 10] = DistanceField::kInfinity;
+
+    const int radius = 1;
+    std::vector<float> smoothed = values;
+    SmoothOperator(radius, SmoothingKernel::BOX).apply(smoothed.data(), dims);
+    const std::vector<float> expected = reference_smooth(values, dims, std::vector<double>(2 * radius + 1, 1.0 / (2 * radius + 1)));
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (std::isinf(expected[i])) {
+            ASSERT_EQ(smoothed[i], expected[i]) << i;
+        } else {
+            ASSERT_NEAR(smoothed[i], expected[i], 1e-5f) << i;
+        }
+    }
+    // Along the first row, only the window of x = 3 is affected
+    EXPECT_TRUE(std::isinf(smoothed[2]) && std::isinf(smoothed[4]));
+    EXPECT_TRUE(std::isfinite(smoothed[5]) && std::isfinite(smoothed[15]));
+}
+
+TEST(SmoothOperatorTest, MajorityFilter) {
+    // Several bricks of rows along y and z
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(69.5f, 79.5f, 40.5f));
+    const Eigen::Vector3i& dims = grid.dimensions();
+    std::mt19937 rng(23);
+    std::bernoulli_distribution noise(0.1);
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                // A solid slab with salt-and-pepper noise
+                const bool slab = x >= 20 && x < 50;
+                grid.set(x, y, z, slab != noise(rng));
+            }
+        }
+    }
+    const VoxelGrid original = grid;
+
+    for (int radius : {1, 2}) {
+        VoxelGrid filtered = original;
+        ASSERT_TRUE(SmoothOperator(radius).apply(filtered));
+        const int side = 2 * radius + 1;
+        for (int z = 0; z < dims.z(); ++z) {
+            for (int y = 0; y < dims.y(); ++y) {
+                for (int x = 0; x < dims.x(); ++x) {
+                    int count = 0;
+                    for (int dz = -radius; dz <= radius; ++dz) {
+                        for (int dy = -radius; dy <= radius; ++dy) {
+                            for (int dx = -radius; dx <= radius; ++dx) {
+                                count += original.get(clamp(x + dx, dims.x()), clamp(y + dy, dims.y()), clamp(z + dz, dims.z()));
+                            }
+                        }
+                    }
+                    ASSERT_EQ(filtered.get(x, y, z), 2 * count > side * side * side)
+                        << radius << ": " << x << " " << y << " " << z;
+                }
+            }
+        }
+        // The noise is gone away from the slab faces
+        EXPECT_TRUE(filtered.get(35, 40, 20));
+        EXPECT_FALSE(filtered.get(5, 40, 20));
+    }
+}
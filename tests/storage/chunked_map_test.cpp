@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <storage/chunked_map.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <set>
+#include <thread>
+#include <tuple>
+
+using namespace VXZ;
+
+namespace {
+
+class ChunkedMapTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char pattern[] = "/tmp/chunked_map_test_XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        directory_ = pattern;
+    }
+    void TearDown() override {
+        std::system(("rm -rf " + directory_).c_str());
+    }
+
+    bool has_file(const Eigen::Vector3i& chunk) const {
+        return static_cast<bool>(std::ifstream(directory_ + "/chunk_" + std::to_string(chunk.x()) + "_" +
+                                               std::to_string(chunk.y()) + "_" + std::to_string(chunk.z()) + ".svo"));
+    }
+
+    std::string directory_;
+};
+
+} // namespace
+
+TEST_F(ChunkedMapTest, VoxelsAcrossChunks) {
+    ChunkedMap map(0.5f, directory_, 8);
+    EXPECT_EQ(map.world_to_voxel(Eigen::Vector3f(-0.1f, 0.0f, 4.2f)), Eigen::Vector3i(-1, 0, 8));
+    EXPECT_EQ(map.chunk_of(Eigen::Vector3i(-1, 7, 8)), Eigen::Vector3i(-1, 0, 1));
+    EXPECT_TRUE(map.voxel_to_world(Eigen::Vector3i(-1, 0, 8)).isApprox(Eigen::Vector3f(-0.25f, 0.25f, 4.25f)));
+
+    EXPECT_FALSE(map.get(1000, -1000, 5));
+    map.set(-1, -1, -1, true);
+    map.set(Eigen::Vector3i(8, 0, 0), true);
+    EXPECT_TRUE(map.get(-1, -1, -1));
+    EXPECT_TRUE(map.get(Eigen::Vector3f(4.1f, 0.1f, 0.1f)));
+    EXPECT_FALSE(map.get(7, 0, 0));
+
+    map.set_region(Eigen::Vector3i(-5, 3, 2), Eigen::Vector3i(12, 4, 2));
+    for (int x = -6; x <= 13; ++x) {
+        EXPECT_EQ(map.get(x, 3, 2), x >= -5 && x <= 12) << x;
+    }
+    EXPECT_TRUE(map.any_in_box(Eigen::Vector3i(12, 4, 2), Eigen::Vector3i(20, 20, 20)));
+    EXPECT_FALSE(map.any_in_box(Eigen::Vector3i(13, 0, 0), Eigen::Vector3i(30, 30, 30)));
+    map.set_region(Eigen::Vector3i(-5, 3, 2), Eigen::Vector3i(12, 4, 2), false);
+    EXPECT_FALSE(map.any_in_box(Eigen::Vector3i(-5, 3, 2), Eigen::Vector3i(12, 4, 2)));
+
+    EXPECT_THROW(ChunkedMap(0.0f, directory_), std::invalid_argument);
+    EXPECT_THROW(map.set_radii(3, 2), std::invalid_argument);
+}
+
+TEST_F(ChunkedMapTest, MemoryStaysBoundedAlongALongPath) {
+    std::set<std::tuple<int, int, int>> written;
+    {
+        ChunkedMap map(1.0f, directory_, 8, 40);
+        map.set_radii(1, 2);
+        std::mt19937 rng(5);
+        // 60 chunks along x; every step marks a few voxels near the focus
+        for (int step = 0; step < 480; step += 4) {
+            map.set_focus(Eigen::Vector3f(step + 0.5f, 4.0f, 4.0f), Eigen::Vector3f(1.0f, 0.0f, 0.0f));
+            for (int i = 0; i < 4; ++i) {
+                const Eigen::Vector3i v(step + static_cast<int>(rng() % 8), static_cast<int>(rng() % 16) - 4,
+                                        static_cast<int>(rng() % 8));
+                map.set(v, true);
+                written.insert(std::make_tuple(v.x(), v.y(), v.z()));
+            }
+            map.wait();
+            EXPECT_LE(map.resident_chunks(), map.max_resident_chunks());
+        }
+        EXPECT_TRUE(map.is_resident(map.chunk_of(Eigen::Vector3i(480 + 16, 4, 4))));
+        EXPECT_FALSE(map.is_resident(Eigen::Vector3i(0, 0, 0)));
+        EXPECT_TRUE(has_file(Eigen::Vector3i(0, 0, 0)));
+
+        // Spilled chunks come back on demand
+        for (const auto& v : written) {
+            EXPECT_TRUE(map.get(std::get<0>(v), std::get<1>(v), std::get<2>(v)));
+        }
+        EXPECT_LE(map.resident_chunks(), map.max_resident_chunks());
+    }
+
+    // Everything was spilled when the map closed
+    ChunkedMap reopened(1.0f, directory_, 8, 16);
+    for (const auto& v : written) {
+        EXPECT_TRUE(reopened.get(std::get<0>(v), std::get<1>(v), std::get<2>(v)));
+    }
+    EXPECT_FALSE(reopened.get(3, 100, 3));
+}
+
+TEST_F(ChunkedMapTest, OccupiedVoxelsIncludeSpilledChunks) {
+    ChunkedMap map(1.0f, directory_, 8, 4);
+    map.set_radii(0, 0);
+    std::mt19937 rng(3);
+    std::set<std::tuple<int, int, int>> expected;
+    for (int i = 0; i < 400; ++i) {
+        const Eigen::Vector3i v(static_cast<int>(rng() % 80) - 8, static_cast<int>(rng() % 8), static_cast<int>(rng() % 8));
+        map.set(v, true);
+        expected.emplace(v.x(), v.y(), v.z());
+    }
+    map.wait();
+
+    // Ten chunks are visited but no more than four are ever held
+    std::set<std::tuple<int, int, int>> visited;
+    map.for_each_occupied(Eigen::Vector3i(-8, 0, 0), Eigen::Vector3i(71, 7, 7), [&](const Eigen::Vector3i& v) {
+        EXPECT_TRUE(visited.emplace(v.x(), v.y(), v.z()).second);
+    });
+    EXPECT_EQ(visited, expected);
+    EXPECT_LE(map.resident_chunks(), 4u);
+
+    // Clipped to a box across a chunk border
+    size_t inside = 0;
+    for (const auto& v : expected) {
+        inside += std::get<0>(v) >= 5 && std::get<0>(v) <= 10 && std::get<1>(v) <= 3;
+    }
+    size_t clipped = 0;
+    map.for_each_occupied(Eigen::Vector3i(5, 0, 0), Eigen::Vector3i(10, 3, 7), [&](const Eigen::Vector3i& v) {
+        EXPECT_TRUE(v.x() >= 5 && v.x() <= 10 && v.y() <= 3);
+        ++clipped;
+    });
+    EXPECT_EQ(clipped, inside);
+}
+
+TEST_F(ChunkedMapTest, PrefetchFollowsTheDirectionOfTravel) {
+    ChunkedMap map(1.0f, directory_, 16);
+    map.set_radii(0, 0);
+    map.set_prefetch_distance(3);
+    map.set_focus(Eigen::Vector3f(8.0f, 8.0f, 8.0f), Eigen::Vector3f(0.0f, -2.0f, 0.0f));
+    map.wait();
+    EXPECT_TRUE(map.is_resident(Eigen::Vector3i(0, 0, 0)));
+    EXPECT_TRUE(map.is_resident(Eigen::Vector3i(0, -3, 0)));
+    EXPECT_FALSE(map.is_resident(Eigen::Vector3i(0, 3, 0)));
+
+    map.set_focus(Eigen::Vector3f(8.0f, 8.0f, 8.0f));
+    map.wait();
+    EXPECT_EQ(map.resident_chunks(), 1u);
+}
+
+TEST_F(ChunkedMapTest, ConcurrentQueriesWhileStreaming) {
+    ChunkedMap map(1.0f, directory_, 8, 24);
+    map.set_radii(1, 1);
+    map.set_region(Eigen::Vector3i(0, 0, 0), Eigen::Vector3i(255, 0, 0));
+
+    std::vector<size_t> misses(4, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            for (int i = 0; i < 5000; ++i) {
+                const int x = static_cast<int>(rng() % 256);
+                misses[t] += !map.get(x, 0, 0) || map.get(x, 1, 0);
+                map.set(x, 2 + t, 0, true);
+            }
+        });
+    }
+    for (int x = 0; x < 256; x += 2) {
+        map.set_focus(Eigen::Vector3f(x + 0.5f, 0.5f, 0.5f), Eigen::Vector3f(1.0f, 0.0f, 0.0f));
+        // Chunks being loaded or written out count too, so the bound holds throughout
+        EXPECT_LE(map.resident_chunks(), map.max_resident_chunks());
+    }
+    for (std::thread& thread : threads) thread.join();
+    map.wait();
+    for (size_t m : misses) EXPECT_EQ(m, 0u);
+    EXPECT_TRUE(map.any_in_box(Eigen::Vector3i(0, 5, 0), Eigen::Vector3i(255, 5, 0)));
+    EXPECT_LE(map.resident_chunks(), map.max_resident_chunks());
+}
+
+TEST_F(ChunkedMapTest, ReadsRacingEditsAndSpillsKeepTheEdits) {
+    // Two resident chunks, so every edit of chunk 0 is spilled again by the
+    // next edit elsewhere while other threads keep reading chunk 0 back in
+    const int kEdits = 512;
+    {
+        ChunkedMap map(1.0f, directory_, 8, 2);
+        std::atomic<bool> done(false);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 3; ++t) {
+            readers.emplace_back([&, t]() {
+                for (int i = 0; !done; ++i) {
+                    map.get(i % 8, t, 0);
+                    map.get(8 * (1 + (i + t) % 3), 0, 0);
+                }
+            });
+        }
+        for (int k = 0; k < kEdits; ++k) {
+            map.set(k % 8, (k / 8) % 8, k / 64, true);
+            map.set(8 * (1 + k % 3), 1, 0, k % 2 == 0);
+            ASSERT_TRUE(map.get(k % 8, (k / 8) % 8, k / 64)) << k;
+        }
+        done = true;
+        for (std::thread& reader : readers) reader.join();
+    }
+
+    ChunkedMap map(1.0f, directory_, 8, 2);
+    for (int k = 0; k < kEdits; ++k) {
+        EXPECT_TRUE(map.get(k % 8, (k / 8) % 8, k / 64)) << k;
+    }
+}
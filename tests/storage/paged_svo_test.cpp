@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <storage/paged_svo.hpp>
+#include <storage/svo.hpp>
+#include "storage_test_helpers.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+namespace {
+
+// Terrain-like floor with scattered boxes over a wide, flat grid
+VoxelGrid make_city() {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(511.0f, 383.0f, 47.0f));
+    const Eigen::Vector3i dims = grid.dimensions();
+    test::fill_floor(grid, 3);
+    std::mt19937 rng(4);
+    for (int i = 0; i < 150; ++i) {
+        const Eigen::Vector3i lo(rng() % 500, rng() % 370, 3);
+        const Eigen::Vector3i hi = (lo + Eigen::Vector3i(rng() % 12, rng() % 12, rng() % 40))
+                                       .cwiseMin(dims - Eigen::Vector3i::Ones());
+        grid.set_region(lo, hi);
+    }
+    test::add_noise(grid, rng, 2000);
+    return grid;
+}
+
+} // namespace
+
+TEST(PagedSVOStorageTest, InMemoryImageMatchesGrid) {
+    const VoxelGrid grid = make_city();
+    PagedSVOStorage paged;
+    ASSERT_TRUE(paged.from_voxel_grid(grid));
+    EXPECT_FALSE(paged.is_mapped());
+    EXPECT_GT(paged.page_count(), 1u);
+    expect_same(grid, paged);
+
+    VoxelGrid restored(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones());
+    ASSERT_TRUE(paged.to_voxel_grid(restored));
+    EXPECT_EQ(restored.count_occupied(), grid.count_occupied());
+    EXPECT_THROW(paged.get(-1, 0, 0), std::out_of_range);
+}
+
+TEST(PagedSVOStorageTest, PageSizesAndSmallTrees) {
+    const VoxelGrid grid = make_city();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    for (int page_size : {8, 32, 1024}) {
+        SCOPED_TRACE(page_size);
+        PagedSVOStorage paged;
+        ASSERT_TRUE(paged.from_svo(svo, page_size));
+        expect_same(grid, paged);
+    }
+    PagedSVOStorage paged;
+    EXPECT_FALSE(paged.from_svo(svo, 48));
+    EXPECT_FALSE(paged.from_svo(svo, 4));
+
+    // Empty grid: top levels without any page
+    VoxelGrid empty(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(255.0f));
+    ASSERT_TRUE(paged.from_voxel_grid(empty));
+    EXPECT_EQ(paged.page_count(), 0u);
+    EXPECT_FALSE(paged.get(10, 10, 10));
+    EXPECT_FALSE(paged.any_in_box(Eigen::Vector3i::Zero(), Eigen::Vector3i::Constant(255)));
+}
+
+TEST(PagedSVOStorageTest, MappedFileLoadsPagesOnDemand) {
+    const VoxelGrid grid = make_city();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    const std::string file = "paged_svo_test.bin";
+    {
+        PagedSVOStorage writer;
+        ASSERT_TRUE(writer.from_svo(svo, 32));
+        ASSERT_TRUE(writer.save(file));
+    }
+
+    PagedSVOStorage paged;
+    ASSERT_TRUE(paged.load(file));
+    EXPECT_TRUE(paged.is_mapped());
+    EXPECT_EQ(paged.resident_pages(), 0u);
+
+    // A local query touches a handful of pages
+    EXPECT_TRUE(paged.any_in_box(Eigen::Vector3i(100, 100, 0), Eigen::Vector3i(120, 120, 2)));
+    EXPECT_FALSE(paged.any_in_box(Eigen::Vector3i(-5, -5, -5), Eigen::Vector3i(-1, -1, -1)));
+    EXPECT_LE(paged.resident_pages(), 4u);
+    EXPECT_LT(paged.get_size(), grid.dimensions().prod() / 8 / 10);
+
+    // Full scans stay within the LRU bound and remain correct
+    paged.set_max_resident_pages(16);
+    expect_same(grid, paged);
+    EXPECT_LE(paged.resident_pages(), 16u);
+    EXPECT_LT(paged.resident_pages(), paged.page_count());
+
+    Eigen::Vector3i hit;
+    ASSERT_TRUE(paged.raycast(Eigen::Vector3f(200.5f, 200.5f, 46.5f), Eigen::Vector3f(0.0f, 0.0f, -1.0f), 100.0f, hit));
+    EXPECT_TRUE(grid.get(hit.x(), hit.y(), hit.z()));
+
+    PagedSVOStorage copy;
+    const std::string copy_file = "paged_svo_copy.bin";
+    ASSERT_TRUE(paged.save(copy_file));
+    ASSERT_TRUE(copy.load(copy_file));
+    std::remove(copy_file.c_str());
+    std::remove(file.c_str());
+    EXPECT_EQ(copy.page_count(), paged.page_count());
+    expect_same(grid, copy);
+}
+
+TEST(PagedSVOStorageTest, ConcurrentQueriesWithEviction) {
+    const VoxelGrid grid = make_city();
+    const std::string file = "paged_svo_threads.bin";
+    {
+        PagedSVOStorage writer;
+        ASSERT_TRUE(writer.from_voxel_grid(grid));
+        ASSERT_TRUE(writer.save(file));
+    }
+    PagedSVOStorage paged;
+    ASSERT_TRUE(paged.load(file));
+    std::remove(file.c_str());
+    paged.set_max_resident_pages(2);
+
+    std::vector<size_t> mismatches(4, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            for (int i = 0; i < 20000; ++i) {
+                const Eigen::Vector3i p(rng() % grid.dimensions().x(), rng() % grid.dimensions().y(),
+                                        rng() % grid.dimensions().z());
+                mismatches[t] += paged.get(p) != grid.get(p.x(), p.y(), p.z());
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (size_t m : mismatches) EXPECT_EQ(m, 0u);
+    EXPECT_LE(paged.resident_pages(), 2u);
+}
+
+TEST(PagedSVOStorageTest, RejectsInvalidFiles) {
+    const std::string file = "paged_svo_invalid.bin";
+    {
+        std::FILE* f = std::fopen(file.c_str(), "wb");
+        const char junk[256] = "VXSP but not really";
+        std::fwrite(junk, 1, sizeof(junk), f);
+        std::fclose(f);
+    }
+    PagedSVOStorage paged;
+    EXPECT_FALSE(paged.load(file));
+    EXPECT_FALSE(paged.load("does_not_exist.bin"));
+    std::remove(file.c_str());
+}
+
+TEST(PagedSVOStorageTest, RejectsCorruptIndices) {
+    const VoxelGrid grid = make_city();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    PagedSVOStorage writer;
+    ASSERT_TRUE(writer.from_svo(svo, 32));
+    const std::string file = "paged_svo_corrupt.bin";
+    ASSERT_TRUE(writer.save(file));
+    std::string bytes;
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    PagedSVOHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    ASSERT_GT(header.top_node_count, 0u);
+    const size_t top_at = sizeof(PagedSVOHeader);
+    const size_t table_at = top_at + header.top_node_count * sizeof(SVONode);
+    PagedSVOPage page;
+    std::memcpy(&page, &bytes[table_at], sizeof(page));
+
+    auto write = [&](const std::string& modified) {
+        std::ofstream ofs(file, std::ios::binary);
+        ofs.write(modified.data(), modified.size());
+    };
+    auto load_modified = [&](const std::string& modified) {
+        write(modified);
+        PagedSVOStorage paged;
+        return paged.load(file);
+    };
+    // Pages are checked when first queried, so only the queries reaching a
+    // corrupt page fail; page 0 holds the voxel at the origin
+    auto page_fails = [&](const std::string& modified) {
+        write(modified);
+        PagedSVOStorage paged;
+        if (!paged.load(file)) return false;
+        const Eigen::Vector3i far = paged.dimensions() - Eigen::Vector3i::Ones();
+        EXPECT_EQ(paged.get(far), grid.get(far));
+        bool failed = false;
+        try {
+            paged.get(0, 0, 0);
+        } catch (const std::runtime_error&) {
+            failed = true;
+        }
+        VoxelGrid copy(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones());
+        return failed && !paged.to_voxel_grid(copy) && paged.get(far) == grid.get(far);
+    };
+    auto patch = [&](size_t at, uint32_t value) {
+        std::string modified = bytes;
+        std::memcpy(&modified[at], &value, sizeof(value));
+        return modified;
+    };
+
+    EXPECT_TRUE(load_modified(bytes));
+    // Top level pointing past the top nodes
+    EXPECT_FALSE(load_modified(patch(top_at + offsetof(SVONode, first_child), 0xFFFF0000u)));
+    // Page root pointing past its nodes, and a page too short for its tree
+    EXPECT_FALSE(page_fails(bytes));
+    EXPECT_TRUE(page_fails(patch(page.offset + offsetof(SVONode, first_child), 0xFFFF0000u)));
+    EXPECT_TRUE(page_fails(patch(table_at + offsetof(PagedSVOPage, node_count), 1u)));
+    // Truncated pages
+    EXPECT_FALSE(load_modified(bytes.substr(0, bytes.size() - 8)));
+    std::remove(file.c_str());
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <storage/storage_query.hpp>
+#include <voxelizer/line_traversal.hpp>
+#include "storage_test_helpers.hpp"
+#include <cstdio>
+#include <random>
+#include <set>
+#include <tuple>
+
+using namespace VXZ;
+
+namespace {
+
+VoxelGrid make_scene() {
+    VoxelGrid grid(0.5f, Eigen::Vector3f(-4.0f, -2.0f, 0.0f), Eigen::Vector3f(36.0f, 20.0f, 12.0f));
+    std::mt19937 rng(21);
+    test::add_boxes(grid, rng, 25, Eigen::Vector3i(70, 40, 20), Eigen::Vector3i(12, 12, 8));
+    test::add_noise(grid, rng, 100);
+    return grid;
+}
+
+const char* const kTypes[] = {"dense", "svo", "svdag", "ssvdag", "vdb_tree", "flat_vdb", "paged_svo"};
+
+} // namespace
+
+TEST(StorageQueryTest, FactoryTypes) {
+    VoxelGrid grid = make_scene();
+    EXPECT_EQ(VoxelStorageFactory::create("dense", grid)->type(), StorageType::DENSE);
+    EXPECT_EQ(VoxelStorageFactory::create("svo", grid)->type(), StorageType::SVO);
+    EXPECT_EQ(VoxelStorageFactory::create("svdag", grid)->type(), StorageType::SVDAG);
+    EXPECT_EQ(VoxelStorageFactory::create("ssvdag", grid)->type(), StorageType::SVDAG);
+    EXPECT_THROW(VoxelStorageFactory::create("octree"), std::invalid_argument);
+}
+
+TEST(StorageQueryTest, QueriesAgreeWithGrid) {
+    VoxelGrid grid = make_scene();
+    const Eigen::Vector3i dims = grid.dimensions();
+    std::set<std::tuple<int, int, int>> expected;
+    for (int z = 0; z < dims.z(); ++z)
+        for (int y = 0; y < dims.y(); ++y)
+            for (int x = 0; x < dims.x(); ++x)
+                if (grid.get(x, y, z)) expected.insert(std::make_tuple(x, y, z));
+
+    for (const char* type : kTypes) {
+        SCOPED_TRACE(type);
+        std::unique_ptr<VoxelStorage> storage = VoxelStorageFactory::create(type, grid);
+
+        std::set<std::tuple<int, int, int>> visited;
+        for_each_occupied(*storage, [&](const Eigen::Vector3i& v) {
+            visited.insert(std::make_tuple(v.x(), v.y(), v.z()));
+        });
+        EXPECT_EQ(visited, expected);
+
+        std::mt19937 rng(4);
+        for (int i = 0; i < 300; ++i) {
+            Eigen::Vector3i p(rng() % dims.x(), rng() % dims.y(), rng() % dims.z());
+            ASSERT_EQ(get_voxel(*storage, p), grid.get(p));
+
+            // Boxes may stick out of the grid
+            Eigen::Vector3i lo = p - Eigen::Vector3i(rng() % 6, rng() % 6, rng() % 6);
+            Eigen::Vector3i hi = p + Eigen::Vector3i(rng() % 6, rng() % 6, rng() % 6);
+            bool brute = false;
+            for (int z = std::max(lo.z(), 0); z <= std::min(hi.z(), dims.z() - 1); ++z)
+                for (int y = std::max(lo.y(), 0); y <= std::min(hi.y(), dims.y() - 1); ++y)
+                    for (int x = std::max(lo.x(), 0); x <= std::min(hi.x(), dims.x() - 1); ++x)
+                        brute = brute || grid.get(x, y, z);
+            ASSERT_EQ(any_in_box(*storage, lo, hi), brute);
+        }
+
+        std::uniform_real_distribution<float> coord(-6.0f, 38.0f);
+        for (int i = 0; i < 100; ++i) {
+            Eigen::Vector3f origin(coord(rng), coord(rng) * 0.5f, coord(rng) * 0.3f);
+            Eigen::Vector3f target(coord(rng), coord(rng) * 0.5f, coord(rng) * 0.3f);
+            Eigen::Vector3i expected_hit, hit;
+            const bool expected_found = find_first_occupied(grid, origin, target, expected_hit, LineAlgorithm::RLV);
+            const bool found = raycast(*storage, origin, target - origin, (target - origin).norm(), hit);
+            ASSERT_EQ(found, expected_found);
+            if (found) {
+                EXPECT_EQ(hit, expected_hit);
+            }
+        }
+    }
+}
+
+TEST(StorageQueryTest, SaveLoadThroughFactory) {
+    VoxelGrid grid = make_scene();
+    for (const char* type : kTypes) {
+        SCOPED_TRACE(type);
+        const std::string file = std::string("storage_query_test_") + type + ".bin";
+        ASSERT_TRUE(VoxelStorageFactory::create(type, grid)->save(file));
+        std::unique_ptr<VoxelStorage> loaded = VoxelStorageFactory::create(type);
+        ASSERT_TRUE(loaded->load(file));
+        std::remove(file.c_str());
+
+        VoxelGrid restored(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones());
+        ASSERT_TRUE(loaded->to_voxel_grid(restored));
+        ASSERT_EQ(restored.dimensions(), grid.dimensions());
+        EXPECT_EQ(restored.count_occupied(), grid.count_occupied());
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// Scene building blocks and checks shared by the storage tests
+
+namespace VXZ {
+namespace test {
+
+/**
+ * @brief Check every voxel of a storage against the grid it was built from
+ *
+ * Works for any type with get(x, y, z); stops at the first mismatch.
+ */
+template <typename Storage>
+void expect_same(const VoxelGrid& expected, const Storage& storage) {
+    const Eigen::Vector3i dims = expected.dimensions();
+    for (int z = 0; z < dims.z(); ++z)
+        for (int y = 0; y < dims.y(); ++y)
+            for (int x = 0; x < dims.x(); ++x)
+                ASSERT_EQ(storage.get(x, y, z), expected.get(x, y, z)) << x << " " << y << " " << z;
+}
+
+/**
+ * @brief Fill the layers z < height
+ */
+inline void fill_floor(VoxelGrid& grid, int height) {
+    const Eigen::Vector3i dims = grid.dimensions();
+    for (int z = 0; z < std::min(height, dims.z()); ++z)
+        for (int y = 0; y < dims.y(); ++y)
+            grid.set_span(y, z, 0, dims.x());
+}
+
+/**
+ * @brief Set the voxels whose index lies strictly within radius of centre
+ */
+inline void add_sphere(VoxelGrid& grid, const Eigen::Vector3f& centre, float radius) {
+    const Eigen::Vector3i dims = grid.dimensions();
+    const Eigen::Vector3i lo = (centre.array() - radius).ceil().cast<int>().max(0).matrix();
+    const Eigen::Vector3i hi = (centre.array() + radius).floor().cast<int>().min(dims.array() - 1).matrix();
+    for (int z = lo.z(); z <= hi.z(); ++z)
+        for (int y = lo.y(); y <= hi.y(); ++y)
+            for (int x = lo.x(); x <= hi.x(); ++x)
+                if ((Eigen::Vector3f(x, y, z) - centre).squaredNorm() < radius * radius)
+                    grid.set(x, y, z, true);
+}
+
+/**
+ * @brief Set count random boxes
+ *
+ * Lower corners are drawn below corner_range and extents below
+ * size_range; boxes are clipped to the grid.
+ */
+inline void add_boxes(VoxelGrid& grid, std::mt19937& rng, int count,
+                      const Eigen::Vector3i& corner_range, const Eigen::Vector3i& size_range) {
+    for (int i = 0; i < count; ++i) {
+        const Eigen::Vector3i lo(rng() % corner_range.x(), rng() % corner_range.y(), rng() % corner_range.z());
+        const Eigen::Vector3i hi = (lo + Eigen::Vector3i(rng() % size_range.x(), rng() % size_range.y(),
+                                                         rng() % size_range.z()))
+                                       .cwiseMin(grid.dimensions() - Eigen::Vector3i::Ones());
+        grid.set_region(lo, hi);
+    }
+}
+
+/**
+ * @brief Set count random voxels
+ */
+inline void add_noise(VoxelGrid& grid, std::mt19937& rng, int count) {
+    const Eigen::Vector3i dims = grid.dimensions();
+    for (int i = 0; i < count; ++i) {
+        grid.set(rng() % dims.x(), rng() % dims.y(), rng() % dims.z(), true);
+    }
+}
+
+} // namespace test
+} // namespace VXZ
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <storage/svdag.hpp>
+#include <storage/svo.hpp>
+#include "storage_test_helpers.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+namespace {
+
+// Block of identical buildings; every other one is mirrored in x
+VoxelGrid make_city() {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(127.0f, 127.0f, 47.0f));
+    for (int by = 0; by < 4; ++by) {
+        for (int bx = 0; bx < 4; ++bx) {
+            const Eigen::Vector3i o(bx * 32, by * 32, 0);
+            const bool mirrored = (bx + by) % 2 == 1;
+            for (int z = 0; z < 40; ++z) {
+                for (int y = 2; y < 28; ++y) {
+                    for (int lx = 2; lx < 30; ++lx) {
+                        // Walls, floors every 5 voxels and a window pattern
+                        const bool wall = lx == 2 || lx == 29 || y == 2 || y == 27;
+                        const bool window = wall && z % 5 > 1 && (lx + y) % 4 < 2;
+                        const bool feature = lx < 9 && y < 6 && z < 20;
+                        if ((wall && !window) || z % 5 == 0 || feature) {
+                            const int x = mirrored ? 31 - lx : lx;
+                            grid.set(o.x() + x, o.y() + y, z, true);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return grid;
+}
+
+} // namespace
+
+TEST(SVDAGStorageTest, QueriesMatchGrid) {
+    VoxelGrid grid = make_city();
+    std::mt19937 rng(5);
+    for (int i = 0; i < 300; ++i) {
+        grid.set(rng() % grid.dimensions().x(), rng() % grid.dimensions().y(), rng() % grid.dimensions().z(), true);
+    }
+    for (bool symmetric : {false, true}) {
+        SVDAGStorage dag(symmetric);
+        ASSERT_TRUE(dag.from_voxel_grid(grid));
+        expect_same(grid, dag);
+
+        VoxelGrid restored(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones());
+        ASSERT_TRUE(dag.to_voxel_grid(restored));
+        ASSERT_EQ(restored.dimensions(), grid.dimensions());
+        EXPECT_EQ(restored.count_occupied(), grid.count_occupied());
+    }
+    EXPECT_THROW(SVDAGStorage().get(0, 0, 0), std::out_of_range);
+}
+
+TEST(SVDAGStorageTest, RepeatedStructuresCompress) {
+    VoxelGrid grid = make_city();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    SVDAGStorage dag(false), sdag(true);
+    ASSERT_TRUE(dag.from_svo(svo));
+    ASSERT_TRUE(sdag.from_svo(svo));
+
+    EXPECT_LT(dag.get_size() * 8, svo.get_size());
+    // Mirrored buildings are only merged by the symmetric variant
+    EXPECT_LT(sdag.nodes().size(), dag.nodes().size());
+    EXPECT_LE(sdag.bricks().size(), dag.bricks().size());
+    expect_same(grid, sdag);
+}
+
+TEST(SVDAGStorageTest, MirrorBrickIsInvolution) {
+    std::mt19937_64 rng(9);
+    for (int i = 0; i < 100; ++i) {
+        const uint64_t mask = rng();
+        for (int m = 0; m < 8; ++m) {
+            EXPECT_EQ(SVDAGStorage::mirror_brick(SVDAGStorage::mirror_brick(mask, m), m), mask);
+        }
+        // Voxel (x, y, z) moves to (3 - x, y, 3 - z) under mirror 5
+        const uint64_t image = SVDAGStorage::mirror_brick(mask, 5);
+        for (int b = 0; b < 64; ++b) {
+            const int x = b & 3, y = (b >> 2) & 3, z = b >> 4;
+            EXPECT_EQ((image >> ((3 - x) + 4 * y + 16 * (3 - z))) & 1, (mask >> b) & 1);
+        }
+    }
+}
+
+TEST(SVDAGStorageTest, SaveLoadRoundTrip) {
+    VoxelGrid grid = make_city();
+    SVDAGStorage dag(true);
+    ASSERT_TRUE(dag.from_voxel_grid(grid));
+
+    const std::string file = "svdag_test.bin";
+    ASSERT_TRUE(dag.save(file));
+    SVDAGStorage loaded;
+    ASSERT_TRUE(loaded.load(file));
+    std::remove(file.c_str());
+
+    EXPECT_TRUE(loaded.symmetric());
+    EXPECT_EQ(loaded.root(), dag.root());
+    EXPECT_EQ(loaded.nodes(), dag.nodes());
+    EXPECT_EQ(loaded.bricks(), dag.bricks());
+    expect_same(grid, loaded);
+}
+
+TEST(SVDAGStorageTest, LoadRejectsCorruptFiles) {
+    VoxelGrid grid = make_city();
+    SVDAGStorage dag(true);
+    ASSERT_TRUE(dag.from_voxel_grid(grid));
+    const std::string file = "svdag_corrupt_test.bin";
+    ASSERT_TRUE(dag.save(file));
+    std::string bytes;
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    // Header ending in the two array sizes, then the nodes, then the bricks
+    const size_t nodes_at = bytes.size() - dag.nodes().size() * sizeof(uint32_t) - dag.bricks().size() * sizeof(uint64_t);
+    auto load_modified = [&](std::string modified) {
+        {
+            std::ofstream ofs(file, std::ios::binary);
+            ofs.write(modified.data(), modified.size());
+        }
+        SVDAGStorage loaded;
+        return loaded.load(file);
+    };
+    auto with_word = [&](size_t at, uint64_t value, size_t size) {
+        std::string modified = bytes;
+        std::memcpy(&modified[at], &value, size);
+        return modified;
+    };
+    auto with_node_word = [&](size_t index, uint32_t value) {
+        return with_word(nodes_at + index * sizeof(uint32_t), value, sizeof(uint32_t));
+    };
+
+    EXPECT_TRUE(load_modified(bytes));
+    EXPECT_FALSE(load_modified(bytes.substr(0, bytes.size() - 8)));
+    // Array sizes larger than the file, checked before allocating
+    EXPECT_FALSE(load_modified(with_word(nodes_at - 16, uint64_t(1) << 40, sizeof(uint64_t))));
+    EXPECT_FALSE(load_modified(with_word(nodes_at - 8, uint64_t(1) << 60, sizeof(uint64_t))));
+
+    // Level-1 nodes come first, the root last
+    const uint32_t root = dag.root() & SVDAGStorage::kIndexMask;
+    ASSERT_EQ(root + 1 + __builtin_popcount(dag.nodes()[root] & ~(dag.nodes()[root] >> 8) & 0xFF), dag.nodes().size());
+    ASSERT_NE(dag.nodes()[0] & ~(dag.nodes()[0] >> 8) & 0xFF, 0u);
+    // A child past the node array, a brick past the brick array, and a root
+    // header whose references run past the end
+    EXPECT_FALSE(load_modified(with_node_word(root + 1, static_cast<uint32_t>(dag.nodes().size()))));
+    EXPECT_FALSE(load_modified(with_node_word(1, static_cast<uint32_t>(dag.bricks().size()))));
+    EXPECT_FALSE(load_modified(with_node_word(root, 0xFFu)));
+    // Mirror bits in a DAG that is not marked symmetric
+    std::string plain = bytes;
+    plain[8] = 0;
+    EXPECT_FALSE(load_modified(plain));
+    std::remove(file.c_str());
+}
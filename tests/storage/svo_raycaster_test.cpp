@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <storage/svo.hpp>
+#include <storage/svo_raycaster.hpp>
+#include <voxelizer/line_traversal.hpp>
+#include "storage_test_helpers.hpp"
+#include <random>
+
+using namespace VXZ;
+
+namespace {
+
+// Solid blocks (full octree nodes) and scattered voxels (bricks)
+VoxelGrid make_scene() {
+    VoxelGrid grid(0.5f, Eigen::Vector3f(-4.0f, -2.0f, 1.0f), Eigen::Vector3f(40.0f, 30.0f, 20.0f));
+    std::mt19937 rng(3);
+    test::add_boxes(grid, rng, 20, Eigen::Vector3i(80, 60, 36), Eigen::Vector3i(16, 16, 12));
+    test::add_noise(grid, rng, 300);
+    return grid;
+}
+
+std::vector<SVORay> make_rays(size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> coord(-10.0f, 50.0f);
+    std::uniform_real_distribution<float> dir(-1.0f, 1.0f);
+    std::vector<SVORay> rays(count);
+    for (SVORay& ray : rays) {
+        ray.origin = Eigen::Vector3f(coord(rng), coord(rng) * 0.7f, coord(rng) * 0.5f);
+        ray.direction = Eigen::Vector3f(dir(rng), dir(rng), dir(rng));
+        ray.max_distance = 200.0f;
+    }
+    return rays;
+}
+
+void expect_hit_on_ray(const VoxelGrid& grid, const SVORay& ray, const SVORayHit& hit) {
+    const Eigen::Vector3f p = ray.origin + ray.direction.normalized() * hit.distance;
+    const Eigen::Vector3f lo = grid.min_bounds() + hit.voxel.cast<float>() * grid.resolution();
+    const float eps = 1e-3f;
+    EXPECT_TRUE((p.array() >= lo.array() - eps).all() &&
+                (p.array() <= lo.array() + grid.resolution() + eps).all())
+        << "entry point " << p.transpose() << " outside voxel " << hit.voxel.transpose();
+}
+
+} // namespace
+
+TEST(SVORaycasterTest, SingleRaysMatchGridWalk) {
+    const VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    SVORaycaster caster(svo);
+
+    int hits = 0;
+    for (const SVORay& ray : make_rays(3000, 7)) {
+        Eigen::Vector3i expected;
+        const Eigen::Vector3f end = ray.origin + ray.direction.normalized() * ray.max_distance;
+        const bool expected_found = find_first_occupied(grid, ray.origin, end, expected, LineAlgorithm::RLV);
+        const SVORayHit hit = caster.cast(ray);
+        ASSERT_EQ(hit.hit, expected_found) << ray.origin.transpose() << " / " << ray.direction.transpose();
+        if (hit.hit) {
+            ++hits;
+            EXPECT_EQ(hit.voxel, expected);
+            EXPECT_TRUE(grid.get(hit.voxel.x(), hit.voxel.y(), hit.voxel.z()));
+            expect_hit_on_ray(grid, ray, hit);
+        }
+    }
+    EXPECT_GT(hits, 300);
+}
+
+TEST(SVORaycasterTest, DistanceAndAxisAlignedRays) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(63.0f, 63.0f, 63.0f));
+    grid.set_region(Eigen::Vector3i(32, 0, 0), Eigen::Vector3i(47, 63, 63));
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    SVORaycaster caster(svo);
+
+    SVORay ray = {Eigen::Vector3f(2.5f, 10.5f, 20.5f), Eigen::Vector3f(3.0f, 0.0f, 0.0f), 100.0f};
+    SVORayHit hit = caster.cast(ray);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_NEAR(hit.distance, 29.5f, 1e-4f);
+    EXPECT_EQ(hit.voxel, Eigen::Vector3i(32, 10, 20));
+
+    // From the other side, and stopping short of the wall
+    ray.origin = Eigen::Vector3f(60.0f, 5.5f, 5.5f);
+    ray.direction = Eigen::Vector3f(-1.0f, 0.0f, 0.0f);
+    hit = caster.cast(ray);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_NEAR(hit.distance, 12.0f, 1e-4f);
+    EXPECT_EQ(hit.voxel, Eigen::Vector3i(47, 5, 5));
+    ray.max_distance = 11.0f;
+    EXPECT_FALSE(caster.cast(ray).hit);
+
+    // Starting inside occupied space hits at distance zero
+    ray.origin = Eigen::Vector3f(40.2f, 7.5f, 7.5f);
+    hit = caster.cast(ray);
+    ASSERT_TRUE(hit.hit);
+    EXPECT_EQ(hit.distance, 0.0f);
+    EXPECT_EQ(hit.voxel, Eigen::Vector3i(40, 7, 7));
+
+    // Parallel to the wall, and pointing away from the grid
+    ray.origin = Eigen::Vector3f(10.5f, 5.5f, 5.5f);
+    ray.direction = Eigen::Vector3f(0.0f, 1.0f, 0.0f);
+    EXPECT_FALSE(caster.cast(ray).hit);
+    ray.origin = Eigen::Vector3f(-5.0f, 5.5f, 5.5f);
+    ray.direction = Eigen::Vector3f(-1.0f, 0.0f, 0.0f);
+    EXPECT_FALSE(caster.cast(ray).hit);
+    ray.direction = Eigen::Vector3f::Zero();
+    EXPECT_FALSE(caster.cast(ray).hit);
+}
+
+TEST(SVORaycasterTest, PacketsMatchSingleRays) {
+    const VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    SVORaycaster caster(svo);
+
+    const std::vector<SVORay> rays = make_rays(2000, 13);
+    SVORayHit hits[SVORaycaster::kMaxPacketSize];
+    size_t begin = 0;
+    for (int count = 1; begin < rays.size(); count = count % SVORaycaster::kMaxPacketSize + 1) {
+        const int n = static_cast<int>(std::min<size_t>(count, rays.size() - begin));
+        caster.cast_packet(&rays[begin], n, hits);
+        for (int i = 0; i < n; ++i) {
+            const SVORayHit expected = caster.cast(rays[begin + i]);
+            ASSERT_EQ(hits[i].hit, expected.hit);
+            if (expected.hit) {
+                EXPECT_EQ(hits[i].voxel, expected.voxel);
+                EXPECT_NEAR(hits[i].distance, expected.distance, 1e-3f);
+            }
+        }
+        begin += n;
+    }
+    EXPECT_THROW(caster.cast_packet(rays.data(), SVORaycaster::kMaxPacketSize + 1, hits), std::invalid_argument);
+}
+
+TEST(SVORaycasterTest, BatchMatchesSingleRays) {
+    const VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    SVORaycaster caster(svo);
+
+    const std::vector<SVORay> rays = make_rays(20000, 17);
+    std::vector<SVORayHit> hits;
+    caster.cast_batch(rays, hits);
+    ASSERT_EQ(hits.size(), rays.size());
+    for (size_t i = 0; i < rays.size(); ++i) {
+        const SVORayHit expected = caster.cast(rays[i]);
+        ASSERT_EQ(hits[i].hit, expected.hit) << i;
+        if (expected.hit) {
+            EXPECT_EQ(hits[i].voxel, expected.voxel) << i;
+        }
+    }
+}
@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <storage/svo.hpp>
+#include "storage_test_helpers.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+namespace {
+
+// Non-cubic grid with a solid block, a sphere and some noise
+VoxelGrid make_scene() {
+    VoxelGrid grid(1.0f, Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(69.0f, 40.0f, 23.0f));
+    grid.set_region(Eigen::Vector3i(8, 8, 0), Eigen::Vector3i(39, 23, 15));
+    test::add_sphere(grid, Eigen::Vector3f(52.0f, 20.0f, 12.0f), 9.5f);
+    std::mt19937 rng(3);
+    test::add_noise(grid, rng, 200);
+    return grid;
+}
+
+} // namespace
+
+TEST(SVOStorageTest, PointQueriesMatchGrid) {
+    VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    EXPECT_EQ(svo.dimensions(), grid.dimensions());
+    EXPECT_EQ(svo.root_size(), 128);
+    EXPECT_EQ(svo.depth(), 5);
+    expect_same(grid, svo);
+    EXPECT_THROW(svo.get(grid.dimensions().x(), 0, 0), std::out_of_range);
+}
+
+TEST(SVOStorageTest, ToVoxelGridRoundTrip) {
+    VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+
+    VoxelGrid restored(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones());
+    ASSERT_TRUE(svo.to_voxel_grid(restored));
+    ASSERT_EQ(restored.dimensions(), grid.dimensions());
+    EXPECT_EQ(restored.min_bounds(), grid.min_bounds());
+    EXPECT_EQ(restored.count_occupied(), grid.count_occupied());
+    for (int z = 0; z < grid.dimensions().z(); ++z)
+        for (int y = 0; y < grid.dimensions().y(); ++y)
+            for (int x = 0; x < grid.dimensions().x(); ++x)
+                ASSERT_EQ(restored.get(x, y, z), grid.get(x, y, z));
+}
+
+TEST(SVOStorageTest, SaveLoadRoundTrip) {
+    VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+
+    const std::string file = "svo_test.bin";
+    ASSERT_TRUE(svo.save(file));
+    SVOStorage loaded;
+    ASSERT_TRUE(loaded.load(file));
+    std::remove(file.c_str());
+
+    EXPECT_EQ(loaded.nodes().size(), svo.nodes().size());
+    EXPECT_EQ(loaded.bricks(), svo.bricks());
+    expect_same(grid, loaded);
+    EXPECT_FALSE(loaded.load("does_not_exist.bin"));
+}
+
+TEST(SVOStorageTest, LoadRejectsCorruptFiles) {
+    VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    const std::string file = "svo_corrupt_test.bin";
+    ASSERT_TRUE(svo.save(file));
+    std::string bytes;
+    {
+        std::ifstream ifs(file, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    // Header, then the nodes, then the bricks
+    const size_t nodes_at = bytes.size() - svo.nodes().size() * sizeof(SVONode) - svo.bricks().size() * sizeof(uint64_t);
+    auto load_modified = [&](std::string modified) {
+        {
+            std::ofstream ofs(file, std::ios::binary);
+            ofs.write(modified.data(), modified.size());
+        }
+        SVOStorage loaded;
+        return loaded.load(file);
+    };
+    auto with_first_child = [&](size_t node, uint32_t first_child) {
+        std::string modified = bytes;
+        std::memcpy(&modified[nodes_at + node * sizeof(SVONode) + offsetof(SVONode, first_child)], &first_child, sizeof(first_child));
+        return modified;
+    };
+
+    EXPECT_TRUE(load_modified(bytes));
+    EXPECT_FALSE(load_modified(bytes.substr(0, bytes.size() - 8)));
+    // Children past the node array, back onto the root, and past the bricks
+    EXPECT_FALSE(load_modified(with_first_child(0, 0xFFFFFFF0u)));
+    EXPECT_FALSE(load_modified(with_first_child(0, 0)));
+    const size_t last = svo.nodes().size() - 1;
+    EXPECT_FALSE(load_modified(with_first_child(last, static_cast<uint32_t>(svo.bricks().size()))));
+    std::remove(file.c_str());
+}
+
+TEST(SVOStorageTest, UniformRegionsCollapse) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(63.0f));
+    SVOStorage svo;
+
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    EXPECT_EQ(svo.nodes().size(), 1u);
+    EXPECT_TRUE(svo.bricks().empty());
+    EXPECT_FALSE(svo.get(10, 20, 30));
+
+    grid.fill(true);
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    EXPECT_EQ(svo.nodes().size(), 1u);
+    EXPECT_EQ(svo.nodes()[0].full_mask, 0xFF);
+    EXPECT_TRUE(svo.get(10, 20, 30));
+
+    // A solid block aligned to the octree only stores its boundary
+    grid.clear();
+    grid.set_region(Eigen::Vector3i(0, 0, 0), Eigen::Vector3i(31, 31, 31));
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    EXPECT_EQ(svo.nodes().size(), 1u);
+    EXPECT_EQ(svo.nodes()[0].full_mask, 0x01);
+    EXPECT_LT(svo.get_size(), 256u);
+}
+
+TEST(SVOStorageTest, ParallelBuildOnLargeNonCubicGrid) {
+    // Rows span several storage words and no dimension is a brick multiple
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(201.0f, 130.0f, 69.0f));
+    std::mt19937 rng(11);
+    for (int i = 0; i < 40; ++i) {
+        Eigen::Vector3i lo(rng() % 190, rng() % 120, rng() % 60);
+        Eigen::Vector3i hi = (lo + Eigen::Vector3i(rng() % 40, rng() % 30, rng() % 20))
+                                 .cwiseMin(grid.dimensions() - Eigen::Vector3i::Ones());
+        grid.set_region(lo, hi, i % 5 != 0);
+    }
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    EXPECT_EQ(svo.root_size(), 256);
+    expect_same(grid, svo);
+
+    VoxelGrid restored(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones());
+    ASSERT_TRUE(svo.to_voxel_grid(restored));
+    EXPECT_EQ(restored.count_occupied(), grid.count_occupied());
+}
+
+TEST(SVOStorageTest, IncrementalEditsMatchRebuild) {
+    VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+
+    std::mt19937 rng(5);
+    const Eigen::Vector3i dims = grid.dimensions();
+    for (int round = 0; round < 30; ++round) {
+        SVOEditBatch batch;
+        for (int i = 0; i < 20; ++i) {
+            const Eigen::Vector3i lo(rng() % dims.x(), rng() % dims.y(), rng() % dims.z());
+            const bool value = rng() % 3 != 0;
+            if (i % 4 == 0) {
+                const Eigen::Vector3i hi = (lo + Eigen::Vector3i(rng() % 20, rng() % 20, rng() % 10))
+                                               .cwiseMin(dims - Eigen::Vector3i::Ones());
+                batch.set_region(lo, hi, value);
+                grid.set_region(lo, hi, value);
+            } else {
+                batch.set(lo, value);
+                grid.set(lo.x(), lo.y(), lo.z(), value);
+            }
+        }
+        if (round % 2 == 0) {
+            svo.apply(batch);
+        } else {
+            for (const SVOEditBatch::Edit& edit : batch.edits()) {
+                svo.set_region(edit.min, edit.max, edit.value);
+            }
+        }
+    }
+    expect_same(grid, svo);
+
+    // Compaction yields exactly the tree built from scratch
+    SVOStorage rebuilt;
+    ASSERT_TRUE(rebuilt.from_voxel_grid(grid));
+    svo.compact();
+    EXPECT_TRUE(svo.is_compact());
+    EXPECT_EQ(svo.root(), 0u);
+    EXPECT_EQ(svo.nodes(), rebuilt.nodes());
+    EXPECT_EQ(svo.bricks(), rebuilt.bricks());
+}
+
+TEST(SVOStorageTest, EditsCollapseAndExpand) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Constant(63.0f));
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+
+    svo.set_region(Eigen::Vector3i::Zero(), Eigen::Vector3i::Constant(63));
+    svo.compact();
+    ASSERT_EQ(svo.nodes().size(), 1u);
+    EXPECT_EQ(svo.nodes()[0].full_mask, 0xFF);
+
+    // Clearing one voxel expands a path down to a brick
+    svo.set(Eigen::Vector3i(5, 6, 7), false);
+    EXPECT_FALSE(svo.get(5, 6, 7));
+    EXPECT_TRUE(svo.get(4, 6, 7));
+    svo.compact();
+    EXPECT_EQ(svo.nodes().size(), static_cast<size_t>(svo.depth()));
+    EXPECT_EQ(svo.bricks().size(), 1u);
+
+    // Setting it again collapses the path
+    svo.set(Eigen::Vector3i(5, 6, 7), true);
+    svo.compact();
+    EXPECT_EQ(svo.nodes().size(), 1u);
+    EXPECT_TRUE(svo.bricks().empty());
+
+    EXPECT_THROW(svo.set(Eigen::Vector3i(64, 0, 0), true), std::out_of_range);
+    SVOEditBatch batch;
+    batch.set(Eigen::Vector3i(1, 1, 1), false);
+    batch.set_region(Eigen::Vector3i(0, 0, 0), Eigen::Vector3i(0, 0, 64));
+    EXPECT_THROW(svo.apply(batch), std::out_of_range);
+    EXPECT_TRUE(svo.get(1, 1, 1));
+}
+
+TEST(SVOStorageTest, EditCostFollowsChangedVoxels) {
+    VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+
+    // Writing what is already stored appends nothing
+    const size_t nodes = svo.nodes().size();
+    const size_t bricks = svo.bricks().size();
+    svo.set(Eigen::Vector3i(10, 10, 5), true);
+    svo.set(Eigen::Vector3i(1, 1, 22), false);
+    EXPECT_EQ(svo.nodes().size(), nodes);
+    EXPECT_EQ(svo.bricks().size(), bricks);
+    EXPECT_TRUE(svo.is_compact());
+
+    // One changed voxel copies one sibling group per level
+    svo.set(Eigen::Vector3i(1, 1, 22), true);
+    EXPECT_FALSE(svo.is_compact());
+    EXPECT_LE(svo.nodes().size(), nodes + 8 * svo.depth());
+    EXPECT_LE(svo.bricks().size(), bricks + 8);
+    EXPECT_TRUE(svo.get(1, 1, 22));
+}
+
+TEST(SVOStorageTest, SnapshotsStayConsistentDuringEdits) {
+    const VoxelGrid grid = make_scene();
+    SVOStorage svo;
+    ASSERT_TRUE(svo.from_voxel_grid(grid));
+    std::shared_ptr<const SVOStorage> snapshot = svo.snapshot();
+
+    // Read the snapshot on another thread while this one edits
+    size_t mismatches = 0;
+    std::thread reader([&]() {
+        for (int pass = 0; pass < 3; ++pass) {
+            const Eigen::Vector3i dims = grid.dimensions();
+            for (int z = 0; z < dims.z(); ++z)
+                for (int y = 0; y < dims.y(); ++y)
+                    for (int x = 0; x < dims.x(); ++x)
+                        mismatches += snapshot->get(x, y, z) != grid.get(x, y, z);
+        }
+    });
+    VoxelGrid edited = grid;
+    std::mt19937 rng(9);
+    for (int i = 0; i < 3000; ++i) {
+        const Eigen::Vector3i p(rng() % grid.dimensions().x(), rng() % grid.dimensions().y(),
+                                rng() % grid.dimensions().z());
+        const bool value = rng() % 2 == 0;
+        svo.set(p, value);
+        edited.set(p.x(), p.y(), p.z(), value);
+    }
+    reader.join();
+    EXPECT_EQ(mismatches, 0u);
+    expect_same(edited, svo);
+
+    const std::string file = "svo_edit_test.bin";
+    ASSERT_TRUE(svo.save(file));
+    SVOStorage loaded;
+    ASSERT_TRUE(loaded.load(file));
+    std::remove(file.c_str());
+    expect_same(edited, loaded);
+}
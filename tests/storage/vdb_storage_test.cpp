@@ -0,0 +1,263 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <storage/vdb_tree_storage.hpp>
+#include <storage/flat_vdb_storage.hpp>
+#include "storage_test_helpers.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+using namespace VXZ;
+using VXZ::test::expect_same;
+
+namespace {
+
+// Solid floor, a sphere and scattered points in a non-cubic grid
+VoxelGrid make_scene() {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(299.0f, 170.0f, 140.0f));
+    test::fill_floor(grid, 16);
+    test::add_sphere(grid, Eigen::Vector3f(150.0f, 80.0f, 70.0f), 28.0f);
+    std::mt19937 rng(11);
+    test::add_noise(grid, rng, 500);
+    return grid;
+}
+
+} // namespace
+
+TEST(VDBTreeStorageTest, QueriesMatchGrid) {
+    const VoxelGrid grid = make_scene();
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+    expect_same(grid, vdb);
+    EXPECT_THROW(vdb.get(-1, 0, 0), std::out_of_range);
+    EXPECT_THROW(vdb.get(grid.dimensions()), std::out_of_range);
+
+    VoxelGrid restored(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f::Ones());
+    ASSERT_TRUE(vdb.to_voxel_grid(restored));
+    ASSERT_EQ(restored.dimensions(), grid.dimensions());
+    expect_same(grid, restored);
+}
+
+TEST(VDBTreeStorageTest, UniformBlocksBecomeTiles) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(255.0f, 255.0f, 255.0f));
+    // One full, aligned 128^3 block and one full 8^3 leaf
+    for (int z = 128; z < 256; ++z)
+        for (int y = 0; y < 128; ++y)
+            grid.set_span(y, z, 128, 256);
+    for (int z = 8; z < 16; ++z)
+        for (int y = 0; y < 8; ++y)
+            grid.set_span(y, z, 16, 24);
+
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+    EXPECT_EQ(vdb.upper_count(), 1u);
+    EXPECT_EQ(vdb.lower_count(), 1u);
+    EXPECT_EQ(vdb.leaf_count(), 0u);
+    EXPECT_TRUE(vdb.get(200, 100, 200));
+    EXPECT_TRUE(vdb.get(20, 4, 12));
+    EXPECT_FALSE(vdb.get(20, 4, 16));
+    EXPECT_TRUE(vdb.any_in_box(Eigen::Vector3i(120, 120, 120), Eigen::Vector3i(128, 128, 128)));
+    EXPECT_FALSE(vdb.any_in_box(Eigen::Vector3i(0, 128, 0), Eigen::Vector3i(255, 255, 127)));
+}
+
+TEST(VDBTreeStorageTest, TilesAndLeavesBuildTheSameTree) {
+    const VoxelGrid grid = make_scene();
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+    std::vector<VDBTile> tiles;
+    std::vector<VDBLeafEntry> leaves;
+    VDBTreeView view;
+    auto on_tile = [&](const Eigen::Vector3i& origin, int size) { tiles.push_back(VDBTile{origin, size}); };
+    auto on_leaf = [&](const Eigen::Vector3i& origin, const VDBLeaf& leaf) {
+        leaves.push_back(VDBLeafEntry{origin, leaf});
+    };
+    const std::vector<uint64_t> flat = vdb.flatten();
+    ASSERT_TRUE(view.attach(flat.data(), flat.size() * sizeof(uint64_t)));
+    view.visit(on_tile, on_leaf);
+    ASSERT_FALSE(tiles.empty());
+
+    VDBTreeStorage built;
+    ASSERT_TRUE(built.from_nodes(grid.resolution(), grid.min_bounds(), grid.dimensions(), tiles, leaves));
+    EXPECT_EQ(built.upper_count(), vdb.upper_count());
+    EXPECT_EQ(built.lower_count(), vdb.lower_count());
+    EXPECT_EQ(built.leaf_count(), vdb.leaf_count());
+    expect_same(grid, built);
+
+    // A whole upper block of tiles, a leaf under a tile, and a full leaf
+    VDBLeaf full;
+    std::memset(&full, 0xFF, sizeof(full));
+    VDBLeaf sparse = VDBLeaf();
+    sparse.words[0] = 1;
+    const Eigen::Vector3i far(VDBTreeView::kUpperDim, 0, 0);
+    VDBTreeStorage big;
+    ASSERT_TRUE(big.from_nodes(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3i(2 * VDBTreeView::kUpperDim, 8, 8),
+                               {VDBTile{Eigen::Vector3i::Zero(), VDBTreeView::kUpperDim},
+                                VDBTile{far, VDBTreeView::kLowerDim}},
+                               {VDBLeafEntry{Eigen::Vector3i(8, 0, 0), sparse},
+                                VDBLeafEntry{far + Eigen::Vector3i(128, 0, 0), full},
+                                VDBLeafEntry{far + Eigen::Vector3i(136, 0, 0), sparse}}));
+    EXPECT_EQ(big.upper_count(), 2u);
+    EXPECT_EQ(big.lower_count(), 1u);
+    EXPECT_EQ(big.leaf_count(), 1u);
+    EXPECT_TRUE(big.get(4000, 7, 7));
+    EXPECT_TRUE(big.get(far + Eigen::Vector3i(127, 7, 7)));
+    EXPECT_TRUE(big.get(far + Eigen::Vector3i(135, 7, 7)));
+    EXPECT_TRUE(big.get(far + Eigen::Vector3i(136, 0, 0)));
+    EXPECT_FALSE(big.get(far + Eigen::Vector3i(137, 0, 0)));
+    EXPECT_FALSE(big.get(far + Eigen::Vector3i(144, 0, 0)));
+
+    EXPECT_FALSE(big.from_nodes(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3i::Constant(64),
+                                {VDBTile{Eigen::Vector3i(4, 0, 0), VDBTreeView::kLeafDim}}, {}));
+    EXPECT_FALSE(big.from_nodes(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3i::Constant(64),
+                                {}, {VDBLeafEntry{Eigen::Vector3i(-8, 0, 0), sparse}}));
+}
+
+TEST(VDBTreeStorageTest, SparseSceneIsSmallerThanDense) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f::Zero(), Eigen::Vector3f(511.0f, 511.0f, 511.0f));
+    for (int i = 0; i < 512; i += 7) {
+        grid.set(i, i, i, true);
+    }
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+    const size_t dense_bytes = grid.dimensions().prod() / 8;
+    EXPECT_LT(vdb.get_size() * 20, dense_bytes);
+}
+
+TEST(VDBTreeStorageTest, SaveLoadRoundTrip) {
+    const VoxelGrid grid = make_scene();
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+
+    const std::string filename = "vdb_storage_test.vxnv";
+    ASSERT_TRUE(vdb.save(filename));
+    VDBTreeStorage loaded;
+    ASSERT_TRUE(loaded.load(filename));
+    std::remove(filename.c_str());
+    EXPECT_EQ(loaded.dimensions(), grid.dimensions());
+    expect_same(grid, loaded);
+}
+
+TEST(VDBTreeStorageTest, RejectsTruncatedFiles) {
+    const VoxelGrid grid = make_scene();
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+    const std::string filename = "vdb_storage_truncated.vxnv";
+    ASSERT_TRUE(vdb.save(filename));
+    std::string bytes;
+    {
+        std::ifstream ifs(filename, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    auto load_modified = [&](const std::string& modified) {
+        {
+            std::ofstream ofs(filename, std::ios::binary);
+            ofs.write(modified.data(), modified.size());
+        }
+        VDBTreeStorage loaded;
+        return loaded.load(filename);
+    };
+
+    // A header claiming far more nodes than the file holds fails before allocating
+    VDBHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    header.upper_count = uint64_t(1) << 30;
+    std::string huge(reinterpret_cast<const char*>(&header), sizeof(header));
+    huge.resize(100 + sizeof(header));
+    EXPECT_FALSE(load_modified(huge));
+    // Cut inside the header and inside the leaves
+    EXPECT_FALSE(load_modified(bytes.substr(0, sizeof(VDBHeader) / 2)));
+    EXPECT_FALSE(load_modified(bytes.substr(0, bytes.size() - 1)));
+    std::remove(filename.c_str());
+}
+
+TEST(FlatVDBStorageTest, MappedFileIsQueriedInPlace) {
+    const VoxelGrid grid = make_scene();
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+    const std::string filename = "flat_vdb_storage_test.vxnv";
+    ASSERT_TRUE(vdb.save(filename));
+
+    FlatVDBStorage mapped;
+    ASSERT_TRUE(mapped.map(filename));
+    EXPECT_TRUE(mapped.is_mapped());
+    expect_same(grid, mapped);
+
+    FlatVDBStorage loaded;
+    ASSERT_TRUE(loaded.load(filename));
+    EXPECT_FALSE(loaded.is_mapped());
+    expect_same(grid, loaded);
+    std::remove(filename.c_str());
+
+    Eigen::Vector3i hit;
+    ASSERT_TRUE(mapped.raycast(Eigen::Vector3f(150.5f, 80.5f, 139.5f), Eigen::Vector3f(0.0f, 0.0f, -1.0f), 200.0f, hit));
+    EXPECT_TRUE(grid.get(hit.x(), hit.y(), hit.z()));
+    EXPECT_GT(hit.z(), 70);
+}
+
+TEST(FlatVDBStorageTest, RejectsInvalidFiles) {
+    const std::string filename = "flat_vdb_invalid.vxnv";
+    {
+        std::FILE* f = std::fopen(filename.c_str(), "wb");
+        const char junk[128] = "not a vdb file";
+        std::fwrite(junk, 1, sizeof(junk), f);
+        std::fclose(f);
+    }
+    FlatVDBStorage storage;
+    EXPECT_FALSE(storage.map(filename));
+    EXPECT_FALSE(storage.load(filename));
+    EXPECT_FALSE(storage.map("does_not_exist.vxnv"));
+    std::remove(filename.c_str());
+}
+
+TEST(FlatVDBStorageTest, RejectsCorruptIndices) {
+    const VoxelGrid grid = make_scene();
+    VDBTreeStorage vdb;
+    ASSERT_TRUE(vdb.from_voxel_grid(grid));
+    ASSERT_GT(vdb.lower_count(), 0u);
+    const std::string filename = "flat_vdb_corrupt.vxnv";
+    ASSERT_TRUE(vdb.save(filename));
+    std::string bytes;
+    {
+        std::ifstream ifs(filename, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    VDBHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const size_t roots_at = sizeof(VDBHeader);
+    const size_t uppers_at = roots_at + header.root_count * sizeof(VDBRootEntry);
+    const size_t lowers_at = uppers_at + header.upper_count * sizeof(VDBUpperNode);
+
+    // Every reader must reject the file
+    auto accepted = [&](const std::string& modified) {
+        {
+            std::ofstream ofs(filename, std::ios::binary);
+            ofs.write(modified.data(), modified.size());
+        }
+        FlatVDBStorage mapped, loaded;
+        VDBTreeStorage tree;
+        const bool map_ok = mapped.map(filename), load_ok = loaded.load(filename), tree_ok = tree.load(filename);
+        EXPECT_EQ(map_ok, load_ok);
+        EXPECT_EQ(map_ok, tree_ok);
+        return map_ok || load_ok || tree_ok;
+    };
+    auto patch = [&](size_t at, uint32_t value) {
+        std::string modified = bytes;
+        std::memcpy(&modified[at], &value, sizeof(value));
+        return modified;
+    };
+
+    EXPECT_TRUE(accepted(bytes));
+    // Root entry past the upper nodes
+    EXPECT_FALSE(accepted(patch(roots_at + offsetof(VDBRootEntry, upper), 0xFFFF0000u)));
+    // Children past the lower nodes and past the leaves
+    EXPECT_FALSE(accepted(patch(uppers_at + offsetof(VDBUpperNode, first_child), 0xFFFF0000u)));
+    EXPECT_FALSE(accepted(patch(lowers_at + offsetof(VDBLowerNode, first_child), static_cast<uint32_t>(header.leaf_count))));
+    // A prefix table that skips children
+    EXPECT_FALSE(accepted(patch(lowers_at + offsetof(VDBLowerNode, prefix) + 4 * sizeof(uint32_t), 0xFFFF0000u)));
+    // An upper node moved off its root key
+    EXPECT_FALSE(accepted(patch(uppers_at + offsetof(VDBUpperNode, origin), static_cast<uint32_t>(-VDBTreeView::kUpperDim))));
+    std::remove(filename.c_str());
+}
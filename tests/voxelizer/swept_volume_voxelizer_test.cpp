@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <voxelizer/swept_volume_voxelizer.hpp>
+#include <voxelizer/tube_voxelizer.hpp>
+#include <cmath>
+#include <vector>
+
+using namespace VXZ;
+
+namespace {
+
+VoxelGrid make_grid() {
+    return VoxelGrid(0.25f, Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(16.0f, 12.0f, 8.0f));
+}
+
+bool inside_box(const Eigen::Vector3f& p, const Eigen::Vector3f& center,
+                const Eigen::Quaternionf& q, const Eigen::Vector3f& half_extents) {
+    Eigen::Vector3f local = q.conjugate() * (p - center);
+    return (local.cwiseAbs().array() <= half_extents.array()).all();
+}
+
+// Every voxel of reference must be set in result, and every voxel of result
+// must be within one voxel of reference
+void expect_conservative(const VoxelGrid& reference, const VoxelGrid& result) {
+    const Eigen::Vector3i dims = reference.dimensions();
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                if (reference.get(x, y, z)) {
+                    ASSERT_TRUE(result.get(x, y, z)) << "gap at " << x << " " << y << " " << z;
+                }
+                if (!result.get(x, y, z)) continue;
+                bool near = false;
+                for (int dz = -1; dz <= 1 && !near; ++dz)
+                    for (int dy = -1; dy <= 1 && !near; ++dy)
+                        for (int dx = -1; dx <= 1 && !near; ++dx) {
+                            Eigen::Vector3i n(x + dx, y + dy, z + dz);
+                            near = reference.is_valid_position(n) && reference.get(n);
+                        }
+                ASSERT_TRUE(near) << "overshoot at " << x << " " << y << " " << z;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(SweptVolumeVoxelizerTest, ConstantRadiusMatchesTube) {
+    // Segments shorter than a tube tile, so both stamp the same capsules
+    std::vector<Eigen::Vector3f> path = {
+        Eigen::Vector3f(2.0f, 2.0f, 2.0f), Eigen::Vector3f(4.0f, 4.0f, 3.0f),
+        Eigen::Vector3f(7.0f, 5.0f, 4.0f), Eigen::Vector3f(9.0f, 3.0f, 5.0f)};
+    VoxelGrid swept = make_grid();
+    VoxelGrid tube = make_grid();
+    SweptVolumeVoxelizerCPU(path, std::vector<float>(path.size(), 1.5f)).voxelize(swept);
+    TubeVoxelizerCPU(path, 1.5f).voxelize(tube);
+    EXPECT_EQ(swept.count_occupied(), tube.count_occupied());
+    for (int z = 0; z < swept.dimensions().z(); ++z)
+        for (int y = 0; y < swept.dimensions().y(); ++y)
+            for (int x = 0; x < swept.dimensions().x(); ++x)
+                ASSERT_EQ(swept.get(x, y, z), tube.get(x, y, z));
+}
+
+TEST(SweptVolumeVoxelizerTest, VariableRadiusHasNoGaps) {
+    std::vector<Eigen::Vector3f> path = {
+        Eigen::Vector3f(2.0f, 6.0f, 4.0f), Eigen::Vector3f(8.0f, 5.0f, 4.0f), Eigen::Vector3f(14.0f, 7.0f, 3.0f)};
+    std::vector<float> radii = {0.5f, 2.5f, 1.0f};
+
+    VoxelGrid reference = make_grid();
+    const int samples = 400;
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        for (int k = 0; k <= samples; ++k) {
+            float t = static_cast<float>(k) / samples;
+            Eigen::Vector3f c = path[i] + (path[i + 1] - path[i]) * t;
+            float r = radii[i] + (radii[i + 1] - radii[i]) * t;
+            for (int z = 0; z < reference.dimensions().z(); ++z)
+                for (int y = 0; y < reference.dimensions().y(); ++y)
+                    for (int x = 0; x < reference.dimensions().x(); ++x)
+                        if ((reference.grid_to_world(Eigen::Vector3i(x, y, z)) - c).norm() <= r)
+                            reference.set(x, y, z, true);
+        }
+    }
+
+    VoxelGrid swept = make_grid();
+    SweptVolumeVoxelizerCPU voxelizer(path, radii);
+    voxelizer.set_chunk_size(1);
+    voxelizer.voxelize(swept);
+    expect_conservative(reference, swept);
+}
+
+TEST(SweptVolumeVoxelizerTest, RotatingBoxHasNoGaps) {
+    const Eigen::Vector3f half_extents(3.0f, 0.5f, 1.0f);
+    std::vector<Eigen::Vector3f> path = {Eigen::Vector3f(6.0f, 6.0f, 4.0f), Eigen::Vector3f(9.0f, 6.0f, 4.0f)};
+    std::vector<Eigen::Quaternionf> orientations = {
+        Eigen::Quaternionf::Identity(),
+        Eigen::Quaternionf(Eigen::AngleAxisf(1.5f, Eigen::Vector3f::UnitZ()))};
+
+    VoxelGrid reference = make_grid();
+    const int samples = 600;
+    for (int k = 0; k <= samples; ++k) {
+        float t = static_cast<float>(k) / samples;
+        Eigen::Vector3f c = path[0] + (path[1] - path[0]) * t;
+        Eigen::Quaternionf q = orientations[0].slerp(t, orientations[1]);
+        for (int z = 0; z < reference.dimensions().z(); ++z)
+            for (int y = 0; y < reference.dimensions().y(); ++y)
+                for (int x = 0; x < reference.dimensions().x(); ++x)
+                    if (inside_box(reference.grid_to_world(Eigen::Vector3i(x, y, z)), c, q, half_extents))
+                        reference.set(x, y, z, true);
+    }
+
+    VoxelGrid swept = make_grid();
+    SweptVolumeVoxelizerCPU(path, orientations, half_extents).voxelize(swept);
+    expect_conservative(reference, swept);
+}
+
+TEST(SweptVolumeVoxelizerTest, IntersectsStopsAtObstacle) {
+    VoxelGrid map = make_grid();
+    map.set_region(Eigen::Vector3i(30, 20, 10), Eigen::Vector3i(33, 23, 20));
+
+    std::vector<Eigen::Vector3f> through = {Eigen::Vector3f(2.0f, 5.5f, 4.0f), Eigen::Vector3f(14.0f, 5.5f, 4.0f)};
+    std::vector<Eigen::Vector3f> beside = {Eigen::Vector3f(2.0f, 10.0f, 4.0f), Eigen::Vector3f(14.0f, 10.0f, 4.0f)};
+    std::vector<float> radii(2, 0.75f);
+    EXPECT_TRUE(SweptVolumeVoxelizerCPU(through, radii).intersects(map));
+    EXPECT_FALSE(SweptVolumeVoxelizerCPU(beside, radii).intersects(map));
+}
+
+TEST(SweptVolumeVoxelizerTest, BoxAlongSpline) {
+    std::vector<Eigen::Vector3f> control = {
+        Eigen::Vector3f(0.0f, 2.0f, 4.0f), Eigen::Vector3f(2.0f, 2.0f, 4.0f),
+        Eigen::Vector3f(8.0f, 8.0f, 4.0f), Eigen::Vector3f(14.0f, 8.0f, 4.0f),
+        Eigen::Vector3f(16.0f, 8.0f, 4.0f)};
+    auto voxelizer = SweptVolumeVoxelizerCPU::along_spline(control, 0, Eigen::Vector3f(1.0f, 0.5f, 0.5f), 0.05f);
+    EXPECT_EQ(voxelizer.footprint(), SweptVolumeVoxelizerCPU::Footprint::BOX);
+
+    VoxelGrid swept = make_grid();
+    voxelizer.voxelize(swept);
+    EXPECT_TRUE(swept.get(swept.world_to_grid(Eigen::Vector3f(2.0f, 2.0f, 4.0f))));
+    EXPECT_TRUE(swept.get(swept.world_to_grid(Eigen::Vector3f(14.0f, 8.0f, 4.0f))));
+    EXPECT_FALSE(swept.get(swept.world_to_grid(Eigen::Vector3f(14.0f, 2.0f, 4.0f))));
+    EXPECT_TRUE(voxelizer.intersects(swept));
+}
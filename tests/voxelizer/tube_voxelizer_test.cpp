@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <core/voxel_grid.hpp>
+#include <voxelizer/tube_voxelizer.hpp>
+#include <voxelizer/spline_voxelizer.hpp>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+using namespace VXZ;
+
+namespace {
+
+float segment_distance(const Eigen::Vector3f& p, const Eigen::Vector3f& a, const Eigen::Vector3f& b) {
+    Eigen::Vector3f ab = b - a;
+    float len2 = ab.squaredNorm();
+    float t = len2 > 0.0f ? std::max(0.0f, std::min(1.0f, (p - a).dot(ab) / len2)) : 0.0f;
+    return (p - (a + t * ab)).norm();
+}
+
+float polyline_distance(const Eigen::Vector3f& p, const std::vector<Eigen::Vector3f>& points) {
+    float best = (p - points[0]).norm();
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        best = std::min(best, segment_distance(p, points[i], points[i + 1]));
+    }
+    return best;
+}
+
+} // namespace
+
+TEST(TubeVoxelizerTest, MatchesBruteForceCapsules) {
+    // Wider than one tile in x and spanning several tiles in y and z
+    VoxelGrid grid(0.5f, Eigen::Vector3f(-1.0f, -2.0f, 0.0f), Eigen::Vector3f(70.0f, 20.0f, 12.0f));
+    std::vector<Eigen::Vector3f> points = {
+        Eigen::Vector3f(0.0f, 0.0f, 1.0f),
+        Eigen::Vector3f(40.0f, 15.0f, 6.0f),
+        Eigen::Vector3f(65.0f, 3.0f, 10.0f),
+        Eigen::Vector3f(66.0f, 3.0f, 10.0f)};
+    const float radius = 2.3f;
+
+    TubeVoxelizerCPU tube(points, radius);
+    tube.voxelize(grid);
+
+    const Eigen::Vector3i dims = grid.dimensions();
+    size_t expected_count = 0;
+    for (int z = 0; z < dims.z(); ++z) {
+        for (int y = 0; y < dims.y(); ++y) {
+            for (int x = 0; x < dims.x(); ++x) {
+                float d = polyline_distance(grid.grid_to_world(Eigen::Vector3i(x, y, z)), points);
+                // Leave a small band for float rounding at the surface
+                if (d < radius - 1e-3f) {
+                    ASSERT_TRUE(grid.get(x, y, z)) << x << " " << y << " " << z;
+                } else if (d > radius + 1e-3f) {
+                    ASSERT_FALSE(grid.get(x, y, z)) << x << " " << y << " " << z;
+                }
+                expected_count += d <= radius ? 1 : 0;
+            }
+        }
+    }
+    EXPECT_NEAR(static_cast<double>(grid.count_occupied()), static_cast<double>(expected_count), 10.0);
+}
+
+TEST(TubeVoxelizerTest, SinglePointIsSphere) {
+    VoxelGrid grid(1.0f, Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(10.0f, 10.0f, 10.0f));
+    TubeVoxelizerCPU tube({Eigen::Vector3f(5.0f, 5.0f, 5.0f)}, 1.0f);
+    tube.voxelize(grid);
+    EXPECT_EQ(grid.count_occupied(), 7u);
+    EXPECT_TRUE(grid.get(5, 5, 5));
+    EXPECT_TRUE(grid.get(4, 5, 5));
+    EXPECT_FALSE(grid.get(4, 4, 5));
+}
+
+TEST(SplineVoxelizerTest, FlattenIsAdaptive) {
+    // Collinear control points flatten to a single chord
+    std::vector<Eigen::Vector3f> straight;
+    for (int i = 0; i < 6; ++i) straight.emplace_back(static_cast<float>(i), 0.0f, 0.0f);
+    SplineVoxelizerCPU line(straight, 1.0f, 0);
+    EXPECT_EQ(line.flatten(0.01f).size(), 4u);
+
+    std::vector<Eigen::Vector3f> bent = {
+        Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(10.0f, 0.0f, 0.0f),
+        Eigen::Vector3f(10.0f, 10.0f, 0.0f), Eigen::Vector3f(0.0f, 10.0f, 5.0f)};
+    SplineVoxelizerCPU curve(bent, 1.0f, 2);
+    auto coarse = curve.flatten(0.5f);
+    auto fine = curve.flatten(0.01f);
+    EXPECT_GT(fine.size(), coarse.size());
+    EXPECT_TRUE(fine.front().isApprox(bent.front()));
+    EXPECT_TRUE(fine.back().isApprox(bent.back()));
+}
+
+TEST(SplineVoxelizerTest, TubeFollowsCurve) {
+    std::vector<Eigen::Vector3f> control = {
+        Eigen::Vector3f(2.0f, 2.0f, 2.0f), Eigen::Vector3f(5.0f, 3.0f, 4.0f),
+        Eigen::Vector3f(12.0f, 14.0f, 6.0f), Eigen::Vector3f(18.0f, 6.0f, 8.0f),
+        Eigen::Vector3f(20.0f, 18.0f, 10.0f)};
+    const float radius = 1.5f;
+    const int samples_per_segment = 256;
+
+    // Catmull-Rom, B-spline and Bezier each go through their own Bezier conversion
+    for (int spline_type = 0; spline_type < 3; ++spline_type) {
+        VoxelGrid grid(0.25f, Eigen::Vector3f(0.0f, 0.0f, 0.0f), Eigen::Vector3f(22.0f, 20.0f, 12.0f));
+        SplineVoxelizerCPU spline(control, radius, spline_type);
+        spline.voxelize(grid);
+
+        // Reference polylines sampled directly from each segment, independent of flatten
+        std::vector<std::vector<Eigen::Vector3f>> reference;
+        for (int segment = 0; segment + 3 < static_cast<int>(control.size()); ++segment) {
+            reference.emplace_back();
+            for (int i = 0; i <= samples_per_segment; ++i) {
+                reference.back().push_back(spline.evaluate_spline(
+                    static_cast<float>(i) / samples_per_segment, segment));
+            }
+        }
+
+        const float tolerance = 0.25f * grid.resolution() + 0.002f;
+        const Eigen::Vector3i dims = grid.dimensions();
+        for (int z = 0; z < dims.z(); ++z) {
+            for (int y = 0; y < dims.y(); ++y) {
+                for (int x = 0; x < dims.x(); ++x) {
+                    const Eigen::Vector3f p = grid.grid_to_world(Eigen::Vector3i(x, y, z));
+                    float d = std::numeric_limits<float>::max();
+                    for (const auto& polyline : reference) {
+                        d = std::min(d, polyline_distance(p, polyline));
+                    }
+                    if (d < radius - tolerance) {
+                        ASSERT_TRUE(grid.get(x, y, z)) << spline_type;
+                    } else if (d > radius + tolerance) {
+                        ASSERT_FALSE(grid.get(x, y, z)) << spline_type;
+                    }
+                }
+            }
+        }
+    }
+}